@@ -11,10 +11,8 @@
 
 #include "DirectXTexP.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#pragma warning(disable : 4616 6993)
-#endif
+#include <atomic>
+#include <vector>
 
 #include "BC.h"
 
@@ -69,12 +67,16 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    HRESULT CompressBC(
+    // Compresses block rows [firstBlockRow, lastBlockRow) of an image. Each block row only
+    // reads its own 4 scanlines and writes its own row of blocks, so ranges are independent.
+    HRESULT CompressBCRows(
         const Image& image,
         const Image& result,
         uint32_t bcflags,
         TEX_FILTER_FLAGS srgb,
-        float threshold) noexcept
+        float threshold,
+        size_t firstBlockRow,
+        size_t lastBlockRow) noexcept
     {
         if (!image.pixels || !result.pixels)
             return E_POINTER;
@@ -106,10 +108,12 @@ namespace
             return HRESULT_E_NOT_SUPPORTED;
 
         XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-        const uint8_t *pSrc = image.pixels;
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
         const size_t rowPitch = image.rowPitch;
-        for (size_t h = 0; h < image.height; h += 4)
+        const uint8_t *pSrc = image.pixels + firstBlockRow * 4 * rowPitch;
+        const uint8_t *pEnd = image.pixels + image.slicePitch;
+        pDest += firstBlockRow * result.rowPitch;
+        const size_t endHeight = std::min<size_t>(image.height, lastBlockRow * 4);
+        for (size_t h = firstBlockRow * 4; h < endHeight; h += 4)
         {
             const uint8_t *sptr = pSrc;
             uint8_t* dptr = pDest;
@@ -197,137 +201,108 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-#ifdef _OPENMP
-    HRESULT CompressBC_Parallel(
+    inline size_t GetBlockRowCount(const Image& image) noexcept
+    {
+        return std::max<size_t>(1, (image.height + 3) / 4);
+    }
+
+    HRESULT CompressBC(
         const Image& image,
         const Image& result,
         uint32_t bcflags,
         TEX_FILTER_FLAGS srgb,
         float threshold) noexcept
     {
-        if (!image.pixels || !result.pixels)
-            return E_POINTER;
+        return CompressBCRows(image, result, bcflags, srgb, threshold, 0, GetBlockRowCount(image));
+    }
 
-        assert(image.width == result.width);
-        assert(image.height == result.height);
 
-        const DXGI_FORMAT format = image.format;
-        size_t sbpp = BitsPerPixel(format);
-        if (!sbpp)
-            return E_FAIL;
+    //-------------------------------------------------------------------------------------
+    // Multi-threaded compression using std::thread (no OpenMP dependency).
+    // The block rows of all images are handed out to the workers a few rows at a time.
+    // Every block row is encoded by exactly the same code as the serial path and written
+    // to its own location, so the output is byte-identical to CompressBC regardless of
+    // thread count or scheduling.
+    HRESULT CompressBC_Parallel(
+        const Image* images,
+        const Image* results,
+        size_t nimages,
+        uint32_t bcflags,
+        TEX_FILTER_FLAGS srgb,
+        float threshold) noexcept
+    {
+        constexpr size_t c_RowsPerTask = 4;
 
-        if (sbpp < 8)
+        // Task ranges: image i owns tasks [taskStart[i], taskStart[i + 1])
+        std::vector<size_t> taskStart;
+        try
         {
-            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-            return HRESULT_E_NOT_SUPPORTED;
+            taskStart.resize(nimages + 1);
         }
-
-        // Round to bytes
-        sbpp = (sbpp + 7) / 8;
-
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
-
-        // Determine BC format encoder
-        BC_ENCODE pfEncode;
-        size_t blocksize;
-        TEX_FILTER_FLAGS cflags;
-        if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
-            return HRESULT_E_NOT_SUPPORTED;
-
-        // Refactored version of loop to support parallel independance
-        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
-
-        bool fail = false;
-
-    #pragma omp parallel for
-        for (int nb = 0; nb < static_cast<int>(nBlocks); ++nb)
+        catch (...)
         {
-            const int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
-
-            int y = nb / nbWidth;
-            const int x = (nb - (y*nbWidth)) * 4;
-            y *= 4;
-
-            assert((x >= 0) && (x < int(image.width)));
-            assert((y >= 0) && (y < int(image.height)));
-
-            const size_t rowPitch = image.rowPitch;
-            const uint8_t *pSrc = image.pixels + (size_t(y)*rowPitch) + (size_t(x)*sbpp);
-
-            uint8_t *pDest = result.pixels + (size_t(nb)*blocksize);
-
-            const size_t ph = std::min<size_t>(4, image.height - size_t(y));
-            const size_t pw = std::min<size_t>(4, image.width - size_t(x));
-            assert(pw > 0 && ph > 0);
-
-            const ptrdiff_t bytesLeft = pEnd - pSrc;
-            assert(bytesLeft > 0);
-            size_t bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft));
+            return E_OUTOFMEMORY;
+        }
+        taskStart[0] = 0;
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            if (!images[index].pixels || !results[index].pixels)
+                return E_POINTER;
 
-            XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-            if (!LoadScanline(&temp[0], pw, pSrc, bytesToRead, format))
-                fail = true;
+            const size_t tasks = (GetBlockRowCount(images[index]) + c_RowsPerTask - 1) / c_RowsPerTask;
+            taskStart[index + 1] = taskStart[index] + tasks;
+        }
+        const size_t taskCount = taskStart[nimages];
 
-            if (ph > 1)
+        std::atomic<size_t> nextTask(0);
+        std::atomic<HRESULT> failure(S_OK);
+        auto worker = [&]() noexcept
+        {
+            size_t index = 0;
+            for (;;)
             {
-                bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch);
-                if (!LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, format))
-                    fail = true;
+                const size_t task = nextTask.fetch_add(1);
+                if (task >= taskCount || FAILED(failure.load()))
+                    break;
 
-                if (ph > 2)
-                {
-                    bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 2);
-                    if (!LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
-                        fail = true;
+                // Tasks are handed out in increasing order, so the image index only moves forward
+                while (task >= taskStart[index + 1])
+                    ++index;
 
-                    if (ph > 3)
-                    {
-                        bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 3);
-                        if (!LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
-                            fail = true;
-                    }
+                const size_t firstBlockRow = (task - taskStart[index]) * c_RowsPerTask;
+                const size_t lastBlockRow = std::min<size_t>(firstBlockRow + c_RowsPerTask, GetBlockRowCount(images[index]));
+                const HRESULT hr = CompressBCRows(images[index], results[index], bcflags, srgb, threshold, firstBlockRow, lastBlockRow);
+                if (FAILED(hr))
+                {
+                    HRESULT expected = S_OK;
+                    failure.compare_exchange_strong(expected, hr);
                 }
             }
+        };
 
-            if (pw != 4 || ph != 4)
+        const size_t threadCount = std::min<size_t>(std::max<unsigned int>(1, std::thread::hardware_concurrency()), taskCount);
+        std::vector<std::thread> threads;
+        if (threadCount > 1)
+        {
+            try
             {
-                // Replicate pixels for partial block
-                static const size_t uSrc[] = { 0, 0, 0, 1 };
-
-                if (pw < 4)
-                {
-                    for (size_t t = 0; t < ph && t < 4; ++t)
-                    {
-                        for (size_t s = pw; s < 4; ++s)
-                        {
-                            temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
-                        }
-                    }
-                }
-
-                if (ph < 4)
-                {
-                    for (size_t t = ph; t < 4; ++t)
-                    {
-                        for (size_t s = 0; s < 4; ++s)
-                        {
-                            temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
-                        }
-                    }
-                }
+                threads.reserve(threadCount - 1);
+                for (size_t t = 1; t < threadCount; ++t)
+                    threads.emplace_back(worker);
+            }
+            catch (...)
+            {
+                // Run with however many threads were started (the calling thread always works)
             }
+        }
 
-            ConvertScanline(temp, 16, result.format, format, cflags | srgb);
+        worker();
 
-            if (pfEncode)
-                pfEncode(pDest, temp, bcflags);
-            else
-                D3DXEncodeBC1(pDest, temp, threshold, bcflags);
-        }
+        for (auto& thread : threads)
+            thread.join();
 
-        return (fail) ? E_FAIL : S_OK;
+        return failure.load();
     }
-#endif // _OPENMP
 
 
     //-------------------------------------------------------------------------------------
@@ -615,11 +590,7 @@ HRESULT DirectX::Compress(
     // Compress single image
     if (compress & TEX_COMPRESS_PARALLEL)
     {
-    #ifndef _OPENMP
-        return E_NOTIMPL;
-    #else
-        hr = CompressBC_Parallel(srcImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-    #endif // _OPENMP
+        hr = CompressBC_Parallel(&srcImage, img, 1, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
     }
     else
     {
@@ -684,26 +655,23 @@ HRESULT DirectX::Compress(
             cImages.Release();
             return E_FAIL;
         }
+    }
 
-        if ((compress & TEX_COMPRESS_PARALLEL))
+    if (compress & TEX_COMPRESS_PARALLEL)
+    {
+        // All images (mips, array slices) are compressed in one parallel pass
+        hr = CompressBC_Parallel(srcImages, dest, nimages, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
+        if (FAILED(hr))
         {
-        #ifndef _OPENMP
-            return E_NOTIMPL;
-        #else
-            if (compress & TEX_COMPRESS_PARALLEL)
-            {
-                hr = CompressBC_Parallel(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-                if (FAILED(hr))
-                {
-                    cImages.Release();
-                    return  hr;
-                }
-            }
-        #endif // _OPENMP
+            cImages.Release();
+            return hr;
         }
-        else
+    }
+    else
+    {
+        for (size_t index = 0; index < nimages; ++index)
         {
-            hr = CompressBC(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold);
+            hr = CompressBC(srcImages[index], dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold);
             if (FAILED(hr))
             {
                 cImages.Release();
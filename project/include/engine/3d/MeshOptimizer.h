@@ -0,0 +1,65 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine/3d/ModelData.h"
+#include "engine/base/SelfTest.h"
+
+// GPUに送る前のインデックス・頂点の並べ替え（CPUのみ、GPU不要）
+//   1. 頂点キャッシュ最適化（Forsyth方式で三角形の順番を並べ替える）
+//   2. オーバードロー最適化（キャッシュの切れ目でクラスタに分け、外向きのものから描く）
+//   3. 頂点フェッチ最適化（頂点をインデックスで最初に使われる順に並べ直す）
+// 三角形の巻き順は変えない
+
+// 頂点キャッシュのシミュレーション方式
+enum class VertexCacheModel {
+	Fifo, // 多くのGPUのポストトランスフォームキャッシュ
+	Lru,
+};
+
+struct VertexCacheStats {
+	float acmr = 0.0f; // 三角形あたりの頂点シェーダ実行数（理想は0.5付近、最悪3.0）
+	float atvr = 0.0f; // 頂点あたりの頂点シェーダ実行数（理想は1.0）
+	size_t shadedVertexCount = 0;
+};
+
+struct MeshOptimizeReport {
+	VertexCacheStats fifoBefore;
+	VertexCacheStats fifoAfter;
+	VertexCacheStats lruBefore;
+	VertexCacheStats lruAfter;
+};
+
+// 統計に使うキャッシュサイズ
+constexpr uint32_t kFifoCacheSize = 16;
+constexpr uint32_t kLruCacheSize = 32;
+
+// キャッシュをシミュレーションしてACMR/ATVRを求める
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	VertexCacheModel model, uint32_t cacheSize);
+
+// 三角形の順番を頂点キャッシュに合わせて並べ替える
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// 頂点キャッシュの効率をthreshold倍まで悪化させてよい範囲で、外側を向いた面から描くように並べ替える
+// OptimizeVertexCacheの後に呼ぶ
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VertexData>& vertices, float threshold = 1.05f);
+
+// 頂点を最初に参照される順に並べ直し、インデックスを付け替える（未使用の頂点は削除）
+void OptimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices);
+
+// 上の3つを順に行い、前後の統計を返す
+MeshOptimizeReport OptimizeMesh(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices);
+MeshOptimizeReport OptimizeMesh(ModelData& model);
+MeshOptimizeReport OptimizeMesh(Mesh& mesh);
+
+// OptimizeMeshの結果を確かめる（-testmesh）
+// ・三角形の集まり（重複の数も含めて）と各三角形の巻き順が変わらない（頂点の中身で比べる）
+// ・FIFO/LRUのACMRが悪くならない。三角形の順番を混ぜた入力では良くなる
+std::vector<SelfTestResult> RunMeshOptimizerSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices);
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,56 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine/3d/ModelData.h"
+#include "engine/base/SelfTest.h"
+
+// Quadric Error Metrics による辺縮約でメッシュを簡略化し、LODを作る
+// 頂点は元の頂点バッファをそのまま使い、LODごとにインデックスだけを作る
+// ・穴の縁（境界）や非多様体の頂点は動かさない
+// ・UVや法線の継ぎ目（同じ位置で属性が違う頂点）は継ぎ目に沿ってのみ縮約する
+
+struct LodSettings {
+	uint32_t maxLevels = 4;     // LOD0を含む最大レベル数
+	float triangleRatio = 0.5f; // 1つ前のレベルに対する三角形数の比
+	float maxError = 0.1f;      // 許容誤差（メッシュの大きさに対する比）
+};
+
+// 1レベル分の簡略化結果
+struct LodLevel {
+	std::vector<uint32_t> indices;
+	float error; // 元メッシュからのずれ（モデル空間の距離）
+};
+
+// 目標インデックス数か目標誤差（メッシュの大きさに対する比）に達するまで簡略化する
+// outErrorには実際の誤差（元の頂点から簡略化した面までの距離の上限。モデル空間）が入る
+std::vector<uint32_t> SimplifyMesh(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float targetError, float* outError = nullptr);
+
+// LOD0（元のインデックス）から順に、triangleRatioずつ減らしたレベルを作る
+// 三角形がほとんど減らなくなるか、誤差がmaxErrorを超えたら打ち切る
+// 各レベルの誤差は、元のメッシュの全ての頂点からそのレベルの面までの距離の上限を測り直したもの
+std::vector<LodLevel> GenerateLodChain(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	const LodSettings& settings = LodSettings());
+
+// LODを作ってindicesの後ろに連結し、lodsに各レベルの範囲を書き込む
+void BuildLods(ModelData& model, const LodSettings& settings = LodSettings());
+void BuildLods(Mesh& mesh, const LodSettings& settings = LodSettings());
+
+// 画面上での誤差がpixelThreshold以下になる最も粗いLODを選ぶ
+// distanceはカメラからの距離、fovYは縦の画角（ラジアン）、viewportHeightは画面の高さ（ピクセル）
+uint32_t SelectLod(const MeshLod* lods, uint32_t lodCount, float distance, float fovY, float viewportHeight,
+	float pixelThreshold = 1.0f);
+
+// 既定の設定でLODを作り、結果を確かめる（-testmesh）
+// ・2レベル以上でき、レベルごとに三角形が減り、最後のレベルは元の半分以下
+// ・記録した誤差が単調増加でmaxError以内。元の全ての頂点からLODの面までの距離がそのレベルの誤差以内
+// ・インデックスが範囲内で、つぶれた三角形が無い
+// ・SelectLodが距離に対して単調で、選んだレベルの誤差が1ピクセル以内
+std::vector<SelfTestResult> RunLodSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices);
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,79 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine/3d/ModelData.h"
+#include "engine/base/SelfTest.h"
+
+// メッシュを頂点数・三角形数に上限のある小さなクラスタ（メッシュレット）に分割する
+// クラスタ単位のカリングやメッシュシェーダ向けの入力になる
+// CPUのみで動き、同じ入力からは常に同じ結果になる
+
+// メッシュシェーダでよく使われる上限
+constexpr uint32_t kDefaultMeshletMaxVertices = 64;
+constexpr uint32_t kDefaultMeshletMaxTriangles = 124;
+// ローカルインデックスをuint8_tで持つので頂点数は256まで
+constexpr uint32_t kMeshletVertexLimit = 256;
+
+struct Meshlet {
+	uint32_t vertexOffset;   // MeshletData::vertices 内の開始位置
+	uint32_t triangleOffset; // MeshletData::triangles 内の開始位置（バイト単位、3バイトで1三角形）
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+// カリング用の境界情報
+struct MeshletBounds {
+	Vector3 center; // 境界球
+	float radius;
+	// 法線コーン（三角形の表向き = cross(p1 - p0, p2 - p0) の向き。D3Dの時計回りが表）
+	Vector3 coneApex;
+	Vector3 coneAxis;
+	float coneCutoff; // sin(広がり角)。1ならコーンでは判定できない
+};
+
+struct MeshletData {
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices; // メッシュレット内の頂点 → 元メッシュの頂点番号
+	std::vector<uint8_t> triangles; // メッシュレット内のローカルインデックス
+	std::vector<MeshletBounds> bounds;
+};
+
+// 三角形を隣接関係に沿って貪欲に詰めていく
+MeshletData BuildMeshlets(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	uint32_t maxVertices = kDefaultMeshletMaxVertices, uint32_t maxTriangles = kDefaultMeshletMaxTriangles);
+MeshletData BuildMeshlets(const Mesh& mesh,
+	uint32_t maxVertices = kDefaultMeshletMaxVertices, uint32_t maxTriangles = kDefaultMeshletMaxTriangles);
+
+// 1つのメッシュレットの境界球と法線コーンを求める
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, const std::vector<VertexData>& vertices);
+
+// カメラから全ての三角形が裏向きに見えるならtrue（描画を省ける）
+bool IsMeshletBackfacing(const MeshletBounds& bounds, const Vector3& cameraPosition);
+
+// メッシュレット生成の速度計測の結果（1つの入力分）
+struct MeshletBenchmarkResult {
+	uint32_t gridSize = 0;       // gridSize x gridSize の四角形を2つずつの三角形に分けた格子
+	size_t triangleCount = 0;
+	size_t meshletCount = 0;
+	double milliseconds = 0.0;   // 3回作ったうちの最速
+	double trianglesPerSecond = 0.0;
+	bool valid = true;           // 全ての三角形がちょうど1回ずつメッシュレットに入ったか（数で確かめる）
+};
+
+// 約50万・200万・450万三角形の格子を既定の上限でメッシュレットに分け、1秒あたりの三角形数を測る（-benchmeshlet）
+std::vector<MeshletBenchmarkResult> RunMeshletBenchmark();
+
+// 上限の組み合わせを変えてメッシュレットを作り、結果を確かめる（-testmesh）
+// ・全ての三角形がちょうど1回ずつ（頂点の順番もそのまま）入っている
+// ・頂点数・三角形数が上限以内で、ローカルインデックスが範囲内
+// ・境界球が全ての頂点を含み、法線コーンで裏向きと判定した視点からは全ての三角形が裏向き
+// ・同じ入力から同じ結果になる
+// 頂点を共有しない三角形の集まり（フラットシェーディング）に展開した入力でも同じことを確かめる
+std::vector<SelfTestResult> RunMeshletSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices);
+
+#endif // MESHLET_H
@@ -0,0 +1,57 @@
+#ifndef MODELDATA_H
+#define MODELDATA_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/math/MathTypes.h"
+
+struct VertexData {
+	Vector4 position; // 頂点の位置
+	Vector2 texcoord; // テクスチャ座標
+	Vector3 normal;   // 法線ベクトル
+};
+
+struct Material {
+	Vector4 color;
+	int32_t lightingMode;
+	float padding[3]; // 16バイトアライメント維持
+	Matrix4x4 uvTransform;
+	std::string textureFilePath; // ← これを追加！
+};
+
+struct MaterialData {
+	std::string textureFilePath;
+};
+
+// 簡略化したLODの1レベル（indices内の範囲）
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; // 元メッシュからのずれ（モデル空間の距離）
+};
+
+struct ModelData {
+	std::vector<VertexData> vertices; // 頂点データ（重複なし）
+	std::vector<uint32_t> indices; // インデックスデータ（LODがあれば全レベルを連結）
+	std::vector<MeshLod> lods; // 空ならindices全体がLOD0
+	MaterialData material; // マテリアルデータ
+	std::string materialLibrary; // mtllibで読んだファイル名（無ければ空）
+};
+
+struct Mesh {
+	std::vector<VertexData> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	std::string name;
+	std::string materialName;
+};
+
+struct MultiModelData {
+	std::vector<Mesh> meshes;
+	std::unordered_map<std::string, Material> materials;
+	std::string materialLibrary; // mtllibで読んだファイル名（無ければ空）
+};
+
+#endif // MODELDATA_H
@@ -0,0 +1,35 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ヘッドレスの自己診断（-testmesh など）の結果
+// 各モジュールのRun...SelfTest()が項目ごとに結果を返し、mainがログに出して終了コードにする
+// GPUやウィンドウを使わず、モジュールに用意した偽物のバックエンドや既存の関数との比較で確かめる
+
+struct SelfTestResult {
+	std::string name;
+	bool passed = false;
+	std::string detail; // 測った誤差や、失敗したときの内容
+};
+
+inline void AddSelfTestResult(std::vector<SelfTestResult>& results, std::string name, bool passed, std::string detail = {}) {
+	results.push_back({ std::move(name), passed, std::move(detail) });
+}
+
+inline void AppendSelfTestResults(std::vector<SelfTestResult>& results, std::vector<SelfTestResult> more) {
+	results.insert(results.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+}
+
+// detail用の数値（有効数字4桁）
+inline std::string FormatSelfTestValue(double value) {
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.4g", value);
+	return buffer;
+}
+
+#endif // SELFTEST_H
@@ -0,0 +1,47 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数のワーカースレッドでタスクを実行するスレッドプール
+class ThreadPool {
+public:
+	// threadCountが0ならハードウェアスレッド数を使う
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+	// タスクを積む（完了は待たない）
+	void Submit(std::function<void()> task);
+
+	// [0, count) の各インデックスについてfuncを並列に呼び、全て終わるまで待つ
+	// 呼び出し元スレッドも処理に参加する
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	// 積まれたタスクが全て終わるまで待つ
+	void WaitIdle();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable taskCondition_;
+	std::condition_variable idleCondition_;
+	size_t activeCount_ = 0;
+	bool stopping_ = false;
+};
+
+#endif // THREADPOOL_H
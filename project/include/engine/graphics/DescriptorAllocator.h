@@ -0,0 +1,113 @@
+#ifndef DESCRIPTORALLOCATOR_H
+#define DESCRIPTORALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <d3d12.h>
+#include "engine/base/SelfTest.h"
+
+// 1つのディスクリプタヒープを3つの範囲に分けて使うアロケータ
+//   [0, reservedCount)                     固定の場所（ImGuiのフォントなど。アロケータは触らない）
+//   [reservedCount, 一時の範囲の手前)        ずっと使うもの（テクスチャのSRVなど）。1個ずつ空きリストで管理する
+//   [capacity - 一時の範囲, capacity)        フレームごとの一時的なもの。フレームごとの区画に先頭から詰めるだけ
+// ・ずっと使う範囲は1個単位なので、いくら確保と解放を繰り返しても断片化しない
+// ・ハンドルには世代が入っていて、解放した後のハンドルは無効になる（古いハンドルで別のディスクリプタを触らない）
+// ・Freeしたものは、Retire(fenceValue)の後にGPUがそのフェンス値まで進んでから（Reclaim）再び使う
+// ・一時的な区画も同じで、Retireでそのフレームの区画を締め、GPUがそのフェンス値まで進んだら（Reclaim）空にする
+// ヒープの作成とディスクリプタの書き込みはmain側で行う（ここは番号の管理だけなので、GPU無しでも動く）
+
+struct DescriptorAllocatorDesc {
+	uint32_t capacity = 0;               // ヒープ全体のディスクリプタの数
+	uint32_t reservedCount = 0;          // 先頭の固定の場所の数
+	uint32_t transientCountPerFrame = 0; // 1フレームで使える一時的なディスクリプタの数
+	uint32_t framesInFlight = 1;         // 一時的な範囲の区画の数
+	// ヒープの先頭（GetCpuHandle・GetGpuHandleで使う）
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart{};
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart{};
+	uint32_t descriptorSize = 0;
+};
+
+struct DescriptorAllocatorStats {
+	uint32_t persistentCapacity = 0;
+	uint32_t persistentCount = 0;     // 使用中（解放待ちを含む）
+	uint32_t peakPersistentCount = 0;
+	uint32_t pendingFreeCount = 0;    // Freeされ、GPUが使い終わるのを待っているもの
+	uint32_t transientCount = 0;      // 今のフレームで使った一時的なもの
+	uint32_t peakTransientCount = 0;
+	size_t failedCount = 0;           // 空きが無くて確保できなかった回数
+};
+
+class DescriptorAllocator {
+public:
+	// 下位kIndexBitsビットがヒープ内の位置、残りが世代
+	using Handle = uint32_t;
+	static constexpr Handle kInvalidHandle = UINT32_MAX;
+	static constexpr uint32_t kIndexBits = 20;
+	static constexpr uint32_t kMaxCapacity = (1u << kIndexBits) - 1; // シェーダーから見えるヒープの上限（約100万）に合わせる
+	static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+	explicit DescriptorAllocator(const DescriptorAllocatorDesc& desc);
+
+	// ずっと使うディスクリプタを1つ確保する（空きが無ければkInvalidHandle）
+	Handle Allocate();
+	// 解放する（ハンドルはすぐに無効になるが、場所を使い回すのはGPUが使い終わってから）
+	void Free(Handle handle);
+	// ここまでのFreeと今のフレームの一時的な区画を、GPUがfenceValueまで進めば使い終わるものとして締める
+	void Retire(uint64_t fenceValue);
+	// completedFenceValueまで終わったものを空きに戻し、終わったフレームの一時的な区画を空にする
+	void Reclaim(uint64_t completedFenceValue);
+
+	bool IsValid(Handle handle) const;
+	uint32_t GetIndex(Handle handle) const;
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(Handle handle) const { return GetCpuHandleAt(GetIndex(handle)); }
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(Handle handle) const { return GetGpuHandleAt(GetIndex(handle)); }
+
+	// フレームの頭で呼び、一時的な確保をframeIndexの区画から行うようにする
+	void BeginFrame(uint32_t frameIndex);
+	// 連続したcount個の一時的なディスクリプタを確保し、先頭のヒープ内の位置を返す
+	// 区画に入らないか、区画を前に使ったフレームがまだReclaimされていなければkInvalidIndex
+	uint32_t AllocateTransient(uint32_t count);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandleAt(uint32_t index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandleAt(uint32_t index) const;
+
+	const DescriptorAllocatorStats& GetStats() const { return stats_; }
+
+private:
+	struct RetiredFrees {
+		uint64_t fenceValue = 0;
+		std::vector<uint32_t> slots;
+	};
+
+	// 一時的な範囲のフレームごとの区画
+	struct TransientFrame {
+		uint32_t offset = 0;     // 区画の先頭から使った数
+		uint64_t fenceValue = 0; // Retireしたときのフェンス値
+		bool retired = false;    // Retire済みでGPUの完了待ち（終わるまで確保しない）
+	};
+
+	DescriptorAllocatorDesc desc_;
+	uint32_t persistentBegin_ = 0;
+	uint32_t transientBegin_ = 0;
+
+	// ずっと使う範囲（persistentBegin_からの番号で管理する）
+	std::vector<uint16_t> generations_;
+	std::vector<uint8_t> alive_;
+	std::vector<uint32_t> freeSlots_;   // 後ろから使う（小さい番号から順に使われる）
+	std::vector<uint32_t> pendingFrees_; // 前回のRetire以降にFreeされたもの
+	std::deque<RetiredFrees> retired_;   // フェンス値の小さい順
+
+	// 一時的な範囲
+	std::vector<TransientFrame> transientFrames_;
+	uint32_t transientFrame_ = 0;
+
+	DescriptorAllocatorStats stats_;
+};
+
+// -testframes用。GPU無しのヒープで、ハンドルの一意さと解放後の無効化、フェンスが終わるまで場所を使い回さないこと、
+// 空きが無いときの失敗、全て返した後にもう一度埋まること、一時的な区画がフェンスの完了で空になることを確かめる
+std::vector<SelfTestResult> RunDescriptorAllocatorSelfTest();
+
+#endif // DESCRIPTORALLOCATOR_H
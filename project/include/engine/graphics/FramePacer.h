@@ -0,0 +1,80 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "engine/base/SelfTest.h"
+
+// GPUより最大framesInFlightフレーム先まで記録を進めるための、フレームのスロットとフェンスの管理
+// ・フレームごとにスロット（コマンドアロケータなど）を順番に使い回す
+// ・BeginFrameでは、同じスロットを前に使ったフレーム（framesInFlightフレーム前）のフェンスだけを待つ
+// ・Deferに渡した処理は、今記録中のフレーム（記録中でなければ最後に送り出したフレーム）までGPUが終わった後
+//   （そのフレームのスロットがまた回ってきたとき）に呼ばれる
+//   GPUが参照しているかもしれないリソースやディスクリプタの解放に使う
+// フェンスの操作はFrameFenceに任せる（GPU無しでも、時間を進める偽のフェンスを渡せば動く）
+
+struct FrameFence {
+	// GPUが終えたフェンス値
+	std::function<uint64_t()> getCompletedValue;
+	// ここまで積んだコマンドが終わったらvalueになるようにする
+	std::function<void(uint64_t value)> signal;
+	// フェンス値がvalue以上になるまで待つ
+	std::function<void(uint64_t value)> wait;
+};
+
+struct FramePacerStats {
+	uint64_t frameCount = 0;     // EndFrameした回数
+	uint64_t waitCount = 0;      // BeginFrameで実際に待った回数
+	uint64_t deferredCount = 0;  // Deferで預かった処理の累計
+};
+
+class FramePacer {
+public:
+	static constexpr uint32_t kMaxFramesInFlight = 4;
+
+	FramePacer(uint32_t framesInFlight, FrameFence fence);
+	// 預かったままの処理を呼ぶ（GPUが全て終わっていること。先にWaitIdleしておく）
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// 次のフレームのスロットが空くまで待ち、そのスロットの番号を返す
+	uint32_t BeginFrame();
+	// 記録したフレームのコマンドを積んだ後に呼ぶ。このフレームのフェンス値を返す
+	uint64_t EndFrame();
+	// 今記録中のフレーム（記録中でなければ最後に送り出したフレーム）までGPUが終わったら呼ぶ処理を預ける
+	void Defer(std::function<void()> function);
+	// 送り出した全てのフレームが終わるまで待つ
+	void WaitIdle();
+
+	uint32_t GetFramesInFlight() const { return framesInFlight_; }
+	uint32_t GetFrameIndex() const { return frameIndex_; }
+	uint64_t GetLastSignaledValue() const { return lastSignaledValue_; }
+	uint64_t GetCompletedValue() const { return fence_.getCompletedValue(); }
+	const FramePacerStats& GetStats() const { return stats_; }
+
+private:
+	struct Slot {
+		uint64_t fenceValue = 0; // このスロットを最後に使ったフレームのフェンス値
+		std::vector<std::function<void()>> deferred;
+	};
+
+	void RunDeferred(Slot& slot);
+
+	uint32_t framesInFlight_;
+	FrameFence fence_;
+	std::vector<Slot> slots_;
+	uint32_t frameIndex_ = 0;
+	bool recording_ = false;
+	uint64_t lastSignaledValue_ = 0;
+	FramePacerStats stats_;
+};
+
+// -testframes用。フレームを一定の時間で順に終える擬似GPUのタイムラインで、スロットを使い回す前にフェンスを待つこと、
+// 送り出したフレームがframesInFlightを超えないこと（GPUが重いときはちょうどframesInFlightまで溜まること）、
+// Deferした処理の呼ばれる時期、フレームを重ねた分だけ速くなることを確かめる
+std::vector<SelfTestResult> RunFramePacerSelfTest();
+
+#endif // FRAMEPACER_H
@@ -0,0 +1,123 @@
+#ifndef PIPELINEBUILDSCHEDULER_H
+#define PIPELINEBUILDSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/base/ThreadPool.h"
+#include "engine/graphics/ShaderCache.h"
+
+// 起動時のシェーダーのコンパイルとPSOの生成をスレッドプールで並行に行うスケジューラ
+// ・AddShaderでコンパイルするシェーダー、AddPipelineでそれを使うPSOを登録してからBuildを呼ぶ
+// ・PSOは自分が使うシェーダーが揃った時点で作り始める（他のシェーダーのコンパイルは待たない。preparePipelinesがあれば全て揃ってから）
+// ・同じ設定のシェーダーは1回だけコンパイルし、使う全てのPSOで共有する
+// ・設定が違ってもバイトコードが全く同じになったシェーダーは1つにまとめ、
+//   まとめた結果シェーダーの組が同じになったPSOは最初の1つだけ作る（GetPipelineSourceで作った方が分かる）
+// ・Buildは各タスクの時間を測り、全体の時間と依存関係で最も長い鎖（クリティカルパス）を返す
+// コンパイルとPSOの生成はPipelineBuildBackendに任せる（CreateMockPipelineBuildBackendを使えばGPUもDXCも要らない）
+
+// 実際の処理（main側で用意する。どちらもワーカースレッドから並行に呼ばれる）
+struct PipelineBuildBackend {
+	std::function<bool(const ShaderCompileRequest&, std::vector<uint8_t>& bytecode)> compileShader;
+	// shadersはAddPipelineに渡した順（VS、PSなど）
+	std::function<bool(uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders)> createPipeline;
+	// 省略可。全てのシェーダーのコンパイルが終わってから、PSOを作り始める前に1回だけ呼ばれる（反映情報からルートシグネチャを作るなど）
+	// 設定すると、PSOは自分のシェーダーではなく全てのシェーダーを待つ。falseを返したらPSOは1つも作らない
+	std::function<bool()> preparePipelines;
+};
+
+struct MockPipelineBuildDesc {
+	uint32_t compileMilliseconds = 20; // 1つのシェーダーのコンパイルにかかる時間
+	uint32_t pipelineMilliseconds = 5; // 1つのPSOの生成にかかる時間
+	std::vector<std::string> failingSources; // コンパイルに失敗させるソースのパス
+};
+
+// モックバックエンドが受け取った呼び出しの記録
+struct MockPipelineBuildLog {
+	std::mutex mutex;
+	size_t compileCount = 0;
+	size_t pipelineCount = 0;
+	size_t activeCount = 0;          // 今実行中のタスク
+	size_t peakActiveCount = 0;      // 同時に実行されたタスクの最大
+	size_t missingShaderCount = 0;   // PSOの生成時にバイトコードが揃っていなかった回数（0でなければ依存関係の誤り）
+	std::vector<uint32_t> createdPipelines; // 作った順
+};
+
+// 決まった時間だけ眠ってバイトコードの代わりのデータを返すバックエンド（スケジューリングの確認用）
+PipelineBuildBackend CreateMockPipelineBuildBackend(std::shared_ptr<MockPipelineBuildLog> log, const MockPipelineBuildDesc& desc = {});
+
+struct PipelineBuildReport {
+	size_t shaderCount = 0;
+	size_t pipelineCount = 0;
+	size_t failedShaderCount = 0;
+	size_t failedPipelineCount = 0;   // 生成に失敗した、またはシェーダーが失敗したので作らなかったPSO
+	size_t duplicateShaderCount = 0;  // 他のシェーダーとバイトコードが同じだったもの
+	size_t duplicatePipelineCount = 0; // シェーダーの組が他と同じだったので作らなかったPSO
+	uint32_t threadCount = 0;
+	double totalMilliseconds = 0.0;        // Buildの開始から全て終わるまで
+	double serialMilliseconds = 0.0;       // 全てのタスクの時間の合計（1スレッドで順に行った場合の目安）
+	double prepareMilliseconds = 0.0;      // preparePipelinesにかかった時間
+	bool prepareFailed = false;            // preparePipelinesがfalseを返した
+	double criticalPathMilliseconds = 0.0; // スレッドをいくら増やしてもこれより速くはならない
+	std::vector<std::string> criticalPath; // その鎖のシェーダーとPSOの名前
+};
+
+class PipelineBuildScheduler {
+public:
+	using ShaderId = uint32_t;
+	using PipelineId = uint32_t;
+
+	// 同じ設定（MakeShaderRequestIdが同じ）なら前に登録したものを返す
+	ShaderId AddShader(const ShaderCompileRequest& request);
+	PipelineId AddPipeline(const std::string& name, const std::vector<ShaderId>& shaders);
+
+	// 登録した全てを作り、終わるまで待つ（threadPoolのワーカースレッドから呼ばないこと）
+	PipelineBuildReport Build(ThreadPool& threadPool, const PipelineBuildBackend& backend);
+
+	size_t GetShaderCount() const { return shaders_.size(); }
+	size_t GetPipelineCount() const { return pipelines_.size(); }
+	const ShaderCompileRequest& GetShaderRequest(ShaderId shader) const { return shaders_[shader].request; }
+	const std::vector<ShaderId>& GetPipelineShaders(PipelineId pipeline) const { return pipelines_[pipeline].shaders; }
+	const std::vector<uint8_t>& GetBytecode(ShaderId shader) const { return shaders_[shaders_[shader].source].bytecode; }
+	bool IsShaderReady(ShaderId shader) const { return shaders_[shader].succeeded; }
+	bool IsPipelineReady(PipelineId pipeline) const { return pipelines_[pipeline].succeeded; }
+	// 実際に作られたPSO（同じシェーダーの組の別のPSOを使い回していればそちらの番号）
+	PipelineId GetPipelineSource(PipelineId pipeline) const { return pipelines_[pipeline].source; }
+
+private:
+	struct ShaderNode {
+		ShaderCompileRequest request;
+		std::string name;
+		std::vector<PipelineId> dependents; // このシェーダーを使うPSO
+		std::vector<uint8_t> bytecode; // 他のシェーダーと同じだったときは空（sourceの方を使う）
+		ShaderId source = 0;           // バイトコードの持ち主（自分か、同じバイトコードの先のシェーダー）
+		bool succeeded = false;
+		double milliseconds = 0.0;
+	};
+	struct PipelineNode {
+		std::string name;
+		std::vector<ShaderId> shaders;
+		uint32_t remainingShaderCount = 0; // Build中、まだ終わっていないシェーダーの数
+		bool shaderFailed = false;
+		PipelineId source = 0; // 実際に作ったPSO（自分か、同じシェーダーの組の先のPSO）
+		bool succeeded = false;
+		double milliseconds = 0.0;
+	};
+
+	std::vector<ShaderNode> shaders_;
+	std::vector<PipelineNode> pipelines_;
+	std::unordered_map<std::string, ShaderId> shaderIds_;
+};
+
+// -testshaders用。モックバックエンドで、PSOを作るときにシェーダーが揃っていること、失敗したシェーダーのPSOを作らないこと、
+// preparePipelinesを待つこと、並行に走って速くなることを確かめる（同じバイトコードのまとめはRunShaderPermutationSelfTest）
+std::vector<SelfTestResult> RunPipelineBuildSchedulerSelfTest();
+
+#endif // PIPELINEBUILDSCHEDULER_H
@@ -0,0 +1,99 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "engine/base/SelfTest.h"
+
+// 描画をいったん集めて並べ替え、状態の設定をまとめて流すキュー
+// ・1回の描画に必要なもの（PSO・ルートパラメータ・メッシュ）をエンジン側の番号でDrawPacketに詰めてSubmitする
+// ・64ビットのキー（レイヤー・PSO・マテリアル・テクスチャ・深度の順）で並べるので、同じ状態の描画が隣り合う
+// ・Executeでは直前と同じ値の設定を飛ばす（光源やWVPのように全ての描画で同じものは最初の1回だけになる）
+// 番号をD3D12のオブジェクトに読み替えてコマンドリストへ記録するのはRenderCommandBackendに任せる
+// （CreateRecordingRenderBackendを使えばGPU無しでも数えられる）
+
+// ルートシグネチャのパラメータの番号（main側のルートシグネチャと合わせる）
+constexpr uint32_t kRootParameterMaterial = 0;  // b0
+constexpr uint32_t kRootParameterTransform = 1; // b1
+constexpr uint32_t kRootParameterTexture = 2;   // t0（ディスクリプタテーブル）
+constexpr uint32_t kRootParameterLight = 3;     // b3
+
+// キーの各部分のビット数（上から順に比べられる）
+constexpr uint32_t kSortKeyLayerBits = 4;     // 描く順番を決めたいもの（3Dの後にスプライトなど）
+constexpr uint32_t kSortKeyPipelineBits = 8;
+constexpr uint32_t kSortKeyMaterialBits = 16;
+constexpr uint32_t kSortKeyTextureBits = 16;
+constexpr uint32_t kSortKeyDepthBits = 20;    // 手前から奥へ（不透明なものは手前から描くと深度テストで捨てやすい）
+
+// 各部分は収まらない分を切り捨てる。depthは0（手前）〜1（奥）
+uint64_t MakeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t texture, float depth);
+
+struct DrawPacket {
+	uint64_t sortKey = 0;
+	uint32_t pipeline = 0; // バックエンドがPSOに読み替える番号
+	uint64_t material = 0;  // 定数バッファのGPUアドレス
+	uint64_t transform = 0;
+	uint64_t light = 0;
+	uint32_t texture = 0;   // SRVヒープの先頭からのディスクリプタの番号
+	uint32_t mesh = 0;      // バックエンドが頂点/インデックスバッファに読み替える番号
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+};
+
+// コマンドリストへの記録（main側で用意する）
+struct RenderCommandBackend {
+	std::function<void(uint32_t pipeline)> setPipeline;
+	std::function<void(uint32_t rootParameter, uint64_t address)> setConstantBufferView;
+	std::function<void(uint32_t rootParameter, uint32_t texture)> setDescriptorTable;
+	std::function<void(uint32_t mesh)> setMesh; // 頂点バッファとインデックスバッファをまとめて設定する
+	std::function<void(uint32_t indexCount, uint32_t firstIndex)> drawIndexed;
+};
+
+// 記録用バックエンドが受け取った呼び出しの記録
+struct RenderCommandLog {
+	size_t pipelineCount = 0;
+	size_t constantBufferViewCount = 0;
+	size_t descriptorTableCount = 0;
+	size_t meshCount = 0;
+	std::vector<std::pair<uint32_t, uint32_t>> draws; // indexCount, firstIndex
+};
+
+// GPUを使わず、呼び出しをlogに記録するだけのバックエンド（並べ替えと省略の確認用）
+RenderCommandBackend CreateRecordingRenderBackend(std::shared_ptr<RenderCommandLog> log);
+
+struct RenderQueueStats {
+	size_t drawCount = 0;
+	size_t stateSetCount = 0;     // 実際に流した状態の設定（PSO・ルートパラメータ・メッシュ）
+	size_t skippedSetCount = 0;   // 直前と同じで飛ばした設定
+	size_t pipelineSetCount = 0;
+	size_t constantBufferSetCount = 0;
+	size_t descriptorTableSetCount = 0;
+	size_t meshSetCount = 0;
+};
+
+class RenderQueue {
+public:
+	void Clear() { packets_.clear(); }
+	void Submit(const DrawPacket& packet) { packets_.push_back(packet); }
+	size_t GetPacketCount() const { return packets_.size(); }
+
+	// キーの順に並べ替える（同じキーならSubmitした順）
+	void Sort();
+	// 並んでいる順に記録する。状態は何も設定されていないものとして始める
+	RenderQueueStats Execute(const RenderCommandBackend& backend) const;
+
+private:
+	std::vector<DrawPacket> packets_;
+	std::vector<std::pair<uint64_t, uint32_t>> order_; // Sortの作業用（キー、Submitした順番）
+	std::vector<DrawPacket> sorted_;
+};
+
+// -testframes用。記録用バックエンドで、キーの順序、並べ替えの後も全ての描画が1回ずつ正しい状態で流れること、
+// 同じ設定を飛ばした数と記録された呼び出しの数が合うことを確かめる
+std::vector<SelfTestResult> RunRenderQueueSelfTest();
+
+#endif // RENDERQUEUE_H
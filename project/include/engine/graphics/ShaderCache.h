@@ -0,0 +1,88 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/base/SelfTest.h"
+
+// コンパイルしたシェーダーのバイトコードをファイルに保存しておき、次回からはコンパイルを省くキャッシュ
+// ・キーはソース、インクルードした全てのファイルの中身、プロファイル、エントリーポイント、引数のハッシュ
+// ・インクルードしたファイルはコンパイルのときにインクルードハンドラが解決したものを覚えておく
+//   （次回はそのファイルを読み直してキーを計算するので、.hlsliだけ変えても気付ける）
+// ・cacheDirectory/<キー>.cso にバイトコード、cacheDirectory/index.txt に依存ファイルの一覧を置く
+// コンパイル自体はcompileに任せる（DXCが無くても、偽のコンパイラを渡せば動く）
+// GetOrCompileは複数のスレッドから同時に呼んでよい（compileはロックの外で並行に呼ばれる）
+
+struct ShaderCompileRequest {
+	std::string sourcePath;              // 実行時のカレントディレクトリからのパス
+	std::string profile;                 // vs_6_0 など
+	std::string entryPoint = "main";
+	std::vector<std::string> arguments;  // -Od、-D NAME=VALUE など（そのままキーに入る）
+};
+
+struct ShaderCompileOutput {
+	std::vector<uint8_t> bytecode;
+	std::vector<std::string> includedFiles; // インクルードハンドラが読んだファイル
+	std::string errors;                     // 警告・エラーのメッセージ
+};
+
+// 成功したらtrue
+using ShaderCompileFunction = std::function<bool(const ShaderCompileRequest&, ShaderCompileOutput&)>;
+
+struct ShaderCacheStats {
+	size_t requestCount = 0;
+	size_t hitCount = 0;      // 保存したバイトコードを使った
+	size_t compileCount = 0;  // コンパイルした
+	size_t failedCount = 0;   // コンパイルに失敗した
+	size_t unsavedCount = 0;  // コンパイル中にファイルが書き換えられたなどで、バイトコードを保存しなかった
+};
+
+class ShaderCache {
+public:
+	ShaderCache(const std::string& cacheDirectory, ShaderCompileFunction compile);
+
+	// 中身が変わっていなければ保存したバイトコードを読み、変わっていればコンパイルして保存する
+	// 失敗したらfalse（errorsにはコンパイラのメッセージが入る）
+	bool GetOrCompile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string* errors = nullptr);
+
+	// ソース自身と、前回のコンパイルでインクルードしたファイル（まだコンパイルしていなければソースだけ）
+	std::vector<std::string> GetDependencies(const ShaderCompileRequest& request) const;
+
+	// 依存ファイルの一覧に変更があれば保存する
+	bool SaveIndex();
+
+	ShaderCacheStats GetStats() const;
+
+private:
+	struct IndexRecord {
+		uint64_t key = 0;
+		std::vector<std::string> dependencies; // ソース以外に読んだファイル
+	};
+
+	void LoadIndex();
+	std::string GetBytecodePath(uint64_t key) const;
+
+	std::string cacheDirectory_;
+	ShaderCompileFunction compile_;
+	mutable std::mutex mutex_; // index_・stats_とキャッシュへの書き込みを守る
+	std::unordered_map<std::string, IndexRecord> index_; // MakeShaderRequestIdの結果→記録
+	bool indexDirty_ = false;
+	ShaderCacheStats stats_;
+};
+
+// 同じ設定のコンパイルを識別する文字列（ソースのパス・プロファイル・エントリーポイント・引数）
+std::string MakeShaderRequestId(const ShaderCompileRequest& request);
+
+// キーを計算する（読めないファイルがあればfalse）
+bool ComputeShaderCacheKey(const ShaderCompileRequest& request, const std::vector<std::string>& dependencies, uint64_t& key);
+
+// -testshaders用。インクルードを解決して繋げるだけの偽のコンパイラで、作り直したキャッシュでのヒット、
+// 引数やインクルードだけの変更での再コンパイル、古いバイトコードの削除、失敗、壊れた対応表、並行した呼び出しを確かめる
+std::vector<SelfTestResult> RunShaderCacheSelfTest();
+
+#endif // SHADERCACHE_H
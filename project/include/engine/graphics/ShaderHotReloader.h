@@ -0,0 +1,149 @@
+#ifndef SHADERHOTRELOADER_H
+#define SHADERHOTRELOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/base/ThreadPool.h"
+#include "engine/graphics/PipelineBuildScheduler.h"
+#include "engine/graphics/ShaderCache.h"
+
+// 実行中にシェーダーのファイルが変わったら、コンパイルし直してPSOを差し替えるホットリロード
+// ・監視するのは、追跡しているシェーダーのソースと、前回のコンパイルでインクルードした全てのファイル
+//   （.hlsliだけを変えても、それをインクルードしている全てのシェーダーがコンパイルし直される）
+// ・一定の間隔で更新時刻とサイズを調べ、最後の変更から少し待ってから（保存の途中を拾わないように）まとめてコンパイルする
+// ・コンパイルとPSOの生成はバックグラウンドのスレッドで行い、Update（フレームの境目）で差し替える
+// ・1つでも失敗したら何も差し替えない（前のPSOのまま描画を続ける）
+// ファイルの状態と時刻はShaderWatchBackend、コンパイルとPSOはShaderReloadBackendに任せる（偽の時計とファイルで動かせる）
+
+struct ShaderFileStamp {
+	bool exists = false;
+	int64_t writeTime = 0;
+	uint64_t size = 0;
+
+	bool operator==(const ShaderFileStamp& other) const {
+		return exists == other.exists && writeTime == other.writeTime && size == other.size;
+	}
+	bool operator!=(const ShaderFileStamp& other) const { return !(*this == other); }
+};
+
+struct ShaderWatchBackend {
+	std::function<ShaderFileStamp(const std::string& path)> getStamp;
+	std::function<double()> nowMilliseconds; // 単調に増える時刻
+};
+
+// std::filesystemとsteady_clockを使う
+ShaderWatchBackend CreateFileSystemWatchBackend();
+
+// main側で用意する（compileShader・createPipelineはバックグラウンドのスレッド、それ以外はUpdateから呼ばれる）
+struct ShaderReloadBackend {
+	std::function<bool(const ShaderCompileRequest&, std::vector<uint8_t>& bytecode, std::string& errors)> compileShader;
+	// 新しいPSOを作って、差し替えるまで預かっておく
+	std::function<bool(uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders)> createPipeline;
+	// 預かっているPSOに差し替える（前のPSOはGPUが使い終わってから捨てること）
+	std::function<void(uint32_t pipeline)> swapPipeline;
+	// 預かっているPSOを捨てる（同じ回の別のものが失敗したとき）
+	std::function<void(uint32_t pipeline)> discardPipeline;
+	// ソース自身とインクルードしたファイル（ShaderCache::GetDependencies）
+	std::function<std::vector<std::string>(const ShaderCompileRequest&)> getDependencies;
+};
+
+struct ShaderHotReloadDesc {
+	double pollIntervalMilliseconds = 250.0; // ファイルを調べる間隔
+	double debounceMilliseconds = 200.0;     // 最後の変更からこれだけ経ち、その後の確認で変更が無ければコンパイルを始める
+};
+
+enum class ShaderReloadStatus {
+	None,     // 差し替えるものは無かった
+	Applied,  // 差し替えた
+	Failed,   // コンパイルかPSOの生成に失敗した（GetLastErrors）
+};
+
+struct ShaderHotReloadStats {
+	size_t watchedFileCount = 0;
+	size_t pollCount = 0;
+	size_t changeCount = 0;     // 変更に気付いたファイルの数の累計
+	size_t reloadCount = 0;     // 差し替えた回数
+	size_t failedCount = 0;     // 失敗して差し替えなかった回数
+	size_t compiledShaderCount = 0;
+	size_t swappedPipelineCount = 0;
+};
+
+class ShaderHotReloader {
+public:
+	ShaderHotReloader(const ShaderHotReloadDesc& desc, ShaderWatchBackend watch, ShaderReloadBackend backend);
+	~ShaderHotReloader();
+
+	ShaderHotReloader(const ShaderHotReloader&) = delete;
+	ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+	// Build済みのスケジューラのシェーダーとPSOを全て追跡する（PSOの番号はスケジューラと同じ）
+	void Track(const PipelineBuildScheduler& scheduler);
+
+	// フレームの境目で毎フレーム呼ぶ
+	// ファイルを調べ、落ち着いた変更があればバックグラウンドでコンパイルを始め、終わっていれば差し替える
+	ShaderReloadStatus Update();
+	// バックグラウンドの処理が終わるまで待つ（差し替えは次のUpdate）
+	void WaitIdle();
+
+	bool IsReloading() const;
+	const std::string& GetLastErrors() const { return lastErrors_; }
+	const ShaderHotReloadStats& GetStats() const { return stats_; }
+
+private:
+	struct TrackedShader {
+		ShaderCompileRequest request;
+		std::vector<uint8_t> bytecode;          // 今のPSOに使われているもの
+		std::vector<std::string> dependencies;  // ソース自身を含む
+	};
+	struct TrackedPipeline {
+		uint32_t id = 0;
+		std::vector<uint32_t> shaders;
+	};
+	// バックグラウンドの1回分
+	struct ReloadJob {
+		std::vector<uint32_t> shaders;
+		std::vector<std::vector<uint8_t>> bytecode; // shadersと同じ順
+		std::vector<uint32_t> pipelines;            // 作ったPSO
+		bool succeeded = false;
+		std::string errors;
+		bool finished = false;
+	};
+
+	bool Poll(double now); // 変更が見つかったらtrue
+	void RebuildWatchList();
+	void StartReload();
+	void RunReload(ReloadJob& job);
+
+	ShaderHotReloadDesc desc_;
+	ShaderWatchBackend watch_;
+	ShaderReloadBackend backend_;
+
+	std::vector<TrackedShader> shaders_;
+	std::vector<TrackedPipeline> pipelines_;
+	std::unordered_map<std::string, ShaderFileStamp> stamps_;            // 監視しているファイル→前回の状態
+	std::unordered_map<std::string, std::vector<uint32_t>> dependents_;  // ファイル→それを使うシェーダー
+	std::vector<uint32_t> dirtyShaders_;                                 // 変更があってまだコンパイルしていないシェーダー
+	std::vector<uint32_t> retryShaders_;                                 // 前の回で失敗して差し替えていないシェーダー
+	double lastPollTime_ = 0.0;
+	double lastChangeTime_ = 0.0;
+	bool polled_ = false;
+
+	mutable std::mutex mutex_;          // job_->finishedを守る
+	std::unique_ptr<ReloadJob> job_;    // 実行中、または差し替え待ち
+	std::string lastErrors_;
+	ShaderHotReloadStats stats_;
+	ThreadPool worker_;                 // バックグラウンドのスレッド（1本）。最後に宣言して最初に壊し、実行中のjob_を待つ
+};
+
+// -testshaders用。メモリ上の偽のファイルと時計、インクルードを辿る偽のコンパイラで、.hlsliだけの変更、連続した保存のまとめ、
+// コンパイルとPSOの失敗で差し替えないこと、新しいインクルードの監視、消えたファイルからの復帰を確かめる
+std::vector<SelfTestResult> RunShaderHotReloaderSelfTest();
+
+#endif // SHADERHOTRELOADER_H
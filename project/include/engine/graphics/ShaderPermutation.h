@@ -0,0 +1,83 @@
+#ifndef SHADERPERMUTATION_H
+#define SHADERPERMUTATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/graphics/PipelineBuildScheduler.h"
+
+// #defineの組み合わせ（キーワード）でシェーダーを作り分けるパーミュテーション
+// ・マニフェストにキーワード（defineの名前と取りうる値の数）と、各ステージが使うキーワードを書く
+// ・キーワードの値を詰めたビットマスク（ShaderPermutationKey）で、描画ごとに専用のPSOを選ぶ
+// ・ステージは自分が使うキーワードだけをdefineしてコンパイルするので、
+//   VSが使わないキーワード（ライティングなど）の分だけVSが増えることはない
+// ・コンパイルとPSOの生成はPipelineBuildSchedulerに登録して行う（同じバイトコードのまとめもそちらで行う）
+
+using ShaderPermutationKey = uint32_t;
+
+struct ShaderKeyword {
+	std::string define;      // HLSL側のdefineの名前（0〜valueCount-1の値でdefineされる）
+	uint32_t valueCount = 2; // 2ならオン・オフ
+};
+
+struct ShaderPermutationStage {
+	std::string sourcePath;
+	std::string profile;
+	std::vector<std::string> keywords; // このステージが使うキーワード
+};
+
+struct ShaderPermutationManifest {
+	std::string name;
+	std::vector<ShaderKeyword> keywords;
+	std::vector<ShaderPermutationStage> stages; // PSOに渡す順（VS、PS）
+};
+
+struct ShaderPermutationReport {
+	size_t keywordCount = 0;
+	size_t permutationCount = 0; // キーワードの値の組み合わせの数
+	size_t shaderCount = 0;      // コンパイルするシェーダーの数（ステージが使わないキーワードの分はまとめた後）
+	size_t pipelineCount = 0;    // 登録したPSOの数（シェーダーの組が同じパーミュテーションはまとめた後）
+};
+
+class ShaderPermutationSet {
+public:
+	static constexpr uint32_t kInvalidPipeline = UINT32_MAX;
+
+	explicit ShaderPermutationSet(const ShaderPermutationManifest& manifest);
+
+	// 見つからなければ-1
+	int32_t FindKeyword(const std::string& define) const;
+	// keyのkeywordの値を差し替えたキー
+	ShaderPermutationKey SetKeyword(ShaderPermutationKey key, uint32_t keyword, uint32_t value) const;
+	uint32_t GetKeyword(ShaderPermutationKey key, uint32_t keyword) const;
+	// 全てのキーワードが範囲内の値か
+	bool IsValidKey(ShaderPermutationKey key) const;
+
+	// 全ての組み合わせのシェーダーとPSOを登録する（argumentsはdefineの前に付ける共通のオプション）
+	void Register(PipelineBuildScheduler& scheduler, const std::vector<std::string>& arguments);
+	// keyの組み合わせ用に登録したPSOの番号（Registerの前や範囲外の値ならkInvalidPipeline）
+	uint32_t GetPipeline(ShaderPermutationKey key) const;
+
+	const ShaderPermutationManifest& GetManifest() const { return manifest_; }
+	const ShaderPermutationReport& GetReport() const { return report_; }
+
+private:
+	struct KeywordBits {
+		uint32_t shift = 0;
+		uint32_t bits = 0;
+	};
+
+	ShaderPermutationManifest manifest_;
+	std::vector<KeywordBits> keywordBits_;
+	uint32_t keyBits_ = 0;
+	std::vector<uint32_t> pipelines_; // キー→PSOの番号（範囲外の値のキーはkInvalidPipeline）
+	ShaderPermutationReport report_;
+};
+
+// -testshaders用。キーの詰め方とIsValidKey、レポートの数、使わないキーワードでのPSOの共有を確かめ、
+// モックバックエンドでビルドして、同じバイトコードになったパーミュテーションのシェーダーとPSOがまとまることを確かめる
+std::vector<SelfTestResult> RunShaderPermutationSelfTest();
+
+#endif // SHADERPERMUTATION_H
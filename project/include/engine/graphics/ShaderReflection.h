@@ -0,0 +1,137 @@
+#ifndef SHADERREFLECTION_H
+#define SHADERREFLECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine/base/SelfTest.h"
+
+// シェーダーの反映情報（どのレジスタに何を使い、cbufferがどう並んでいるか）から
+// ルートシグネチャの並びを作り、C++側の構造体のレイアウトをcbufferと照らし合わせる
+// ・反映情報はShaderReflectionDataにまとめる（DXCから取り出すのはmain側。テキストに書き出して読み戻せる）
+// ・ルートシグネチャは全てのシェーダーの和で作る（同じレジスタを複数のステージが使えばALLから見えるようにする）
+//   小さいcbufferはルート定数、それ以外のcbufferはルートCBV、SRV/UAVは1つずつディスクリプタテーブル、サンプラーは静的サンプラー
+// ・C++の構造体は、cbufferの全ての変数が同じ名前のフィールドと同じオフセット・サイズで、最後の変数の終わりまで収まればよい
+// ここはD3D12に依存しないので、書き出した反映情報だけで確かめられる
+
+enum class ShaderStage : uint32_t {
+	Vertex,
+	Pixel,
+};
+
+// 使うステージのビット
+constexpr uint32_t kShaderStageMaskVertex = 1u << uint32_t(ShaderStage::Vertex);
+constexpr uint32_t kShaderStageMaskPixel = 1u << uint32_t(ShaderStage::Pixel);
+
+// プロファイル（vs_6_0など）の先頭から。分からなければfalse
+bool GetShaderStageFromProfile(const std::string& profile, ShaderStage& stage);
+
+enum class ShaderBindingKind : uint32_t {
+	ConstantBuffer,  // b
+	ShaderResource,  // t
+	UnorderedAccess, // u
+	Sampler,         // s
+};
+
+struct ShaderConstantVariable {
+	std::string name;    // 構造体のメンバーは「gDirectionalLight.color」のように繋げる（末端の変数だけを並べる）
+	uint32_t offset = 0; // cbufferの先頭からのバイト数
+	uint32_t size = 0;
+
+	bool operator==(const ShaderConstantVariable& other) const {
+		return name == other.name && offset == other.offset && size == other.size;
+	}
+};
+
+struct ShaderBinding {
+	std::string name;
+	ShaderBindingKind kind = ShaderBindingKind::ConstantBuffer;
+	uint32_t shaderRegister = 0;
+	uint32_t space = 0;
+	uint32_t count = 1;
+	uint32_t size = 0; // cbufferの大きさ（ConstantBufferのときだけ）
+	std::vector<ShaderConstantVariable> variables; // オフセット順（ConstantBufferのときだけ）
+};
+
+struct ShaderReflectionData {
+	ShaderStage stage = ShaderStage::Vertex;
+	std::vector<ShaderBinding> bindings;
+};
+
+// 1行目が「# CG2 shader reflection v1」、以降はタブ区切りのテキスト
+std::string SerializeShaderReflection(const ShaderReflectionData& reflection);
+// 壊れていればfalse（errorsに何行目か）
+bool ParseShaderReflection(const std::string& text, ShaderReflectionData& reflection, std::string* errors = nullptr);
+
+// 見つからなければnullptr
+const ShaderBinding* FindShaderBinding(const ShaderReflectionData& reflection, ShaderBindingKind kind, const std::string& name);
+
+enum class RootParameterKind : uint32_t {
+	Constants,          // ルート定数（SetGraphicsRoot32BitConstants）
+	ConstantBufferView, // ルートCBV（SetGraphicsRootConstantBufferView）
+	DescriptorTable,    // SRV/UAVのテーブル（SetGraphicsRootDescriptorTable）
+};
+
+struct RootParameterLayout {
+	RootParameterKind kind = RootParameterKind::ConstantBufferView;
+	ShaderBindingKind bindingKind = ShaderBindingKind::ConstantBuffer;
+	std::string name;
+	uint32_t shaderRegister = 0;
+	uint32_t space = 0;
+	uint32_t count = 1;     // Constantsなら32ビット値の数、DescriptorTableならディスクリプタの数
+	uint32_t stageMask = 0; // 使うステージ（2つ以上ならALLから見えるようにする）
+	uint32_t cost = 0;      // ルートシグネチャの中の大きさ（32ビット単位）
+};
+
+struct StaticSamplerLayout {
+	std::string name;
+	uint32_t shaderRegister = 0;
+	uint32_t space = 0;
+	uint32_t stageMask = 0;
+};
+
+struct RootSignatureLayoutDesc {
+	uint32_t maxRootConstantBytes = 16;  // この大きさ以下のcbufferはルート定数にする（0ならしない）
+	uint32_t maxCost = 64;               // D3D12の上限（32ビット単位）。超えたら大きいルート定数からCBVに戻す
+	std::vector<std::string> order;      // 先頭から並べる名前（描画ごとによく変わるものを前に）。残りは後ろにレジスタの順
+};
+
+struct RootSignatureLayout {
+	std::vector<RootParameterLayout> parameters;
+	std::vector<StaticSamplerLayout> staticSamplers;
+	uint32_t cost = 0;
+};
+
+// 同じレジスタで種類や大きさ・変数の並びが違う、上限を超えるなどのときはfalse（errorsに理由）
+bool BuildRootSignatureLayout(const std::vector<const ShaderReflectionData*>& shaders, const RootSignatureLayoutDesc& desc,
+	RootSignatureLayout& layout, std::string* errors = nullptr);
+// 見つからなければ-1
+int32_t FindRootParameter(const RootSignatureLayout& layout, const std::string& name);
+// shaderの使う全てのレジスタが、そのステージから見えるパラメータ（か静的サンプラー）にあるか（ホットリロードでの確認用）
+bool IsShaderCompatibleWithRootSignature(const ShaderReflectionData& shader, const RootSignatureLayout& layout, std::string* errors = nullptr);
+
+// C++側の構造体のフィールド（nameはシェーダー側の変数名）
+struct CppStructField {
+	std::string name;
+	uint32_t offset = 0;
+	uint32_t size = 0;
+};
+
+struct CppStructLayout {
+	std::string name;           // C++の型の名前（メッセージ用）
+	std::string constantBuffer; // アップロードする先のcbufferの名前
+	uint32_t size = 0;
+	std::vector<CppStructField> fields;
+};
+
+// cbufferと構造体のレイアウトが合っているか（合わなければerrorsに変数ごとの違い）
+bool ValidateConstantBufferLayout(const ShaderBinding& constantBuffer, const CppStructLayout& layout, std::string* errors = nullptr);
+// shaderの全てのcbufferを、constantBufferが同じ名前の構造体と照らし合わせる（構造体の無いcbufferも誤り）
+bool ValidateConstantBufferLayouts(const ShaderReflectionData& shader, const std::vector<CppStructLayout>& layouts, std::string* errors = nullptr);
+
+// -testshaders用。Object3dのシェーダーから書き出した形の反映情報のテキストを読み、書き出しとの往復、壊れたテキストの拒否、
+// mainと同じ並びのルートシグネチャ、ルート定数と上限、ホットリロードでの互換性、構造体のずれの検出を確かめる
+std::vector<SelfTestResult> RunShaderReflectionSelfTest();
+
+#endif // SHADERREFLECTION_H
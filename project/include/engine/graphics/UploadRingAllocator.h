@@ -0,0 +1,110 @@
+#ifndef UPLOADRINGALLOCATOR_H
+#define UPLOADRINGALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "engine/base/SelfTest.h"
+
+// 大きめのUPLOADヒープのページを切り分けて使うアロケータ
+// ・Allocateはページの先頭から順に詰めるだけ（入らなければ次のページへ）
+// ・Retire(fenceValue)でそれまでの割り当てを締め、GPUがそのフェンス値まで進んだらReclaimでページを使い回す
+//   毎フレームRetireすれば、フレーム数分のページを回すリングになる
+// ・ページより大きい割り当てには専用のページを作り、使い終わったら捨てる
+// ページの作成と破棄はUploadPageBackendに任せる（D3D12のリソースはmain側で結び付ける。普通のメモリを渡せばGPU無しでも動く）
+
+// ページを指すハンドル。中身はバックエンドが決める（D3D12ではID3D12Resource*）
+using UploadPageHandle = uint64_t;
+
+// ページ（マップしたままにしておく）
+struct UploadPage {
+	UploadPageHandle handle = 0;
+	uint8_t* cpu = nullptr;
+	uint64_t gpuAddress = 0;
+	uint64_t size = 0;
+};
+
+// ページの作成と破棄（main側で用意する。Allocate・Reclaim・デストラクタから呼ばれる）
+struct UploadPageBackend {
+	// size以上のページを作り、マップしたCPUアドレスとGPUアドレスを返す。GPUアドレスはD3D12のバッファと同じく64KB単位に揃っていること
+	std::function<UploadPage(uint64_t size)> createPage;
+	// 省略可。使い終わったページを破棄する（GPUはもうこのページを使っていない）
+	std::function<void(const UploadPage&)> destroyPage;
+};
+
+struct UploadAllocation {
+	UploadPageHandle page = 0;
+	uint64_t offset = 0;     // ページの先頭からの位置
+	uint8_t* cpu = nullptr;
+	uint64_t gpuAddress = 0; // D3D12_GPU_VIRTUAL_ADDRESS
+	size_t size = 0;
+};
+
+struct UploadAllocatorStats {
+	size_t pageCount = 0;         // 今持っているページ（使用中・再利用待ち・空きの合計）
+	size_t pageCreateCount = 0;   // ページを作った回数の累計（リソースの作成回数）
+	size_t oversizeCount = 0;     // ページより大きくて専用のページを作った回数の累計
+	size_t allocationCount = 0;   // Allocateの回数の累計
+	size_t allocatedBytes = 0;    // 割り当てたバイト数の累計（揃えの分を含む）
+	size_t pendingPageCount = 0;  // Retire済みでGPUの完了待ちのページ
+};
+
+class UploadRingAllocator {
+public:
+	// CBVのアドレスは256バイト単位でなければならない（D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT）
+	static constexpr size_t kConstantBufferAlignment = 256;
+
+	UploadRingAllocator(uint64_t pageSize, UploadPageBackend backend);
+	// 全てのページを破棄する（GPUが使い終わってから破棄すること）
+	~UploadRingAllocator();
+
+	UploadRingAllocator(const UploadRingAllocator&) = delete;
+	UploadRingAllocator& operator=(const UploadRingAllocator&) = delete;
+
+	// sizeバイトをalignment（2のべき乗）に揃えて割り当てる
+	UploadAllocation Allocate(size_t size, size_t alignment = kConstantBufferAlignment);
+
+	// 定数バッファ1つ分を割り当ててvalueをコピーする
+	template<class T>
+	UploadAllocation AllocateConstants(const T& value) {
+		UploadAllocation allocation = Allocate(sizeof(T), kConstantBufferAlignment);
+		std::memcpy(allocation.cpu, &value, sizeof(T));
+		return allocation;
+	}
+
+	// ここまでの割り当てを、GPUがfenceValueまで進めば使い終わるものとして締める
+	void Retire(uint64_t fenceValue);
+	// completedFenceValueまで終わったページを再利用に回す
+	void Reclaim(uint64_t completedFenceValue);
+
+	uint64_t GetPageSize() const { return pageSize_; }
+	const UploadAllocatorStats& GetStats() const { return stats_; }
+
+private:
+	struct RetiredPages {
+		uint64_t fenceValue = 0;
+		std::vector<UploadPage> pages;
+	};
+
+	UploadPage CreatePage(uint64_t size);
+	void DestroyPage(const UploadPage& page);
+
+	uint64_t pageSize_;
+	UploadPageBackend backend_;
+
+	UploadPage activePage_;  // 今詰めているページ（sizeが0なら無し）
+	uint64_t activeOffset_ = 0;
+	std::vector<UploadPage> usedPages_; // 前回のRetire以降に使い終わったページ
+	std::deque<RetiredPages> retired_;  // フェンス値の小さい順
+	std::vector<UploadPage> freePages_;
+	UploadAllocatorStats stats_;
+};
+
+// -testframes用。普通のメモリのページと擬似フェンスで、256バイト揃え、フェンス完了前に使い回さないこと、
+// 完了後はページを作り足さないこと、専用ページ、統計を確かめる
+std::vector<SelfTestResult> RunUploadRingAllocatorSelfTest();
+
+#endif // UPLOADRINGALLOCATOR_H
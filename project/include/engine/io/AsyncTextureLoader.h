@@ -0,0 +1,189 @@
+#ifndef ASYNCTEXTURELOADER_H
+#define ASYNCTEXTURELOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/base/ThreadPool.h"
+#include "engine/io/TextureCache.h"
+
+// テクスチャをワーカースレッドで読み込み、ミップを小さい方から少しずつGPUへ書き込むローダー
+// ・Requestはすぐ返る。デコード（またはクック済みDDSの読み込み）はスレッドプールで優先度の高い順に行う
+// ・読み込みが終わるまではプレースホルダーのSRVを返す
+// ・デコードが終わったら、まず各テクスチャの一番小さいミップを書き込んで表示できるようにし、
+//   残りのミップは優先度の高い順に、1回のUpdateあたりの量と全体のメモリ予算の範囲で書き込んでいく
+// ・GPU側は書き込み済みのミップの分だけ確保する（バックエンドが細かいミップを足すたびに作り直す）
+//   CPU側のデコード結果はミップごとに分けて持ち、書き込んだミップから捨てる
+// ・中身の重複はTextureCacheで共有する（読み込み済みと分かっていればデコードもしない）
+// GPUへの書き込みはTextureUploadBackendに任せるので、CreateNullTextureUploadBackendを使えばGPU無しでも動く
+
+// GPU側の処理（main側で用意する。全てメインスレッドのUpdateから呼ばれる）
+struct TextureUploadBackend {
+	// SRVを作る（中身はまだ無いので、SRVはプレースホルダーを指しておく）。ピクセルの器はまだ作らない
+	std::function<TextureGpuResource(const DirectX::TexMetadata&)> create;
+	// 1ミップ分のピクセルを書き込む。ミップは細かい方へ1つずつ来るので、器をmipLevel以降のミップだけの大きさにして、
+	// 書き込み済みのミップを移してからmipLevelを書き込む（古い器は前のフレームが使い終わってから捨てる）
+	std::function<void(TextureGpuResource&, const DirectX::TexMetadata&, size_t mipLevel, const DirectX::Image&)> uploadMip;
+	// mostDetailedMip以降（書き込み済みの範囲。器の全体）を参照するSRVにする
+	// 前のフレームが今のSRVを参照しているかもしれないので、新しいディスクリプタに作ってsrvHandleを差し替えてよい
+	std::function<void(TextureGpuResource&, const DirectX::TexMetadata&, size_t mostDetailedMip)> publish;
+	std::function<void(TextureGpuResource&)> destroy;
+	// まだ何も表示できないテクスチャの代わりに使うSRV
+	D3D12_GPU_DESCRIPTOR_HANDLE placeholderSrv{};
+};
+
+// ヌルバックエンドが受け取った呼び出しの記録
+struct NullTextureUploadLog {
+	struct Upload {
+		uint32_t texture = 0; // createで割り当てた番号（srvDescriptor）
+		size_t mipLevel = 0;
+		size_t bytes = 0;
+	};
+	std::vector<Upload> uploads;
+	size_t createCount = 0;
+	size_t publishCount = 0;
+	size_t destroyCount = 0;
+};
+
+// GPUを使わず、呼び出しをlogに記録するだけのバックエンド（キューや予算の動作確認用）
+TextureUploadBackend CreateNullTextureUploadBackend(std::shared_ptr<NullTextureUploadLog> log = nullptr);
+
+struct AsyncTextureLoaderDesc {
+	std::string indexPath;                      // TextureCacheの対応表のファイル
+	size_t memoryBudgetBytes = 256ull << 20;    // 書き込み済みミップ（GPUに確保する量）の合計の上限
+	size_t uploadBytesPerUpdate = 8ull << 20;   // 1回のUpdateで書き込む量の目安（最低1ミップは書く）
+	uint32_t threadCount = 0;                   // デコードに使うスレッド数（0ならハードウェアスレッド数）
+};
+
+enum class TextureLoadState {
+	Loading,   // デコード待ち、またはデコード中
+	Streaming, // 一部のミップだけ書き込み済み（何も書いていなければプレースホルダー）
+	Resident,  // 全てのミップを書き込み済み
+	Failed,    // 読み込めなかった
+};
+
+struct AsyncTextureLoaderStats {
+	size_t loadingCount = 0;     // デコード待ち・デコード中のリクエスト
+	size_t streamingCount = 0;   // ミップを書き込み中のテクスチャ
+	size_t failedCount = 0;      // 読み込めなかったリクエストの累計
+	size_t residentBytes = 0;    // 書き込み済みのミップの合計（GPUに確保している量）
+	size_t stagedBytes = 0;      // CPU側に残している、まだ書き込んでいないミップの合計
+	size_t uploadedBytes = 0;    // 書き込んだ量の累計
+	size_t budgetStallCount = 0; // メモリ予算が足りずに書き込みを止めた回数
+};
+
+class AsyncTextureLoader {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle kInvalidHandle = UINT32_MAX;
+
+	// ワーカースレッドで呼ぶ読み込み処理（省略するとLoadTextureFile）
+	using LoadFunction = std::function<HRESULT(const std::string&, DirectX::ScratchImage&)>;
+
+	AsyncTextureLoader(const AsyncTextureLoaderDesc& desc, TextureUploadBackend backend, LoadFunction load = nullptr);
+	// 待っているデコードは捨て、実行中のデコードが終わるまで待つ
+	~AsyncTextureLoader();
+
+	AsyncTextureLoader(const AsyncTextureLoader&) = delete;
+	AsyncTextureLoader& operator=(const AsyncTextureLoader&) = delete;
+
+	// 読み込みを予約して参照カウントを1増やす（同じパスなら同じハンドル）。priorityが大きいほど先に処理する
+	Handle Request(const std::string& filePath, int priority = 0);
+	// 優先度を変える（デコード待ちの順番と、ミップを書き込む順番に効く）
+	void SetPriority(Handle handle, int priority);
+	// 参照カウントを1減らす。0になったらデコード待ちから外し、テクスチャをTextureCacheに返す
+	void Release(Handle handle);
+	// 参照されていないテクスチャを破棄する（GPUが使い終わってから呼ぶ）
+	void Trim();
+
+	// メインスレッドで毎フレーム呼ぶ。デコードが終わったものを受け取り、ミップを書き込む
+	void Update();
+	// 待っているデコードが全て終わるまで待つ（結果は次のUpdateで受け取る）
+	void WaitForDecodes();
+
+	TextureLoadState GetState(Handle handle) const;
+	// 1つ以上のミップが見えるならtrue
+	bool IsReady(Handle handle) const;
+	// 見えている一番細かいミップ（何も見えていなければSIZE_MAX）
+	size_t GetMostDetailedMip(Handle handle) const;
+	// 描画に使うSRV（まだ見えなければプレースホルダー）
+	D3D12_GPU_DESCRIPTOR_HANDLE GetSrvHandle(Handle handle) const;
+	// デコード待ちも書き込み途中のテクスチャも無ければtrue
+	bool IsIdle() const;
+
+	TextureCache& GetCache() { return cache_; }
+	const AsyncTextureLoaderStats& GetStats() const { return stats_; }
+
+private:
+	struct RequestEntry {
+		std::string filePath;
+		std::string key;
+		int priority = 0;
+		uint32_t refCount = 0;
+		bool alive = false;
+		bool decoding = false; // ワーカーに渡した（結果を受け取るまでハンドルを使い回さない）
+		bool failed = false;
+		TextureCache::Handle texture = TextureCache::kInvalidHandle;
+	};
+	// TextureCacheのテクスチャごとの書き込み状況
+	struct Stream {
+		std::vector<DirectX::ScratchImage> mips; // ミップごとのデコード結果（書き込んだものから空にする）
+		DirectX::TexMetadata metadata;
+		size_t mostDetailedMip = 0;  // 書き込み済みの一番細かいミップ（mipLevelsなら未書き込み）
+		size_t residentBytes = 0;
+		int priority = 0;
+	};
+	// ワーカーとの受け渡し（mutex_で守る）
+	struct DecodeTask {
+		Handle handle = kInvalidHandle;
+		int priority = 0;
+		uint64_t order = 0; // 同じ優先度なら先に頼んだ方から
+		std::string filePath;
+	};
+	struct DecodeResult {
+		Handle handle = kInvalidHandle;
+		HRESULT hr = S_OK;
+		DirectX::ScratchImage image;
+	};
+
+	void DecodeNext();
+	void ReceiveDecodes();
+	void StreamMips();
+	void FreeRequest(Handle handle);
+
+	TextureUploadBackend backend_;
+	LoadFunction load_;
+	size_t memoryBudgetBytes_;
+	size_t uploadBytesPerUpdate_;
+
+	TextureCache cache_;
+	std::unordered_map<TextureCache::Handle, Stream> streams_;
+	// cache_の作成処理で作ったStream（ハンドルが決まってから登録する）
+	std::unique_ptr<Stream> pendingStream_;
+
+	std::vector<RequestEntry> requests_;
+	std::vector<Handle> freeRequests_;
+	std::unordered_map<std::string, Handle> keyToRequest_;
+	AsyncTextureLoaderStats stats_;
+
+	mutable std::mutex mutex_;
+	std::vector<DecodeTask> decodeQueue_;
+	std::vector<DecodeResult> decodeResults_;
+	uint64_t nextOrder_ = 0;
+	bool cancelled_ = false;
+
+	// 最後に宣言して最初に破棄する（ワーカーを止めてから他のメンバーを壊す）
+	ThreadPool threadPool_;
+};
+
+// -testtextures用。ヌルバックエンドと偽の読み込み処理で、デコードの順番、小さいミップからの書き込み、
+// 1回のUpdateの量とメモリ予算、重複の共有、失敗、破棄を確かめる
+std::vector<SelfTestResult> RunAsyncTextureLoaderSelfTest();
+
+#endif // ASYNCTEXTURELOADER_H
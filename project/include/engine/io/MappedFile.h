@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// 読み込み専用のメモリマップドファイル
+// ファイル全体をアドレス空間に割り当て、コピーせずに参照する
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// ファイルを開いてマップする。失敗したらfalse
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool IsOpen() const { return isOpen_; }
+	const char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool isOpen_ = false;
+#ifdef _WIN32
+	void* fileHandle_ = nullptr;
+	void* mappingHandle_ = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,170 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "engine/3d/MeshOptimizer.h"
+#include "engine/3d/ModelData.h"
+#include "engine/io/MappedFile.h"
+
+class ThreadPool;
+
+// OBJを読み込んだ結果を保存するバイナリキャッシュ
+// 2回目以降はファイルをメモリマップするだけで、頂点・インデックスをそのまま参照できる
+//
+// ファイル構成（先頭から）
+//   MeshCacheHeader
+//   MeshCacheMeshEntry      x meshCount
+//   MeshCacheMaterialEntry  x materialCount
+//   MeshLod                 x lodCount（メッシュごとのLODの範囲。最低1つ）
+//   文字列テーブル（メッシュ名・マテリアル名・テクスチャパス・mtllibのファイル名）
+//   頂点ブロブ（VertexData の配列、16バイト境界）
+//   インデックスブロブ（uint32_t の配列、16バイト境界。メッシュごとに全LODを連結）
+
+// どちらのローダーで読んだデータか（Multiは座標系の変換が違うので別キャッシュ）
+enum class MeshCacheLayout : uint32_t {
+	Single, // LoadObjFile
+	Multi,  // LoadObjFileMulti
+};
+
+// キャッシュの無効化に使う元ファイルの情報
+struct MeshCacheSource {
+	uint64_t size = 0;
+	int64_t writeTime = 0;
+	uint64_t hash = 0; // 0なら未計算
+};
+
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t layout;
+	uint32_t vertexStride; // sizeof(VertexData)。構造体が変わったら作り直す
+	uint64_t sourceSize;
+	int64_t sourceWriteTime;
+	uint64_t sourceHash;
+	uint32_t meshCount;
+	uint32_t materialCount;
+	uint64_t lodTableOffset;
+	uint32_t lodCount;
+	uint32_t padding;
+	uint64_t stringTableOffset;
+	uint64_t stringTableSize;
+	uint64_t vertexBlobOffset;
+	uint64_t vertexCount;
+	uint64_t indexBlobOffset;
+	uint64_t indexCount;
+	// マテリアルはmtlから読むので、mtlの変更でも作り直す（mtllibが無ければ全て0）
+	uint64_t materialSourceSize;
+	int64_t materialSourceWriteTime;
+	uint64_t materialSourceHash;
+	uint32_t materialLibraryOffset; // 文字列テーブル内のmtlのファイル名（OBJと同じフォルダからの相対パス）
+	uint32_t materialLibraryLength;
+};
+
+struct MeshCacheMeshEntry {
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t materialNameOffset;
+	uint32_t materialNameLength;
+	uint64_t firstVertex; // 頂点ブロブ内の位置（要素数）
+	uint64_t vertexCount;
+	uint64_t firstIndex;  // インデックスブロブ内の位置（要素数）
+	uint64_t indexCount;  // 全LODの合計
+	uint32_t firstLod;    // LODテーブル内の位置
+	uint32_t lodCount;
+};
+
+struct MeshCacheMaterialEntry {
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t texturePathOffset;
+	uint32_t texturePathLength;
+	Vector4 color;
+	int32_t lightingMode;
+	float padding[3];
+	Matrix4x4 uvTransform;
+};
+
+// キャッシュ内の1メッシュ（ポインタはキャッシュのメモリを直接指す）
+struct MeshCacheMesh {
+	std::string_view name;
+	std::string_view materialName;
+	const VertexData* vertices;
+	size_t vertexCount;
+	const uint32_t* indices;
+	size_t indexCount; // 全LODの合計（アップロードする量）
+	const MeshLod* lods; // firstIndexはindicesからの位置。lods[0]が元の解像度
+	uint32_t lodCount;
+};
+
+// 開いたキャッシュへの読み取り専用ビュー
+class MeshCacheView {
+public:
+	MeshCacheView() = default;
+
+	// キャッシュファイルを開いて形式を検証する
+	bool Open(const std::string& cachePath);
+	// シリアライズ済みのバッファをそのまま使う（キャッシュを書けなかった時用）
+	bool Adopt(std::vector<char> buffer);
+
+	bool IsOpen() const { return header_ != nullptr; }
+	// 元ファイルの情報と一致するか（size/mtimeが違えばハッシュで確認する）
+	bool IsValidFor(const MeshCacheSource& source) const;
+	// mtlファイルの情報と一致するか（判定はIsValidForと同じ）
+	bool IsMaterialValidFor(const MeshCacheSource& materialSource) const;
+	// mtllibのファイル名（無ければ空）
+	std::string_view GetMaterialLibrary() const;
+
+	const MeshCacheHeader& GetHeader() const { return *header_; }
+	uint32_t GetMeshCount() const { return header_->meshCount; }
+	MeshCacheMesh GetMesh(uint32_t index) const;
+
+	// マテリアル表を復元する
+	std::unordered_map<std::string, Material> LoadMaterials() const;
+	// 単一モデル用のマテリアル（先頭のテクスチャパス）
+	MaterialData LoadMaterialData() const;
+
+	size_t GetSizeInBytes() const { return size_; }
+
+private:
+	bool Validate();
+	std::string_view GetString(uint32_t offset, uint32_t length) const;
+
+	MappedFile file_;
+	std::vector<char> ownedBuffer_;
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	const MeshCacheHeader* header_ = nullptr;
+};
+
+// 元ファイルのサイズと更新時刻を取得する（hashは計算しない）
+MeshCacheSource GetMeshCacheSource(const std::string& sourcePath);
+// 元ファイル全体のハッシュ（FNV-1a 64bit）
+uint64_t ComputeSourceHash(const std::string& sourcePath);
+
+// キャッシュのバイト列を作る（materialSourceはmodel.materialLibraryのファイルの情報）
+std::vector<char> SerializeMeshCache(const MultiModelData& model, MeshCacheLayout layout, const MeshCacheSource& source,
+	const MeshCacheSource& materialSource = {});
+std::vector<char> SerializeMeshCache(const ModelData& model, const MeshCacheSource& source, const MeshCacheSource& materialSource = {});
+
+// キャッシュファイルのパス（directoryPath/.meshcache/filename.*.cgmesh）
+std::string GetMeshCachePath(const std::string& directoryPath, const std::string& filename, MeshCacheLayout layout);
+
+// キャッシュを作り直したときの、メッシュごとの頂点キャッシュ最適化の前後の統計
+struct MeshCacheOptimizeReport {
+	std::string meshName; // Singleでは空
+	MeshOptimizeReport report;
+};
+
+// キャッシュ経由でOBJを開く
+// OBJとmtlの両方が変わっていなければマップするだけ。どちらかが変わっていればOBJを読み込んでキャッシュを書き出す
+// threadPoolはMultiの読み込み直しに使う（nullptrなら呼び出し元のスレッドだけで読む）
+// optimizeReportsには作り直したときだけメッシュの順に統計を入れる（マップしただけなら空）
+MeshCacheView LoadObjFileCached(const std::string& directoryPath, const std::string& filename, MeshCacheLayout layout,
+	ThreadPool* threadPool = nullptr, std::vector<MeshCacheOptimizeReport>* optimizeReports = nullptr);
+
+#endif // MESHCACHE_H
@@ -0,0 +1,50 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/3d/ModelData.h"
+
+class ThreadPool;
+
+// OBJ/MTLファイルの読み込み
+// ファイルはメモリマップして、その場でトークン分割する（1行ごとのヒープ確保なし）
+
+// mtlファイルからテクスチャパスだけを読む
+MaterialData LoadMaterialTemplate(const std::string& directoryPath, const std::string& filename);
+
+// mtlファイルの全マテリアルを読む（マテリアル名がキー）
+std::unordered_map<std::string, Material> LoadMaterialTemplateMulti(
+	const std::string& directoryPath, const std::string& filename);
+
+// 単一メッシュとして読み込む
+ModelData LoadObjFile(const std::string& directoryPath, const std::string& filename);
+
+// g/o/usemtl 単位でメッシュを分けて読み込む
+MultiModelData LoadObjFileMulti(const std::string& directoryPath, const std::string& filename);
+
+// LoadObjFileMultiの並列版。改行位置でチャンクに分けてワーカースレッドで読み、
+// ファイル順に結合する。結果はLoadObjFileMultiと完全に一致する
+// スレッドプールは呼び出し元のものを使う（読み込みごとにスレッドを作らない）。nullptrなら呼び出し元のスレッドだけで読む
+MultiModelData LoadObjFileMultiParallel(const std::string& directoryPath, const std::string& filename, ThreadPool* threadPool);
+
+// OBJ読み込みの速度計測の結果（1ファイル・1ローダー分）
+struct ObjLoadBenchmarkResult {
+	std::string file;         // 読んだファイル名
+	const char* loader = "";  // 計ったローダーの名前
+	size_t fileBytes = 0;
+	uint32_t threadCount = 1;
+	double megabytesPerSecond = 0.0; // 3回読んだうちの最速
+	size_t vertexCount = 0;   // 全メッシュの頂点数の合計
+	size_t indexCount = 0;
+	bool identical = true;    // 結果がLoadObjFileMultiと完全に一致したか（並列版のみ比べる）
+};
+
+// resourceDirectoryのteapot.obj/suzanne.objと、一時フォルダに合成した大きなOBJ（約10MB・50MB・約200万面の200MB）を
+// 各ローダーで読み、MB/sを測る（-benchobj）。並列版は呼び出し元を含めて1/2/4/8/16スレッドで測る
+std::vector<ObjLoadBenchmarkResult> RunObjLoadBenchmark(const std::string& resourceDirectory);
+
+#endif // OBJLOADER_H
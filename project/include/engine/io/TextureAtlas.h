@@ -0,0 +1,80 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DirectXTex.h"
+#include "engine/math/MathTypes.h"
+
+class ThreadPool;
+
+// 小さいテクスチャ（スプライトやマテリアル）を共有のページにまとめるアトラス
+// ・配置はimstb_rectpack（Skyline）で決め、入り切らなければ次のページを作る
+// ・各テクスチャの周りに端のピクセルを引き伸ばしたガターを付ける（バイリニアで隣が滲まない）
+// ・位置と大きさを2^(mipLevels-1)の倍数に揃えてからボックスフィルタでミップを作るので、
+//   どのミップでも隣のテクスチャと混ざらず、最後のミップでもガターが1ピクセル以上残る
+// ・元のUV(0〜1)にregionのuvTransformを掛けるとページ上のUVになる（Material.uvTransformに掛け合わせる）
+//   繰り返し（0〜1の外）のUVはアトラスでは使えない
+
+constexpr uint32_t kAtlasNotPacked = UINT32_MAX;
+
+struct TextureAtlasDesc {
+	uint32_t pageSize = 2048;   // ページの幅と高さ（2のべき乗）
+	uint32_t padding = 4;       // 周りのガターの幅（ピクセル）。揃える単位より小さければ単位まで広げる
+	uint32_t mipLevels = 3;     // ページのミップ数
+	uint32_t maxInputSize = 512; // 幅か高さがこれより大きいテクスチャは載せない
+	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM; // 入力とページの形式（違う形式の入力は載せない）
+};
+
+struct TextureAtlasRegion {
+	uint32_t page = kAtlasNotPacked;
+	// ページ内の中身の位置（ガターは含まない）
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	// ガターと揃えの余りを含めた、このテクスチャが占める範囲
+	uint32_t cellX = 0;
+	uint32_t cellY = 0;
+	uint32_t cellWidth = 0;
+	uint32_t cellHeight = 0;
+	Matrix4x4 uvTransform{}; // 元のUV→ページのUV
+};
+
+struct TextureAtlasStats {
+	size_t packedCount = 0;
+	size_t rejectedCount = 0; // 大きすぎる・形式が違うなどで載せなかった数
+	size_t pageCount = 0;
+	size_t contentPixels = 0; // 中身の合計
+	size_t cellPixels = 0;    // ガターと揃えの余りを含めた合計
+	size_t pagePixels = 0;    // ページの合計
+	float efficiency = 0.0f;  // contentPixels / pagePixels
+};
+
+struct TextureAtlas {
+	std::vector<DirectX::ScratchImage> pages; // ミップ込み
+	std::vector<TextureAtlasRegion> regions;  // 入力と同じ順番（載せなかったものはpageがkAtlasNotPacked）
+	TextureAtlasStats stats;
+};
+
+// imagesをページにまとめる（threadPoolはページのミップマップ作成に使う。nullptrなら1スレッド）
+HRESULT BuildTextureAtlas(const std::vector<const DirectX::Image*>& images, const TextureAtlasDesc& desc, TextureAtlas& atlas,
+	ThreadPool* threadPool = nullptr);
+
+// 各テクスチャの範囲がページ内に収まって重なっておらず、揃えとガターの幅が守られていればtrue
+bool ValidateTextureAtlas(const TextureAtlas& atlas, const TextureAtlasDesc& desc);
+
+// 乱数の大きさのテクスチャをまとめたときの結果（-benchatlas）
+struct TextureAtlasBenchmarkResult {
+	size_t inputCount = 0;
+	uint32_t minSize = 0;
+	uint32_t maxSize = 0;
+	TextureAtlasStats stats;
+	double milliseconds = 0.0;
+	bool valid = false; // ValidateTextureAtlasの結果と、ガターの中身が端のピクセルと一致するか
+};
+
+std::vector<TextureAtlasBenchmarkResult> RunTextureAtlasBenchmark();
+
+#endif // TEXTUREATLAS_H
@@ -0,0 +1,135 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <d3d12.h>
+#include <wrl/client.h>
+#include "DirectXTex.h"
+
+// 読み込んだテクスチャを中身のハッシュで管理するキャッシュ
+// ・パスが違っても中身（デコード後、またはクック済みのデータ）が同じなら1つのGPUリソースを共有する
+//   ハッシュが同じでも形式・大きさ・ミップ数が違えば別物とし、小さいテクスチャはピクセルも比べる
+// ・パスはフォルダ込みで区別する（別フォルダの同名ファイルがぶつからない）
+// ・パス→ハッシュの対応はファイルに保存する。サイズと更新時刻が同じなら、
+//   次回からはデコードする前に中身が分かるので、既に読み込み済みならデコードを丸ごと省ける
+// ・参照カウントが0になったものはTrimを呼ぶまで残す（同じテクスチャを再び使うときは読み直さない）
+
+// GPU側のテクスチャ（作成・破棄はmain側で用意する）
+struct TextureGpuResource {
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	D3D12_GPU_DESCRIPTOR_HANDLE srvHandle{};
+	uint32_t srvDescriptor = 0; // SRVのディスクリプタ（mainではDescriptorAllocatorのハンドル）
+};
+
+struct TextureCacheStats {
+	size_t requestCount = 0;      // Acquireの回数
+	size_t hitCount = 0;          // 同じパスが読み込み済みだった回数
+	size_t decodeCount = 0;       // 実際にデコードした回数
+	size_t decodeSkipCount = 0;   // 保存した対応表で中身が分かり、デコードを省いた回数
+	size_t deduplicatedCount = 0; // 別のパスで同じ中身が読み込み済みだった回数
+	size_t residentCount = 0;     // 保持している（中身の違う）テクスチャの数
+	size_t residentBytes = 0;     // 保持しているピクセルの合計
+	size_t bytesSaved = 0;        // 重複を共有したことで作らずに済んだバイト数
+	size_t hashCollisionCount = 0; // ハッシュは同じだが中身が違った回数
+};
+
+class TextureCache {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle kInvalidHandle = UINT32_MAX;
+
+	// 新しい中身のテクスチャを作る。画像は引き取ってよい（少しずつアップロードする場合など）
+	using CreateFunction = std::function<TextureGpuResource(DirectX::ScratchImage&&)>;
+	using DestroyFunction = std::function<void(TextureGpuResource&)>;
+
+	// indexPathはパス→ハッシュの対応表のファイル（無ければ新しく作る）
+	TextureCache(const std::string& indexPath, CreateFunction create, DestroyFunction destroy = nullptr);
+
+	// テクスチャを読み込んで参照カウントを1増やす。読み込めなければkInvalidHandle
+	Handle Acquire(const std::string& filePath);
+	// デコードせずに済む場合だけ参照カウントを1増やす（読み込み済みのパス、または対応表から中身が読み込み済みと分かる場合）
+	// デコードが必要ならkInvalidHandle
+	Handle AcquireIfKnown(const std::string& filePath);
+	// 別のスレッドなどでデコードした画像を登録して参照カウントを1増やす
+	Handle AcquireDecoded(const std::string& filePath, DirectX::ScratchImage&& image);
+	// 参照カウントを1減らす
+	void Release(Handle handle);
+	// 参照カウントが0のテクスチャを破棄する（GPUが使い終わってから呼ぶ）
+	void Trim();
+
+	// パスから読み込み済みのハンドルを探す（参照カウントは変えない）
+	Handle Find(const std::string& filePath) const;
+	const TextureGpuResource& GetResource(Handle handle) const { return entries_[handle].gpu; }
+	TextureGpuResource& GetResource(Handle handle) { return entries_[handle].gpu; }
+	D3D12_GPU_DESCRIPTOR_HANDLE GetSrvHandle(Handle handle) const { return entries_[handle].gpu.srvHandle; }
+	uint64_t GetContentHash(Handle handle) const { return entries_[handle].content.hash; }
+	uint32_t GetRefCount(Handle handle) const { return entries_[handle].refCount; }
+
+	// 対応表に変更があれば保存する
+	bool SaveIndex();
+
+	const TextureCacheStats& GetStats() const { return stats_; }
+
+private:
+	// 中身を見分けるための値（ハッシュと、ハッシュが偶然一致しても区別できる形式・大きさ）
+	struct ContentKey {
+		uint64_t hash = 0;
+		uint64_t width = 0;
+		uint64_t height = 0;
+		uint64_t mipLevels = 0;
+		uint32_t format = 0;
+
+		bool operator==(const ContentKey& other) const {
+			return hash == other.hash && width == other.width && height == other.height &&
+				mipLevels == other.mipLevels && format == other.format;
+		}
+	};
+	struct Entry {
+		ContentKey content;
+		size_t bytes = 0;
+		std::vector<uint8_t> pixels; // 比べるために残すピクセル（kComparePixelBytes以下のときだけ）
+		uint32_t refCount = 0;
+		bool alive = false;
+		TextureGpuResource gpu;
+	};
+	// 保存する対応表の1行（実際に読むファイルのサイズと更新時刻で有効か判定する）
+	struct IndexRecord {
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		ContentKey content;
+	};
+	// この大きさ以下のテクスチャは、ハッシュが一致したときにピクセルも比べる
+	static constexpr size_t kComparePixelBytes = 64 * 1024;
+
+	void LoadIndex();
+	// 同じ中身のテクスチャを探す。imageがあれば、残してあるピクセルとも比べる（無ければピクセルを残したものは対象外）
+	Handle FindContent(const ContentKey& content, const DirectX::ScratchImage* image);
+	Handle AddReference(Handle handle, const std::string& key);
+	// 実際に読むファイル（最新のDDSがあればそちら）のサイズと更新時刻
+	static bool GetDataStamp(const std::string& filePath, IndexRecord& record);
+
+	std::string indexPath_;
+	CreateFunction create_;
+	DestroyFunction destroy_;
+
+	std::vector<Entry> entries_;
+	std::vector<Handle> freeHandles_;
+	std::unordered_multimap<uint64_t, Handle> hashToHandle_;
+	std::unordered_map<std::string, Handle> pathToHandle_;
+	std::unordered_map<std::string, IndexRecord> index_;
+	bool indexDirty_ = false;
+	TextureCacheStats stats_;
+};
+
+// 同じパスとして扱うためのキー（区切りを/に揃え、./や../を畳み、小文字にする）
+std::string NormalizeTexturePath(const std::string& filePath);
+
+// テクスチャの中身のハッシュ（形式・大きさ・全ミップのピクセル）
+uint64_t ComputeTextureContentHash(const DirectX::ScratchImage& image);
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,86 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DirectXTex.h"
+
+class ThreadPool;
+
+// PNGなどの画像を、ミップマップ付き・BC圧縮済みのDDSに変換する（オフライン用）
+// 変換したDDSは元画像と同じフォルダに拡張子だけ変えて置く（resources/uvChecker.png → resources/uvChecker.dds）
+// LoadTextureはDDSが元画像より新しければそれを読み、無ければ従来どおり実行時にミップマップを作る
+// クックしたときの設定はDDSの横のテキスト（resources/uvChecker.cook）に残し、設定が変わればDDSを作り直す
+
+enum class TextureCompression {
+	Auto, // 不透明ならBC1、アルファがあればBC3
+	None, // 圧縮しない（ミップマップだけ作る）
+	BC1,
+	BC3,
+	BC7,
+};
+
+// ミップマップの作り方や圧縮のフラグなど、同じ設定でも出力が変わる変更をしたら上げる
+constexpr uint32_t kTextureCookVersion = 1;
+
+// クックしたときの設定（.cookファイルの中身）
+struct TextureCookParameters {
+	uint32_t version = kTextureCookVersion;
+	TextureCompression compression = TextureCompression::Auto; // 指定された圧縮形式
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;                    // 書き出した形式
+	size_t mipLevels = 0;
+	uintmax_t sourceSize = 0; // 元画像のサイズ（書き換えで更新時刻が戻っても気づけるように）
+};
+
+struct TextureCookResult {
+	std::string sourcePath;
+	std::string cookedPath;
+	bool succeeded = false;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	size_t uncompressedBytes = 0; // ミップマップ込みの非圧縮サイズ
+	size_t cookedBytes = 0;       // ミップマップ込みの圧縮後サイズ
+	double milliseconds = 0.0;
+};
+
+// 元画像に対応するDDSのパス
+std::string GetCookedTexturePath(const std::string& sourcePath);
+
+// 元画像に対応する.cookファイルのパス
+std::string GetCookParametersPath(const std::string& sourcePath);
+
+// DDSが存在し、元画像より新しく、.cookの設定が今のバージョン・元画像・DDSの中身と合っていればtrue
+// compressionを渡すと、その圧縮形式でクックしたものだけを最新とみなす（nullptrなら形式は問わない）
+bool IsCookedTextureUpToDate(const std::string& sourcePath, const TextureCompression* compression = nullptr);
+
+// 1枚変換する（threadPoolはミップマップの作成に使う。nullptrなら1スレッド）
+TextureCookResult CookTexture(const std::string& sourcePath, TextureCompression compression = TextureCompression::Auto,
+	ThreadPool* threadPool = nullptr);
+
+// フォルダ内のPNGを全て変換する。forceがfalseなら同じ圧縮形式で作った最新のDDSがあるものは飛ばす
+std::vector<TextureCookResult> CookTextures(const std::string& directory,
+	TextureCompression compression = TextureCompression::Auto, bool force = false);
+
+// コマンドライン（-cook [-bc1|-bc3|-bc7|-nocompress] [-force]）から圧縮形式を読む
+TextureCompression ParseTextureCompression(const std::string& commandLine);
+
+// BC圧縮の速度計測の結果（1形式・1サイズ分）
+struct TextureCompressBenchmarkResult {
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	size_t width = 0;
+	size_t height = 0;
+	double serialMegapixelsPerSecond = 0.0;
+	double parallelMegapixelsPerSecond = 0.0;
+	bool identical = false; // 並列版の出力が1スレッド版とバイト単位で一致したか
+};
+
+// 2K・4Kの合成画像をBC1/BC3/BC5/BC7で、1スレッドと並列（TEX_COMPRESS_PARALLEL）で圧縮して比べる（-benchbc）
+std::vector<TextureCompressBenchmarkResult> RunTextureCompressBenchmark();
+
+// テクスチャを読み込む。最新のDDSがあればそれを読み、無ければ元画像からミップマップを作る
+DirectX::ScratchImage LoadTexture(const std::string& filePath);
+// LoadTextureと同じだが、失敗してもassertせずHRESULTを返す（ワーカースレッド用）
+HRESULT LoadTextureFile(const std::string& filePath, DirectX::ScratchImage& image);
+
+#endif // TEXTURECOOKER_H
@@ -0,0 +1,47 @@
+#ifndef TEXTUREMIPMAPS_H
+#define TEXTUREMIPMAPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DirectXTex.h"
+
+class ThreadPool;
+
+// よく使う形式のミップマップを専用のカーネルで作る（DirectX::GenerateMipMapsの高速版）
+// ・RGBA8/BGRA8のUNORMは整数のまま、SSE2で4ピクセルずつ縮小する
+// ・RGBA8/BGRA8のsRGBはテーブルで線形に戻してから平均し、テーブルでsRGBに戻す（ガンマを考慮した平均）
+// ・RGBA32Fはfloatのまま縮小する
+// ・各レベルは行ごとに、呼び出し側のスレッドプールで分けて計算する（ローダーのワーカーなどからはプール無しで1スレッド）
+// 幅と高さが2のべき乗でない場合や、それ以外の形式はDirectX::GenerateMipMapsに任せる
+
+enum class MipFilter {
+	Box,      // 2x2の平均（TEX_FILTER_BOXと同じ）
+	Triangle, // 1:7:7:1の重みで縦横に縮小（2:1縮小のときのTEX_FILTER_TRIANGLEと同じ）
+};
+
+// 高速パスで作れる形式・大きさならtrue
+bool CanGenerateMipMapsFast(DXGI_FORMAT format, size_t width, size_t height);
+
+// baseImageからミップマップを作る（levelsが0なら1x1まで）。threadPoolがnullptrなら呼び出したスレッドだけで作る
+// 高速パスで扱えない場合はDirectX::GenerateMipMapsで作る
+HRESULT GenerateMipMapsFast(const DirectX::Image& baseImage, MipFilter filter, size_t levels,
+	DirectX::ScratchImage& mipChain, ThreadPool* threadPool = nullptr);
+
+// 高速版と従来の経路（DirectX::GenerateMipMaps）の比較結果（-benchmip）
+struct MipMapBenchmarkResult {
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	MipFilter filter = MipFilter::Box;
+	size_t width = 0;
+	size_t height = 0;
+	double referenceMilliseconds = 0.0;
+	double fastMilliseconds = 0.0;
+	float maxError = 0.0f; // 全レベルの最大誤差（8bitは段階数、RGBA32Fは値の差。失敗したら負）
+	float tolerance = 0.0f; // 形式とフィルタごとの許容誤差（maxErrorが超えたら-benchmipは失敗する）
+};
+
+// 2048x2048のRGBA8/sRGB/RGBA32F画像で、ボックスと三角フィルタをそれぞれ比べる
+// 許容誤差は8bitのボックスが2段階（丸めの違いが次のレベルに持ち越される）、他の8bitは1段階、RGBA32Fは1e-6
+std::vector<MipMapBenchmarkResult> RunMipMapBenchmark();
+
+#endif // TEXTUREMIPMAPS_H
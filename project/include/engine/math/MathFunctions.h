@@ -0,0 +1,75 @@
+#ifndef MATHFUNCTIONS_H
+#define MATHFUNCTIONS_H
+
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/math/MathTypes.h"
+
+// 単位行列の作成
+Matrix4x4 MakeIdentity4x4();
+
+// 4x4行列の積（x86/x64ではSSE2。スカラー版とビット単位で一致する）
+Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2);
+
+// 行ベクトル × 行列
+Vector4 Multiply(const Vector4& v, const Matrix4x4& m);
+
+// 座標変換（w=1として変換し、wで割る）
+Vector3 TransformPoint(const Vector3& v, const Matrix4x4& m);
+
+// 方向の変換（w=0、平行移動は無視）
+Vector3 TransformDirection(const Vector3& v, const Matrix4x4& m);
+
+// 拡大縮小
+Matrix4x4 MakeScaleMatrix(const Vector3& scale);
+
+// 平行移動
+Matrix4x4 MakeTranslateMatrix(const Vector3& translate);
+
+// X,Y,Z軸回転行列
+Matrix4x4 MakeRotateXMatrix(float angle);
+Matrix4x4 MakeRotateYMatrix(float angle);
+Matrix4x4 MakeRotateZMatrix(float angle);
+
+// アフィン変換行列
+// 回転行列を積で合成する旧実装とは0の符号を除いて一致する（0ULP）
+Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate);
+
+// 逆行列の誤差の上限（-testmathで確かめる）
+// 結果の各要素と正確な逆行列 inv との差は kInverseErrorBound * κ(m) * FLT_EPSILON * max|inv| 以内
+// κ(m) = ‖m‖∞‖inv‖∞（行の絶対値和の最大どうしの積）。アフィン行列は左上3x3だけで測る
+inline constexpr double kInverseErrorBound = 4.0;
+
+// 4x4行列の逆行列を計算
+// 計算順が変わったので旧実装（余因子展開）とはビット単位では一致しない。誤差はkInverseErrorBoundの範囲
+Matrix4x4 Inverse(const Matrix4x4& m);
+
+// アフィン変換行列（カメラ・ワールド行列など4列目が(0,0,0,1)）の逆行列。Inverseより速い
+// 誤差はInverseと同じくkInverseErrorBoundの範囲
+Matrix4x4 InverseAffine(const Matrix4x4& m);
+
+// 透視投影行列
+Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip);
+
+// 平行投影行列（左手座標系）
+Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip);
+
+// 正規化
+Vector3 Normalize(const Vector3& v);
+
+// -testmath用。乱数の行列でSSE版・展開した式と元のスカラー版を比べる
+// 逆行列はdouble精度の結果との誤差をkInverseErrorBoundで、SimdSinCosはdoubleのsin/cosとの差を確かめる
+std::vector<SelfTestResult> RunMathSelfTest();
+
+// 元のスカラー版と今の実装の速度の比較結果（1つの関数分）
+struct MathBenchmarkResult {
+	const char* name = "";
+	double referenceNanoseconds = 0.0; // 1回あたり。3回測ったうちの最速
+	double fastNanoseconds = 0.0;
+};
+
+// 乱数の行列・変換でMultiply（行列・ベクトル）、Inverse、InverseAffine（比較対象は余因子展開のInverse）、
+// MakeAffineMatrixを元のスカラー版と比べる（-benchmath）
+std::vector<MathBenchmarkResult> RunMathBenchmark();
+
+#endif // MATHFUNCTIONS_H
@@ -0,0 +1,89 @@
+#ifndef MATHSIMD_H
+#define MATHSIMD_H
+
+#include "engine/math/MathTypes.h"
+
+// 数学関数の内部で使うSSE2の補助関数
+// x86/x64ではSSE2で計算する（それ以外はMATH_USE_SSE2が0になり、各関数はスカラー版を使う）
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define MATH_USE_SSE2 0
+#endif
+
+// SimdSinCosの誤差の上限（-testmathで確かめる）
+inline constexpr float kSimdSinCosMaxInput = 8192.0f;
+inline constexpr double kSimdSinCosMaxAbsError = 1.1920928955078125e-7; // FLT_EPSILON
+
+#if MATH_USE_SSE2
+
+// _mm_shuffle_psの引数を読む順（x,y,z,w）で書くためのマクロ
+#define MATH_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE((w), (z), (y), (x)))
+#define MATH_SWIZZLE(v, x, y, z, w) MATH_SHUFFLE((v), (v), (x), (y), (z), (w))
+
+inline __m128 SimdLoadRow(const Matrix4x4& m, int row) {
+	return _mm_loadu_ps(m.m[row]);
+}
+
+inline void SimdStoreRow(Matrix4x4& m, int row, __m128 value) {
+	_mm_storeu_ps(m.m[row], value);
+}
+
+// 行ベクトル × 行列。スカラー版と同じく 0 + x0*m0 + x1*m1 + x2*m2 + x3*m3 の順に足す
+inline __m128 SimdMultiplyRow(__m128 row, __m128 m0, __m128 m1, __m128 m2, __m128 m3) {
+	__m128 result = _mm_setzero_ps();
+	result = _mm_add_ps(result, _mm_mul_ps(MATH_SWIZZLE(row, 0, 0, 0, 0), m0));
+	result = _mm_add_ps(result, _mm_mul_ps(MATH_SWIZZLE(row, 1, 1, 1, 1), m1));
+	result = _mm_add_ps(result, _mm_mul_ps(MATH_SWIZZLE(row, 2, 2, 2, 2), m2));
+	result = _mm_add_ps(result, _mm_mul_ps(MATH_SWIZZLE(row, 3, 3, 3, 3), m3));
+	return result;
+}
+
+// 4つの角度のsinとcosをまとめて求める（Cephesの多項式近似）
+// |x| < 8192 の範囲で真値との差は FLT_EPSILON 以内（絶対誤差。kSimdSinCosMaxAbsError）
+// 結果の絶対値が0.5以上なら2ULP以内。0に近い値（sinのnπ付近など）は絶対誤差で効くので、ULPで見ると大きくなる
+inline void SimdSinCos(__m128 x, __m128* outSin, __m128* outCos) {
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+	__m128 signSin = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	// π/4単位の象限を求める（偶数に丸める）
+	__m128i quadrant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+	quadrant = _mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(quadrant);
+
+	__m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(4)), 29));
+	__m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+		_mm_andnot_si128(_mm_sub_epi32(quadrant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+	__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+	signSin = _mm_xor_ps(signSin, swapSignSin);
+
+	// π/4を3つに分けて引き、精度を落とさずに [-π/4, π/4] へ寄せる
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+	__m128 z = _mm_mul_ps(x, x);
+	__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+	cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+	cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+	__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+	sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+	// 象限によってsinとcosの多項式を入れ替える
+	__m128 sinValue = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+	__m128 cosValue = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+	*outSin = _mm_xor_ps(sinValue, signSin);
+	*outCos = _mm_xor_ps(cosValue, signCos);
+}
+
+#endif // MATH_USE_SSE2
+
+#endif // MATHSIMD_H
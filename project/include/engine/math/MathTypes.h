@@ -0,0 +1,35 @@
+#ifndef MATHTYPES_H
+#define MATHTYPES_H
+
+// ベクター2
+struct Vector2 {
+	float x, y;
+};
+
+// ベクター3
+struct Vector3 {
+	float x, y, z;
+};
+
+// ベクター4
+struct Vector4 {
+	float x, y, z, w;
+};
+
+// クォータニオン（x,y,zが虚部、wが実部）
+struct Quaternion {
+	float x, y, z, w;
+};
+
+// 4x4行列の定義
+struct Matrix4x4 {
+	float m[4][4];
+};
+
+struct Transform {
+	Vector3 scale;
+	Vector3 rotate;
+	Vector3 translate;
+};
+
+#endif // MATHTYPES_H
@@ -0,0 +1,51 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include <cstddef>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/math/MathTypes.h"
+
+// クォータニオンによる回転
+// 行列はこのエンジンの行ベクトル規約（v * M）に合わせて作る
+// オイラー角はTransform.rotateと同じ順番（MakeAffineMatrixの Rx * Ry * Rz、X→Y→Zの順に回す）
+
+// 単位クォータニオン
+Quaternion IdentityQuaternion();
+
+// 積（rhsで回してからlhsで回す）
+Quaternion Multiply(const Quaternion& lhs, const Quaternion& rhs);
+
+// 共役・長さ・正規化・逆
+Quaternion Conjugate(const Quaternion& q);
+float Norm(const Quaternion& q);
+Quaternion Normalize(const Quaternion& q);
+Quaternion Inverse(const Quaternion& q);
+float Dot(const Quaternion& q0, const Quaternion& q1);
+
+// 任意軸回転（axisは正規化済み）
+Quaternion MakeRotateAxisAngleQuaternion(const Vector3& axis, float angle);
+
+// オイラー角（Transform.rotate）との変換
+Quaternion MakeQuaternionFromEuler(const Vector3& rotate);
+Vector3 MakeEulerFromQuaternion(const Quaternion& q);
+
+// 複数のオイラー角をまとめて変換する（x86/x64ではsin/cosを4つずつSSE2で求める）
+void MakeQuaternionsFromEuler(const Vector3* rotates, Quaternion* out, size_t count);
+
+// ベクトルを回転させる
+Vector3 RotateVector(const Vector3& v, const Quaternion& q);
+
+// 回転行列・アフィン変換行列（qは正規化済み）
+Matrix4x4 MakeRotateMatrix(const Quaternion& q);
+Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Quaternion& rotate, const Vector3& translate);
+
+// 球面線形補間（近い方の経路を通る）
+Quaternion Slerp(const Quaternion& q0, const Quaternion& q1, float t);
+// 線形補間して正規化する（Slerpより速いが、角速度は一定にならない）
+Quaternion Nlerp(const Quaternion& q0, const Quaternion& q1, float t);
+
+// -testmath用。オイラー角の行列との一致、Slerp/Nlerpの性質、まとめて変換した結果を乱数で確かめる
+std::vector<SelfTestResult> RunQuaternionSelfTest();
+
+#endif // QUATERNION_H
@@ -0,0 +1,84 @@
+#ifndef TRANSFORMSYSTEM_H
+#define TRANSFORMSYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "engine/base/SelfTest.h"
+#include "engine/math/MathTypes.h"
+
+// 定数バッファに送る行列（シェーダ側のTransformationMatrixと同じ並び）
+struct TransformationMatrix {
+	Matrix4x4 WVP;
+	Matrix4x4 World;
+};
+
+// 大量のオブジェクトのTransformをまとめて管理し、World行列とWVP行列を一括で計算する
+// ・scale/rotate/translateは成分ごとの配列（SoA）で持ち、4オブジェクトずつSSE2で計算する
+// ・変更されたオブジェクトだけ計算し直す。ビュー射影行列が変わったときは全てのWVPを作り直す
+//   （World行列はキャッシュを使うので、三角関数は計算しない）
+// ・結果は連続したTransformationMatrixの配列になるので、そのままアップロードできる
+// 回転の計算は近似のsin/cosを使うので、MakeAffineMatrixとの差は相対誤差1e-6程度
+class TransformSystem {
+public:
+	using Handle = uint32_t;
+
+	explicit TransformSystem(size_t reserveCount = 0);
+
+	// オブジェクトを追加して番号を返す（番号は0から順に振られる）
+	Handle Create(const Transform& transform);
+	size_t GetCount() const { return matrices_.size(); }
+
+	// 値が変わったときだけ計算対象に入れる
+	void SetTransform(Handle handle, const Transform& transform);
+	void SetScale(Handle handle, const Vector3& scale);
+	void SetRotate(Handle handle, const Vector3& rotate);
+	void SetTranslate(Handle handle, const Vector3& translate);
+	Transform GetTransform(Handle handle) const;
+
+	// 変更のあったオブジェクトのWorld/WVPを計算する
+	void Update(const Matrix4x4& viewProjection);
+
+	const TransformationMatrix& GetMatrix(Handle handle) const { return matrices_[handle]; }
+	const TransformationMatrix* GetMatrices() const { return matrices_.data(); }
+
+	// 直前のUpdateで計算し直した数（World行列, WVP行列）
+	size_t GetLastWorldUpdateCount() const { return lastWorldUpdateCount_; }
+	size_t GetLastWvpUpdateCount() const { return lastWvpUpdateCount_; }
+
+private:
+	void MarkDirty(Handle handle);
+	// indicesのオブジェクトのWorld行列を計算する。writeWvpならWVPも同時に書く
+	void UpdateWorld(const uint32_t* indices, size_t count, const Matrix4x4& viewProjection, bool writeWvp);
+	// 全オブジェクトのWVPをキャッシュしたWorld行列から作り直す
+	void UpdateAllWvp(const Matrix4x4& viewProjection);
+
+	std::vector<float> scaleX_, scaleY_, scaleZ_;
+	std::vector<float> rotateX_, rotateY_, rotateZ_;
+	std::vector<float> translateX_, translateY_, translateZ_;
+	std::vector<uint8_t> dirty_;
+	std::vector<uint32_t> dirtyList_;
+	std::vector<TransformationMatrix> matrices_;
+
+	Matrix4x4 viewProjection_ = {};
+	bool hasViewProjection_ = false;
+	size_t lastWorldUpdateCount_ = 0;
+	size_t lastWvpUpdateCount_ = 0;
+};
+
+// オブジェクトごとにMakeAffineMatrix・Multiplyを呼ぶ従来の経路とTransformSystem::Updateの速度の比較結果（1つの場面分）
+struct TransformBenchmarkResult {
+	const char* scenario = "";
+	size_t objectCount = 0;
+	size_t worldUpdateCount = 0; // 計算し直したWorld行列の数
+	size_t wvpUpdateCount = 0;
+	double milliseconds = 0.0;   // 1フレーム分。10回測ったうちの最速
+};
+
+// 10万個のオブジェクトで、従来の経路と、全て変更・1%だけ変更・ビュー射影行列だけ変更・変更無しのUpdateを測る（-benchtransform）
+std::vector<TransformBenchmarkResult> RunTransformBenchmark();
+
+// -testmath用。乱数のTransformで、World/WVPをMakeAffineMatrix・Multiplyの結果と比べ、変更分だけ計算し直すことも確かめる
+std::vector<SelfTestResult> RunTransformSystemSelfTest();
+
+#endif // TRANSFORMSYSTEM_H
@@ -1,15 +1,17 @@
-#include "Object3d.hlsli" // DirectionalLight 構造体を含む
+#include "Object3d.hlsli" // DirectionalLight 構造体とキーワードを含む
 
 cbuffer MaterialCB : register(b0)
 {
     float4 gMaterialColor;
-    int gEnableLighting;
+    int gEnableLighting; // ライティングはLIGHTING_MODEで決まる（レイアウトを合わせるために残す）
     float3 padding; // アライメント用
     float4x4 uvTransform;
 };
 
+#if HAS_UV
 Texture2D<float4> gTexture : register(t0);
 SamplerState gSampler : register(s0);
+#endif
 
 cbuffer DirectionalLightCB : register(b3)
 {
@@ -25,29 +27,27 @@ PixelShaderOutput main(VertexShaderOutput input)
 {
     PixelShaderOutput output;
 
+#if HAS_UV
     float2 uv = mul(float4(input.texcoord, 0.0f, 1.0f), uvTransform).xy;
     float4 tex = gTexture.Sample(gSampler, uv);
+#else
+    float4 tex = float4(1.0f, 1.0f, 1.0f, 1.0f); // UVの無いモデルはマテリアルの色だけ
+#endif
     float3 normal = normalize(input.normal);
-    float3 lightDir = normalize(-gDirectionalLight.direction);
-
-    if (gEnableLighting == 1)
-    { // Lambert
-        float NdotL = saturate(dot(normal, lightDir));
-        float3 litColor = gMaterialColor.rgb * gDirectionalLight.color.rgb * gDirectionalLight.intensity * NdotL;
-        output.color = float4(litColor, 1.0f) * tex;
-    }
-    else if (gEnableLighting == 2)
-    { // Half Lambert
-        float NdotL = dot(normal, lightDir);
-        float halfLambert = NdotL * 0.5 + 0.5;
-        float3 litColor = gMaterialColor.rgb * gDirectionalLight.color.rgb * gDirectionalLight.intensity * halfLambert * halfLambert;
-        output.color = float4(litColor, 1.0f) * tex;
-    }
-    else
-    {
-        output.color = gMaterialColor * tex;
-    }
+    float3 lightDir = normalize(-gDirectionalLight.direction.xyz);
+
+#if LIGHTING_MODE == LIGHTING_LAMBERT
+    float NdotL = saturate(dot(normal, lightDir));
+    float3 litColor = gMaterialColor.rgb * gDirectionalLight.color.rgb * gDirectionalLight.intensity * NdotL;
+    output.color = float4(litColor, 1.0f) * tex;
+#elif LIGHTING_MODE == LIGHTING_HALF_LAMBERT
+    float NdotL = dot(normal, lightDir);
+    float halfLambert = NdotL * 0.5 + 0.5;
+    float3 litColor = gMaterialColor.rgb * gDirectionalLight.color.rgb * gDirectionalLight.intensity * halfLambert * halfLambert;
+    output.color = float4(litColor, 1.0f) * tex;
+#else
+    output.color = gMaterialColor * tex;
+#endif
 
     return output;
 }
-
@@ -1,3 +1,5 @@
+#include "Object3d.hlsli" // VertexShaderOutput とキーワードを含む
+
 cbuffer TransformCB : register(b1)
 {
     float4x4 gWVP;
@@ -7,14 +9,9 @@ cbuffer TransformCB : register(b1)
 struct VertexShaderInput
 {
     float4 position : POSITION0;
+#if HAS_UV
     float2 texcoord : TEXCOORD0;
-    float3 normal : NORMAL0;
-};
-
-struct VertexShaderOutput
-{
-    float4 position : SV_POSITION;
-    float2 texcoord : TEXCOORD0;
+#endif
     float3 normal : NORMAL0;
 };
 
@@ -22,7 +19,11 @@ VertexShaderOutput main(VertexShaderInput input)
 {
     VertexShaderOutput output;
     output.position = mul(input.position, gWVP);
+#if HAS_UV
     output.texcoord = input.texcoord;
+#else
+    output.texcoord = float2(0.0f, 0.0f); // PSでは使わない
+#endif
 
     // 法線をワールド空間へ変換（スケーリングがある場合は inverse-transpose 必須）
     float3x3 normalMatrix = (float3x3) gWorld;
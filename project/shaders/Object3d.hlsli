@@ -19,3 +19,16 @@ struct DirectionalLight
     float intensity;
     float3 padding; // アライメント用
 };
+
+// LIGHTING_MODEの値（main側のLightingModeと合わせる）
+#define LIGHTING_NONE 0
+#define LIGHTING_LAMBERT 1
+#define LIGHTING_HALF_LAMBERT 2
+
+// パーミュテーションのキーワード（main側のマニフェストの値が-Dで渡される。無いときの既定値）
+#ifndef LIGHTING_MODE
+#define LIGHTING_MODE LIGHTING_HALF_LAMBERT
+#endif
+#ifndef HAS_UV
+#define HAS_UV 1 // 0ならUVの無いモデル用（テクスチャを使わない）
+#endif
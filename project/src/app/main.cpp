@@ -10,11 +10,40 @@
 #include <dxgi1_6.h>
 #include <dxgidebug.h>
 #include <dxcapi.h>
+#include <d3d12shader.h>
 #include <cassert>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include "engine/3d/ResourceObject.h"
+#include "engine/3d/MeshOptimizer.h"
+#include "engine/3d/MeshSimplifier.h"
+#include "engine/3d/Meshlet.h"
+#include "engine/3d/ModelData.h"
+#include "engine/base/SelfTest.h"
+#include "engine/graphics/DescriptorAllocator.h"
+#include "engine/graphics/FramePacer.h"
+#include "engine/graphics/PipelineBuildScheduler.h"
+#include "engine/graphics/RenderQueue.h"
+#include "engine/graphics/ShaderCache.h"
+#include "engine/graphics/ShaderHotReloader.h"
+#include "engine/graphics/ShaderPermutation.h"
+#include "engine/graphics/ShaderReflection.h"
+#include "engine/graphics/UploadRingAllocator.h"
+#include "engine/io/MeshCache.h"
+#include "engine/io/ObjLoader.h"
+#include "engine/io/AsyncTextureLoader.h"
+#include "engine/io/TextureAtlas.h"
+#include "engine/io/TextureCache.h"
+#include "engine/io/TextureCooker.h"
+#include "engine/io/TextureMipmaps.h"
+#include "engine/math/MathFunctions.h"
+#include "engine/math/Quaternion.h"
+#include "engine/scene/TransformSystem.h"
 #include <wrl/client.h>
 #include <xaudio2.h>
 #define DIRECTINPUT_VERSION 0x0800 // DirectInputのバージョン指定
@@ -35,52 +64,6 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg
 
 using namespace Microsoft::WRL;
 
-// ベクター2
-struct Vector2 {
-	float x, y;
-};
-
-// ベクター3
-struct Vector3 {
-	float x, y, z;
-};
-
-// ベクター4
-struct Vector4 {
-	float x, y, z, w;
-};
-
-// 4x4行列の定義
-struct Matrix4x4 {
-	float m[4][4];
-};
-
-struct Transform {
-	Vector3 scale;
-	Vector3 rotate;
-	Vector3 translate;
-};
-
-struct VertexData {
-	Vector4 position; // 頂点の位置
-	Vector2 texcoord; // テクスチャ座標
-	Vector3 normal;   // 法線ベクトル
-};
-
-struct Material {
-	Vector4 color;
-	int32_t lightingMode;
-	float padding[3]; // 16バイトアライメント維持
-	Matrix4x4 uvTransform;
-	std::string textureFilePath; // ← これを追加！
-};
-
-
-struct TransformationMatrix {
-	Matrix4x4 WVP;
-	Matrix4x4 World;
-};
-
 struct DirectionalLight {
 	Vector4 color;
 	Vector4 direction;
@@ -90,16 +73,6 @@ struct DirectionalLight {
 
 
 
-struct MaterialData {
-	std::string textureFilePath;
-};
-
-struct ModelData {
-	std::vector<VertexData> vertices; // 頂点データ
-	MaterialData material; // マテリアルデータ
-};
-
-
 struct D3DResourceLeakChecker {
 	~D3DResourceLeakChecker() {
 		// リソースリークチェック
@@ -156,220 +129,18 @@ enum class LightingMode {
 	HalfLambert,
 };
 
-struct Mesh {
-	std::vector<VertexData> vertices;
-	std::string name;
-	std::string materialName;
-};
-
-struct MultiModelData {
-	std::vector<Mesh> meshes;
-	std::unordered_map<std::string, Material> materials;
-};
-
 struct MeshRenderData {
-	ComPtr<ID3D12Resource> vertexResource;
-	D3D12_VERTEX_BUFFER_VIEW vbView;
-	size_t vertexCount;
+	D3D12_VERTEX_BUFFER_VIEW vbView; // modelUploadsのページ内を指す
+	D3D12_INDEX_BUFFER_VIEW ibView;
+	std::vector<MeshLod> lods; // インデックスバッファ内の各LODの範囲（lods[0]が元の解像度）
 	std::string name;
 	std::string materialName;
+	bool hasUV; // falseならUV無しのパーミュテーションで描く
 };
-MultiModelData multiModel;
+std::unordered_map<std::string, Material> multiMaterials; // マルチメッシュモデルのマテリアル
 std::vector<MeshRenderData> meshRenderList;
 
  
-// 単位行列の作成
-Matrix4x4 MakeIdentity4x4() {
-	Matrix4x4 result;
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 4; j++) {
-			if (i == j) {
-				result.m[i][j] = 1.0f;
-			} else {
-				result.m[i][j] = 0.0f;
-			}
-		}
-	}
-	return result;
-}
-
-// 4x4行列の積
-Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2) {
-	Matrix4x4 result;
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 4; j++) {
-			result.m[i][j] = 0;
-			for (int k = 0; k < 4; k++) {
-				result.m[i][j] += m1.m[i][k] * m2.m[k][j];
-			}
-		}
-	}
-	return result;
-}
-
-// 拡大縮小
-Matrix4x4 MakeScaleMatrix(const Vector3& scale) {
-	Matrix4x4 result{};
-	result.m[0][0] = scale.x;
-	result.m[1][1] = scale.y;
-	result.m[2][2] = scale.z;
-	result.m[3][3] = 1.0f;
-	return result;
-}
-
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
-	Matrix4x4 result{};
-	result.m[0][0] = 1.0f;
-	result.m[1][1] = 1.0f;
-	result.m[2][2] = 1.0f;
-	result.m[3][3] = 1.0f;
-	result.m[3][0] = translate.x;
-	result.m[3][1] = translate.y;
-	result.m[3][2] = translate.z;
-	return result;
-}
-
-
-// X軸回転行列
-Matrix4x4 MakeRotateXMatrix(float angle) {
-	Matrix4x4 result = {};
-	result.m[0][0] = 1.0f;
-	result.m[3][3] = 1.0f;
-	result.m[1][1] = std::cos(angle);
-	result.m[1][2] = std::sin(angle);
-	result.m[2][1] = -std::sin(angle);
-	result.m[2][2] = std::cos(angle);
-	return result;
-}
-// Y軸回転行列
-Matrix4x4 MakeRotateYMatrix(float angle) {
-	Matrix4x4 result = {};
-	result.m[1][1] = 1.0f;
-	result.m[3][3] = 1.0f;
-	result.m[0][0] = std::cos(angle);
-	result.m[0][2] = -std::sin(angle);
-	result.m[2][0] = std::sin(angle);
-	result.m[2][2] = std::cos(angle);
-	return result;
-}
-// Z軸回転行列
-Matrix4x4 MakeRotateZMatrix(float angle) {
-	Matrix4x4 result = {};
-	result.m[2][2] = 1.0f;
-	result.m[3][3] = 1.0f;
-	result.m[0][0] = std::cos(angle);
-	result.m[0][1] = std::sin(angle);
-	result.m[1][0] = -std::sin(angle);
-	result.m[1][1] = std::cos(angle);
-	return result;
-}
-
-// アフィン変換行列
-Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
-	Matrix4x4 result = {};
-	// X,Y,Z軸の回転をまとめる
-	Matrix4x4 rotateXYZ =
-		Multiply(MakeRotateXMatrix(rotate.x), Multiply(MakeRotateYMatrix(rotate.y), MakeRotateZMatrix(rotate.z)));
-
-	result.m[0][0] = scale.x * rotateXYZ.m[0][0];
-	result.m[0][1] = scale.x * rotateXYZ.m[0][1];
-	result.m[0][2] = scale.x * rotateXYZ.m[0][2];
-	result.m[1][0] = scale.y * rotateXYZ.m[1][0];
-	result.m[1][1] = scale.y * rotateXYZ.m[1][1];
-	result.m[1][2] = scale.y * rotateXYZ.m[1][2];
-	result.m[2][0] = scale.z * rotateXYZ.m[2][0];
-	result.m[2][1] = scale.z * rotateXYZ.m[2][1];
-	result.m[2][2] = scale.z * rotateXYZ.m[2][2];
-	result.m[3][0] = translate.x;
-	result.m[3][1] = translate.y;
-	result.m[3][2] = translate.z;
-	result.m[3][3] = 1.0f;
-
-	return result;
-}
-
-// 3x3の行列式を計算
-static float Determinant3x3(float matrix[3][3]) {
-	return matrix[0][0] * (matrix[1][1] * matrix[2][2] - matrix[1][2] * matrix[2][1]) -
-		matrix[0][1] * (matrix[1][0] * matrix[2][2] - matrix[1][2] * matrix[2][0]) +
-		matrix[0][2] * (matrix[1][0] * matrix[2][1] - matrix[1][1] * matrix[2][0]);
-}
-
-// 4x4行列の余因子を計算
-static float Minor(const Matrix4x4& m, int row, int col) {
-	float sub[3][3];
-	int sub_i = 0;
-	for (int i = 0; i < 4; ++i) {
-		if (i == row) continue;
-		int sub_j = 0;
-		for (int j = 0; j < 4; ++j) {
-			if (j == col) continue;
-			sub[sub_i][sub_j] = m.m[i][j];
-			sub_j++;
-		}
-		sub_i++;
-	}
-
-	// 3x3行列の行列式を計算
-	return Determinant3x3(sub);
-}
-
-// 4x4行列の逆行列を計算
-static Matrix4x4 Inverse(const Matrix4x4& m) {
-	Matrix4x4 result = {};
-
-	// 4x4行列の行列式を計算
-	float det = 0.0f;
-	for (int col = 0; col < 4; ++col) {
-		int sign = (col % 2 == 0) ? 1 : -1;
-		det += sign * m.m[0][col] * Minor(m, 0, col);
-	}
-
-	// 行列式が0の場合は逆行列が存在しない
-	if (det == 0.0f) {
-		return result;
-	}
-
-	float invDet = 1.0f / det;
-
-	// 各要素の計算
-	for (int i = 0; i < 4; ++i) {
-		for (int j = 0; j < 4; ++j) {
-			int sign = ((i + j) % 2 == 0) ? 1 : -1;
-			result.m[j][i] = sign * Minor(m, i, j) * invDet;
-		}
-	}
-
-	return result;
-}
-
-// 透視投影行列
-Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip) {
-	Matrix4x4 result = {};
-	result.m[0][0] = 1.0f / (aspectRatio * std::tan(fovY / 2.0f));
-	result.m[1][1] = 1.0f / std::tan(fovY / 2.0f);
-	result.m[2][2] = farClip / (farClip - nearClip);
-	result.m[2][3] = 1.0f;
-	result.m[3][2] = -(farClip * nearClip) / (farClip - nearClip);
-	return result;
-}
-
-// 平行投影行列（左手座標系）
-Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip) {
-	Matrix4x4 result = {};
-
-	result.m[0][0] = 2.0f / (right - left);
-	result.m[1][1] = 2.0f / (top - bottom);
-	result.m[2][2] = 1.0f / (farClip - nearClip);
-	result.m[3][0] = (left + right) / (left - right);
-	result.m[3][1] = (top + bottom) / (bottom - top);
-	result.m[3][2] = -nearClip / (farClip - nearClip);
-	result.m[3][3] = 1.0f;
-
-	return result;
-}
-
-
 static void Log(const std::string& message) {
 	OutputDebugStringA(message.c_str());
 }
@@ -428,23 +199,65 @@ static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lp
 
 // 関数の作成
 
+// 既定のインクルードハンドラに任せつつ、読み込めたファイルの名前を覚えておく（シェーダーキャッシュの依存ファイルになる）
+// Compileの間だけ使うのでスタックに置き、参照カウントは数えない
+class RecordingIncludeHandler : public IDxcIncludeHandler {
+public:
+	explicit RecordingIncludeHandler(IDxcIncludeHandler* inner) : inner_(inner) {}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override {
+		HRESULT hr = inner_->LoadSource(pFilename, ppIncludeSource);
+		if (SUCCEEDED(hr)) {
+			includedFiles.push_back(ConvertString(std::wstring(pFilename)));
+		}
+		return hr;
+	}
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+		if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown)) {
+			*ppvObject = this;
+			return S_OK;
+		}
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	std::vector<std::string> includedFiles;
+
+private:
+	IDxcIncludeHandler* inner_;
+};
+
 IDxcBlob* CompileShader(
 	// CompilerするShaderファイルへのパス
 	const std::wstring& filePath,
 	// Compileに使用するProfile
 	const wchar_t* profile,
+	// エントリーポイントとそれ以外のオプション（シェーダーキャッシュのキーと揃える）
+	const std::wstring& entryPoint,
+	const std::vector<std::wstring>& options,
 	// 初期化で生成したものを3つ
 	IDxcUtils* dxcUtils,
 	IDxcCompiler3* dxcCompiler,
-	IDxcIncludeHandler* includeHandler) {
+	IDxcIncludeHandler* includeHandler,
+	// 警告・エラーのメッセージ（要らなければnullptr）
+	std::string* errors = nullptr) {
 	// 1.hlslファイルを読む
 	// これからシェーダーをコンパイルする旨をログに出す
 	Log(ConvertString(std::format(L"Begin CompileShader, path:{}, profile:{}\n", filePath, profile)));
 	// hlslファイルを読む
-	IDxcBlobEncoding* shaderSource = nullptr;
+	ComPtr<IDxcBlobEncoding> shaderSource = nullptr;
 	HRESULT hr = dxcUtils->LoadFile(filePath.c_str(), nullptr, &shaderSource);
-	// 読めなかったら止める
-	assert(SUCCEEDED(hr));
+	// 読めなかったら（保存の途中で消えている・ロックされているなど）エラーとして返す。次の保存でまた読みに来る
+	if (FAILED(hr)) {
+		const std::string message = std::format("{}: cannot open the file (hr = 0x{:08X})\n", ConvertString(filePath), uint32_t(hr));
+		Log(message);
+		if (errors) {
+			*errors = message;
+		}
+		return nullptr;
+	}
 	// 読み込んだファイルの内容を設定する
 	DxcBuffer shaderSourceBuffer;
 	shaderSourceBuffer.Ptr = shaderSource->GetBufferPointer();
@@ -452,20 +265,20 @@ IDxcBlob* CompileShader(
 	shaderSourceBuffer.Encoding = DXC_CP_UTF8;  // UTF8の文字コードであることを通知
 
 	// 2.Compileする
-	LPCWSTR arguments[] = {
+	std::vector<LPCWSTR> arguments = {
 		filePath.c_str(), // コンパイル対象のhlslファイル名
-		L"-E", L"main", // エントリーポイントの指定。基本的にmain以外には市内
+		L"-E", entryPoint.c_str(), // エントリーポイントの指定。基本的にmain以外には市内
 		L"-T", profile, // ShaderProfileの設定
-		L"-Zi", L"-Qembed_debug",   // デバッグ用の情報を埋め込む
-		L"-Od",     // 最適化を外しておく
-		L"-Zpr",     // メモリレイアウトは行優先
 	};
+	for (const std::wstring& option : options) {
+		arguments.push_back(option.c_str());
+	}
 	// 実際にShaderをコンパイルする
-	IDxcResult* shaderResult = nullptr;
+	ComPtr<IDxcResult> shaderResult = nullptr;
 	hr = dxcCompiler->Compile(
 		&shaderSourceBuffer, // 読み込んだファイル
-		arguments,           // コンパイルオプション
-		_countof(arguments),  // コンパイルオプションの数
+		arguments.data(),    // コンパイルオプション
+		static_cast<UINT32>(arguments.size()),  // コンパイルオプションの数
 		includeHandler,      // includeが含まれた諸々
 		IID_PPV_ARGS(&shaderResult) // コンパイル結果
 	);
@@ -473,11 +286,14 @@ IDxcBlob* CompileShader(
 	assert(SUCCEEDED(hr));
 
 	// 3.警告・エラーがでていないか確認する
-	// 警告・エラーが出てたらログに出して止める
-	IDxcBlobUtf8* shaderError = nullptr;
+	// 警告・エラーが出てたらログに出し、メッセージを呼び出し側に返す（エラーならこの後のバイナリが空になる）
+	ComPtr<IDxcBlobUtf8> shaderError = nullptr;
 	shaderResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&shaderError), nullptr);
 	if (shaderError != nullptr && shaderError->GetStringLength() != 0) {
 		Log(shaderError->GetStringPointer());
+		if (errors) {
+			*errors = shaderError->GetStringPointer();
+		}
 	}
 
 	// 4.Compile結果を受け取って返す
@@ -491,6 +307,186 @@ IDxcBlob* CompileShader(
 	return shaderBlob;
 }
 
+// 反映情報の型から、cbufferの中の大きさを求める（32ビットの型だけを考える）
+static uint32_t GetConstantTypeSize(ID3D12ShaderReflectionType* type) {
+	D3D12_SHADER_TYPE_DESC typeDesc{};
+	type->GetDesc(&typeDesc);
+	uint32_t elementSize = 0;
+	if (typeDesc.Class == D3D_SVC_STRUCT) {
+		for (UINT member = 0; member < typeDesc.Members; member++) {
+			ID3D12ShaderReflectionType* memberType = type->GetMemberTypeByIndex(member);
+			D3D12_SHADER_TYPE_DESC memberDesc{};
+			memberType->GetDesc(&memberDesc);
+			elementSize = (std::max)(elementSize, uint32_t(memberDesc.Offset) + GetConstantTypeSize(memberType));
+		}
+	} else {
+		// 行列は列（column_major）か行（row_major）ごとに16バイトのレジスタに入る
+		const bool columnMajor = typeDesc.Class == D3D_SVC_MATRIX_COLUMNS;
+		const uint32_t registers = columnMajor ? typeDesc.Columns : typeDesc.Rows;
+		const uint32_t components = columnMajor ? typeDesc.Rows : typeDesc.Columns;
+		elementSize = (registers - 1) * 16 + components * 4;
+	}
+	if (typeDesc.Elements == 0) {
+		return elementSize;
+	}
+	// 配列の要素はそれぞれ16バイト境界から始まる
+	return (elementSize + 15) / 16 * 16 * (typeDesc.Elements - 1) + elementSize;
+}
+
+// 構造体の変数はメンバーを末端まで辿り、cbufferの先頭からのオフセットで並べる
+static void AppendConstantVariables(ID3D12ShaderReflectionType* type, const std::string& name, uint32_t offset, uint32_t size,
+	std::vector<ShaderConstantVariable>& variables) {
+	D3D12_SHADER_TYPE_DESC typeDesc{};
+	type->GetDesc(&typeDesc);
+	if (typeDesc.Class != D3D_SVC_STRUCT || typeDesc.Elements != 0) {
+		variables.push_back({ name, offset, size });
+		return;
+	}
+	for (UINT member = 0; member < typeDesc.Members; member++) {
+		ID3D12ShaderReflectionType* memberType = type->GetMemberTypeByIndex(member);
+		D3D12_SHADER_TYPE_DESC memberDesc{};
+		memberType->GetDesc(&memberDesc);
+		AppendConstantVariables(memberType, name + "." + type->GetMemberTypeName(member), offset + memberDesc.Offset,
+			GetConstantTypeSize(memberType), variables);
+	}
+}
+
+// DXCのバイトコードに埋め込まれた反映情報を読み出す（-Qstrip_reflectでコンパイルしたものは読めない）
+static bool ReflectShader(IDxcUtils* dxcUtils, const std::vector<uint8_t>& bytecode, const std::string& profile, ShaderReflectionData& reflection) {
+	reflection = {};
+	if (!GetShaderStageFromProfile(profile, reflection.stage)) {
+		return false;
+	}
+	DxcBuffer buffer{};
+	buffer.Ptr = bytecode.data();
+	buffer.Size = bytecode.size();
+	buffer.Encoding = DXC_CP_ACP;
+	ComPtr<ID3D12ShaderReflection> shaderReflection = nullptr;
+	if (FAILED(dxcUtils->CreateReflection(&buffer, IID_PPV_ARGS(&shaderReflection)))) {
+		return false;
+	}
+	D3D12_SHADER_DESC shaderDesc{};
+	shaderReflection->GetDesc(&shaderDesc);
+	for (UINT resource = 0; resource < shaderDesc.BoundResources; resource++) {
+		D3D12_SHADER_INPUT_BIND_DESC bindDesc{};
+		shaderReflection->GetResourceBindingDesc(resource, &bindDesc);
+		ShaderBinding& binding = reflection.bindings.emplace_back();
+		binding.name = bindDesc.Name;
+		binding.shaderRegister = bindDesc.BindPoint;
+		binding.space = bindDesc.Space;
+		binding.count = bindDesc.BindCount;
+		switch (bindDesc.Type) {
+		case D3D_SIT_CBUFFER:
+			binding.kind = ShaderBindingKind::ConstantBuffer;
+			break;
+		case D3D_SIT_SAMPLER:
+			binding.kind = ShaderBindingKind::Sampler;
+			break;
+		case D3D_SIT_UAV_RWTYPED:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_APPEND_STRUCTURED:
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+			binding.kind = ShaderBindingKind::UnorderedAccess;
+			break;
+		default:
+			binding.kind = ShaderBindingKind::ShaderResource; // テクスチャ・StructuredBufferなど
+			break;
+		}
+		if (binding.kind != ShaderBindingKind::ConstantBuffer) {
+			continue;
+		}
+		ID3D12ShaderReflectionConstantBuffer* constantBuffer = shaderReflection->GetConstantBufferByName(bindDesc.Name);
+		D3D12_SHADER_BUFFER_DESC bufferDesc{};
+		if (FAILED(constantBuffer->GetDesc(&bufferDesc))) {
+			return false;
+		}
+		binding.size = bufferDesc.Size;
+		for (UINT index = 0; index < bufferDesc.Variables; index++) {
+			ID3D12ShaderReflectionVariable* variable = constantBuffer->GetVariableByIndex(index);
+			D3D12_SHADER_VARIABLE_DESC variableDesc{};
+			variable->GetDesc(&variableDesc);
+			AppendConstantVariables(variable->GetType(), variableDesc.Name, variableDesc.StartOffset, variableDesc.Size, binding.variables);
+		}
+	}
+	return true;
+}
+
+// 反映情報から並べたルートシグネチャを作る（静的サンプラーは全てsamplerの設定で、レジスタと見えるステージだけ変える）
+static ComPtr<ID3D12RootSignature> CreateRootSignature(ID3D12Device* device, const RootSignatureLayout& layout, const D3D12_STATIC_SAMPLER_DESC& sampler) {
+	auto getVisibility = [](uint32_t stageMask) {
+		switch (stageMask) {
+		case kShaderStageMaskVertex: return D3D12_SHADER_VISIBILITY_VERTEX;
+		case kShaderStageMaskPixel: return D3D12_SHADER_VISIBILITY_PIXEL;
+		default: return D3D12_SHADER_VISIBILITY_ALL;
+		}
+	};
+	// テーブルのレンジはパラメータから指されるので、先に全部の場所を取っておく
+	std::vector<D3D12_DESCRIPTOR_RANGE> descriptorRanges(layout.parameters.size());
+	std::vector<D3D12_ROOT_PARAMETER> rootParameters(layout.parameters.size());
+	for (size_t i = 0; i < layout.parameters.size(); i++) {
+		const RootParameterLayout& parameter = layout.parameters[i];
+		D3D12_ROOT_PARAMETER& rootParameter = rootParameters[i];
+		rootParameter.ShaderVisibility = getVisibility(parameter.stageMask);
+		switch (parameter.kind) {
+		case RootParameterKind::Constants:
+			rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+			rootParameter.Constants.ShaderRegister = parameter.shaderRegister;
+			rootParameter.Constants.RegisterSpace = parameter.space;
+			rootParameter.Constants.Num32BitValues = parameter.count;
+			break;
+		case RootParameterKind::ConstantBufferView:
+			rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+			rootParameter.Descriptor.ShaderRegister = parameter.shaderRegister;
+			rootParameter.Descriptor.RegisterSpace = parameter.space;
+			break;
+		case RootParameterKind::DescriptorTable: {
+			D3D12_DESCRIPTOR_RANGE& range = descriptorRanges[i];
+			range.RangeType = parameter.bindingKind == ShaderBindingKind::ConstantBuffer ? D3D12_DESCRIPTOR_RANGE_TYPE_CBV
+				: parameter.bindingKind == ShaderBindingKind::UnorderedAccess ? D3D12_DESCRIPTOR_RANGE_TYPE_UAV
+				: D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+			range.NumDescriptors = parameter.count;
+			range.BaseShaderRegister = parameter.shaderRegister;
+			range.RegisterSpace = parameter.space;
+			range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+			rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			rootParameter.DescriptorTable.pDescriptorRanges = &range;
+			rootParameter.DescriptorTable.NumDescriptorRanges = 1;
+			break;
+		}
+		}
+	}
+	std::vector<D3D12_STATIC_SAMPLER_DESC> staticSamplers;
+	for (const StaticSamplerLayout& samplerLayout : layout.staticSamplers) {
+		D3D12_STATIC_SAMPLER_DESC& staticSampler = staticSamplers.emplace_back(sampler);
+		staticSampler.ShaderRegister = samplerLayout.shaderRegister;
+		staticSampler.RegisterSpace = samplerLayout.space;
+		staticSampler.ShaderVisibility = getVisibility(samplerLayout.stageMask);
+	}
+
+	D3D12_ROOT_SIGNATURE_DESC descriptionRootSignature{};
+	descriptionRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+	descriptionRootSignature.pParameters = rootParameters.data();
+	descriptionRootSignature.NumParameters = UINT(rootParameters.size());
+	descriptionRootSignature.pStaticSamplers = staticSamplers.data();
+	descriptionRootSignature.NumStaticSamplers = UINT(staticSamplers.size());
+
+	// シリアライズしてバイナリにする
+	ComPtr<ID3DBlob> signatureBlob = nullptr;
+	ComPtr<ID3DBlob> errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&descriptionRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
+	if (FAILED(hr)) {
+		if (errorBlob) {
+			Log(reinterpret_cast<char*>(errorBlob->GetBufferPointer()));
+		}
+		return nullptr;
+	}
+	// バイナリを元に生成
+	ComPtr<ID3D12RootSignature> rootSignature = nullptr;
+	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
+	return SUCCEEDED(hr) ? rootSignature : nullptr;
+}
 
 ComPtr<ID3D12Resource> CreateBufferResource(ComPtr<ID3D12Device>& device, size_t sizeInBytes) {
 	// ヒープ設定（UploadHeap）
@@ -535,22 +531,6 @@ ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(ComPtr<ID3D12Device>& device,
 	return descriptorHeap;
 }
 
-static DirectX::ScratchImage LoadTexture(const std::string& filePath) {
-	// テクスチャファイルを読んでプログラムで扱えるようにする
-	DirectX::ScratchImage image{};
-	std::wstring filePathW = ConvertString(filePath);
-	HRESULT hr = DirectX::LoadFromWICFile(filePathW.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
-	assert(SUCCEEDED(hr)); // テクスチャの読み込みに失敗したらエラー
-
-	// ミップマップの作成
-	DirectX::ScratchImage mipImages{};
-	hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0, mipImages);
-	assert(SUCCEEDED(hr)); // ミップマップの生成に失敗したらエラー
-
-	return mipImages;
-
-}
-
 static ComPtr<ID3D12Resource> CreateTextureResource(ComPtr<ID3D12Device>& device, const DirectX::TexMetadata& metadata) {
 	// metadateを基にResourceの設定
 	D3D12_RESOURCE_DESC resourceDesc{};
@@ -701,12 +681,6 @@ D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle(ComPtr<ID3D12DescriptorHeap>&
 	return handleGPU;
 }
 
-Vector3 Normalize(const Vector3& v) {
-	float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
-	if (length == 0.0f) return { 0.0f, 0.0f, 0.0f };
-	return { v.x / length, v.y / length, v.z / length };
-}
-
 void SetVertex(VertexData& v, const Vector4& pos, const Vector2& uv) {
 	v.position = pos;
 	v.texcoord = uv;
@@ -714,238 +688,6 @@ void SetVertex(VertexData& v, const Vector4& pos, const Vector2& uv) {
 	v.normal = Normalize(p);
 }
 
-MaterialData LoadMaterialTemplate(const std::string& directoryPath, const std::string& filename) {
-	MaterialData materialData;
-	std::string line; // ファイルから読んだ1行を格納するもの
-	std::ifstream file(directoryPath + "/" + filename); // ファイルを開く
-	assert(file.is_open()); // ファイルが開けなかったらエラー
-	while (std::getline(file, line)) {
-		std::string identifier;
-		std::istringstream s(line);
-		s >> identifier;
-
-		// identifierに応じた処理
-		if (identifier == "map_Kd") {
-			std::string textureFilename;
-			s >> textureFilename;
-			// 連結してファイルパスにする
-			materialData.textureFilePath = directoryPath + "/" + textureFilename;
-		}
-	}
-	return materialData;
-}
-
-std::unordered_map<std::string, Material> LoadMaterialTemplateMulti(
-    const std::string& directoryPath,
-    const std::string& filename)
-{
-    std::unordered_map<std::string, Material> materials;
-    std::ifstream file(directoryPath + "/" + filename);
-    assert(file.is_open());
-
-    std::string line;
-    std::string currentMaterialName;
-    Material currentMaterial{};
-
-    while (std::getline(file, line)) {
-        std::istringstream s(line);
-        std::string identifier;
-        s >> identifier;
-
-        if (identifier == "newmtl") {
-            // 直前のマテリアルを保存
-            if (!currentMaterialName.empty()) {
-                materials[currentMaterialName] = currentMaterial;
-            }
-
-            // 新しいマテリアル名
-            s >> currentMaterialName;
-            currentMaterial = Material(); // 初期化
-            currentMaterial.color = { 1.0f, 1.0f, 1.0f, 1.0f };
-            currentMaterial.lightingMode = 1; // Lambertなど
-            currentMaterial.uvTransform = MakeIdentity4x4();
-        }
-        else if (identifier == "Kd") {
-            // 拡散反射色
-            s >> currentMaterial.color.x >> currentMaterial.color.y >> currentMaterial.color.z;
-            currentMaterial.color.w = 1.0f;
-        }
-        else if (identifier == "map_Kd") {
-            std::string textureFilename;
-            s >> textureFilename;
-            currentMaterial.textureFilePath = directoryPath + "/" + textureFilename;
-        }
-    }
-
-    // 最後のマテリアルを保存
-    if (!currentMaterialName.empty()) {
-        materials[currentMaterialName] = currentMaterial;
-    }
-
-    return materials;
-}
-
-
-
-ModelData LoadObjFile(const std::string& directoryPath, const std::string& filename) {
-	ModelData modelData;
-	std::vector<Vector4> positions;  // 頂点位置
-	std::vector<Vector2> texcoords; // テクスチャ座標
-	std::vector<Vector3> normals; // 法線ベクトル
-	std::string line; // ファイルから読んだ1行を格納するもの
-
-	std::ifstream file(directoryPath + "/" + filename);
-	assert(file.is_open()); // ファイルが開けなかったらエラー
-
-	while (std::getline(file, line)) {
-		std::string identifier;
-		std::istringstream s(line);
-
-		s >> identifier; // 行の先頭の文字列を取得
-		if (identifier == "v") { // 頂点位置
-			Vector4 position;
-			s >> position.x >> position.y >> position.z;
-			position.w = 1.0f; // 同次座標系のためw成分を1に設定
-			positions.push_back(position);
-		} else if (identifier == "vt") { // テクスチャ座標
-			Vector2 texcoord;
-			s >> texcoord.x >> texcoord.y;
-			texcoords.push_back(texcoord);
-		} else if (identifier == "vn") { // 法線ベクトル
-			Vector3 normal;
-			s >> normal.x >> normal.y >> normal.z;
-			normals.push_back(normal);
-		} else if (identifier == "f") { // 面情報
-			  VertexData triangle[3];
-			// 面は三角形限定。他のは未対応
-			for (int32_t faceVertex = 0; faceVertex < 3; ++faceVertex) {
-				std::string vertexDefinition;
-				s >> vertexDefinition;
-
-				std::istringstream v(vertexDefinition);
-				uint32_t elementIndices[3];
-				for (int32_t element = 0; element < 3; ++element) {
-					std::string index;
-					std::getline(v, index, '/');
-					elementIndices[element] = std::stoi(index);
-				}
-
-				Vector4 position = positions[elementIndices[0] - 1];
-				Vector2 texcoord = texcoords[elementIndices[1] - 1];
-				Vector3 normal = normals[elementIndices[2] - 1];
-
-				// 🔁 座標系変換：X軸反転（右手 → 左手）
-				// position.x *= -1.0f; ← やらない
-				// normal.x *= -1.0f; ← やらない
-				texcoord.y = 1.0f - texcoord.y;
-
-
-				triangle[faceVertex] = { position, texcoord, normal };
-			}
-
-			// 🔁 頂点の登録順を逆順にする（面の回り順を逆にする）
-			modelData.vertices.push_back(triangle[2]);
-			modelData.vertices.push_back(triangle[1]);
-			modelData.vertices.push_back(triangle[0]);
-		} else if (identifier == "mtllib") {
-			std::string materialFilename;
-			s >> materialFilename;
-			modelData.material = LoadMaterialTemplate(directoryPath, materialFilename);
-		}
-	}
-	return modelData;
-}
-
-MultiModelData LoadObjFileMulti(const std::string& directoryPath, const std::string& filename) {
-	MultiModelData modelData;
-
-	std::vector<Vector4> positions;
-	std::vector<Vector2> texcoords;
-	std::vector<Vector3> normals;
-
-	std::ifstream file(directoryPath + "/" + filename);
-	assert(file.is_open());
-
-	std::string line;
-	std::string currentMeshName = "default";
-	std::string currentMaterialName = "default"; // 現在のマテリアル名
-	Mesh currentMesh;
-
-	while (std::getline(file, line)) {
-		std::istringstream s(line);
-		std::string identifier;
-		s >> identifier;
-
-		if (identifier == "v") {
-			Vector4 pos; s >> pos.x >> pos.y >> pos.z;
-			pos.z *= -1.0f;
-			pos.w = 1.0f;
-			positions.push_back(pos);
-		} else if (identifier == "vt") {
-			Vector2 uv; s >> uv.x >> uv.y;
-			texcoords.push_back(uv);
-		} else if (identifier == "vn") {
-			Vector3 n; s >> n.x >> n.y >> n.z;
-			n.z *= -1.0f;
-			normals.push_back(n);
-		} else if (identifier == "f") {
-			VertexData tri[3];
-			for (int i = 0; i < 3; ++i) {
-				std::string vtx;
-				s >> vtx;
-				std::istringstream vs(vtx);
-				uint32_t idx[3] = {};
-				for (int j = 0; j < 3; ++j) {
-					std::string val;
-					std::getline(vs, val, '/');
-					idx[j] = std::stoi(val);
-				}
-				tri[i] = {
-					positions[idx[0] - 1],
-					{ texcoords[idx[1] - 1].x, 1.0f - texcoords[idx[1] - 1].y },
-					normals[idx[2] - 1]
-				};
-			}
-			currentMesh.vertices.push_back(tri[2]);
-			currentMesh.vertices.push_back(tri[1]);
-			currentMesh.vertices.push_back(tri[0]);
-		} else if (identifier == "g" || identifier == "o") {
-			if (!currentMesh.vertices.empty()) {
-				currentMesh.name = currentMeshName;
-				currentMesh.materialName = currentMaterialName; // 使用中のマテリアル名を記録
-				modelData.meshes.push_back(currentMesh);
-				currentMesh = Mesh(); // 次のMeshへ
-			}
-			s >> currentMeshName;
-		} else if (identifier == "mtllib") {
-			std::string mtl;
-			s >> mtl;
-			modelData.materials = LoadMaterialTemplateMulti(directoryPath, mtl); // マテリアル複数対応版
-		} else if (identifier == "usemtl") {
-			// 現在のマテリアル名を更新
-			s >> currentMaterialName;
-
-			// もし現メッシュに頂点があれば、いったん保存してマテリアル名を更新
-			if (!currentMesh.vertices.empty()) {
-				currentMesh.name = currentMeshName;
-				currentMesh.materialName = currentMaterialName;
-				modelData.meshes.push_back(currentMesh);
-				currentMesh = Mesh(); // 次のメッシュへ切り替え
-			}
-		}
-
-	}
-
-	if (!currentMesh.vertices.empty()) {
-		currentMesh.name = currentMeshName;
-		currentMesh.materialName = currentMaterialName;
-		modelData.meshes.push_back(currentMesh);
-	}
-
-	return modelData;
-}
-
-
 // 音声データの読み込み
 SoundData SoundLoadWave(const char* filename) {
 	//HRESULT result;
@@ -1057,11 +799,109 @@ const char* GetModelFileName(ModelType type) {
 	}
 }
 
-auto NormalizeTextureKey = [](const std::string& path) -> std::string {
-	std::string filename = std::filesystem::path(path).filename().string();
-	std::transform(filename.begin(), filename.end(), filename.begin(), ::tolower);
-	return filename;
-	};
+// UVを持っているか（OBJにvtが無いと、全ての頂点が同じUVになる）
+bool HasTexcoords(const VertexData* vertices, size_t vertexCount) {
+	for (size_t i = 1; i < vertexCount; i++) {
+		if (vertices[i].texcoord.x != vertices[0].texcoord.x || vertices[i].texcoord.y != vertices[0].texcoord.y) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// 頂点の重複除去の効果をログに出す
+void LogIndexedMeshStats(const std::string& name, size_t vertexCount, size_t indexCount) {
+	size_t expandedBytes = sizeof(VertexData) * indexCount;
+	size_t indexedBytes = sizeof(VertexData) * vertexCount + sizeof(uint32_t) * indexCount;
+	Log(std::format("{}: vertices {} -> {}, {} bytes -> {} bytes\n",
+		name, indexCount, vertexCount, expandedBytes, indexedBytes));
+}
+
+// 頂点キャッシュ最適化の効果（FIFO/LRUシミュレーション）をログに出す
+void LogMeshOptimizeReport(const std::string& name, const MeshOptimizeReport& report) {
+	Log(std::format("{}: ACMR FIFO{} {:.3f} -> {:.3f}, LRU{} {:.3f} -> {:.3f} / ATVR FIFO{} {:.3f} -> {:.3f}\n",
+		name, kFifoCacheSize, report.fifoBefore.acmr, report.fifoAfter.acmr,
+		kLruCacheSize, report.lruBefore.acmr, report.lruAfter.acmr,
+		kFifoCacheSize, report.fifoBefore.atvr, report.fifoAfter.atvr));
+}
+
+// 読み込んだメッシュの頂点キャッシュ効率をログに出す（キャッシュ作成時に最適化済み）
+void LogVertexCacheStats(const std::string& name, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	VertexCacheStats fifo = AnalyzeVertexCache(indices, indexCount, vertexCount, VertexCacheModel::Fifo, kFifoCacheSize);
+	VertexCacheStats lru = AnalyzeVertexCache(indices, indexCount, vertexCount, VertexCacheModel::Lru, kLruCacheSize);
+	Log(std::format("{}: ACMR FIFO{} {:.3f}, LRU{} {:.3f} / ATVR FIFO{} {:.3f}\n",
+		name, kFifoCacheSize, fifo.acmr, kLruCacheSize, lru.acmr, kFifoCacheSize, fifo.atvr));
+}
+
+void LogTextureCacheStats(const TextureCacheStats& stats) {
+	Log(std::format("texture cache: {} requests, {} decoded, {} decode skipped, {} deduplicated, {} textures / {} bytes resident, {} bytes saved, {} hash collisions\n",
+		stats.requestCount, stats.decodeCount, stats.decodeSkipCount, stats.deduplicatedCount,
+		stats.residentCount, stats.residentBytes, stats.bytesSaved, stats.hashCollisionCount));
+}
+
+void LogRenderQueueStats(const std::string& name, const RenderQueueStats& stats) {
+	Log(std::format("{}: {} draws, {} state sets ({} pipeline, {} CBV, {} table, {} mesh), {} redundant sets skipped\n",
+		name, stats.drawCount, stats.stateSetCount, stats.pipelineSetCount, stats.constantBufferSetCount,
+		stats.descriptorTableSetCount, stats.meshSetCount, stats.skippedSetCount));
+}
+
+void LogPipelineBuildReport(const PipelineBuildReport& report) {
+	std::string criticalPath;
+	for (const std::string& name : report.criticalPath) {
+		criticalPath += criticalPath.empty() ? name : " -> " + name;
+	}
+	Log(std::format("pipeline build: {} shaders, {} pipelines on {} threads, {:.1f} ms (serial {:.1f} ms, prepare {:.1f} ms, critical path {:.1f} ms: {}), {} shaders / {} pipelines failed\n",
+		report.shaderCount, report.pipelineCount, report.threadCount, report.totalMilliseconds, report.serialMilliseconds, report.prepareMilliseconds,
+		report.criticalPathMilliseconds, criticalPath, report.failedShaderCount, report.failedPipelineCount));
+}
+
+void LogShaderPermutationReport(const ShaderPermutationSet& permutations, const PipelineBuildScheduler& builder) {
+	const ShaderPermutationReport& report = permutations.GetReport();
+	Log(std::format("{}: {} keywords, {} permutations -> {} shaders, {} pipelines\n",
+		permutations.GetManifest().name, report.keywordCount, report.permutationCount, report.shaderCount, report.pipelineCount));
+	for (size_t pipeline = 0; pipeline < builder.GetPipelineCount(); pipeline++) {
+		if (builder.GetPipelineSource(uint32_t(pipeline)) != pipeline) {
+			Log(std::format("  pipeline {} has the same bytecode as pipeline {}\n", pipeline, builder.GetPipelineSource(uint32_t(pipeline))));
+		}
+	}
+}
+
+void LogShaderCacheStats(const ShaderCacheStats& stats) {
+	Log(std::format("shader cache: {} requests, {} hits, {} compiled, {} failed, {} unsaved\n",
+		stats.requestCount, stats.hitCount, stats.compileCount, stats.failedCount, stats.unsavedCount));
+}
+
+void LogRootSignatureLayout(const RootSignatureLayout& layout) {
+	static const char* kKindNames[] = { "constants", "CBV", "table" };
+	static const char kRegisterPrefixes[] = { 'b', 't', 'u', 's' };
+	Log(std::format("root signature: {} parameters, {} static samplers, {} DWORDs\n", layout.parameters.size(), layout.staticSamplers.size(), layout.cost));
+	for (size_t i = 0; i < layout.parameters.size(); i++) {
+		const RootParameterLayout& parameter = layout.parameters[i];
+		Log(std::format("  [{}] {} {} ({}{}, {} DWORDs)\n", i, kKindNames[uint32_t(parameter.kind)], parameter.name,
+			kRegisterPrefixes[uint32_t(parameter.bindingKind)], parameter.shaderRegister, parameter.cost));
+	}
+}
+
+void LogShaderHotReloadStats(const ShaderHotReloadStats& stats) {
+	Log(std::format("shader hot reload: {} files watched, {} changes, {} reloads ({} shaders compiled, {} pipelines swapped), {} failed\n",
+		stats.watchedFileCount, stats.changeCount, stats.reloadCount, stats.compiledShaderCount, stats.swappedPipelineCount, stats.failedCount));
+}
+
+void LogUploadAllocatorStats(const std::string& name, const UploadAllocatorStats& stats) {
+	Log(std::format("{}: {} allocations / {} bytes, {} pages ({} created, {} oversize, {} pending)\n",
+		name, stats.allocationCount, stats.allocatedBytes, stats.pageCount, stats.pageCreateCount, stats.oversizeCount, stats.pendingPageCount));
+}
+
+// 自己診断（-testXxx）の結果をログに出す。全て通ればtrue
+bool LogSelfTestResults(const std::vector<SelfTestResult>& results) {
+	size_t failedCount = 0;
+	for (const SelfTestResult& result : results) {
+		Log(std::format("{} {}{}{}\n", result.passed ? "[ OK ]" : "[FAIL]", result.name, result.detail.empty() ? "" : ": ", result.detail));
+		failedCount += result.passed ? 0 : 1;
+	}
+	Log(std::format("self test: {} checks, {} failed\n", results.size(), failedCount));
+	return !results.empty() && failedCount == 0;
+}
 
 LPDIRECTINPUT8 directInput = nullptr;
 LPDIRECTINPUTDEVICE8 gamepad = nullptr;
@@ -1091,11 +931,189 @@ void InitGamepad(HWND hwnd) {
 
 
 // Windowsアプリでのエントリーポイント(main関数)
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR lpCmdLine, int) {
 	D3DResourceLeakChecker leakcheck;
 
 	CoInitializeEx(0, COINIT_MULTITHREADED);
 
+	// -cook: resources内のPNGをミップマップ付き・BC圧縮済みのDDSに変換して終了する
+	const std::string commandLine = lpCmdLine ? lpCmdLine : "";
+	if (commandLine.find("-cook") != std::string::npos) {
+		bool force = commandLine.find("-force") != std::string::npos;
+		std::vector<TextureCookResult> results = CookTextures("resources", ParseTextureCompression(commandLine), force);
+		bool allSucceeded = true;
+		for (const TextureCookResult& result : results) {
+			if (!result.succeeded) {
+				Log(std::format("cook failed: {}\n", result.sourcePath));
+				allSucceeded = false;
+				continue;
+			}
+			Log(std::format("cooked {} -> {}: format {}, {} bytes -> {} bytes, {:.1f} ms\n",
+				result.sourcePath, result.cookedPath, static_cast<int>(result.format),
+				result.uncompressedBytes, result.cookedBytes, result.milliseconds));
+		}
+		Log(std::format("cook: {} textures\n", results.size()));
+		CoUninitialize();
+		return allSucceeded ? 0 : 1;
+	}
+
+	// -benchbc: BC圧縮の速度（1スレッドと並列）を計測して終了する
+	if (commandLine.find("-benchbc") != std::string::npos) {
+		bool allIdentical = true;
+		for (const TextureCompressBenchmarkResult& result : RunTextureCompressBenchmark()) {
+			Log(std::format("BC format {} {}x{}: serial {:.2f} MP/s, parallel {:.2f} MP/s ({:.2f}x), {}\n",
+				static_cast<int>(result.format), result.width, result.height,
+				result.serialMegapixelsPerSecond, result.parallelMegapixelsPerSecond,
+				result.serialMegapixelsPerSecond > 0.0 ? result.parallelMegapixelsPerSecond / result.serialMegapixelsPerSecond : 0.0,
+				result.identical ? "identical" : "MISMATCH"));
+			allIdentical = allIdentical && result.identical;
+		}
+		CoUninitialize();
+		return allIdentical ? 0 : 1;
+	}
+
+	// -benchmip: ミップマップ生成の速度と誤差を従来の経路と比べ、誤差が許容範囲を超えたら失敗して終了する
+	if (commandLine.find("-benchmip") != std::string::npos) {
+		bool allSucceeded = true;
+		for (const MipMapBenchmarkResult& result : RunMipMapBenchmark()) {
+			// 計算に失敗したら負になる
+			const bool withinTolerance = result.maxError >= 0.0f && result.maxError <= result.tolerance;
+			Log(std::format("mip format {} {} {}x{}: reference {:.2f} ms, fast {:.2f} ms ({:.2f}x), max error {} (tolerance {}), {}\n",
+				static_cast<int>(result.format), result.filter == MipFilter::Box ? "box" : "triangle", result.width, result.height,
+				result.referenceMilliseconds, result.fastMilliseconds,
+				result.fastMilliseconds > 0.0 ? result.referenceMilliseconds / result.fastMilliseconds : 0.0, result.maxError,
+				result.tolerance, withinTolerance ? "ok" : "OVER TOLERANCE"));
+			allSucceeded = allSucceeded && withinTolerance;
+		}
+		CoUninitialize();
+		return allSucceeded ? 0 : 1;
+	}
+
+	// -benchatlas: 乱数の大きさのテクスチャをアトラスにまとめ、重なりと詰め込み効率を確認して終了する
+	if (commandLine.find("-benchatlas") != std::string::npos) {
+		bool allValid = true;
+		for (const TextureAtlasBenchmarkResult& result : RunTextureAtlasBenchmark()) {
+			Log(std::format("atlas {} textures {}-{} px: {} packed, {} rejected, {} pages, efficiency {:.1f}% (with gutter {:.1f}%), {:.2f} ms, {}\n",
+				result.inputCount, result.minSize, result.maxSize, result.stats.packedCount, result.stats.rejectedCount, result.stats.pageCount,
+				result.stats.efficiency * 100.0f,
+				result.stats.pagePixels != 0 ? 100.0 * double(result.stats.cellPixels) / double(result.stats.pagePixels) : 0.0,
+				result.milliseconds, result.valid ? "valid" : "INVALID"));
+			allValid = allValid && result.valid;
+		}
+		CoUninitialize();
+		return allValid ? 0 : 1;
+	}
+
+	// -benchobj: teapot/suzanneと合成した大きなOBJを各ローダーで読み、読み込み速度と並列版のスレッド数ごとの伸びを計測して終了する
+	if (commandLine.find("-benchobj") != std::string::npos) {
+		std::vector<ObjLoadBenchmarkResult> results = RunObjLoadBenchmark("resources");
+		bool allIdentical = true;
+		for (const ObjLoadBenchmarkResult& result : results) {
+			Log(std::format("obj {} {} {:.1f} MB, {} threads: {:.1f} MB/s, {} vertices, {} indices, {}\n",
+				result.file, result.loader, double(result.fileBytes) / 1e6, result.threadCount, result.megabytesPerSecond,
+				result.vertexCount, result.indexCount, result.identical ? "identical" : "MISMATCH"));
+			allIdentical = allIdentical && result.identical;
+		}
+		CoUninitialize();
+		return !results.empty() && allIdentical ? 0 : 1;
+	}
+
+	// -benchmath: 行列の積・逆行列・アフィン変換行列の作成を元のスカラー版と比べて終了する
+	if (commandLine.find("-benchmath") != std::string::npos) {
+		std::vector<MathBenchmarkResult> results = RunMathBenchmark();
+		for (const MathBenchmarkResult& result : results) {
+			Log(std::format("math {}: reference {:.1f} ns, fast {:.1f} ns ({:.2f}x)\n", result.name,
+				result.referenceNanoseconds, result.fastNanoseconds,
+				result.fastNanoseconds > 0.0 ? result.referenceNanoseconds / result.fastNanoseconds : 0.0));
+		}
+		CoUninitialize();
+		return results.empty() ? 1 : 0;
+	}
+
+	// -benchtransform: 10万個のオブジェクトのWorld/WVPの計算を、オブジェクトごとの従来の経路とTransformSystemで比べて終了する
+	if (commandLine.find("-benchtransform") != std::string::npos) {
+		std::vector<TransformBenchmarkResult> results = RunTransformBenchmark();
+		const double referenceMilliseconds = results.empty() ? 0.0 : results.front().milliseconds;
+		for (const TransformBenchmarkResult& result : results) {
+			Log(std::format("transform {} ({} objects, {} world / {} WVP updated): {:.3f} ms ({:.1f}x)\n",
+				result.scenario, result.objectCount, result.worldUpdateCount, result.wvpUpdateCount, result.milliseconds,
+				result.milliseconds > 0.0 ? referenceMilliseconds / result.milliseconds : 0.0));
+		}
+		CoUninitialize();
+		return results.empty() ? 1 : 0;
+	}
+
+	// -benchmeshlet: 数百万三角形の格子をメッシュレットに分け、1秒あたりの三角形数を計測して終了する
+	if (commandLine.find("-benchmeshlet") != std::string::npos) {
+		std::vector<MeshletBenchmarkResult> results = RunMeshletBenchmark();
+		bool allValid = true;
+		for (const MeshletBenchmarkResult& result : results) {
+			Log(std::format("meshlet grid {}x{}: {} triangles -> {} meshlets, {:.1f} ms, {:.2f} Mtri/s, {}\n",
+				result.gridSize, result.gridSize, result.triangleCount, result.meshletCount, result.milliseconds,
+				result.trianglesPerSecond / 1e6, result.valid ? "valid" : "INVALID"));
+			allValid = allValid && result.valid;
+		}
+		CoUninitialize();
+		return !results.empty() && allValid ? 0 : 1;
+	}
+
+	// -testmesh: suzanne/teapotで頂点キャッシュ最適化・メッシュレット・LODを行い、三角形の抜け・重複や巻き順、
+	// ACMRやLODの誤差などを確かめて終了する
+	if (commandLine.find("-testmesh") != std::string::npos) {
+		std::vector<SelfTestResult> results;
+		for (const char* fileName : { "suzanne.obj", "teapot.obj" }) {
+			ModelData model = LoadObjFile("resources", fileName);
+			AppendSelfTestResults(results, RunMeshOptimizerSelfTest(fileName, model.vertices, model.indices));
+			AppendSelfTestResults(results, RunMeshletSelfTest(fileName, model.vertices, model.indices));
+			AppendSelfTestResults(results, RunLodSelfTest(fileName, model.vertices, model.indices));
+		}
+		bool allPassed = LogSelfTestResults(results);
+		CoUninitialize();
+		return allPassed ? 0 : 1;
+	}
+
+	// -testmath: 乱数でSSE版の行列計算やTransformSystem、クォータニオンを元のスカラー版と比べて終了する
+	if (commandLine.find("-testmath") != std::string::npos) {
+		std::vector<SelfTestResult> results = RunMathSelfTest();
+		AppendSelfTestResults(results, RunTransformSystemSelfTest());
+		AppendSelfTestResults(results, RunQuaternionSelfTest());
+		bool allPassed = LogSelfTestResults(results);
+		CoUninitialize();
+		return allPassed ? 0 : 1;
+	}
+
+	// -testtextures: GPUを使わずに、テクスチャの読み込みと書き込みの順番・予算などを確かめて終了する
+	if (commandLine.find("-testtextures") != std::string::npos) {
+		bool allPassed = LogSelfTestResults(RunAsyncTextureLoaderSelfTest());
+		CoUninitialize();
+		return allPassed ? 0 : 1;
+	}
+
+	// -testframes: GPUを使わずに、アップロード領域とディスクリプタの使い回し、フレームの重ね方を擬似フェンスで、
+	// 描画の並べ替えを記録用バックエンドで確かめて終了する
+	if (commandLine.find("-testframes") != std::string::npos) {
+		std::vector<SelfTestResult> results = RunUploadRingAllocatorSelfTest();
+		AppendSelfTestResults(results, RunFramePacerSelfTest());
+		AppendSelfTestResults(results, RunDescriptorAllocatorSelfTest());
+		AppendSelfTestResults(results, RunRenderQueueSelfTest());
+		bool allPassed = LogSelfTestResults(results);
+		CoUninitialize();
+		return allPassed ? 0 : 1;
+	}
+
+	// -testshaders: DXCやGPUを使わずに、偽のコンパイラとモックのバックエンドでシェーダーのキャッシュとPSOの並行生成、パーミュテーション、
+	// ホットリロード（偽のファイルと時計）、書き出した反映情報からのルートシグネチャと構造体の照合を確かめて終了する
+	if (commandLine.find("-testshaders") != std::string::npos) {
+		std::vector<SelfTestResult> results = RunShaderCacheSelfTest();
+		AppendSelfTestResults(results, RunPipelineBuildSchedulerSelfTest());
+		AppendSelfTestResults(results, RunShaderPermutationSelfTest());
+		AppendSelfTestResults(results, RunShaderHotReloaderSelfTest());
+		AppendSelfTestResults(results, RunShaderReflectionSelfTest());
+		bool allPassed = LogSelfTestResults(results);
+		CoUninitialize();
+		return allPassed ? 0 : 1;
+	}
+
 	// ウィンドウクラスの定義
 	WNDCLASS wc = {};
 	// ウィンドウプロシージャ
@@ -1230,17 +1248,28 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		IID_PPV_ARGS(&commandQueue));
 	assert(SUCCEEDED(hr)); // コマンドキューの生成に失敗したらエラー
 
-	// コマンドアロケータを生成する
-	ComPtr<ID3D12CommandAllocator> commandAllocator = nullptr;
-	hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
-		IID_PPV_ARGS(&commandAllocator));
-	assert(SUCCEEDED(hr)); // コマンドアロケータの生成に失敗したらエラー
+	// -frames N: GPUより何フレーム先まで記録を進めるか（1なら毎フレームGPUの終わりを待つ）
+	uint32_t framesInFlight = 2;
+	if (size_t option = commandLine.find("-frames "); option != std::string::npos) {
+		framesInFlight = std::clamp<uint32_t>(uint32_t(std::atoi(commandLine.c_str() + option + 8)), 1, FramePacer::kMaxFramesInFlight);
+	}
+
+	// コマンドアロケータを生成する（GPUが使っている間はResetできないので、フレームごとに用意する）
+	std::vector<ComPtr<ID3D12CommandAllocator>> commandAllocators(framesInFlight);
+	for (ComPtr<ID3D12CommandAllocator>& commandAllocator : commandAllocators) {
+		hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(&commandAllocator));
+		assert(SUCCEEDED(hr)); // コマンドアロケータの生成に失敗したらエラー
+	}
 
 	// コマンドリストを生成する
 	ComPtr<ID3D12GraphicsCommandList> commandList = nullptr;
 	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-		commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList));
+		commandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&commandList));
 	assert(SUCCEEDED(hr)); // コマンドリストの生成に失敗したらエラー
+	// 毎フレームの頭でそのフレームのアロケータを使ってResetするので、いったん閉じておく
+	hr = commandList->Close();
+	assert(SUCCEEDED(hr)); // コマンドリストのクローズに失敗したらエラー
 
 	// スワップチェーンを生成する
 	ComPtr<IDXGISwapChain4> swapChain = nullptr;
@@ -1275,11 +1304,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		2, // ダブルバッファ用に２つ
 		false); // シェーダーからはアクセスしない
 
-	// SRV用のディスクリプタヒープを生成する
+	// SRV用のディスクリプタヒープを生成する（中の場所はDescriptorAllocatorで割り当てる）
+	const uint32_t kSrvHeapSize = 16384;
 	ComPtr<ID3D12DescriptorHeap> srvDescriptorHeap = CreateDescriptorHeap(
 		device, // デバイス
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, // SRV用
-		128, // 128個用意する
+		kSrvHeapSize,
 		true); // シェーダーからアクセスする
 
 	// DSV用のディスクリプタヒープ
@@ -1337,82 +1367,77 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	HANDLE fenceEvent = CreateEvent(nullptr, false, false, nullptr);
 	assert(fenceEvent != nullptr); // イベントハンドルの生成に失敗したらエラー
 
-	// dxCompilerの初期化
-	IDxcUtils* dxcUtils = nullptr;
-	IDxcCompiler3* dxcCompiler = nullptr;
-	hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
-	assert(SUCCEEDED(hr)); // dxcUtilsの生成に失敗したらエラー
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
-	assert(SUCCEEDED(hr)); // dxcCompilerの生成に失敗したらエラー
-
-	// includeに対応するための設定を行う
-	IDxcIncludeHandler* includeHandler = nullptr;
-	hr = dxcUtils->CreateDefaultIncludeHandler(&includeHandler);
-	assert(SUCCEEDED(hr)); // includeHandlerの生成に失敗したらエラー
-
-	// RootSignature作成
-	D3D12_ROOT_SIGNATURE_DESC descriptionRootSignature{};
-	descriptionRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-
-	// RootParameter作成。PixelShaderのMaterialとVertexShaderのTransform 
-	D3D12_ROOT_PARAMETER rootParameters[4] = {};
-
-	// b0: MaterialCB (PixelShader)
-	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-	rootParameters[0].Descriptor.ShaderRegister = 0;
-
-	// b1: TransformCB (VertexShader)
-	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-	rootParameters[1].Descriptor.ShaderRegister = 1;
-
-	// t0: SRVテクスチャ (PixelShader)
-	D3D12_DESCRIPTOR_RANGE descriptorRange[1] = {};
-	descriptorRange[0].BaseShaderRegister = 0;
-	descriptorRange[0].NumDescriptors = 1;
-	descriptorRange[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	descriptorRange[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-	rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-	rootParameters[2].DescriptorTable.pDescriptorRanges = descriptorRange;
-	rootParameters[2].DescriptorTable.NumDescriptorRanges = _countof(descriptorRange);
-
-	// b3: DirectionalLight (PixelShader)
-	rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-	rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-	rootParameters[3].Descriptor.ShaderRegister = 3;
-
-	// ルートシグネチャのセットアップ
-	descriptionRootSignature.pParameters = rootParameters;
-	descriptionRootSignature.NumParameters = _countof(rootParameters);
-
-	// Samplerの設定
-	D3D12_STATIC_SAMPLER_DESC staticSamplers[1] = {};
-	staticSamplers[0].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR; // バイリニアフィルタ
-	staticSamplers[0].AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;   // 0~1の範囲外をリピート
-	staticSamplers[0].AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-	staticSamplers[0].AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-	staticSamplers[0].ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;   // 比較しない
-	staticSamplers[0].MaxLOD = D3D12_FLOAT32_MAX;   // ありったけのMipmapを使う
-	staticSamplers[0].ShaderRegister = 0;   // レジスタ番号0を使う
-	staticSamplers[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL; // PixelShaderで使う
-	descriptionRootSignature.pStaticSamplers = staticSamplers;
-	descriptionRootSignature.NumStaticSamplers = _countof(staticSamplers);
+	// コンパイルしたシェーダーはshaders/.shadercacheに保存し、ソースとインクルードしたファイルが同じならDXCを呼ばない
+	const std::vector<std::string> shaderCompileOptions = {
+		"-Zi", "-Qembed_debug",   // デバッグ用の情報を埋め込む
+		"-Od",     // 最適化を外しておく
+		"-Zpr",     // メモリレイアウトは行優先
+	};
+	ShaderCache shaderCache("shaders/.shadercache", [&](const ShaderCompileRequest& request, ShaderCompileOutput& output) {
+		// ワーカースレッドから並行に呼ばれる。DXCのオブジェクトはスレッドをまたいで使えないので、コンパイルごとに作る
+		ComPtr<IDxcUtils> dxcUtils = nullptr;
+		ComPtr<IDxcCompiler3> dxcCompiler = nullptr;
+		HRESULT hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
+		assert(SUCCEEDED(hr)); // dxcUtilsの生成に失敗したらエラー
+		hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
+		assert(SUCCEEDED(hr)); // dxcCompilerの生成に失敗したらエラー
+
+		// includeに対応するための設定を行う
+		ComPtr<IDxcIncludeHandler> includeHandler = nullptr;
+		hr = dxcUtils->CreateDefaultIncludeHandler(&includeHandler);
+		assert(SUCCEEDED(hr)); // includeHandlerの生成に失敗したらエラー
+		RecordingIncludeHandler recordingIncludeHandler(includeHandler.Get());
+		std::vector<std::wstring> options;
+		for (const std::string& argument : request.arguments) {
+			options.push_back(ConvertString(argument));
+		}
+		std::wstring profile = ConvertString(request.profile);
+		IDxcBlob* shaderBlob = CompileShader(ConvertString(request.sourcePath), profile.c_str(), ConvertString(request.entryPoint), options,
+			dxcUtils.Get(), dxcCompiler.Get(), &recordingIncludeHandler, &output.errors);
+		output.includedFiles = std::move(recordingIncludeHandler.includedFiles);
+		if (shaderBlob == nullptr) {
+			return false;
+		}
+		const uint8_t* bytecode = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+		output.bytecode.assign(bytecode, bytecode + shaderBlob->GetBufferSize());
+		shaderBlob->Release();
+		return !output.bytecode.empty();
+	});
 
-	// シリアライズしてバイナリにする
-	ID3DBlob* signatureBlob = nullptr;
-	ID3DBlob* errorBlob = nullptr;
-	hr = D3D12SerializeRootSignature(&descriptionRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
-	if (FAILED(hr)) {
-		Log(reinterpret_cast<char*>(errorBlob->GetBufferPointer()));
-		assert(false);
-	}
-	// バイナリを元に生成
+	// RootSignatureはシェーダーの反映情報から作る（全てのシェーダーのコンパイルが終わってから、PSOを作る前に。pipelineBuildBackend.preparePipelines）
 	ComPtr<ID3D12RootSignature> rootSignature = nullptr;
-	hr = device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
-	assert(SUCCEEDED(hr));
+	RootSignatureLayout rootSignatureLayout;
+	// 描画キューのルートパラメータの番号（kRootParameter〜）と同じ順に並べる
+	RootSignatureLayoutDesc rootSignatureLayoutDesc;
+	rootSignatureLayoutDesc.order = { "MaterialCB", "TransformCB", "gTexture", "DirectionalLightCB" };
+	// cbufferにアップロードするC++の構造体（フィールドの名前はHLSL側の変数名。起動時とホットリロードで反映情報と照らし合わせる）
+	const std::vector<CppStructLayout> constantBufferLayouts = {
+		{ "Material", "MaterialCB", uint32_t(sizeof(Material)), {
+			{ "gMaterialColor", uint32_t(offsetof(Material, color)), uint32_t(sizeof(Material::color)) },
+			{ "gEnableLighting", uint32_t(offsetof(Material, lightingMode)), uint32_t(sizeof(Material::lightingMode)) },
+			{ "padding", uint32_t(offsetof(Material, padding)), uint32_t(sizeof(Material::padding)) },
+			{ "uvTransform", uint32_t(offsetof(Material, uvTransform)), uint32_t(sizeof(Material::uvTransform)) },
+		} },
+		{ "TransformationMatrix", "TransformCB", uint32_t(sizeof(TransformationMatrix)), {
+			{ "gWVP", uint32_t(offsetof(TransformationMatrix, WVP)), uint32_t(sizeof(TransformationMatrix::WVP)) },
+			{ "gWorld", uint32_t(offsetof(TransformationMatrix, World)), uint32_t(sizeof(TransformationMatrix::World)) },
+		} },
+		{ "DirectionalLight", "DirectionalLightCB", uint32_t(sizeof(DirectionalLight)), {
+			{ "gDirectionalLight.color", uint32_t(offsetof(DirectionalLight, color)), uint32_t(sizeof(DirectionalLight::color)) },
+			{ "gDirectionalLight.direction", uint32_t(offsetof(DirectionalLight, direction)), uint32_t(sizeof(DirectionalLight::direction)) },
+			{ "gDirectionalLight.intensity", uint32_t(offsetof(DirectionalLight, intensity)), uint32_t(sizeof(DirectionalLight::intensity)) },
+			{ "gDirectionalLight.padding", uint32_t(offsetof(DirectionalLight, padding)), uint32_t(sizeof(DirectionalLight::padding)) },
+		} },
+	};
+
+	// Samplerの設定（反映情報にあるサンプラーは全てこの設定の静的サンプラーにする）
+	D3D12_STATIC_SAMPLER_DESC staticSamplerDesc{};
+	staticSamplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR; // バイリニアフィルタ
+	staticSamplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;   // 0~1の範囲外をリピート
+	staticSamplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	staticSamplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	staticSamplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;   // 比較しない
+	staticSamplerDesc.MaxLOD = D3D12_FLOAT32_MAX;   // ありったけのMipmapを使う
 
 	// InputLayout
 	D3D12_INPUT_ELEMENT_DESC inputElementDescs[3] = {};
@@ -1445,29 +1470,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	// 三角形の中を塗りつぶす
 	rasterizerDesc.FillMode = D3D12_FILL_MODE_SOLID;
 
-	// Shaderのコンパイル
-	IDxcBlob* vertexShaderBlob = CompileShader(
-		L"shaders/Object3D.VS.hlsl", // コンパイルするファイルのパス
-		L"vs_6_0", // プロファイル
-		dxcUtils, // dxcUtils
-		dxcCompiler, // dxcCompiler
-		includeHandler); // includeHandler
-	assert(vertexShaderBlob != nullptr); // シェーダーのコンパイルに失敗したらエラー
-
-	IDxcBlob* pixelShaderBlob = CompileShader(
-		L"shaders/Object3D.PS.hlsl", // コンパイルするファイルのパス
-		L"ps_6_0", // プロファイル
-		dxcUtils, // dxcUtils
-		dxcCompiler, // dxcCompiler
-		includeHandler); // includeHandler
-	assert(pixelShaderBlob != nullptr); // シェーダーのコンパイルに失敗したらエラー
-
-	// PSOを生成する
+	// PSOを生成する（シェーダーは後でPSOごとに差し替える）
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicsPipelineStateDesc{};
-	graphicsPipelineStateDesc.pRootSignature = rootSignature.Get(); // RootSignature
+	graphicsPipelineStateDesc.pRootSignature = nullptr; // RootSignature（反映情報から作った後に設定する）
 	graphicsPipelineStateDesc.InputLayout = inputLayoutDesc; // InputLayout
-	graphicsPipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() }; // VertexShader
-	graphicsPipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() }; // PixelShader
 	graphicsPipelineStateDesc.BlendState = blendDesc; // BlendState
 	graphicsPipelineStateDesc.RasterizerState = rasterizerDesc; // RasterizerState
 	// 書き込むRTVの情報
@@ -1523,19 +1529,136 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	assert(SUCCEEDED(result));
 
 
-	// 実際に生成
-	ComPtr<ID3D12PipelineState> graphicsPipelineState = nullptr;
-	hr = device->CreateGraphicsPipelineState(&graphicsPipelineStateDesc, IID_PPV_ARGS(&graphicsPipelineState));
-	assert(SUCCEEDED(hr));
+	// Shaderのコンパイルと実際の生成
+	// スレッドプールで並行に行い、PSOは自分のシェーダーが揃ったものから作る
+	PipelineBuildScheduler pipelineBuilder;
+	// Object3dのパーミュテーションのマニフェスト（キーワードと、それを使うステージはここにだけ書く）
+	const ShaderPermutationManifest object3dManifest = {
+		"Object3d",
+		{
+			{ "LIGHTING_MODE", 3 }, // LightingModeの値（None / Lambert / HalfLambert）
+			{ "HAS_UV", 2 },        // 0ならテクスチャを使わない（UVの無いモデル用）
+		},
+		{
+			{ "shaders/Object3d.VS.hlsl", "vs_6_0", { "HAS_UV" } },
+			{ "shaders/Object3d.PS.hlsl", "ps_6_0", { "LIGHTING_MODE", "HAS_UV" } },
+		},
+	};
+	ShaderPermutationSet object3dPermutations(object3dManifest);
+	const uint32_t kKeywordLightingMode = uint32_t(object3dPermutations.FindKeyword("LIGHTING_MODE"));
+	const uint32_t kKeywordHasUV = uint32_t(object3dPermutations.FindKeyword("HAS_UV"));
+	// PSOの番号はDrawPacket::pipelineと同じ
+	object3dPermutations.Register(pipelineBuilder, shaderCompileOptions);
+	std::vector<ComPtr<ID3D12PipelineState>> graphicsPipelineStates(pipelineBuilder.GetPipelineCount());
+
+	PipelineBuildBackend pipelineBuildBackend;
+	pipelineBuildBackend.compileShader = [&](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) {
+		return shaderCache.GetOrCompile(request, bytecode);
+	};
+	pipelineBuildBackend.preparePipelines = [&]() {
+		// 全てのシェーダーの反映情報を合わせて1つのルートシグネチャを作り、cbufferとC++の構造体のずれをここで見つける
+		ComPtr<IDxcUtils> dxcUtils = nullptr;
+		HRESULT hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
+		assert(SUCCEEDED(hr)); // dxcUtilsの生成に失敗したらエラー
+		std::vector<ShaderReflectionData> reflections(pipelineBuilder.GetShaderCount());
+		std::vector<const ShaderReflectionData*> reflectedShaders;
+		std::string errors;
+		bool succeeded = true;
+		for (uint32_t shader = 0; shader < reflections.size(); shader++) {
+			if (!pipelineBuilder.IsShaderReady(shader)) {
+				continue; // コンパイルに失敗したシェーダーのPSOは作られない
+			}
+			const ShaderCompileRequest& request = pipelineBuilder.GetShaderRequest(shader);
+			if (!ReflectShader(dxcUtils.Get(), pipelineBuilder.GetBytecode(shader), request.profile, reflections[shader])) {
+				errors += request.sourcePath + " (" + request.profile + "): failed to read shader reflection\n";
+				succeeded = false;
+				continue;
+			}
+			succeeded = ValidateConstantBufferLayouts(reflections[shader], constantBufferLayouts, &errors) && succeeded;
+			reflectedShaders.push_back(&reflections[shader]);
+		}
+		succeeded = succeeded && BuildRootSignatureLayout(reflectedShaders, rootSignatureLayoutDesc, rootSignatureLayout, &errors);
+		if (!succeeded) {
+			Log("shader reflection:\n" + errors);
+			return false;
+		}
+		rootSignature = CreateRootSignature(device.Get(), rootSignatureLayout, staticSamplerDesc);
+		graphicsPipelineStateDesc.pRootSignature = rootSignature.Get();
+		return rootSignature != nullptr;
+	};
+	pipelineBuildBackend.createPipeline = [&](uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders) {
+		// CreateGraphicsPipelineStateは複数のスレッドから同時に呼んでよい
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc = graphicsPipelineStateDesc;
+		pipelineStateDesc.VS = { shaders[0]->data(), shaders[0]->size() }; // VertexShader
+		pipelineStateDesc.PS = { shaders[1]->data(), shaders[1]->size() }; // PixelShader
+		return SUCCEEDED(device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&graphicsPipelineStates[pipeline])));
+	};
+	// 起動時のシェーダー・PSOの生成と、OBJの読み込み直しで共有するワーカー
+	ThreadPool workerThreads;
+	{
+		PipelineBuildReport pipelineBuildReport = pipelineBuilder.Build(workerThreads, pipelineBuildBackend);
+		LogPipelineBuildReport(pipelineBuildReport);
+		assert(!pipelineBuildReport.prepareFailed); // ルートシグネチャを作れない、またはcbufferとC++の構造体が合わなければエラー
+		assert(pipelineBuildReport.failedShaderCount == 0 && pipelineBuildReport.failedPipelineCount == 0); // シェーダーのコンパイル・PSOの生成に失敗したらエラー
+	}
+	LogRootSignatureLayout(rootSignatureLayout);
+	// 描画キューはルートパラメータの番号とCBV/テーブルの種類を決め打ちしているので、作ったルートシグネチャと合っているか確かめる
+	auto isRootParameter = [&](const char* name, uint32_t index, RootParameterKind kind) {
+		return FindRootParameter(rootSignatureLayout, name) == int32_t(index) && rootSignatureLayout.parameters[index].kind == kind;
+	};
+	assert(isRootParameter("MaterialCB", kRootParameterMaterial, RootParameterKind::ConstantBufferView));
+	assert(isRootParameter("TransformCB", kRootParameterTransform, RootParameterKind::ConstantBufferView));
+	assert(isRootParameter("gTexture", kRootParameterTexture, RootParameterKind::DescriptorTable));
+	assert(isRootParameter("DirectionalLightCB", kRootParameterLight, RootParameterKind::ConstantBufferView));
+	(void)isRootParameter;
+	LogShaderPermutationReport(object3dPermutations, pipelineBuilder);
+	// 実際に描画に使うPSOの番号（バイトコードが同じでまとめられたPSOは、実際に作った方の番号。ホットリロードで自分のPSOができたら自分になる）
+	std::vector<uint32_t> pipelineSources(pipelineBuilder.GetPipelineCount());
+	for (uint32_t pipeline = 0; pipeline < pipelineSources.size(); pipeline++) {
+		pipelineSources[pipeline] = pipelineBuilder.GetPipelineSource(pipeline);
+	}
+	// 描画ごとにキーワードの値からPSOを選ぶ
+	auto selectObject3dPipeline = [&](int32_t lightingMode, bool hasUV) {
+		ShaderPermutationKey key = object3dPermutations.SetKeyword(0, kKeywordLightingMode, uint32_t(lightingMode));
+		key = object3dPermutations.SetKeyword(key, kKeywordHasUV, hasUV ? 1 : 0);
+		return pipelineSources[object3dPermutations.GetPipeline(key)];
+	};
+	shaderCache.SaveIndex();
+	LogShaderCacheStats(shaderCache.GetStats());
 
 	InitGamepad(hwnd); // ゲームパッドを初期化
 
 
-	// モデルデータの読み込み
-	ModelData modelData = LoadObjFile("resources", "plane.obj");
-
-	// リソース作成
-	ComPtr<ID3D12Resource> vertexResource = CreateBufferResource(device, sizeof(VertexData) * modelData.vertices.size());
+	// モデルデータの読み込み（バイナリキャッシュをマップして、そのまま参照する）
+	std::vector<MeshCacheOptimizeReport> meshOptimizeReports; // キャッシュを作り直したときだけ入る
+	MeshCacheView modelCache = LoadObjFileCached("resources", "plane.obj", MeshCacheLayout::Single, nullptr, &meshOptimizeReports);
+	assert(modelCache.IsOpen());
+	MeshCacheMesh modelMesh = modelCache.GetMesh(0);
+	for (const MeshCacheOptimizeReport& optimizeReport : meshOptimizeReports) {
+		LogMeshOptimizeReport("plane.obj", optimizeReport.report);
+	}
+	bool modelHasUV = HasTexcoords(modelMesh.vertices, modelMesh.vertexCount);
+
+	// 定数バッファとモデルの頂点・インデックスは、大きめのページを切り分けて置く（1つずつリソースを作らない）
+	// ページはマップしたままにしておく。ハンドルはID3D12Resource*で、参照はアロケータがページを破棄するまで持つ
+	UploadPageBackend uploadPageBackend;
+	uploadPageBackend.createPage = [&](uint64_t size) {
+		UploadPage page;
+		ComPtr<ID3D12Resource> resource = CreateBufferResource(device, size_t(size));
+		HRESULT pageHr = resource->Map(0, nullptr, reinterpret_cast<void**>(&page.cpu));
+		assert(SUCCEEDED(pageHr));
+		page.gpuAddress = resource->GetGPUVirtualAddress();
+		page.size = size;
+		page.handle = reinterpret_cast<UploadPageHandle>(resource.Detach());
+		return page;
+	};
+	uploadPageBackend.destroyPage = [](const UploadPage& page) {
+		reinterpret_cast<ID3D12Resource*>(page.handle)->Release();
+	};
+	// 毎フレームの定数（フレームの終わりにRetireし、GPUが終わったら使い回す）
+	UploadRingAllocator frameUploads(64 * 1024, uploadPageBackend);
+	// モデルの頂点・インデックス（モデルを切り替えるときにまとめてRetireする）
+	UploadRingAllocator modelUploads(8 * 1024 * 1024, uploadPageBackend);
 
 	// リソース作成
 	std::vector<ComPtr<ID3D12Resource>> textureResources;
@@ -1544,6 +1667,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	std::vector<VertexData> sphereVertices;
 	std::vector<uint32_t> sphereIndices;
 	GenerateSphereMesh(sphereVertices, sphereIndices, 32, 32);  // 分割数32で球生成
+	LogMeshOptimizeReport("sphere", OptimizeMesh(sphereVertices, sphereIndices));
 
 	// 頂点バッファ
 	ComPtr<ID3D12Resource> vertexResourceSphere = CreateBufferResource(device, sizeof(VertexData) * sphereVertices.size());
@@ -1587,58 +1711,56 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	// 頂点バッファビューを作成
 	D3D12_VERTEX_BUFFER_VIEW vertexBufferView{};
-	// リソースの先頭のアドレスから使う
-	vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
+	// 頂点リソースにデータを書き込む
+	UploadAllocation vertexAllocation = modelUploads.Allocate(sizeof(VertexData) * modelMesh.vertexCount, alignof(VertexData));
+	std::memcpy(vertexAllocation.cpu, modelMesh.vertices, sizeof(VertexData) * modelMesh.vertexCount);
+	// 割り当てた場所の先頭のアドレスから使う
+	vertexBufferView.BufferLocation = vertexAllocation.gpuAddress;
 	// 使用するリソースサイズは頂点3つ分のサイズ
-	vertexBufferView.SizeInBytes = UINT(sizeof(VertexData) * modelData.vertices.size());
+	vertexBufferView.SizeInBytes = UINT(sizeof(VertexData) * modelMesh.vertexCount);
 	// 1つの頂点のサイズ
 	vertexBufferView.StrideInBytes = sizeof(VertexData);
 
+	// インデックスリソースにデータを書き込む
+	UploadAllocation indexAllocation = modelUploads.Allocate(sizeof(uint32_t) * modelMesh.indexCount, sizeof(uint32_t));
+	std::memcpy(indexAllocation.cpu, modelMesh.indices, sizeof(uint32_t) * modelMesh.indexCount);
 
-	// 頂点リソースにデータを書き込む
-	VertexData* vertexData = nullptr;
-	// 書き込むためのアドレスを取得
-	vertexResource->Map(0, nullptr, reinterpret_cast<void**>(&vertexData));
-	std::memcpy(vertexData, modelData.vertices.data(), sizeof(VertexData) * modelData.vertices.size());
-	vertexResource->Unmap(0, nullptr); // 書き込み完了したのでアンマップ
+	D3D12_INDEX_BUFFER_VIEW indexBufferView{};
+	indexBufferView.BufferLocation = indexAllocation.gpuAddress;
+	indexBufferView.SizeInBytes = UINT(sizeof(uint32_t) * modelMesh.indexCount);
+	indexBufferView.Format = DXGI_FORMAT_R32_UINT;
 
-	// GPU上のマテリアルリソース一覧（マテリアル名で識別）
-	std::unordered_map<std::string, ComPtr<ID3D12Resource>> materialResources;
+	// 定数バッファの中身はCPU側に持っておき、描画の直前にframeUploadsへコピーする
 
-	// CPU側のマテリアルポインタ一覧（ImGuiで編集用）
-	std::unordered_map<std::string, Material*> materialDataList;
+	// マルチマテリアルの各マテリアル（ImGuiで編集用。マテリアル名で識別）
+	std::unordered_map<std::string, Material> materialDataList;
 
 	// A マテリアル（32バイト必要）
-	ComPtr<ID3D12Resource> materialResourceA = CreateBufferResource(device, sizeof(Material));
-	Material* materialDataA = nullptr;
-	materialResourceA->Map(0, nullptr, reinterpret_cast<void**>(&materialDataA));
+	Material materialA{};
+	Material* materialDataA = &materialA;
 	*materialDataA = { {1.0f, 1.0f, 1.0f, 1.0f},1 }; // Lighting有効
 
 	// A WVP（128バイト必要）
-	ComPtr<ID3D12Resource> wvpResourceA = CreateBufferResource(device, sizeof(TransformationMatrix));
-	TransformationMatrix* wvpDataA = nullptr;
-	wvpResourceA->Map(0, nullptr, reinterpret_cast<void**>(&wvpDataA));
+	TransformationMatrix wvpA{};
+	TransformationMatrix* wvpDataA = &wvpA;
 	wvpDataA->WVP = MakeIdentity4x4();
 	wvpDataA->World = MakeIdentity4x4();
 
 	// B マテリアル
-	ComPtr<ID3D12Resource> materialResourceB = CreateBufferResource(device, sizeof(Material));
-	Material* materialDataB = nullptr;
-	materialResourceB->Map(0, nullptr, reinterpret_cast<void**>(&materialDataB));
+	Material materialB{};
+	Material* materialDataB = &materialB;
 	*materialDataB = { {1.0f, 1.0f, 1.0f, 1.0f},1 }; // Lighting有効
 
 	// B WVP
-	ComPtr<ID3D12Resource> wvpResourceB = CreateBufferResource(device, sizeof(TransformationMatrix));
-	TransformationMatrix* wvpDataB = nullptr;
-	wvpResourceB->Map(0, nullptr, reinterpret_cast<void**>(&wvpDataB));
+	TransformationMatrix wvpB{};
+	TransformationMatrix* wvpDataB = &wvpB;
 	wvpDataB->WVP = MakeIdentity4x4();
 	wvpDataB->World = MakeIdentity4x4();
 
 
-	// Sprite用のマテリアルリソースを作成する。今回はcolor1つ分のサイズを用意する
-	ComPtr<ID3D12Resource> materialResourceSprite = CreateBufferResource(device, sizeof(Material));
-	Material* materialDataSprite = nullptr;
-	materialResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&materialDataSprite));
+	// Sprite用のマテリアル
+	Material materialSprite{};
+	Material* materialDataSprite = &materialSprite;
 
 	// UVTransformを単位行列で初期化する
 	*materialDataSprite = {
@@ -1667,10 +1789,9 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	indexDataSprite[4] = 3; // 上2
 	indexDataSprite[5] = 2; // 右下2
 
-	// 平行光源のバッファを作成し、CPU 側から書き込めるようにする
-	ComPtr<ID3D12Resource> directionalLightResource = CreateBufferResource(device, sizeof(DirectionalLight));
-	DirectionalLight* directionalLightData = nullptr;
-	directionalLightResource->Map(0, nullptr, reinterpret_cast<void**>(&directionalLightData));
+	// 平行光源
+	DirectionalLight directionalLight{};
+	DirectionalLight* directionalLightData = &directionalLight;
 
 	// 初期データ設定
 	directionalLightData->color = { 1.0f, 1.0f, 1.0f };
@@ -1708,78 +1829,184 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		  {1.0f, 0.0f, 0.0f}   // translate
 	};
 
-	// Textureを呼んで転送する
-	DirectX::ScratchImage mipImages = LoadTexture("resources/uvChecker.png");
-	const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
-	ComPtr<ID3D12Resource> textureResource = CreateTextureResource(device, metadata);
-	assert(textureResource);
-	UploadTextureData(textureResource, mipImages);
-
-
-	// 2枚目Textureを呼んで転送する
-	DirectX::ScratchImage mipImages2 = LoadTexture("resources/monsterBall.png");
-	const DirectX::TexMetadata& metadata2 = mipImages2.GetMetadata();
-	ComPtr<ID3D12Resource> textureResource2 = CreateTextureResource(device, metadata2);
-	UploadTextureData(textureResource2, mipImages2);
-
-	// 3枚目Textureを呼んで転送する
-	DirectX::ScratchImage mipImages3 = LoadTexture("resources/checkerBoard.png");
-	const DirectX::TexMetadata& metadata3 = mipImages3.GetMetadata();
-	ComPtr<ID3D12Resource> textureResource3 = CreateTextureResource(device, metadata3);
-	UploadTextureData(textureResource3, mipImages3);
-
-	// metadataを基にSRVを作成する
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-	srvDesc.Format = metadata.format; // フォーマット
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING; // コンポーネントマッピング
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-	srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels); // mipレベルの数
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc2{};
-	srvDesc2.Format = metadata2.format; // フォーマット
-	srvDesc2.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING; // コンポーネントマッピング
-	srvDesc2.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-	srvDesc2.Texture2D.MipLevels = UINT(metadata2.mipLevels); // mipレベルの数
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc3{};
-	srvDesc3.Format = metadata3.format;
-	srvDesc3.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc3.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc3.Texture2D.MipLevels = UINT(metadata3.mipLevels);
-
-
-	//SRVを作成するDescriptorHeapの先頭を取得する
-	UINT descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU = GetCPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 1);
-	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 1);
-	// テクスチャのSRVを作成する
-	device->CreateShaderResourceView(textureResource.Get(), &srvDesc, textureSrvHandleCPU);
-
-	D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU2 = GetCPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 2);
-	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU2 = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 2);
-	// テクスチャのSRVを作成する
-	device->CreateShaderResourceView(textureResource2.Get(), &srvDesc2, textureSrvHandleCPU2);
-
-
-	// SRVの作成（3番目のスロット＝3番目のインデックス）
-	D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU3 = GetCPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 3);
-	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU3 = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 3);
-	device->CreateShaderResourceView(textureResource3.Get(), &srvDesc3, textureSrvHandleCPU3);
-
-	std::unordered_map<std::string, D3D12_GPU_DESCRIPTOR_HANDLE> textureHandleMap;
-	std::vector<ComPtr<ID3D12Resource>> textureUploadBuffers; // アップロードバッファ保持用
-
-	// uvChecker.png のSRV作成後に登録
-	textureHandleMap[NormalizeTextureKey("uvChecker.png")] = textureSrvHandleGPU;
-	textureUploadBuffers.push_back(textureResource);
-
-	// monsterBall.png のSRV作成後に登録
-	textureHandleMap[NormalizeTextureKey("monsterBall.png")] = textureSrvHandleGPU2;
-	textureUploadBuffers.push_back(textureResource2);
-
-	// マップに登録（キーは .mtl に記載されてるファイル名に一致させる）
-	textureHandleMap[NormalizeTextureKey("checkerBoard.png")] = textureSrvHandleGPU3;
-	textureUploadBuffers.push_back(textureResource3);
+	// SRVの0番はImGuiが使うので、アロケータには1番から渡す
+	// フレームごとの一時的なディスクリプタはまだ使う処理が無いので、全てテクスチャなどの長く使う方に回す
+	DescriptorAllocatorDesc srvDescriptorsDesc;
+	srvDescriptorsDesc.capacity = kSrvHeapSize;
+	srvDescriptorsDesc.reservedCount = 1;
+	srvDescriptorsDesc.transientCountPerFrame = 0; // AllocateTransientを使う処理ができたら増やす
+	srvDescriptorsDesc.framesInFlight = framesInFlight;
+	srvDescriptorsDesc.cpuStart = srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	srvDescriptorsDesc.gpuStart = srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	srvDescriptorsDesc.descriptorSize = descriptorSizeSRV;
+	DescriptorAllocator srvDescriptors(srvDescriptorsDesc);
+
+	// フレームのスロットとフェンスの管理（GPUが使い終わるまで解放を遅らせる処理もここに預ける）
+	FrameFence frameFence;
+	frameFence.getCompletedValue = [&]() { return fence->GetCompletedValue(); };
+	frameFence.signal = [&](uint64_t value) {
+		// GPUがここまできたとき、Fenceの値を指定した値に代入するようにSignalを送る
+		HRESULT signalHr = commandQueue->Signal(fence.Get(), value);
+		assert(SUCCEEDED(signalHr));
+	};
+	frameFence.wait = [&](uint64_t value) {
+		// 指定した値になるまで待つように設定する
+		fence->SetEventOnCompletion(value, fenceEvent);
+		// 指定した値になるまで待つ
+		WaitForSingleObject(fenceEvent, INFINITE);
+	};
+	FramePacer framePacer(framesInFlight, frameFence);
+
+	// シェーダーのホットリロード（shaders/以下を保存すると、バックグラウンドでコンパイルし直してフレームの境目でPSOを差し替える）
+	std::vector<ComPtr<ID3D12PipelineState>> reloadedPipelineStates(graphicsPipelineStates.size()); // 差し替え待ちのPSO
+	ShaderReloadBackend shaderReloadBackend;
+	shaderReloadBackend.compileShader = [&](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) {
+		if (!shaderCache.GetOrCompile(request, bytecode, &errors)) {
+			return false;
+		}
+		// ルートシグネチャは作り直さないので、cbufferの並びや使うレジスタが変わったシェーダーは差し替えない
+		ComPtr<IDxcUtils> dxcUtils = nullptr;
+		HRESULT hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
+		assert(SUCCEEDED(hr)); // dxcUtilsの生成に失敗したらエラー
+		ShaderReflectionData reflection;
+		if (!ReflectShader(dxcUtils.Get(), bytecode, request.profile, reflection)) {
+			errors += "failed to read shader reflection\n";
+			return false;
+		}
+		const bool layoutsMatch = ValidateConstantBufferLayouts(reflection, constantBufferLayouts, &errors);
+		const bool compatible = IsShaderCompatibleWithRootSignature(reflection, rootSignatureLayout, &errors);
+		return layoutsMatch && compatible;
+	};
+	shaderReloadBackend.createPipeline = [&](uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc = graphicsPipelineStateDesc;
+		pipelineStateDesc.VS = { shaders[0]->data(), shaders[0]->size() }; // VertexShader
+		pipelineStateDesc.PS = { shaders[1]->data(), shaders[1]->size() }; // PixelShader
+		return SUCCEEDED(device->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&reloadedPipelineStates[pipeline])));
+	};
+	shaderReloadBackend.swapPipeline = [&](uint32_t pipeline) {
+		// 前のPSOは送り出したフレームがまだ使っているかもしれないので、GPUが終わってから解放する
+		framePacer.Defer([pipelineState = graphicsPipelineStates[pipeline]]() {});
+		graphicsPipelineStates[pipeline] = std::move(reloadedPipelineStates[pipeline]);
+		pipelineSources[pipeline] = pipeline;
+	};
+	shaderReloadBackend.discardPipeline = [&](uint32_t pipeline) { reloadedPipelineStates[pipeline].Reset(); };
+	shaderReloadBackend.getDependencies = [&](const ShaderCompileRequest& request) { return shaderCache.GetDependencies(request); };
+	ShaderHotReloader shaderHotReloader({}, CreateFileSystemWatchBackend(), shaderReloadBackend);
+	shaderHotReloader.Track(pipelineBuilder);
+
+	// テクスチャは中身のハッシュで管理する（別のパスでも中身が同じなら1つのリソースとSRVを共有する）
+	auto allocateTextureSrv = [&]() {
+		DescriptorAllocator::Handle srv = srvDescriptors.Allocate();
+		assert(srv != DescriptorAllocator::kInvalidHandle); // SRVヒープの大きさを超えたらエラー
+		return srv;
+	};
+	auto createTextureSrv = [&](ID3D12Resource* resource, DescriptorAllocator::Handle srv) {
+		// リソースの全てのミップを見せるSRVを作成する
+		const D3D12_RESOURCE_DESC resourceDesc = resource->GetDesc();
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = resourceDesc.Format; // フォーマット
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING; // コンポーネントマッピング
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = resourceDesc.MipLevels; // mipレベルの数
+		device->CreateShaderResourceView(resource, &srvDesc, srvDescriptors.GetCpuHandle(srv));
+	};
+
+	// 読み込み中に表示するプレースホルダー（1x1の白）
+	DirectX::ScratchImage placeholderImage;
+	placeholderImage.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1);
+	std::memset(placeholderImage.GetPixels(), 0xFF, placeholderImage.GetPixelsSize());
+	ComPtr<ID3D12Resource> placeholderTexture = CreateTextureResource(device, placeholderImage.GetMetadata());
+	UploadTextureData(placeholderTexture, placeholderImage);
+	const DescriptorAllocator::Handle placeholderSrv = allocateTextureSrv();
+	createTextureSrv(placeholderTexture.Get(), placeholderSrv);
+
+	// デコードはワーカースレッドで行い、ミップはフレームの頭に小さい方から書き込む
+	// リソースは書き込み済みのミップの分だけ作り、細かいミップが来るたびに1段大きく作り直す（メモリ予算がGPUの確保量になる）
+	// 書き込み先は新しいリソースなので、前のフレームのGPU処理と重なっても古い方が読まれるだけ
+	TextureUploadBackend textureBackend;
+	textureBackend.create = [&](const DirectX::TexMetadata&) {
+		TextureGpuResource gpu;
+		gpu.srvDescriptor = allocateTextureSrv();
+		gpu.srvHandle = srvDescriptors.GetGpuHandle(gpu.srvDescriptor);
+		// 最初のミップが書き込まれるまではプレースホルダーを指す
+		createTextureSrv(placeholderTexture.Get(), gpu.srvDescriptor);
+		return gpu;
+	};
+	textureBackend.uploadMip = [&](TextureGpuResource& gpu, const DirectX::TexMetadata& metadata, size_t mipLevel, const DirectX::Image& image) {
+		// mipLevel以降のミップだけを持つリソース
+		DirectX::TexMetadata residentMetadata = metadata;
+		residentMetadata.width = (std::max)(size_t(1), metadata.width >> mipLevel);
+		residentMetadata.height = (std::max)(size_t(1), metadata.height >> mipLevel);
+		residentMetadata.mipLevels = metadata.mipLevels - mipLevel;
+		ComPtr<ID3D12Resource> resource = CreateTextureResource(device, residentMetadata);
+		assert(resource);
+
+		// 書き込み済みのミップを1段ずらして移す（どちらもCPUから読み書きできるヒープなので、コピーコマンドは要らない）
+		if (gpu.resource) {
+			const UINT residentLevels = gpu.resource->GetDesc().MipLevels;
+			std::vector<uint8_t> pixels;
+			for (UINT level = 0; level < residentLevels; ++level) {
+				size_t rowPitch = 0, slicePitch = 0;
+				HRESULT hr = DirectX::ComputePitch(metadata.format, (std::max)(size_t(1), residentMetadata.width >> (level + 1)),
+					(std::max)(size_t(1), residentMetadata.height >> (level + 1)), rowPitch, slicePitch);
+				assert(SUCCEEDED(hr));
+				pixels.resize(slicePitch);
+				hr = gpu.resource->ReadFromSubresource(pixels.data(), UINT(rowPitch), UINT(slicePitch), level, nullptr);
+				assert(SUCCEEDED(hr));
+				hr = resource->WriteToSubresource(level + 1, nullptr, pixels.data(), UINT(rowPitch), UINT(slicePitch));
+				assert(SUCCEEDED(hr));
+			}
+			// 古いリソースは今のSRVが指しているので、GPUが使い終わってから解放する
+			framePacer.Defer([oldResource = gpu.resource]() {});
+		}
+		HRESULT hr = resource->WriteToSubresource(
+			0, // 新しいリソースの先頭のミップ
+			nullptr, // 全領域へコピー
+			image.pixels, // ピクセルデータ
+			UINT(image.rowPitch), // 行のピッチ
+			UINT(image.slicePitch) // スライスのピッチ
+		);
+		assert(SUCCEEDED(hr)); // テクスチャデータのアップロードに失敗したらエラー
+		gpu.resource = resource;
+	};
+	textureBackend.publish = [&](TextureGpuResource& gpu, const DirectX::TexMetadata& metadata, size_t mostDetailedMip) {
+		// リソースはmostDetailedMip以降だけを持っているので、その全体を見せる
+		assert(gpu.resource && gpu.resource->GetDesc().MipLevels == metadata.mipLevels - mostDetailedMip);
+		(void)metadata;
+		(void)mostDetailedMip;
+		// 前のフレームが今のSRVを参照しているかもしれないので、書き換えずに新しいディスクリプタへ作って差し替える
+		DescriptorAllocator::Handle srv = allocateTextureSrv();
+		createTextureSrv(gpu.resource.Get(), srv);
+		srvDescriptors.Free(gpu.srvDescriptor);
+		gpu.srvDescriptor = srv;
+		gpu.srvHandle = srvDescriptors.GetGpuHandle(srv);
+	};
+	textureBackend.destroy = [&](TextureGpuResource& gpu) {
+		// SRVの場所はGPUが使い終わるまでアロケータが使い回さない
+		srvDescriptors.Free(gpu.srvDescriptor);
+		// リソースも前のフレームがまだ参照しているかもしれないので、ラムダに持たせてGPUが終わってから解放する
+		framePacer.Defer([resource = gpu.resource]() {});
+		gpu.resource.Reset();
+	};
+	textureBackend.placeholderSrv = srvDescriptors.GetGpuHandle(placeholderSrv);
+
+	AsyncTextureLoaderDesc textureLoaderDesc;
+	textureLoaderDesc.indexPath = "resources/.texturecache/index.txt";
+	AsyncTextureLoader textureLoader(textureLoaderDesc, textureBackend);
+	// マルチマテリアルモデルのマテリアル名→テクスチャ
+	std::unordered_map<std::string, AsyncTextureLoader::Handle> materialTextures;
+
+	// Textureの読み込みを予約する（-cookで変換したDDSがあれば、読み込むだけで済む）
+	// 読み込みが終わるまではプレースホルダーで描画するので、最初のフレームを待たせない
+	auto textureLoadStart = std::chrono::steady_clock::now();
+	bool textureLoadPending = true;
+	AsyncTextureLoader::Handle uvCheckerTexture = textureLoader.Request("resources/uvChecker.png", 1);
+	AsyncTextureLoader::Handle monsterBallTexture = textureLoader.Request("resources/monsterBall.png", 0);
+	AsyncTextureLoader::Handle checkerBoardTexture = textureLoader.Request("resources/checkerBoard.png", 1);
+
+	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU = textureLoader.GetSrvHandle(uvCheckerTexture);
+	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU3 = textureLoader.GetSrvHandle(checkerBoardTexture);
 
 	// Sprite用の頂点リソースを作る
 	ComPtr<ID3D12Resource> vertexResourceSprite = CreateBufferResource(device, sizeof(VertexData) * 4);
@@ -1817,9 +2044,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 
 	// TransformationMatrix 構造体を使う
-	ComPtr<ID3D12Resource> transformationMatrixResourceSprite = CreateBufferResource(device, sizeof(TransformationMatrix));
-	TransformationMatrix* transformationMatrixDataSprite = nullptr;
-	transformationMatrixResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&transformationMatrixDataSprite));
+	TransformationMatrix transformationMatrixSprite{};
+	TransformationMatrix* transformationMatrixDataSprite = &transformationMatrixSprite;
 	// 単位行列で初期化
 	transformationMatrixDataSprite->WVP = MakeIdentity4x4();
 	transformationMatrixDataSprite->World = MakeIdentity4x4();
@@ -1830,6 +2056,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		  {0.0f, 0.0f, 0.0f} // translate
 	};
 
+	// World/WVP行列はTransformSystemでまとめて計算する（3D用とスプライト用でビュー射影が違うので分ける）
+	TransformSystem sceneTransforms(2);
+	const TransformSystem::Handle transformHandleA = sceneTransforms.Create(transformA);
+	const TransformSystem::Handle transformHandleB = sceneTransforms.Create(transformB);
+	TransformSystem spriteTransforms(1);
+	const TransformSystem::Handle transformHandleSprite = spriteTransforms.Create(transformSprite);
+
 	Transform uvTransformSprite{
 	{1.0f, 1.0f, 1.0f},  // scale
 	{0.0f, 0.0f, 0.0f},  // rotate
@@ -1854,12 +2087,33 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
 	ImGui_ImplWin32_Init(hwnd);
-	ImGui_ImplDX12_Init(device.Get(), swapChainDesc.BufferCount,
+	ImGui_ImplDX12_Init(device.Get(), int(framesInFlight),
 		rtvDesc.Format,
 		srvDescriptorHeap.Get(), // SRV用のヒープ
 		srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), // CPU側のヒープ
 		srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart()); // GPU側のヒープ
 
+	// 描画キューの記録先（パケットの番号をここでD3D12のオブジェクトに読み替える）
+	// meshViewsはフレームごとに作り直す頂点/インデックスバッファの表（DrawPacket::meshはこの添え字）
+	std::vector<std::pair<D3D12_VERTEX_BUFFER_VIEW, D3D12_INDEX_BUFFER_VIEW>> meshViews;
+	RenderCommandBackend renderBackend;
+	renderBackend.setPipeline = [&](uint32_t pipeline) { commandList->SetPipelineState(graphicsPipelineStates[pipeline].Get()); };
+	renderBackend.setConstantBufferView = [&](uint32_t rootParameter, uint64_t address) {
+		commandList->SetGraphicsRootConstantBufferView(rootParameter, D3D12_GPU_VIRTUAL_ADDRESS(address));
+	};
+	renderBackend.setDescriptorTable = [&](uint32_t rootParameter, uint32_t texture) {
+		D3D12_GPU_DESCRIPTOR_HANDLE handle = srvDescriptorsDesc.gpuStart;
+		handle.ptr += UINT64(texture) * descriptorSizeSRV;
+		commandList->SetGraphicsRootDescriptorTable(rootParameter, handle);
+	};
+	renderBackend.setMesh = [&](uint32_t mesh) {
+		commandList->IASetVertexBuffers(0, 1, &meshViews[mesh].first);
+		commandList->IASetIndexBuffer(&meshViews[mesh].second);
+	};
+	renderBackend.drawIndexed = [&](uint32_t indexCount, uint32_t firstIndex) { commandList->DrawIndexedInstanced(indexCount, 1, firstIndex, 0, 0); };
+	RenderQueue renderQueue;
+	bool logRenderQueueStats = true; // モデルを切り替えた最初のフレームで記録する
+
 	MSG msg{};
 	// ウィンドウのxボタンが押されるまでループ
 	while (msg.message != WM_QUIT) {
@@ -1870,6 +2124,40 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			DispatchMessage(&msg);
 		} else {
 			// ゲームの処理
+			// framesInFlightフレーム前（このフレームと同じアロケータを使ったフレーム）のGPU処理だけを待つ
+			const uint32_t frameIndex = framePacer.BeginFrame();
+			hr = commandAllocators[frameIndex]->Reset();
+			assert(SUCCEEDED(hr)); // コマンドアロケータのリセットに失敗したらエラー
+			hr = commandList->Reset(commandAllocators[frameIndex].Get(), nullptr);
+			assert(SUCCEEDED(hr)); // コマンドリストのリセットに失敗したらエラー
+			srvDescriptors.Reclaim(framePacer.GetCompletedValue());
+			srvDescriptors.BeginFrame(frameIndex);
+
+			textureLoader.Update();
+			frameUploads.Reclaim(framePacer.GetCompletedValue());
+			textureSrvHandleGPU = textureLoader.GetSrvHandle(uvCheckerTexture);
+			textureSrvHandleGPU3 = textureLoader.GetSrvHandle(checkerBoardTexture);
+			if (textureLoadPending && textureLoader.IsIdle()) {
+				textureLoadPending = false;
+				Log(std::format("texture load {} us\n",
+					std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - textureLoadStart).count()));
+				LogTextureCacheStats(textureLoader.GetCache().GetStats());
+				textureLoader.GetCache().SaveIndex();
+			}
+
+			// 変更されたシェーダーのPSOを、このフレームの記録の前に差し替える（失敗したら前のPSOのまま）
+			switch (shaderHotReloader.Update()) {
+			case ShaderReloadStatus::Applied:
+				LogShaderHotReloadStats(shaderHotReloader.GetStats());
+				shaderCache.SaveIndex();
+				break;
+			case ShaderReloadStatus::Failed:
+				Log("shader hot reload failed:\n" + shaderHotReloader.GetLastErrors());
+				break;
+			case ShaderReloadStatus::None:
+				break;
+			}
+
 			ImGui_ImplDX12_NewFrame();
 			ImGui_ImplWin32_NewFrame();
 			ImGui::NewFrame();
@@ -1909,6 +2197,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			if (ImGui::Combo("Model", &currentItem, modelItems, IM_ARRAYSIZE(modelItems))) {
 				selectedModel = static_cast<ModelType>(currentItem);
 				shouldReloadModel = true; // フラグを立てる
+				logRenderQueueStats = true;
 			}
 
 			// モデルAのTransform
@@ -1945,13 +2234,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 					int i = 0;
 					for (auto& [name, matData] : materialDataList) {
 						if (ImGui::TreeNode((name + "##" + std::to_string(i)).c_str())) {
-							ImGui::DragFloat2(("UV Translate##" + name).c_str(), &matData->uvTransform.m[3][0], 0.01f, -10.0f, 10.0f);
-							ImGui::DragFloat2(("UV Scale##" + name).c_str(), &matData->uvTransform.m[0][0], 0.01f, -10.0f, 10.0f);
-							ImGui::SliderAngle(("UV Rotate##" + name).c_str(), &matData->uvTransform.m[0][1]); // 任意（角度表現）
-							ImGui::ColorEdit3(("Color##" + name).c_str(), &matData->color.x);
-							int lighting = static_cast<int>(matData->lightingMode);
+							ImGui::DragFloat2(("UV Translate##" + name).c_str(), &matData.uvTransform.m[3][0], 0.01f, -10.0f, 10.0f);
+							ImGui::DragFloat2(("UV Scale##" + name).c_str(), &matData.uvTransform.m[0][0], 0.01f, -10.0f, 10.0f);
+							ImGui::SliderAngle(("UV Rotate##" + name).c_str(), &matData.uvTransform.m[0][1]); // 任意（角度表現）
+							ImGui::ColorEdit3(("Color##" + name).c_str(), &matData.color.x);
+							int lighting = static_cast<int>(matData.lightingMode);
 							if (ImGui::Combo(("Lighting##" + name).c_str(), &lighting, "None\0Lambert\0HalfLambert\0")) {
-								matData->lightingMode = lighting;
+								matData.lightingMode = lighting;
 							}
 						}
 						++i;
@@ -1990,28 +2279,36 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			// WVP行列の計算
 			Transform cameraTransform = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -5.0f } };
 			Matrix4x4 cameraMatrix = MakeAffineMatrix(cameraTransform.scale, cameraTransform.rotate, cameraTransform.translate);
-			Matrix4x4 viewMatrix = Inverse(cameraMatrix);
-			Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(0.45f, float(kClientWidth) / float(kClientHeight), 0.1f, 100.0f);
+			Matrix4x4 viewMatrix = InverseAffine(cameraMatrix);
+			const float fovY = 0.45f;
+			Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(fovY, float(kClientWidth) / float(kClientHeight), 0.1f, 100.0f);
+
+			// ImGuiで変わった分だけWorld/WVPを計算し直す
+			sceneTransforms.SetTransform(transformHandleA, transformA);
+			sceneTransforms.SetTransform(transformHandleB, transformB);
+			sceneTransforms.Update(Multiply(viewMatrix, projectionMatrix));
 
 			// 三角形A
-			Matrix4x4 worldMatrixA = MakeAffineMatrix(transformA.scale, transformA.rotate, transformA.translate);
-			Matrix4x4 worldViewProjectionMatrixA = Multiply(worldMatrixA, Multiply(viewMatrix, projectionMatrix));
-			wvpDataA->WVP = worldViewProjectionMatrixA;
-			wvpDataA->World = worldMatrixA;
+			*wvpDataA = sceneTransforms.GetMatrix(transformHandleA);
 			materialDataA->lightingMode = static_cast<int32_t>(lightingMode);
 
+			// カメラからの距離でLODを選ぶ（LODの誤差はモデル空間なので、拡大率で割った距離で判定する）
+			Vector3 cameraToModel = {
+				transformA.translate.x - cameraTransform.translate.x,
+				transformA.translate.y - cameraTransform.translate.y,
+				transformA.translate.z - cameraTransform.translate.z };
+			float modelScale = (std::max)({ transformA.scale.x, transformA.scale.y, transformA.scale.z });
+			float lodDistance = modelScale > 0.0f ? std::sqrt(cameraToModel.x * cameraToModel.x + cameraToModel.y * cameraToModel.y + cameraToModel.z * cameraToModel.z) / modelScale : 0.0f;
+
 			// 三角形B
-			Matrix4x4 worldMatrixB = MakeAffineMatrix(transformB.scale, transformB.rotate, transformB.translate);
-			Matrix4x4 worldViewProjectionMatrixB = Multiply(worldMatrixB, Multiply(viewMatrix, projectionMatrix));
-			wvpDataB->WVP = worldViewProjectionMatrixB;
-			wvpDataB->World = worldMatrixB;
+			*wvpDataB = sceneTransforms.GetMatrix(transformHandleB);
 
 
 			// Sprite用のWVPMを作る
-			Matrix4x4 worldMatrixSprite = MakeAffineMatrix(transformSprite.scale, transformSprite.rotate, transformSprite.translate);
 			Matrix4x4 viewMatrixSprite = MakeIdentity4x4();
 			Matrix4x4 projectionMatrixSprite = MakeOrthographicMatrix(0.0f, 0.0f, float(kClientWidth), float(kClientHeight), 0.0f, 100.0f);
-			Matrix4x4 worldViewProjectionMatrixSprite = Multiply(worldMatrixSprite, Multiply(viewMatrixSprite, projectionMatrixSprite));
+			spriteTransforms.SetTransform(transformHandleSprite, transformSprite);
+			spriteTransforms.Update(Multiply(viewMatrixSprite, projectionMatrixSprite));
 
 			Matrix4x4 uvTransformMatrix = MakeScaleMatrix(uvTransformSprite.scale);
 			uvTransformMatrix = Multiply(uvTransformMatrix, MakeRotateZMatrix(uvTransformSprite.rotate.z));
@@ -2021,66 +2318,120 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			materialDataSprite->uvTransform = uvTransformMatrix;
 
 			// TransformationMatrixに正しく代入
-			transformationMatrixDataSprite->WVP = worldViewProjectionMatrixSprite;
-			transformationMatrixDataSprite->World = worldMatrixSprite;
+			*transformationMatrixDataSprite = spriteTransforms.GetMatrix(transformHandleSprite);
 
 			D3D12_GPU_DESCRIPTOR_HANDLE selectedTextureHandle = textureSrvHandleGPU;
 
 			if ((selectedModel == ModelType::MultiMesh || selectedModel == ModelType::MultiMaterial) && shouldReloadModel) {
 				const char* fileName = GetModelFileName(selectedModel);
-				multiModel = LoadObjFileMulti("resources", fileName);
+				auto loadStart = std::chrono::steady_clock::now();
+				// キャッシュからマップしたメモリを、そのままアップロードバッファへコピーする
+				MeshCacheView multiCache = LoadObjFileCached("resources", fileName, MeshCacheLayout::Multi, &workerThreads, &meshOptimizeReports);
+				assert(multiCache.IsOpen());
+				multiMaterials = multiCache.LoadMaterials();
+
+				// マテリアルのテクスチャを取り直す（読み込み済みの中身なら参照カウントが増えるだけ）
+				// 新しいテクスチャは裏で読み込み、終わるまではプレースホルダーで描画する
+				std::unordered_map<std::string, AsyncTextureLoader::Handle> previousTextures;
+				previousTextures.swap(materialTextures);
+				for (const auto& [matName, mat] : multiMaterials) {
+					if (!mat.textureFilePath.empty()) {
+						materialTextures[matName] = textureLoader.Request(mat.textureFilePath, 2);
+					}
+				}
+				for (const auto& [matName, textureHandle] : previousTextures) {
+					textureLoader.Release(textureHandle);
+				}
+				textureLoadStart = std::chrono::steady_clock::now();
+				textureLoadPending = true;
 
+				// 前のモデルの頂点・インデックスはもう描画しないので、ページごと使い回す
+				modelUploads.Retire(framePacer.GetLastSignaledValue());
+				modelUploads.Reclaim(framePacer.GetCompletedValue());
 				meshRenderList.clear();
-				for (const auto& mesh : multiModel.meshes) {
+				for (uint32_t meshIndex = 0; meshIndex < multiCache.GetMeshCount(); ++meshIndex) {
+					MeshCacheMesh mesh = multiCache.GetMesh(meshIndex);
 					MeshRenderData renderData;
-					renderData.vertexCount = mesh.vertices.size();
-					renderData.name = mesh.name;
-					renderData.materialName = mesh.materialName;
-
-					renderData.vertexResource = CreateBufferResource(device, sizeof(VertexData) * mesh.vertices.size());
-					void* vtxPtr = nullptr;
-					renderData.vertexResource->Map(0, nullptr, &vtxPtr);
-					memcpy(vtxPtr, mesh.vertices.data(), sizeof(VertexData) * mesh.vertices.size());
-					renderData.vertexResource->Unmap(0, nullptr);
-
-					renderData.vbView.BufferLocation = renderData.vertexResource->GetGPUVirtualAddress();
-					renderData.vbView.SizeInBytes = UINT(sizeof(VertexData) * mesh.vertices.size());
+					renderData.lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+					renderData.name = std::string(mesh.name);
+					renderData.materialName = std::string(mesh.materialName);
+					renderData.hasUV = HasTexcoords(mesh.vertices, mesh.vertexCount);
+
+					UploadAllocation vtxAllocation = modelUploads.Allocate(sizeof(VertexData) * mesh.vertexCount, alignof(VertexData));
+					memcpy(vtxAllocation.cpu, mesh.vertices, sizeof(VertexData) * mesh.vertexCount);
+
+					renderData.vbView.BufferLocation = vtxAllocation.gpuAddress;
+					renderData.vbView.SizeInBytes = UINT(sizeof(VertexData) * mesh.vertexCount);
 					renderData.vbView.StrideInBytes = sizeof(VertexData);
 
+					UploadAllocation idxAllocation = modelUploads.Allocate(sizeof(uint32_t) * mesh.indexCount, sizeof(uint32_t));
+					memcpy(idxAllocation.cpu, mesh.indices, sizeof(uint32_t) * mesh.indexCount);
+
+					renderData.ibView.BufferLocation = idxAllocation.gpuAddress;
+					renderData.ibView.SizeInBytes = UINT(sizeof(uint32_t) * mesh.indexCount);
+					renderData.ibView.Format = DXGI_FORMAT_R32_UINT;
+
+					LogIndexedMeshStats(std::string(fileName) + "/" + renderData.name, mesh.vertexCount, mesh.lods[0].indexCount);
+					// キャッシュを作り直したときは最適化の前後を、マップしただけなら最適化済みの値を出す
+					if (meshIndex < meshOptimizeReports.size()) {
+						LogMeshOptimizeReport(std::string(fileName) + "/" + renderData.name, meshOptimizeReports[meshIndex].report);
+					} else {
+						LogVertexCacheStats(std::string(fileName) + "/" + renderData.name, mesh.indices, mesh.lods[0].indexCount, mesh.vertexCount);
+					}
 					meshRenderList.push_back(renderData);
 				}
+				auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart);
+				Log(std::format("{}: model switch {} us\n", fileName, loadTime.count()));
+				LogUploadAllocatorStats("model uploads", modelUploads.GetStats());
 
 				// ✅ マルチマテリアル初期化（ここを追加）
-				materialResources.clear();
 				materialDataList.clear();
 
-				for (auto& [matName, mat] : multiModel.materials) {
-					ComPtr<ID3D12Resource> resource = CreateBufferResource(device, sizeof(Material));
-					Material* data = nullptr;
-					resource->Map(0, nullptr, reinterpret_cast<void**>(&data));
-					*data = mat;
-					data->lightingMode = static_cast<int32_t>(lightingMode);
-
-					materialResources[matName] = resource;
-					materialDataList[matName] = data;
+				for (auto& [matName, mat] : multiMaterials) {
+					Material& data = materialDataList[matName];
+					data = mat;
+					data.lightingMode = static_cast<int32_t>(lightingMode);
 				}
 
 				shouldReloadModel = false;
 			} else if (shouldReloadModel) {
 				// 通常モデル（Plane, Sphereなど）
 				const char* fileName = GetModelFileName(selectedModel);
-				modelData = LoadObjFile("resources", fileName);
+				auto loadStart = std::chrono::steady_clock::now();
+				// 2回目以降はキャッシュをマップするだけ（テキスト解析なし）
+				modelCache = LoadObjFileCached("resources", fileName, MeshCacheLayout::Single, nullptr, &meshOptimizeReports);
+				assert(modelCache.IsOpen());
+				modelMesh = modelCache.GetMesh(0);
+				modelHasUV = HasTexcoords(modelMesh.vertices, modelMesh.vertexCount);
+
+				// 前のモデルの頂点・インデックスはもう描画しないので、ページごと使い回す
+				modelUploads.Retire(framePacer.GetLastSignaledValue());
+				modelUploads.Reclaim(framePacer.GetCompletedValue());
+
+				vertexAllocation = modelUploads.Allocate(sizeof(VertexData) * modelMesh.vertexCount, alignof(VertexData));
+				memcpy(vertexAllocation.cpu, modelMesh.vertices, sizeof(VertexData) * modelMesh.vertexCount);
+
+				vertexBufferView.BufferLocation = vertexAllocation.gpuAddress;
+				vertexBufferView.SizeInBytes = UINT(sizeof(VertexData) * modelMesh.vertexCount);
+				vertexBufferView.StrideInBytes = sizeof(VertexData);
 
-				vertexResource = CreateBufferResource(device, sizeof(VertexData) * modelData.vertices.size());
-				void* vertexPtr = nullptr;
-				vertexResource->Map(0, nullptr, &vertexPtr);
-				memcpy(vertexPtr, modelData.vertices.data(), sizeof(VertexData) * modelData.vertices.size());
-				vertexResource->Unmap(0, nullptr);
+				indexAllocation = modelUploads.Allocate(sizeof(uint32_t) * modelMesh.indexCount, sizeof(uint32_t));
+				memcpy(indexAllocation.cpu, modelMesh.indices, sizeof(uint32_t) * modelMesh.indexCount);
 
-				vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
-				vertexBufferView.SizeInBytes = UINT(sizeof(VertexData) * modelData.vertices.size());
-				vertexBufferView.StrideInBytes = sizeof(VertexData);
+				indexBufferView.BufferLocation = indexAllocation.gpuAddress;
+				indexBufferView.SizeInBytes = UINT(sizeof(uint32_t) * modelMesh.indexCount);
 
+				auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart);
+				Log(std::format("{}: model switch {} us\n", fileName, loadTime.count()));
+				LogIndexedMeshStats(fileName, modelMesh.vertexCount, modelMesh.lods[0].indexCount);
+				if (!meshOptimizeReports.empty()) {
+					LogMeshOptimizeReport(fileName, meshOptimizeReports[0].report);
+				} else {
+					LogVertexCacheStats(fileName, modelMesh.indices, modelMesh.lods[0].indexCount, modelMesh.vertexCount);
+				}
+				for (uint32_t lod = 1; lod < modelMesh.lodCount; ++lod) {
+					Log(std::format("{}: LOD{} {} triangles, error {:.4f}\n", fileName, lod, modelMesh.lods[lod].indexCount / 3, modelMesh.lods[lod].error));
+				}
 				shouldReloadModel = false;
 			}
 
@@ -2125,104 +2476,132 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
 
-			// RootSignatureとPSOの設定
+			// RootSignatureの設定（PSOは描画キューが設定する）
 			commandList->SetGraphicsRootSignature(rootSignature.Get());
-			commandList->SetPipelineState(graphicsPipelineState.Get());
 
 			// 頂点バッファの設定
 			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-			// 球の描画
+			// このフレームの定数をframeUploadsへコピーする
+			// （前のフレームの分はGPUが読み終わるまで残るので、毎フレーム別の場所に書く）
+			const D3D12_GPU_VIRTUAL_ADDRESS materialAddressA = frameUploads.AllocateConstants(*materialDataA).gpuAddress;
+			const D3D12_GPU_VIRTUAL_ADDRESS wvpAddressA = frameUploads.AllocateConstants(*wvpDataA).gpuAddress;
+			const D3D12_GPU_VIRTUAL_ADDRESS wvpAddressB = frameUploads.AllocateConstants(*wvpDataB).gpuAddress;
+			const D3D12_GPU_VIRTUAL_ADDRESS materialAddressSprite = frameUploads.AllocateConstants(*materialDataSprite).gpuAddress;
+			const D3D12_GPU_VIRTUAL_ADDRESS transformationMatrixAddressSprite = frameUploads.AllocateConstants(*transformationMatrixDataSprite).gpuAddress;
+			const D3D12_GPU_VIRTUAL_ADDRESS directionalLightAddress = frameUploads.AllocateConstants(*directionalLightData).gpuAddress;
+
+			// 描画するLOD（モデル切り替え後のキャッシュから選ぶ）
+			const MeshLod& modelLod = modelMesh.lods[SelectLod(modelMesh.lods, modelMesh.lodCount, lodDistance, fovY, float(kClientHeight))];
+
+			// 描画をキューに集め、状態の順に並べてから記録する（同じ設定が続くところは飛ばされる）
+			// キーのマテリアルの番号は並びを決めるだけなので、このフレームの中で区別できればよい
+			auto textureIndex = [&](D3D12_GPU_DESCRIPTOR_HANDLE handle) {
+				return uint32_t((handle.ptr - srvDescriptorsDesc.gpuStart.ptr) / descriptorSizeSRV);
+			};
+			auto meshIndex = [&](const D3D12_VERTEX_BUFFER_VIEW& vertexBuffer, const D3D12_INDEX_BUFFER_VIEW& indexBuffer) {
+				meshViews.emplace_back(vertexBuffer, indexBuffer);
+				return uint32_t(meshViews.size() - 1);
+			};
+			auto distanceFromCamera = [&](const Vector3& position) {
+				Vector3 offset = { position.x - cameraTransform.translate.x, position.y - cameraTransform.translate.y, position.z - cameraTransform.translate.z };
+				// 遠クリップ面（100）までを0〜1にする
+				return std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z) / 100.0f;
+			};
+			const uint32_t kLayerScene = 0;
+			const uint32_t kLayerSprite = 1; // 3Dの後に描く
+			auto submitDraw = [&](DrawPacket packet, uint32_t layer, uint32_t materialId, float depth) {
+				packet.sortKey = MakeSortKey(layer, packet.pipeline, materialId, packet.texture, depth);
+				renderQueue.Submit(packet);
+			};
+			renderQueue.Clear();
+			meshViews.clear();
+
+			// 全ての描画で同じもの
+			DrawPacket basePacket;
+			basePacket.material = materialAddressA;
+			basePacket.transform = wvpAddressA;
+			basePacket.light = directionalLightAddress;
+
+			if (selectedModel == ModelType::Plane || selectedModel == ModelType::UtahTeapot || selectedModel == ModelType::StanfordBunny) {
+				// 読み込んだモデルを描画
+				DrawPacket packet = basePacket;
+				packet.texture = textureIndex(selectedModel == ModelType::UtahTeapot ? textureSrvHandleGPU3 : selectedTextureHandle);
+				packet.mesh = meshIndex(vertexBufferView, indexBufferView);
+				packet.indexCount = modelLod.indexCount;
+				packet.firstIndex = modelLod.firstIndex;
+				packet.pipeline = selectObject3dPipeline(materialDataA->lightingMode, modelHasUV);
+				submitDraw(packet, kLayerScene, 0, distanceFromCamera(transformA.translate));
+			}
+			if (selectedModel == ModelType::Plane || selectedModel == ModelType::Sphere) {
+				// Sphereを描画（PlaneのときはBの位置に、SphereのときはAの位置に描く）
+				DrawPacket packet = basePacket;
+				packet.transform = selectedModel == ModelType::Plane ? wvpAddressB : wvpAddressA;
+				packet.texture = textureIndex(selectedTextureHandle);
+				packet.mesh = meshIndex(vertexBufferViewSphere, indexBufferViewSphere);
+				packet.indexCount = static_cast<UINT>(sphereIndices.size());
+				packet.pipeline = selectObject3dPipeline(materialDataA->lightingMode, true);
+				submitDraw(packet, kLayerScene, 0, distanceFromCamera(selectedModel == ModelType::Plane ? transformB.translate : transformA.translate));
+			}
 			if (selectedModel == ModelType::Plane) {
-				// Planeモデルを描画
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, wvpResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootDescriptorTable(2, selectedTextureHandle);
-				commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-				commandList->DrawInstanced(static_cast<UINT>(modelData.vertices.size()), 1, 0, 0);
-
-				// さらにSphereも描画！
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSphere);
-				commandList->IASetIndexBuffer(&indexBufferViewSphere);
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, wvpResourceB->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootDescriptorTable(2, selectedTextureHandle); // Sphere用テクスチャ
-				commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-				commandList->DrawIndexedInstanced(static_cast<UINT>(sphereIndices.size()), 1, 0, 0, 0);
-
-				commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
 				// Spriteの描画
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSprite);
-				commandList->IASetIndexBuffer(&indexBufferViewSprite);
-				// TransformationBufferの設定
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceSprite->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, transformationMatrixResourceSprite->GetGPUVirtualAddress());
-
-				// 描画
-				commandList->DrawIndexedInstanced(6, 1, 0, 0, 0);
-
-			} else if (selectedModel == ModelType::Sphere) {
-				// Sphereモデルを描画
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSphere);
-				commandList->IASetIndexBuffer(&indexBufferViewSphere);
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, wvpResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootDescriptorTable(2, selectedTextureHandle);
-				commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-				commandList->DrawIndexedInstanced(static_cast<UINT>(sphereIndices.size()), 1, 0, 0, 0);
-			} else if (selectedModel == ModelType::UtahTeapot) {
-				// Teapotモデルを描画
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, wvpResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU3);
-				commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-				commandList->DrawInstanced(static_cast<UINT>(modelData.vertices.size()), 1, 0, 0);
-			} else if (selectedModel == ModelType::StanfordBunny) {
-				// Stanford Bunnyモデルを描画
-				commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-				commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootConstantBufferView(1, wvpResourceA->GetGPUVirtualAddress());
-				commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
-				commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-				commandList->DrawInstanced(static_cast<UINT>(modelData.vertices.size()), 1, 0, 0);
-			}if (selectedModel == ModelType::MultiMesh || selectedModel == ModelType::MultiMaterial) {
+				DrawPacket packet = basePacket;
+				packet.material = materialAddressSprite;
+				packet.transform = transformationMatrixAddressSprite;
+				packet.texture = textureIndex(textureSrvHandleGPU);
+				packet.mesh = meshIndex(vertexBufferViewSprite, indexBufferViewSprite);
+				packet.indexCount = 6;
+				packet.pipeline = selectObject3dPipeline(materialDataSprite->lightingMode, true);
+				submitDraw(packet, kLayerSprite, 1, 0.0f);
+			}
+			if (selectedModel == ModelType::MultiMesh || selectedModel == ModelType::MultiMaterial) {
+				// マテリアルの定数はマテリアルごとに1回だけコピーする（同じマテリアルのメッシュは並べ替えで隣り合う）
+				struct MaterialConstants {
+					uint32_t id;
+					D3D12_GPU_VIRTUAL_ADDRESS address;
+					int32_t lightingMode;
+				};
+				std::unordered_map<std::string, MaterialConstants> materialAddresses;
+				for (const auto& [name, matData] : materialDataList) {
+					materialAddresses[name] = { uint32_t(materialAddresses.size()) + 2, frameUploads.AllocateConstants(matData).gpuAddress, matData.lightingMode };
+				}
+				const float meshDepth = distanceFromCamera(transformA.translate);
 				for (const auto& mesh : meshRenderList) {
-					// テクスチャキーを取得
-					std::string texKey = "none";
-					auto it = multiModel.materials.find(mesh.materialName);
-					if (it != multiModel.materials.end()) {
-						texKey = NormalizeTextureKey(it->second.textureFilePath);
-					}
-
-					D3D12_GPU_DESCRIPTOR_HANDLE texHandle = textureSrvHandleGPU;
-					if (textureHandleMap.count(texKey)) {
-						texHandle = textureHandleMap[texKey];
+					DrawPacket packet = basePacket;
+					// マテリアルのテクスチャを取得
+					packet.texture = textureIndex(textureSrvHandleGPU);
+					auto textureIt = materialTextures.find(mesh.materialName);
+					if (textureIt != materialTextures.end()) {
+						packet.texture = textureIndex(textureLoader.GetSrvHandle(textureIt->second));
 					} else {
-						Log("❌ textureHandleMapに " + texKey + " が存在しない");
+						Log("❌ materialTexturesに " + mesh.materialName + " が存在しない");
 					}
 
-					// 描画
-					commandList->IASetVertexBuffers(0, 1, &mesh.vbView);
-
-					// ImGuiで操作されたマテリアルバッファを使う
-					auto matResourceIt = materialResources.find(mesh.materialName);
-					if (matResourceIt != materialResources.end()) {
-						commandList->SetGraphicsRootConstantBufferView(0, matResourceIt->second->GetGPUVirtualAddress());
-					} else {
-						commandList->SetGraphicsRootConstantBufferView(0, materialResourceA->GetGPUVirtualAddress());
+					// ImGuiで操作されたマテリアルを使う
+					uint32_t materialId = 0;
+					int32_t meshLightingMode = materialDataA->lightingMode;
+					auto materialIt = materialAddresses.find(mesh.materialName);
+					if (materialIt != materialAddresses.end()) {
+						materialId = materialIt->second.id;
+						packet.material = materialIt->second.address;
+						meshLightingMode = materialIt->second.lightingMode;
 					}
+					packet.pipeline = selectObject3dPipeline(meshLightingMode, mesh.hasUV);
 
-					commandList->SetGraphicsRootConstantBufferView(1, wvpResourceA->GetGPUVirtualAddress());
-					commandList->SetGraphicsRootDescriptorTable(2, texHandle);
-					commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-
-					commandList->DrawInstanced(static_cast<UINT>(mesh.vertexCount), 1, 0, 0);
+					const MeshLod& lod = mesh.lods[SelectLod(mesh.lods.data(), uint32_t(mesh.lods.size()), lodDistance, fovY, float(kClientHeight))];
+					packet.mesh = meshIndex(mesh.vbView, mesh.ibView);
+					packet.indexCount = lod.indexCount;
+					packet.firstIndex = lod.firstIndex;
+					submitDraw(packet, kLayerScene, materialId, meshDepth);
 				}
 			}
 
-
+			renderQueue.Sort();
+			RenderQueueStats renderQueueStats = renderQueue.Execute(renderBackend);
+			if (logRenderQueueStats) {
+				logRenderQueueStats = false;
+				LogRenderQueueStats(GetModelFileName(selectedModel), renderQueueStats);
+			}
 
 			// ImGuiの描画
 			ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList.Get());
@@ -2242,26 +2621,16 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			commandQueue->ExecuteCommandLists(1, commandLists);
 			// GPUとOSに画面の交換をさせる
 			swapChain->Present(1, 0);
-			// Fenceの値を更新
-			fenceValue++;
-			// GPUがここまできたとき、Fenceの値を指定した値に代入するようにSignalを送る
-			commandQueue->Signal(fence.Get(), fenceValue);
-			// Fenceの値が指定した値になったか確認する
-			if (fence->GetCompletedValue() < fenceValue) {
-				// 指定した値になっていなかったら、指定した値になるまで待つように設定する
-				fence->SetEventOnCompletion(fenceValue, fenceEvent);
-				// 指定した値になるまで待つ
-				WaitForSingleObject(fenceEvent, INFINITE);
-			}
-
-			// 次のフレーム用のコマンドリストを取得
-			hr = commandAllocator->Reset();
-			assert(SUCCEEDED(hr)); // コマンドアロケータのリセットに失敗したらエラー
-			// コマンドリストをリセット
-			hr = commandList->Reset(commandAllocator.Get(), nullptr);
-			assert(SUCCEEDED(hr)); // コマンドリストのリセットに失敗したらエラー
+			// Fenceの値を更新してSignalを送る（ここでは待たず、次のフレームの記録に進む）
+			const uint64_t frameFenceValue = framePacer.EndFrame();
+			// このフレームの定数とFreeしたディスクリプタは、GPUがframeFenceValueまで進めば使い終わる
+			frameUploads.Retire(frameFenceValue);
+			srvDescriptors.Retire(frameFenceValue);
 		}
 	}
+	// 解放する前に、バックグラウンドのコンパイルと送り出したフレームを全て終わらせる
+	shaderHotReloader.WaitIdle();
+	framePacer.WaitIdle();
 
 	// 出力ウィンドウへの文字出力
 	OutputDebugStringA("Hello, DirectX!\n");
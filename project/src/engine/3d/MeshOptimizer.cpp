@@ -0,0 +1,387 @@
+#include "engine/3d/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Forsyth "Linear-Speed Vertex Cache Optimisation" のパラメータ
+constexpr uint32_t kForsythCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+constexpr uint32_t kInvalidTriangle = std::numeric_limits<uint32_t>::max();
+
+// キャッシュ内の位置と残りの三角形数から頂点のスコアを求める
+class VertexScoreTable {
+public:
+	VertexScoreTable() {
+		for (uint32_t i = 0; i < kForsythCacheSize; ++i) {
+			if (i < 3) {
+				// 直前の三角形の頂点は、同じ三角形を続けて使わないように少し下げる
+				cacheScores_[i] = kLastTriangleScore;
+			} else {
+				float scaler = 1.0f / float(kForsythCacheSize - 3);
+				cacheScores_[i] = std::pow(1.0f - float(i - 3) * scaler, kCacheDecayPower);
+			}
+		}
+		for (uint32_t i = 0; i < kValenceTableSize; ++i) {
+			valenceScores_[i] = i == 0 ? 0.0f : kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+		}
+	}
+
+	float Get(int32_t cachePosition, uint32_t remainingTriangles) const {
+		if (remainingTriangles == 0) {
+			return -1.0f; // もう使わない頂点
+		}
+		float score = cachePosition < 0 ? 0.0f : cacheScores_[cachePosition];
+		// 残りが少ない頂点を優先して片付ける
+		if (remainingTriangles < kValenceTableSize) {
+			score += valenceScores_[remainingTriangles];
+		} else {
+			score += kValenceBoostScale * std::pow(float(remainingTriangles), -kValenceBoostPower);
+		}
+		return score;
+	}
+
+private:
+	static constexpr uint32_t kValenceTableSize = 64;
+	float cacheScores_[kForsythCacheSize];
+	float valenceScores_[kValenceTableSize];
+};
+
+Vector3 Sub(const Vector4& a, const Vector4& b) {
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+Vector3 Cross(const Vector3& a, const Vector3& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+// オーバードロー最適化で並べ替える三角形のまとまり
+struct TriangleCluster {
+	size_t firstTriangle;
+	size_t triangleCount;
+	float sortKey;
+};
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	VertexCacheModel model, uint32_t cacheSize) {
+	VertexCacheStats stats;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0 || cacheSize == 0) {
+		return stats;
+	}
+
+	size_t misses = 0;
+	if (model == VertexCacheModel::Fifo) {
+		// 頂点がキャッシュに入った時刻を覚えておき、その後cacheSize回以上押し出されたら外れとみなす
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			uint32_t index = indices[i];
+			if (time - timestamps[index] > cacheSize) {
+				timestamps[index] = time++;
+				++misses;
+			}
+		}
+	} else {
+		std::vector<uint32_t> cache;
+		cache.reserve(cacheSize + 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i) {
+			uint32_t index = indices[i];
+			auto it = std::find(cache.begin(), cache.end(), index);
+			if (it == cache.end()) {
+				++misses;
+				cache.insert(cache.begin(), index);
+				if (cache.size() > cacheSize) {
+					cache.pop_back();
+				}
+			} else {
+				std::rotate(cache.begin(), it, it + 1);
+			}
+		}
+	}
+
+	// ATVRは実際に参照されている頂点数で割る
+	std::vector<bool> referenced(vertexCount, false);
+	size_t referencedCount = 0;
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		if (!referenced[indices[i]]) {
+			referenced[indices[i]] = true;
+			++referencedCount;
+		}
+	}
+
+	stats.shadedVertexCount = misses;
+	stats.acmr = float(misses) / float(triangleCount);
+	stats.atvr = float(misses) / float(referencedCount);
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+	static const VertexScoreTable scoreTable;
+
+	// 頂点ごとの隣接三角形リスト（CSR形式）
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		++remaining[indices[i]];
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (size_t k = 0; k < 3; ++k) {
+				adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+			}
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		vertexScores[v] = scoreTable.Get(-1, remaining[v]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const uint32_t* tri = &indices[t * 3];
+		triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+		if (triangleScores[t] > triangleScores[bestTriangle]) {
+			bestTriangle = uint32_t(t);
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(kForsythCacheSize + 3);
+	newCache.reserve(kForsythCacheSize + 3);
+	size_t scanCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+		if (bestTriangle == kInvalidTriangle) {
+			// キャッシュ内に候補が無い：入力順で次の未出力の三角形から再開する
+			while (emitted[scanCursor]) {
+				++scanCursor;
+			}
+			bestTriangle = uint32_t(scanCursor);
+		}
+
+		const uint32_t* tri = &indices[bestTriangle * 3];
+		output.insert(output.end(), tri, tri + 3);
+		emitted[bestTriangle] = true;
+
+		// 出力した三角形を隣接リストから外す
+		for (size_t k = 0; k < 3; ++k) {
+			uint32_t v = tri[k];
+			uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+			uint32_t* end = begin + remaining[v];
+			uint32_t* it = std::find(begin, end, bestTriangle);
+			*it = *(end - 1);
+			--remaining[v];
+		}
+
+		// 出力した頂点を先頭にしてLRUキャッシュを更新する
+		newCache.clear();
+		for (size_t k = 0; k < 3; ++k) {
+			if (std::find(newCache.begin(), newCache.end(), tri[k]) == newCache.end()) {
+				newCache.push_back(tri[k]);
+			}
+		}
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				newCache.push_back(v);
+			}
+		}
+
+		// キャッシュ内の頂点（押し出された頂点も含む）のスコアを更新
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			uint32_t v = newCache[i];
+			cachePositions[v] = i < kForsythCacheSize ? int32_t(i) : -1;
+			vertexScores[v] = scoreTable.Get(cachePositions[v], remaining[v]);
+		}
+
+		// スコアが変わった頂点の三角形を再計算し、次の候補を探す
+		bestTriangle = kInvalidTriangle;
+		float bestScore = -std::numeric_limits<float>::max();
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			uint32_t v = newCache[i];
+			const uint32_t* adjacent = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t a = 0; a < remaining[v]; ++a) {
+				uint32_t t = adjacent[a];
+				const uint32_t* other = &indices[t * 3];
+				float score = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+				triangleScores[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > kForsythCacheSize) {
+			newCache.resize(kForsythCacheSize);
+		}
+		cache.swap(newCache);
+	}
+
+	indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VertexData>& vertices, float threshold) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2 || vertices.empty()) {
+		return;
+	}
+
+	// FIFOキャッシュで3頂点とも外れる三角形を区切りにしてクラスタに分ける
+	// （キャッシュが空になる位置なので、クラスタを入れ替えてもキャッシュ効率はほぼ変わらない）
+	std::vector<TriangleCluster> clusters;
+	{
+		std::vector<uint32_t> timestamps(vertices.size(), 0);
+		uint32_t time = kFifoCacheSize + 1;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			uint32_t misses = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t index = indices[t * 3 + k];
+				if (time - timestamps[index] > kFifoCacheSize) {
+					timestamps[index] = time++;
+					++misses;
+				}
+			}
+			if (t == 0 || misses == 3) {
+				clusters.push_back({ t, 0, 0.0f });
+			}
+			++clusters.back().triangleCount;
+		}
+	}
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	// 面積で重み付けしたクラスタの中心と法線
+	std::vector<Vector3> centroids(clusters.size());
+	std::vector<Vector3> normals(clusters.size());
+	Vector3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		Vector3 centroid = { 0.0f, 0.0f, 0.0f };
+		Vector3 normal = { 0.0f, 0.0f, 0.0f };
+		float clusterArea = 0.0f;
+		for (size_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; ++t) {
+			const Vector4& p0 = vertices[indices[t * 3 + 0]].position;
+			const Vector4& p1 = vertices[indices[t * 3 + 1]].position;
+			const Vector4& p2 = vertices[indices[t * 3 + 2]].position;
+			Vector3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+			float area = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			centroid.x += (p0.x + p1.x + p2.x) * (area / 3.0f);
+			centroid.y += (p0.y + p1.y + p2.y) * (area / 3.0f);
+			centroid.z += (p0.z + p1.z + p2.z) * (area / 3.0f);
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			clusterArea += area;
+		}
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f) {
+			centroid.x /= clusterArea;
+			centroid.y /= clusterArea;
+			centroid.z /= clusterArea;
+		}
+		float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		if (length > 0.0f) {
+			normal.x /= length;
+			normal.y /= length;
+			normal.z /= length;
+		}
+		centroids[c] = centroid;
+		normals[c] = normal;
+	}
+	if (meshArea <= 0.0f) {
+		return;
+	}
+	meshCentroid.x /= meshArea;
+	meshCentroid.y /= meshArea;
+	meshCentroid.z /= meshArea;
+
+	// メッシュの中心から外を向いているクラスタほど手前にある可能性が高いので先に描く
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		Vector3 offset = { centroids[c].x - meshCentroid.x, centroids[c].y - meshCentroid.y, centroids[c].z - meshCentroid.z };
+		clusters[c].sortKey = offset.x * normals[c].x + offset.y * normals[c].y + offset.z * normals[c].z;
+	}
+	std::vector<size_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return clusters[a].sortKey > clusters[b].sortKey;
+		});
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (size_t c : order) {
+		auto begin = indices.begin() + clusters[c].firstTriangle * 3;
+		sorted.insert(sorted.end(), begin, begin + clusters[c].triangleCount * 3);
+	}
+
+	// キャッシュ効率がthresholdを超えて悪化するなら元のままにする
+	float before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), VertexCacheModel::Fifo, kFifoCacheSize).acmr;
+	float after = AnalyzeVertexCache(sorted.data(), sorted.size(), vertices.size(), VertexCacheModel::Fifo, kFifoCacheSize).acmr;
+	if (after <= before * threshold) {
+		indices.swap(sorted);
+	}
+}
+
+void OptimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices) {
+	constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertices.size(), kUnused);
+	std::vector<VertexData> reordered;
+	reordered.reserve(vertices.size());
+	for (uint32_t& index : indices) {
+		if (remap[index] == kUnused) {
+			remap[index] = uint32_t(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+MeshOptimizeReport OptimizeMesh(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices) {
+	MeshOptimizeReport report;
+	report.fifoBefore = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), VertexCacheModel::Fifo, kFifoCacheSize);
+	report.lruBefore = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), VertexCacheModel::Lru, kLruCacheSize);
+
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+
+	report.fifoAfter = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), VertexCacheModel::Fifo, kFifoCacheSize);
+	report.lruAfter = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), VertexCacheModel::Lru, kLruCacheSize);
+	return report;
+}
+
+MeshOptimizeReport OptimizeMesh(ModelData& model) {
+	return OptimizeMesh(model.vertices, model.indices);
+}
+
+MeshOptimizeReport OptimizeMesh(Mesh& mesh) {
+	return OptimizeMesh(mesh.vertices, mesh.indices);
+}
@@ -0,0 +1,76 @@
+#include "engine/3d/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 頂点の中身（バイト列）で比べるためのキー
+std::string VertexKey(const VertexData& vertex) {
+	return std::string(reinterpret_cast<const char*>(&vertex), sizeof(VertexData));
+}
+
+// 三角形を中身の番号の組にする。巻き順を保ったまま、最小の番号が先頭に来るように回す
+std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	std::map<std::string, uint32_t>& contentIds) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	triangles.reserve(indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<uint32_t, 3> triangle;
+		for (size_t k = 0; k < 3; ++k) {
+			auto [it, inserted] = contentIds.emplace(VertexKey(vertices[indices[i + k]]), uint32_t(contentIds.size()));
+			triangle[k] = it->second;
+		}
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunMeshOptimizerSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices) {
+	// 三角形の順番を混ぜた入力（キャッシュの効きが悪いので、最適化で必ず良くなるはず）
+	std::vector<uint32_t> shuffledIndices = indices;
+	{
+		std::vector<uint32_t> order(indices.size() / 3);
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(5));
+		for (size_t i = 0; i < order.size(); ++i) {
+			std::memcpy(&shuffledIndices[i * 3], &indices[size_t(order[i]) * 3], sizeof(uint32_t) * 3);
+		}
+	}
+
+	std::vector<SelfTestResult> results;
+	for (bool shuffled : { false, true }) {
+		const std::vector<uint32_t>& inputIndices = shuffled ? shuffledIndices : indices;
+		std::vector<VertexData> optimizedVertices = vertices;
+		std::vector<uint32_t> optimizedIndices = inputIndices;
+		const MeshOptimizeReport report = OptimizeMesh(optimizedVertices, optimizedIndices);
+
+		std::map<std::string, uint32_t> contentIds;
+		const bool sameTriangles = CanonicalTriangles(vertices, inputIndices, contentIds) ==
+			CanonicalTriangles(optimizedVertices, optimizedIndices, contentIds);
+		const std::string testName = "mesh optimizer " + name + (shuffled ? " (shuffled)" : "");
+		AddSelfTestResult(results, testName + " keeps triangles and winding", sameTriangles,
+			std::to_string(indices.size() / 3) + " triangles, " + std::to_string(vertices.size()) + " -> " +
+			std::to_string(optimizedVertices.size()) + " vertices");
+
+		// 混ぜた入力では改善することまで求める
+		const bool fifoOk = shuffled ? report.fifoAfter.acmr < report.fifoBefore.acmr : report.fifoAfter.acmr <= report.fifoBefore.acmr;
+		const bool lruOk = shuffled ? report.lruAfter.acmr < report.lruBefore.acmr : report.lruAfter.acmr <= report.lruBefore.acmr;
+		AddSelfTestResult(results, testName + " does not worsen ACMR", fifoOk && lruOk,
+			"FIFO " + FormatSelfTestValue(report.fifoBefore.acmr) + " -> " + FormatSelfTestValue(report.fifoAfter.acmr) +
+			", LRU " + FormatSelfTestValue(report.lruBefore.acmr) + " -> " + FormatSelfTestValue(report.lruAfter.acmr));
+	}
+	return results;
+}
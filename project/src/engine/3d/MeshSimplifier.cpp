@@ -0,0 +1,771 @@
+#include "engine/3d/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include "engine/3d/MeshOptimizer.h"
+
+namespace {
+
+constexpr uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+// これ以上法線の向きが違う頂点は、同じ位置でも別の面（ハードエッジ）として扱う
+constexpr float kNormalSeamCos = 0.5f;
+constexpr float kTexcoordEpsilon = 1e-6f;
+// 継ぎ目の形を保つための拘束平面の重み
+constexpr double kSeamWeight = 10.0;
+// 1レベルでこれ以上減らなければLODの生成を打ち切る
+constexpr float kMinReduction = 0.95f;
+
+struct Vec3d {
+	double x, y, z;
+};
+
+Vec3d Sub(const Vec3d& a, const Vec3d& b) {
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+Vec3d Cross(const Vec3d& a, const Vec3d& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+double Dot(const Vec3d& a, const Vec3d& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// 点pと三角形abcの最短距離（Ericson "Real-Time Collision Detection" 5.1.5）
+double PointTriangleDistance(const Vec3d& p, const Vec3d& a, const Vec3d& b, const Vec3d& c) {
+	auto distance = [&](const Vec3d& q) {
+		Vec3d d = Sub(p, q);
+		return std::sqrt(Dot(d, d));
+	};
+	auto lerp = [](const Vec3d& from, const Vec3d& direction, double t) {
+		return Vec3d{ from.x + direction.x * t, from.y + direction.y * t, from.z + direction.z * t };
+	};
+	Vec3d ab = Sub(b, a);
+	Vec3d ac = Sub(c, a);
+	Vec3d ap = Sub(p, a);
+	double d1 = Dot(ab, ap);
+	double d2 = Dot(ac, ap);
+	if (d1 <= 0.0 && d2 <= 0.0) {
+		return distance(a);
+	}
+	Vec3d bp = Sub(p, b);
+	double d3 = Dot(ab, bp);
+	double d4 = Dot(ac, bp);
+	if (d3 >= 0.0 && d4 <= d3) {
+		return distance(b);
+	}
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+		return distance(lerp(a, ab, d1 / (d1 - d3)));
+	}
+	Vec3d cp = Sub(p, c);
+	double d5 = Dot(ab, cp);
+	double d6 = Dot(ac, cp);
+	if (d6 >= 0.0 && d5 <= d6) {
+		return distance(c);
+	}
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+		return distance(lerp(a, ac, d2 / (d2 - d6)));
+	}
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+		return distance(lerp(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+	}
+	double denominator = 1.0 / (va + vb + vc);
+	Vec3d q = lerp(a, ab, vb * denominator);
+	return distance(lerp(q, ac, vc * denominator));
+}
+
+// 平面までの距離の2乗和を表す対称4x4行列（上三角の10要素）と重み
+struct Quadric {
+	double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+	double a11 = 0, a12 = 0, a13 = 0;
+	double a22 = 0, a23 = 0;
+	double a33 = 0;
+	double weight = 0;
+
+	// 平面 n・p + d = 0 を重みwで加える（nは正規化済み）
+	void AddPlane(const Vec3d& n, double d, double w) {
+		a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+		a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+		a22 += w * n.z * n.z; a23 += w * n.z * d;
+		a33 += w * d * d;
+		weight += w;
+	}
+
+	void Add(const Quadric& q) {
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23;
+		a33 += q.a33;
+		weight += q.weight;
+	}
+
+	// 点pでの誤差（平面までの距離の2乗の重み付き平均）
+	double Evaluate(const Vec3d& p) const {
+		double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + a33
+			+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+			+ 2.0 * (a03 * p.x + a13 * p.y + a23 * p.z);
+		return weight > 0.0 ? std::max(r, 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double error;
+};
+
+class Simplifier {
+public:
+	Simplifier(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices)
+		: vertices_(vertices) {
+		BuildPositions();
+		BuildAttributeClasses();
+		BuildTriangles(indices);
+		BuildTopology();
+		BuildQuadrics();
+	}
+
+	// 目標の三角形数・誤差まで縮約する。誤差の見積もり（距離）を返す
+	// 縮約の順番はQEMで決め、誤差は消える頂点から新しい面までの距離を積み上げて見積もる
+	// （QEMは面積で平均されるので、小さな突起を削った時のずれを小さく見積もってしまう）
+	double Run(size_t targetTriangleCount, double maxError) {
+		double maxErrorSquared = maxError * maxError;
+		double resultError = 0.0;
+		std::vector<Collapse> collapses;
+		std::vector<bool> touched(positions_.size(), false);
+		std::vector<uint32_t> pairs;
+
+		while (aliveTriangleCount_ > targetTriangleCount) {
+			// 生きている辺を列挙する（位置番号の小さい順で重複なし）
+			pairs.clear();
+			for (size_t t = 0; t < triangleAlive_.size(); ++t) {
+				if (!triangleAlive_[t]) {
+					continue;
+				}
+				for (size_t k = 0; k < 3; ++k) {
+					uint32_t a = PositionOf(t, k);
+					uint32_t b = PositionOf(t, (k + 1) % 3);
+					pairs.push_back(std::min(a, b));
+					pairs.push_back(std::max(a, b));
+				}
+			}
+			std::vector<uint64_t> edges(pairs.size() / 2);
+			for (size_t i = 0; i < edges.size(); ++i) {
+				edges[i] = (uint64_t(pairs[i * 2]) << 32) | pairs[i * 2 + 1];
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+			// 各辺の安い方の向きを候補にする
+			collapses.clear();
+			for (uint64_t edge : edges) {
+				uint32_t a = uint32_t(edge >> 32);
+				uint32_t b = uint32_t(edge & 0xffffffffu);
+				Collapse best{ kInvalid, kInvalid, std::numeric_limits<double>::max() };
+				for (int direction = 0; direction < 2; ++direction) {
+					uint32_t from = direction == 0 ? a : b;
+					uint32_t to = direction == 0 ? b : a;
+					if (locked_[from]) {
+						continue;
+					}
+					Quadric q = quadrics_[from];
+					q.Add(quadrics_[to]);
+					double error = q.Evaluate(positions_[to]);
+					if (error < best.error && IsCollapseValid(from, to)) {
+						best = { from, to, error };
+					}
+				}
+				if (best.from != kInvalid && best.error <= maxErrorSquared) {
+					collapses.push_back(best);
+				}
+			}
+			if (collapses.empty()) {
+				break;
+			}
+			std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) {
+				return l.error < r.error;
+				});
+
+			// 誤差の小さい順に、同じパスで触った頂点を避けながら縮約する
+			std::fill(touched.begin(), touched.end(), false);
+			size_t performed = 0;
+			for (const Collapse& collapse : collapses) {
+				if (aliveTriangleCount_ <= targetTriangleCount) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to] || !IsCollapseValid(collapse.from, collapse.to)) {
+					continue;
+				}
+				double deviation = deviations_[collapse.from] + ComputeRemovedDistance(collapse.from, collapse.to);
+				if (deviation > maxError) {
+					continue;
+				}
+				PerformCollapse(collapse.from, collapse.to);
+				collapsedInto_[collapse.from] = collapse.to;
+				deviations_[collapse.to] = std::max(deviations_[collapse.to], deviation);
+				touched[collapse.from] = true;
+				touched[collapse.to] = true;
+				resultError = std::max(resultError, deviation);
+				++performed;
+			}
+			if (performed == 0) {
+				break;
+			}
+		}
+		return resultError;
+	}
+
+	std::vector<uint32_t> GetIndices() const {
+		std::vector<uint32_t> indices;
+		indices.reserve(aliveTriangleCount_ * 3);
+		for (size_t t = 0; t < triangleAlive_.size(); ++t) {
+			if (triangleAlive_[t]) {
+				indices.insert(indices.end(), &corners_[t * 3], &corners_[t * 3] + 3);
+			}
+		}
+		return indices;
+	}
+
+	size_t GetTriangleCount() const { return aliveTriangleCount_; }
+
+	// メッシュの大きさ（バウンディングボックスの最大辺）
+	double GetExtent() const { return extent_; }
+
+	// 頂点 → 位置番号（同じ頂点配列なら、どの入力インデックスでも同じ番号になる）
+	const std::vector<uint32_t>& GetPositionIds() const { return positionIds_; }
+	const std::vector<Vec3d>& GetPositions() const { return positions_; }
+
+	// 位置ごとの縮約先（縮約で消えた位置は、最終的に吸収した位置。残った位置は自分）
+	std::vector<uint32_t> GetOwners() const {
+		std::vector<uint32_t> owners(positions_.size());
+		for (uint32_t position = 0; position < owners.size(); ++position) {
+			uint32_t owner = position;
+			while (collapsedInto_[owner] != kInvalid) {
+				owner = collapsedInto_[owner];
+			}
+			owners[position] = owner;
+		}
+		return owners;
+	}
+
+private:
+	uint32_t PositionOf(size_t triangle, size_t corner) const {
+		return positionIds_[corners_[triangle * 3 + corner]];
+	}
+
+	// 座標が完全に一致する頂点を同じ位置として番号を振る
+	void BuildPositions() {
+		std::vector<uint32_t> order(vertices_.size());
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		auto key = [&](uint32_t v) {
+			const Vector4& p = vertices_[v].position;
+			uint32_t bits[3];
+			std::memcpy(&bits[0], &p.x, 4);
+			std::memcpy(&bits[1], &p.y, 4);
+			std::memcpy(&bits[2], &p.z, 4);
+			return std::make_tuple(bits[0], bits[1], bits[2], v);
+		};
+		std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r) { return key(l) < key(r); });
+
+		positionIds_.assign(vertices_.size(), kInvalid);
+		Vec3d minimum = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+		Vec3d maximum = { -minimum.x, -minimum.y, -minimum.z };
+		for (size_t i = 0; i < order.size(); ++i) {
+			uint32_t v = order[i];
+			const Vector4& p = vertices_[v].position;
+			if (i > 0) {
+				const Vector4& q = vertices_[order[i - 1]].position;
+				if (std::memcmp(&p, &q, sizeof(float) * 3) == 0) {
+					positionIds_[v] = positionIds_[order[i - 1]];
+					continue;
+				}
+			}
+			positionIds_[v] = uint32_t(positions_.size());
+			positions_.push_back({ p.x, p.y, p.z });
+			minimum = { std::min(minimum.x, double(p.x)), std::min(minimum.y, double(p.y)), std::min(minimum.z, double(p.z)) };
+			maximum = { std::max(maximum.x, double(p.x)), std::max(maximum.y, double(p.y)), std::max(maximum.z, double(p.z)) };
+		}
+		extent_ = positions_.empty() ? 0.0 : std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+	}
+
+	bool SameAttributes(const VertexData& a, const VertexData& b) const {
+		if (std::abs(a.texcoord.x - b.texcoord.x) > kTexcoordEpsilon || std::abs(a.texcoord.y - b.texcoord.y) > kTexcoordEpsilon) {
+			return false;
+		}
+		float la = std::sqrt(a.normal.x * a.normal.x + a.normal.y * a.normal.y + a.normal.z * a.normal.z);
+		float lb = std::sqrt(b.normal.x * b.normal.x + b.normal.y * b.normal.y + b.normal.z * b.normal.z);
+		if (la == 0.0f || lb == 0.0f) {
+			return la == lb;
+		}
+		float d = (a.normal.x * b.normal.x + a.normal.y * b.normal.y + a.normal.z * b.normal.z) / (la * lb);
+		return d >= kNormalSeamCos;
+	}
+
+	// 同じ位置で属性がほぼ同じ頂点をまとめる（まとめた頂点は縮約後に代表で置き換えてよい）
+	void BuildAttributeClasses() {
+		classIds_.assign(vertices_.size(), kInvalid);
+		std::vector<std::vector<uint32_t>> positionVertices(positions_.size());
+		for (uint32_t v = 0; v < vertices_.size(); ++v) {
+			positionVertices[positionIds_[v]].push_back(v);
+		}
+		for (const std::vector<uint32_t>& list : positionVertices) {
+			size_t firstClass = classRepresentatives_.size();
+			for (uint32_t v : list) {
+				for (size_t c = firstClass; c < classRepresentatives_.size(); ++c) {
+					if (SameAttributes(vertices_[v], vertices_[classRepresentatives_[c]])) {
+						classIds_[v] = uint32_t(c);
+						break;
+					}
+				}
+				if (classIds_[v] == kInvalid) {
+					classIds_[v] = uint32_t(classRepresentatives_.size());
+					classRepresentatives_.push_back(v);
+				}
+			}
+		}
+	}
+
+	void BuildTriangles(const std::vector<uint32_t>& indices) {
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			uint32_t a = positionIds_[indices[t]];
+			uint32_t b = positionIds_[indices[t + 1]];
+			uint32_t c = positionIds_[indices[t + 2]];
+			// 位置が重なった縮退三角形は見えないので最初から除く
+			if (a == b || b == c || c == a) {
+				continue;
+			}
+			corners_.insert(corners_.end(), &indices[t], &indices[t] + 3);
+		}
+		triangleAlive_.assign(corners_.size() / 3, true);
+		aliveTriangleCount_ = triangleAlive_.size();
+		positionTriangles_.resize(positions_.size());
+		for (uint32_t t = 0; t < triangleAlive_.size(); ++t) {
+			for (size_t k = 0; k < 3; ++k) {
+				positionTriangles_[PositionOf(t, k)].push_back(t);
+			}
+		}
+	}
+
+	// 境界・非多様体の頂点を固定し、継ぎ目の辺を調べる
+	void BuildTopology() {
+		locked_.assign(positions_.size(), false);
+		struct EdgeUse {
+			uint32_t a, b, triangle, classA, classB;
+		};
+		std::vector<EdgeUse> uses;
+		uses.reserve(corners_.size());
+		for (uint32_t t = 0; t < triangleAlive_.size(); ++t) {
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t va = corners_[t * 3 + k];
+				uint32_t vb = corners_[t * 3 + (k + 1) % 3];
+				if (positionIds_[va] > positionIds_[vb]) {
+					std::swap(va, vb);
+				}
+				uses.push_back({ positionIds_[va], positionIds_[vb], t, classIds_[va], classIds_[vb] });
+			}
+		}
+		std::sort(uses.begin(), uses.end(), [](const EdgeUse& l, const EdgeUse& r) {
+			return std::tie(l.a, l.b, l.triangle) < std::tie(r.a, r.b, r.triangle);
+			});
+		for (size_t i = 0; i < uses.size();) {
+			size_t j = i;
+			while (j < uses.size() && uses[j].a == uses[i].a && uses[j].b == uses[i].b) {
+				++j;
+			}
+			size_t count = j - i;
+			if (count != 2) {
+				// 穴の縁（1枚）や3枚以上が共有する辺の頂点は動かさない
+				locked_[uses[i].a] = true;
+				locked_[uses[i].b] = true;
+			} else if (uses[i].classA != uses[i + 1].classA || uses[i].classB != uses[i + 1].classB) {
+				seamEdges_.push_back({ uses[i].a, uses[i].b, uses[i].triangle });
+				seamEdges_.push_back({ uses[i].a, uses[i].b, uses[i + 1].triangle });
+			}
+			i = j;
+		}
+	}
+
+	void BuildQuadrics() {
+		quadrics_.assign(positions_.size(), Quadric());
+		deviations_.assign(positions_.size(), 0.0);
+		collapsedInto_.assign(positions_.size(), kInvalid);
+		for (uint32_t t = 0; t < triangleAlive_.size(); ++t) {
+			const Vec3d& p0 = positions_[PositionOf(t, 0)];
+			const Vec3d& p1 = positions_[PositionOf(t, 1)];
+			const Vec3d& p2 = positions_[PositionOf(t, 2)];
+			Vec3d n = Cross(Sub(p1, p0), Sub(p2, p0));
+			double length = std::sqrt(Dot(n, n));
+			if (length == 0.0) {
+				continue;
+			}
+			n = { n.x / length, n.y / length, n.z / length };
+			double area = length * 0.5;
+			for (size_t k = 0; k < 3; ++k) {
+				quadrics_[PositionOf(t, k)].AddPlane(n, -Dot(n, p0), area);
+			}
+		}
+		// 継ぎ目の辺は、面に垂直で辺を含む平面で拘束して形を保つ
+		for (const SeamEdge& seam : seamEdges_) {
+			const Vec3d& pa = positions_[seam.a];
+			const Vec3d& pb = positions_[seam.b];
+			const Vec3d& p0 = positions_[PositionOf(seam.triangle, 0)];
+			const Vec3d& p1 = positions_[PositionOf(seam.triangle, 1)];
+			const Vec3d& p2 = positions_[PositionOf(seam.triangle, 2)];
+			Vec3d faceNormal = Cross(Sub(p1, p0), Sub(p2, p0));
+			Vec3d edge = Sub(pb, pa);
+			Vec3d n = Cross(edge, faceNormal);
+			double length = std::sqrt(Dot(n, n));
+			if (length == 0.0) {
+				continue;
+			}
+			n = { n.x / length, n.y / length, n.z / length };
+			double weight = Dot(edge, edge) * kSeamWeight;
+			quadrics_[seam.a].AddPlane(n, -Dot(n, pa), weight);
+			quadrics_[seam.b].AddPlane(n, -Dot(n, pa), weight);
+		}
+	}
+
+	// fromの位置をtoに寄せてよいか（多様体の維持・継ぎ目・面の裏返り）
+	bool IsCollapseValid(uint32_t from, uint32_t to) {
+		if (locked_[from] || from == to) {
+			return false;
+		}
+		// 共有する三角形（縮約で消える）と、残って形が変わる三角形に分ける
+		sharedTriangles_.clear();
+		movingTriangles_.clear();
+		for (uint32_t t : positionTriangles_[from]) {
+			if (!triangleAlive_[t]) {
+				continue;
+			}
+			bool shared = PositionOf(t, 0) == to || PositionOf(t, 1) == to || PositionOf(t, 2) == to;
+			(shared ? sharedTriangles_ : movingTriangles_).push_back(t);
+		}
+		if (sharedTriangles_.empty()) {
+			return false;
+		}
+
+		// リンク条件：両端に共通する隣接頂点は、消える三角形の対頂点だけでなければならない
+		neighborsFrom_.clear();
+		neighborsTo_.clear();
+		CollectNeighbors(from, neighborsFrom_);
+		CollectNeighbors(to, neighborsTo_);
+		size_t common = 0;
+		for (uint32_t n : neighborsFrom_) {
+			if (std::binary_search(neighborsTo_.begin(), neighborsTo_.end(), n)) {
+				++common;
+			}
+		}
+		if (common != sharedTriangles_.size()) {
+			return false;
+		}
+
+		// 属性のまとまりの対応：from側の各まとまりが、消える三角形を通してto側の1つのまとまりにつながること
+		classMap_.clear();
+		for (uint32_t t : sharedTriangles_) {
+			uint32_t classFrom = kInvalid;
+			uint32_t classTo = kInvalid;
+			for (size_t k = 0; k < 3; ++k) {
+				if (PositionOf(t, k) == from) {
+					classFrom = classIds_[corners_[t * 3 + k]];
+				} else if (PositionOf(t, k) == to) {
+					classTo = classIds_[corners_[t * 3 + k]];
+				}
+			}
+			uint32_t mapped = FindClassMapping(classFrom);
+			if (mapped == kInvalid) {
+				classMap_.push_back({ classFrom, classTo });
+			} else if (mapped != classTo) {
+				return false;
+			}
+		}
+
+		const Vec3d& target = positions_[to];
+		for (uint32_t t : movingTriangles_) {
+			Vec3d p[3];
+			Vec3d moved[3];
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t position = PositionOf(t, k);
+				if (position == from) {
+					// 継ぎ目をまたぐ縮約はUV・法線が崩れるので行わない
+					if (FindClassMapping(classIds_[corners_[t * 3 + k]]) == kInvalid) {
+						return false;
+					}
+				}
+				p[k] = positions_[position];
+				moved[k] = position == from ? target : p[k];
+			}
+			// 面が裏返る・つぶれる縮約は行わない
+			Vec3d before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+			Vec3d after = Cross(Sub(moved[1], moved[0]), Sub(moved[2], moved[0]));
+			if (Dot(before, after) <= 0.0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// fromを消した後の面からfromの元の位置までの距離（IsCollapseValidの直後に呼ぶ）
+	double ComputeRemovedDistance(uint32_t from, uint32_t to) const {
+		const Vec3d& removed = positions_[from];
+		double nearest = std::numeric_limits<double>::max();
+		for (uint32_t t : movingTriangles_) {
+			Vec3d p[3];
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t position = PositionOf(t, k);
+				p[k] = positions_[position == from ? to : position];
+			}
+			nearest = std::min(nearest, PointTriangleDistance(removed, p[0], p[1], p[2]));
+		}
+		// 周りの面が全部消える場合（孤立した三角形の組）は辺の長さで見積もる
+		if (movingTriangles_.empty()) {
+			Vec3d d = Sub(removed, positions_[to]);
+			nearest = std::sqrt(Dot(d, d));
+		}
+		return nearest;
+	}
+
+	// IsCollapseValidの直後に呼ぶ（sharedTriangles_などを使う）
+	void PerformCollapse(uint32_t from, uint32_t to) {
+		for (uint32_t t : sharedTriangles_) {
+			triangleAlive_[t] = false;
+			--aliveTriangleCount_;
+		}
+		for (uint32_t t : movingTriangles_) {
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t& corner = corners_[t * 3 + k];
+				if (positionIds_[corner] == from) {
+					corner = classRepresentatives_[FindClassMapping(classIds_[corner])];
+				}
+			}
+			positionTriangles_[to].push_back(t);
+		}
+		positionTriangles_[from].clear();
+		// 消えた三角形を隣接リストから掃除する
+		std::vector<uint32_t>& list = positionTriangles_[to];
+		list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return !triangleAlive_[t]; }), list.end());
+		quadrics_[to].Add(quadrics_[from]);
+	}
+
+	void CollectNeighbors(uint32_t position, std::vector<uint32_t>& out) const {
+		for (uint32_t t : positionTriangles_[position]) {
+			if (!triangleAlive_[t]) {
+				continue;
+			}
+			for (size_t k = 0; k < 3; ++k) {
+				uint32_t p = PositionOf(t, k);
+				if (p != position) {
+					out.push_back(p);
+				}
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+
+	uint32_t FindClassMapping(uint32_t classFrom) const {
+		for (const auto& [source, destination] : classMap_) {
+			if (source == classFrom) {
+				return destination;
+			}
+		}
+		return kInvalid;
+	}
+
+	struct SeamEdge {
+		uint32_t a, b, triangle;
+	};
+
+	const std::vector<VertexData>& vertices_;
+	std::vector<uint32_t> positionIds_; // 頂点 → 位置番号
+	std::vector<Vec3d> positions_;
+	std::vector<uint32_t> classIds_; // 頂点 → 属性のまとまり
+	std::vector<uint32_t> classRepresentatives_; // まとまり → 代表の頂点
+	std::vector<uint32_t> corners_; // 三角形の頂点番号（縮約で書き換わる）
+	std::vector<bool> triangleAlive_;
+	size_t aliveTriangleCount_ = 0;
+	std::vector<std::vector<uint32_t>> positionTriangles_;
+	std::vector<bool> locked_;
+	std::vector<SeamEdge> seamEdges_;
+	std::vector<Quadric> quadrics_;
+	std::vector<double> deviations_; // 位置ごとの、これまでに吸収した頂点のずれの見積もり
+	std::vector<uint32_t> collapsedInto_; // 縮約で消えた位置 → 寄せた先の位置
+	double extent_ = 0.0;
+
+	// IsCollapseValidの作業領域
+	std::vector<uint32_t> sharedTriangles_;
+	std::vector<uint32_t> movingTriangles_;
+	std::vector<uint32_t> neighborsFrom_;
+	std::vector<uint32_t> neighborsTo_;
+	std::vector<std::pair<uint32_t, uint32_t>> classMap_;
+};
+
+// バウンディングボックスの最大辺
+float ComputeExtent(const std::vector<VertexData>& vertices) {
+	if (vertices.empty()) {
+		return 0.0f;
+	}
+	Vector3 minimum = { vertices[0].position.x, vertices[0].position.y, vertices[0].position.z };
+	Vector3 maximum = minimum;
+	for (const VertexData& vertex : vertices) {
+		minimum = { std::min(minimum.x, vertex.position.x), std::min(minimum.y, vertex.position.y), std::min(minimum.z, vertex.position.z) };
+		maximum = { std::max(maximum.x, vertex.position.x), std::max(maximum.y, vertex.position.y), std::max(maximum.z, vertex.position.z) };
+	}
+	return std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+}
+
+// 元のメッシュの全ての位置から、簡略化したメッシュまでの距離の上限
+// 縮約のずれの見積もりは周りの縮約で面が動いた分を含まないので、LODを作った後に測り直す
+// 各位置は最終的に吸収した位置（owners）の周りの面までの距離で測る（全ての面との最短距離以上になる）
+double MeasureSimplifiedDistance(const std::vector<Vec3d>& positions, const std::vector<uint32_t>& positionIds,
+	const std::vector<uint32_t>& originalIndices, const std::vector<uint32_t>& owners, const std::vector<uint32_t>& simplifiedIndices) {
+	// 位置 → 周りの三角形（CSR形式）
+	const size_t triangleCount = simplifiedIndices.size() / 3;
+	std::vector<uint32_t> offsets(positions.size() + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		++offsets[positionIds[simplifiedIndices[i]] + 1];
+	}
+	for (size_t p = 0; p < positions.size(); ++p) {
+		offsets[p + 1] += offsets[p];
+	}
+	std::vector<uint32_t> triangles(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (size_t k = 0; k < 3; ++k) {
+				triangles[fill[positionIds[simplifiedIndices[t * 3 + k]]]++] = uint32_t(t);
+			}
+		}
+	}
+	auto triangleDistance = [&](const Vec3d& p, uint32_t t) {
+		return PointTriangleDistance(p, positions[positionIds[simplifiedIndices[t * 3 + 0]]],
+			positions[positionIds[simplifiedIndices[t * 3 + 1]]], positions[positionIds[simplifiedIndices[t * 3 + 2]]]);
+	};
+
+	std::vector<bool> measured(positions.size(), false);
+	double maxDistance = 0.0;
+	for (uint32_t index : originalIndices) {
+		const uint32_t position = positionIds[index];
+		if (measured[position]) {
+			continue;
+		}
+		measured[position] = true;
+		const uint32_t owner = owners[position];
+		double nearest = std::numeric_limits<double>::max();
+		for (uint32_t a = offsets[owner]; a < offsets[owner + 1]; ++a) {
+			nearest = std::min(nearest, triangleDistance(positions[position], triangles[a]));
+		}
+		// 吸収した位置の面が全て消えた（小さな部品がつぶれた）ときは全ての面から探す
+		if (offsets[owner] == offsets[owner + 1]) {
+			for (uint32_t t = 0; t < triangleCount; ++t) {
+				nearest = std::min(nearest, triangleDistance(positions[position], t));
+			}
+		}
+		maxDistance = std::max(maxDistance, nearest);
+	}
+	return maxDistance;
+}
+
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float targetError, float* outError) {
+	Simplifier simplifier(vertices, indices);
+	simplifier.Run(targetIndexCount / 3, double(targetError) * simplifier.GetExtent());
+	std::vector<uint32_t> simplified = simplifier.GetIndices();
+	if (outError) {
+		*outError = float(MeasureSimplifiedDistance(
+			simplifier.GetPositions(), simplifier.GetPositionIds(), indices, simplifier.GetOwners(), simplified));
+	}
+	return simplified;
+}
+
+std::vector<LodLevel> GenerateLodChain(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	const LodSettings& settings) {
+	std::vector<LodLevel> levels;
+	levels.push_back({ indices, 0.0f });
+	float extent = ComputeExtent(vertices);
+	if (extent <= 0.0f) {
+		return levels;
+	}
+	// 元の位置 → 今のレベルで吸収している位置
+	std::vector<uint32_t> owners;
+	for (uint32_t level = 1; level < settings.maxLevels; ++level) {
+		const LodLevel& previous = levels.back();
+		// 1つ前のレベルから簡略化するので、誤差は前のレベルの分を足して見積もる
+		float remainingError = settings.maxError - previous.error / extent;
+		if (remainingError <= 0.0f) {
+			break;
+		}
+		size_t target = size_t(double(previous.indices.size() / 3) * settings.triangleRatio) * 3;
+		Simplifier simplifier(vertices, previous.indices);
+		simplifier.Run(target / 3, double(remainingError) * simplifier.GetExtent());
+		std::vector<uint32_t> simplified = simplifier.GetIndices();
+		if (simplified.empty() || float(simplified.size()) > float(previous.indices.size()) * kMinReduction) {
+			break;
+		}
+
+		// 記録する誤差は、元のメッシュ（LOD0）の位置から測り直した値
+		std::vector<uint32_t> levelOwners = simplifier.GetOwners();
+		if (owners.empty()) {
+			owners = std::move(levelOwners);
+		} else {
+			for (uint32_t& owner : owners) {
+				owner = levelOwners[owner];
+			}
+		}
+		float error = std::max(previous.error, float(MeasureSimplifiedDistance(
+			simplifier.GetPositions(), simplifier.GetPositionIds(), indices, owners, simplified)));
+		if (error > settings.maxError * extent) {
+			break;
+		}
+		OptimizeVertexCache(simplified, vertices.size());
+		levels.push_back({ std::move(simplified), error });
+	}
+	return levels;
+}
+
+namespace {
+
+void AppendLods(const std::vector<VertexData>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods,
+	const LodSettings& settings) {
+	std::vector<LodLevel> levels = GenerateLodChain(vertices, indices, settings);
+	indices.clear();
+	lods.clear();
+	for (const LodLevel& level : levels) {
+		lods.push_back({ uint32_t(indices.size()), uint32_t(level.indices.size()), level.error });
+		indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+	}
+}
+
+} // namespace
+
+void BuildLods(ModelData& model, const LodSettings& settings) {
+	AppendLods(model.vertices, model.indices, model.lods, settings);
+}
+
+void BuildLods(Mesh& mesh, const LodSettings& settings) {
+	AppendLods(mesh.vertices, mesh.indices, mesh.lods, settings);
+}
+
+uint32_t SelectLod(const MeshLod* lods, uint32_t lodCount, float distance, float fovY, float viewportHeight,
+	float pixelThreshold) {
+	if (lodCount == 0 || distance <= 0.0f) {
+		return 0;
+	}
+	// 距離distanceでの1ピクセルあたりのモデル空間の長さ
+	float worldPerPixel = 2.0f * distance * std::tan(fovY * 0.5f) / viewportHeight;
+	for (uint32_t level = lodCount - 1; level > 0; --level) {
+		if (lods[level].error <= worldPerPixel * pixelThreshold) {
+			return level;
+		}
+	}
+	return 0;
+}
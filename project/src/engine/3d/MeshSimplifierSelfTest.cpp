@@ -0,0 +1,156 @@
+#include "engine/3d/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+// GenerateLodChainの打ち切り条件と合わせる
+constexpr float kMinReduction = 0.95f;
+
+// バウンディングボックスの最大辺
+float ComputeExtent(const std::vector<VertexData>& vertices) {
+	if (vertices.empty()) {
+		return 0.0f;
+	}
+	Vector3 minimum = { vertices[0].position.x, vertices[0].position.y, vertices[0].position.z };
+	Vector3 maximum = minimum;
+	for (const VertexData& vertex : vertices) {
+		minimum = { std::min(minimum.x, vertex.position.x), std::min(minimum.y, vertex.position.y), std::min(minimum.z, vertex.position.z) };
+		maximum = { std::max(maximum.x, vertex.position.x), std::max(maximum.y, vertex.position.y), std::max(maximum.z, vertex.position.z) };
+	}
+	return std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+}
+
+struct Vec3d {
+	double x, y, z;
+};
+
+Vec3d ToVec3d(const VertexData& vertex) {
+	return { vertex.position.x, vertex.position.y, vertex.position.z };
+}
+
+Vec3d Sub(const Vec3d& a, const Vec3d& b) {
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+double Dot(const Vec3d& a, const Vec3d& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vec3d Cross(const Vec3d& a, const Vec3d& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+// 点pと線分abの最短距離
+double PointSegmentDistance(const Vec3d& p, const Vec3d& a, const Vec3d& b) {
+	const Vec3d ab = Sub(b, a);
+	const double lengthSquared = Dot(ab, ab);
+	const double t = lengthSquared > 0.0 ? std::clamp(Dot(Sub(p, a), ab) / lengthSquared, 0.0, 1.0) : 0.0;
+	const Vec3d d = Sub(p, { a.x + ab.x * t, a.y + ab.y * t, a.z + ab.z * t });
+	return std::sqrt(Dot(d, d));
+}
+
+// 点pと三角形abcの最短距離
+// 簡略化側（MeshSimplifier.cppの領域判定）とは別の求め方にして、測った誤差が同じ誤りを共有しないようにする
+// 平面への射影が三角形の内側なら平面までの距離、外側なら3辺までの距離の最小
+double PointTriangleDistance(const Vec3d& p, const Vec3d& a, const Vec3d& b, const Vec3d& c) {
+	const Vec3d normal = Cross(Sub(b, a), Sub(c, a));
+	const double normalLengthSquared = Dot(normal, normal);
+	if (normalLengthSquared > 0.0) {
+		const Vec3d ap = Sub(p, a);
+		const bool inside = Dot(Cross(Sub(b, a), ap), normal) >= 0.0 &&
+			Dot(Cross(Sub(c, b), Sub(p, b)), normal) >= 0.0 &&
+			Dot(Cross(Sub(a, c), Sub(p, c)), normal) >= 0.0;
+		if (inside) {
+			return std::abs(Dot(ap, normal)) / std::sqrt(normalLengthSquared);
+		}
+	}
+	return std::min({ PointSegmentDistance(p, a, b), PointSegmentDistance(p, b, c), PointSegmentDistance(p, c, a) });
+}
+
+// 元の全ての頂点から、簡略化した面までの最短距離の最大値（総当たり）
+double MeasureLodDistance(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& originalIndices,
+	const std::vector<uint32_t>& lodIndices) {
+	std::vector<bool> used(vertices.size(), false);
+	for (uint32_t index : originalIndices) {
+		used[index] = true;
+	}
+	double maxDistance = 0.0;
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		if (!used[v]) {
+			continue;
+		}
+		const Vec3d p = ToVec3d(vertices[v]);
+		double nearest = std::numeric_limits<double>::max();
+		for (size_t i = 0; i + 2 < lodIndices.size() && nearest > 0.0; i += 3) {
+			nearest = std::min(nearest, PointTriangleDistance(p,
+				ToVec3d(vertices[lodIndices[i]]), ToVec3d(vertices[lodIndices[i + 1]]), ToVec3d(vertices[lodIndices[i + 2]])));
+		}
+		maxDistance = std::max(maxDistance, nearest);
+	}
+	return maxDistance;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunLodSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices) {
+	std::vector<SelfTestResult> results;
+	const LodSettings settings;
+	const float extent = ComputeExtent(vertices);
+	std::vector<LodLevel> levels = GenerateLodChain(vertices, indices, settings);
+
+	// 三角形数の減り方
+	std::string counts = std::to_string(indices.size() / 3);
+	bool reduced = levels.size() >= 2 && levels.back().indices.size() * 2 <= indices.size();
+	for (size_t level = 1; level < levels.size(); ++level) {
+		counts += " -> " + std::to_string(levels[level].indices.size() / 3);
+		reduced = reduced && float(levels[level].indices.size()) <= float(levels[level - 1].indices.size()) * kMinReduction;
+	}
+	AddSelfTestResult(results, "lod " + name + " triangle reduction", reduced, std::to_string(levels.size()) + " levels, triangles " + counts);
+
+	// インデックスの範囲とつぶれた三角形
+	bool wellFormed = true;
+	for (const LodLevel& level : levels) {
+		for (size_t i = 0; i + 2 < level.indices.size(); i += 3) {
+			const uint32_t a = level.indices[i], b = level.indices[i + 1], c = level.indices[i + 2];
+			wellFormed = wellFormed && a < vertices.size() && b < vertices.size() && c < vertices.size() && a != b && b != c && a != c;
+		}
+	}
+	AddSelfTestResult(results, "lod " + name + " indices", wellFormed);
+
+	// 記録した誤差と、実際に測った距離
+	bool errorsBounded = true;
+	std::string errors;
+	for (size_t level = 1; level < levels.size(); ++level) {
+		const double measured = MeasureLodDistance(vertices, indices, levels[level].indices);
+		errorsBounded = errorsBounded && levels[level].error >= levels[level - 1].error &&
+			levels[level].error <= settings.maxError * extent * 1.0001f && measured <= double(levels[level].error) + 1e-6 * extent;
+		errors += " LOD" + std::to_string(level) + " recorded " + FormatSelfTestValue(levels[level].error / extent) +
+			" measured " + FormatSelfTestValue(measured / extent);
+	}
+	AddSelfTestResult(results, "lod " + name + " error bounds", errorsBounded, "relative to extent:" + errors);
+
+	// 遠いほど粗いレベルを選び、選んだレベルの誤差は1ピクセル以内
+	std::vector<MeshLod> lods;
+	for (const LodLevel& level : levels) {
+		lods.push_back({ 0, uint32_t(level.indices.size()), level.error });
+	}
+	const float fovY = 0.45f;
+	const float viewportHeight = 720.0f;
+	bool selectionValid = true;
+	uint32_t previousLevel = 0;
+	for (float distance = extent * 0.5f; distance < extent * 10000.0f; distance *= 1.25f) {
+		uint32_t level = SelectLod(lods.data(), uint32_t(lods.size()), distance, fovY, viewportHeight);
+		float worldPerPixel = 2.0f * distance * std::tan(fovY * 0.5f) / viewportHeight;
+		selectionValid = selectionValid && level >= previousLevel && level < lods.size() && (level == 0 || lods[level].error <= worldPerPixel);
+		previousLevel = level;
+	}
+	AddSelfTestResult(results, "lod " + name + " selection", selectionValid && previousLevel + 1 == lods.size(),
+		"coarsest level reached at far distance: " + std::string(previousLevel + 1 == lods.size() ? "yes" : "no"));
+	return results;
+}
@@ -0,0 +1,391 @@
+#include "engine/3d/Meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kNoLocalIndex = std::numeric_limits<uint32_t>::max();
+
+Vector3 ToVector3(const Vector4& v) {
+	return { v.x, v.y, v.z };
+}
+
+Vector3 Sub(const Vector3& a, const Vector3& b) {
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+float Dot(const Vector3& a, const Vector3& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector3 Cross(const Vector3& a, const Vector3& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Length(const Vector3& v) {
+	return std::sqrt(Dot(v, v));
+}
+
+// 作成中のメッシュレット
+class MeshletBuilder {
+public:
+	MeshletBuilder(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+		: indices_(indices), maxVertices_(maxVertices), maxTriangles_(maxTriangles), localIndices_(vertexCount, kNoLocalIndex) {
+	}
+
+	// 三角形を追加すると増える頂点数
+	uint32_t CountNewVertices(uint32_t triangle) const {
+		const uint32_t* tri = &indices_[size_t(triangle) * 3];
+		uint32_t count = 0;
+		for (size_t k = 0; k < 3; ++k) {
+			// 縮退三角形で同じ頂点が2回出てきても1つと数える
+			bool repeated = (k >= 1 && tri[k] == tri[0]) || (k == 2 && tri[2] == tri[1]);
+			if (localIndices_[tri[k]] == kNoLocalIndex && !repeated) {
+				++count;
+			}
+		}
+		return count;
+	}
+
+	bool CanAdd(uint32_t newVertices) const {
+		return vertices_.size() + newVertices <= maxVertices_ && triangleCount_ + 1 <= maxTriangles_;
+	}
+
+	// 追加して、新しく入った頂点をnewVerticesに返す
+	void Add(uint32_t triangle, std::vector<uint32_t>& newVertices) {
+		newVertices.clear();
+		const uint32_t* tri = &indices_[size_t(triangle) * 3];
+		for (size_t k = 0; k < 3; ++k) {
+			uint32_t& local = localIndices_[tri[k]];
+			if (local == kNoLocalIndex) {
+				local = uint32_t(vertices_.size());
+				vertices_.push_back(tri[k]);
+				newVertices.push_back(tri[k]);
+			}
+			triangles_.push_back(uint8_t(local));
+		}
+		++triangleCount_;
+	}
+
+	bool IsEmpty() const { return triangleCount_ == 0; }
+
+	// 出力に書き出して空にする
+	void Flush(MeshletData& out) {
+		Meshlet meshlet{};
+		meshlet.vertexOffset = uint32_t(out.vertices.size());
+		meshlet.triangleOffset = uint32_t(out.triangles.size());
+		meshlet.vertexCount = uint32_t(vertices_.size());
+		meshlet.triangleCount = triangleCount_;
+		out.meshlets.push_back(meshlet);
+		out.vertices.insert(out.vertices.end(), vertices_.begin(), vertices_.end());
+		out.triangles.insert(out.triangles.end(), triangles_.begin(), triangles_.end());
+		for (uint32_t v : vertices_) {
+			localIndices_[v] = kNoLocalIndex;
+		}
+		vertices_.clear();
+		triangles_.clear();
+		triangleCount_ = 0;
+	}
+
+private:
+	const std::vector<uint32_t>& indices_;
+	uint32_t maxVertices_;
+	uint32_t maxTriangles_;
+	std::vector<uint32_t> localIndices_; // 元の頂点番号 → メッシュレット内の番号
+	std::vector<uint32_t> vertices_;
+	std::vector<uint8_t> triangles_;
+	uint32_t triangleCount_ = 0;
+};
+
+} // namespace
+
+MeshletData BuildMeshlets(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	uint32_t maxVertices, uint32_t maxTriangles) {
+	assert(maxVertices >= 3 && maxVertices <= kMeshletVertexLimit);
+	assert(maxTriangles >= 1);
+
+	MeshletData out;
+	const size_t triangleCount = indices.size() / 3;
+	const size_t vertexCount = vertices.size();
+	if (triangleCount == 0) {
+		return out;
+	}
+
+	// 頂点 → 三角形の隣接リスト（CSR形式）
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		++adjacencyOffsets[indices[i] + 1];
+	}
+	for (size_t v = 0; v < vertexCount; ++v) {
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (size_t k = 0; k < 3; ++k) {
+				adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+			}
+		}
+	}
+
+	MeshletBuilder builder(indices, vertexCount, maxVertices, maxTriangles);
+	std::vector<bool> emitted(triangleCount, false);
+	// 候補リストへの重複登録を防ぐ（値はメッシュレット番号+1）
+	std::vector<uint32_t> candidateStamps(triangleCount, 0);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> newVertices;
+	uint32_t stamp = 1;
+	size_t scanCursor = 0;
+	size_t emittedCount = 0;
+
+	auto addTriangle = [&](uint32_t triangle) {
+		builder.Add(triangle, newVertices);
+		emitted[triangle] = true;
+		++emittedCount;
+		// 新しい頂点に隣接する三角形を候補にする
+		for (uint32_t v : newVertices) {
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a) {
+				uint32_t t = adjacency[a];
+				if (!emitted[t] && candidateStamps[t] != stamp) {
+					candidateStamps[t] = stamp;
+					candidates.push_back(t);
+				}
+			}
+		}
+	};
+
+	while (emittedCount < triangleCount) {
+		// 直前のメッシュレットの隣から始めると、空間的にまとまった並びになる
+		uint32_t seed = kNoLocalIndex;
+		for (uint32_t t : candidates) {
+			if (!emitted[t]) {
+				seed = t;
+				break;
+			}
+		}
+		if (seed == kNoLocalIndex) {
+			while (emitted[scanCursor]) {
+				++scanCursor;
+			}
+			seed = uint32_t(scanCursor);
+		}
+		candidates.clear();
+		++stamp;
+		addTriangle(seed);
+
+		// 追加する頂点が最も少ない候補を選び続ける（同点なら先に見つけた方）
+		while (true) {
+			uint32_t best = kNoLocalIndex;
+			uint32_t bestNewVertices = 4;
+			size_t write = 0;
+			for (size_t i = 0; i < candidates.size(); ++i) {
+				uint32_t t = candidates[i];
+				if (emitted[t]) {
+					continue;
+				}
+				candidates[write++] = t;
+				if (best != kNoLocalIndex && bestNewVertices == 0) {
+					continue;
+				}
+				uint32_t newCount = builder.CountNewVertices(t);
+				if (newCount < bestNewVertices && builder.CanAdd(newCount)) {
+					best = t;
+					bestNewVertices = newCount;
+				}
+			}
+			candidates.resize(write);
+			if (best == kNoLocalIndex && candidates.empty()) {
+				// つながった三角形を使い切った（フラットシェーディングで頂点を共有しない等）
+				// 空きがあれば入力順で次の三角形を詰める
+				while (scanCursor < triangleCount && emitted[scanCursor]) {
+					++scanCursor;
+				}
+				if (scanCursor < triangleCount && builder.CanAdd(builder.CountNewVertices(uint32_t(scanCursor)))) {
+					best = uint32_t(scanCursor);
+				}
+			}
+			if (best == kNoLocalIndex) {
+				break;
+			}
+			addTriangle(best);
+		}
+		builder.Flush(out);
+	}
+
+	out.bounds.reserve(out.meshlets.size());
+	for (const Meshlet& meshlet : out.meshlets) {
+		out.bounds.push_back(ComputeMeshletBounds(out, meshlet, vertices));
+	}
+	return out;
+}
+
+MeshletData BuildMeshlets(const Mesh& mesh, uint32_t maxVertices, uint32_t maxTriangles) {
+	return BuildMeshlets(mesh.vertices, mesh.indices, maxVertices, maxTriangles);
+}
+
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, const std::vector<VertexData>& vertices) {
+	MeshletBounds bounds{};
+	bounds.coneCutoff = 1.0f;
+	if (meshlet.vertexCount == 0) {
+		return bounds;
+	}
+	const uint32_t* meshletVertices = &data.vertices[meshlet.vertexOffset];
+	auto position = [&](uint32_t local) {
+		return ToVector3(vertices[meshletVertices[local]].position);
+	};
+
+	// Ritterの方法で境界球を求める
+	Vector3 a = position(0);
+	float farthest = -1.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		Vector3 d = Sub(position(i), position(0));
+		if (Dot(d, d) > farthest) {
+			farthest = Dot(d, d);
+			a = position(i);
+		}
+	}
+	Vector3 b = a;
+	farthest = -1.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		Vector3 d = Sub(position(i), a);
+		if (Dot(d, d) > farthest) {
+			farthest = Dot(d, d);
+			b = position(i);
+		}
+	}
+	Vector3 center = { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f };
+	float radius = Length(Sub(b, a)) * 0.5f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+		Vector3 p = position(i);
+		float distance = Length(Sub(p, center));
+		if (distance > radius) {
+			// 外れた点を含むように球を広げる
+			float newRadius = (radius + distance) * 0.5f;
+			float shift = (newRadius - radius) / distance;
+			center.x += (p.x - center.x) * shift;
+			center.y += (p.y - center.y) * shift;
+			center.z += (p.z - center.z) * shift;
+			radius = newRadius;
+		}
+	}
+	bounds.center = center;
+	bounds.radius = radius;
+	bounds.coneApex = center;
+
+	// 法線コーン：三角形の法線の平均を軸に、最も外れた法線までの角度
+	const uint8_t* triangles = &data.triangles[meshlet.triangleOffset];
+	std::vector<Vector3> normals;
+	normals.reserve(meshlet.triangleCount);
+	std::vector<Vector3> corners;
+	corners.reserve(meshlet.triangleCount);
+	Vector3 axis = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t) {
+		Vector3 p0 = position(triangles[t * 3 + 0]);
+		Vector3 p1 = position(triangles[t * 3 + 1]);
+		Vector3 p2 = position(triangles[t * 3 + 2]);
+		Vector3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+		float length = Length(n);
+		if (length == 0.0f) {
+			continue; // 縮退三角形は向きを持たない
+		}
+		n = { n.x / length, n.y / length, n.z / length };
+		normals.push_back(n);
+		corners.push_back(p0);
+		axis = { axis.x + n.x, axis.y + n.y, axis.z + n.z };
+	}
+	float axisLength = Length(axis);
+	if (normals.empty() || axisLength == 0.0f) {
+		return bounds;
+	}
+	axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+	bounds.coneAxis = axis;
+
+	float minDot = 1.0f;
+	for (const Vector3& n : normals) {
+		minDot = std::min(minDot, Dot(axis, n));
+	}
+	// 広がりが大きすぎると判定に使えない（ほぼ半球以上）
+	if (minDot <= 0.1f) {
+		return bounds;
+	}
+
+	// 全ての三角形の平面より後ろに頂点を置く
+	float maxT = 0.0f;
+	for (size_t i = 0; i < normals.size(); ++i) {
+		float dc = Dot(Sub(center, corners[i]), normals[i]);
+		float dn = Dot(axis, normals[i]);
+		maxT = std::max(maxT, dc / dn);
+	}
+	bounds.coneApex = { center.x - axis.x * maxT, center.y - axis.y * maxT, center.z - axis.z * maxT };
+	bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	return bounds;
+}
+
+bool IsMeshletBackfacing(const MeshletBounds& bounds, const Vector3& cameraPosition) {
+	if (bounds.coneCutoff >= 1.0f) {
+		return false;
+	}
+	Vector3 direction = Sub(bounds.coneApex, cameraPosition);
+	float length = Length(direction);
+	if (length == 0.0f) {
+		return false;
+	}
+	return Dot(direction, bounds.coneAxis) >= bounds.coneCutoff * length;
+}
+
+std::vector<MeshletBenchmarkResult> RunMeshletBenchmark() {
+	const uint32_t gridSizes[] = { 500, 1000, 1500 };
+
+	std::vector<MeshletBenchmarkResult> results;
+	for (uint32_t gridSize : gridSizes) {
+		// XZ平面の格子（頂点を共有するので、隣接を辿って詰める経路を通る）
+		const uint32_t rowVertices = gridSize + 1;
+		std::vector<VertexData> vertices(size_t(rowVertices) * rowVertices);
+		for (uint32_t z = 0; z < rowVertices; ++z) {
+			for (uint32_t x = 0; x < rowVertices; ++x) {
+				VertexData& vertex = vertices[size_t(z) * rowVertices + x];
+				vertex.position = { float(x), 0.0f, float(z), 1.0f };
+				vertex.texcoord = { float(x) / float(gridSize), float(z) / float(gridSize) };
+				vertex.normal = { 0.0f, 1.0f, 0.0f };
+			}
+		}
+		std::vector<uint32_t> indices;
+		indices.reserve(size_t(gridSize) * gridSize * 6);
+		for (uint32_t z = 0; z < gridSize; ++z) {
+			for (uint32_t x = 0; x < gridSize; ++x) {
+				const uint32_t v0 = z * rowVertices + x;
+				const uint32_t v1 = v0 + 1;
+				const uint32_t v2 = v0 + rowVertices;
+				const uint32_t v3 = v2 + 1;
+				indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		}
+
+		MeshletBenchmarkResult result;
+		result.gridSize = gridSize;
+		result.triangleCount = indices.size() / 3;
+		MeshletData data;
+		for (int run = 0; run < 3; ++run) {
+			auto start = std::chrono::steady_clock::now();
+			data = BuildMeshlets(vertices, indices);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (run == 0 || milliseconds < result.milliseconds) {
+				result.milliseconds = milliseconds;
+			}
+		}
+		result.meshletCount = data.meshlets.size();
+		result.trianglesPerSecond = result.milliseconds > 0.0 ? double(result.triangleCount) / (result.milliseconds / 1000.0) : 0.0;
+		size_t packedTriangles = 0;
+		for (const Meshlet& meshlet : data.meshlets) {
+			packedTriangles += meshlet.triangleCount;
+		}
+		result.valid = packedTriangles == result.triangleCount && data.bounds.size() == data.meshlets.size();
+		results.push_back(result);
+	}
+	return results;
+}
@@ -0,0 +1,153 @@
+#include "engine/3d/Meshlet.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+Vector3 ToVector3(const Vector4& v) {
+	return { v.x, v.y, v.z };
+}
+
+Vector3 Sub(const Vector3& a, const Vector3& b) {
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+float Dot(const Vector3& a, const Vector3& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector3 Cross(const Vector3& a, const Vector3& b) {
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Length(const Vector3& v) {
+	return std::sqrt(Dot(v, v));
+}
+
+bool IsSameMeshletData(const MeshletData& a, const MeshletData& b) {
+	return a.meshlets.size() == b.meshlets.size() && a.vertices == b.vertices && a.triangles == b.triangles &&
+		(a.meshlets.empty() || std::memcmp(a.meshlets.data(), b.meshlets.data(), sizeof(Meshlet) * a.meshlets.size()) == 0) &&
+		(a.bounds.empty() || std::memcmp(a.bounds.data(), b.bounds.data(), sizeof(MeshletBounds) * a.bounds.size()) == 0);
+}
+
+// 1つの入力・1つの上限についての確認。失敗した内容をerrorsに書く（空なら成功）
+void ValidateMeshlets(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+	uint32_t maxVertices, uint32_t maxTriangles, std::string& errors, float& maxBoundsExcess) {
+	MeshletData data = BuildMeshlets(vertices, indices, maxVertices, maxTriangles);
+
+	// 三角形を元の頂点番号に戻して並べ、入力と同じ集まり（重複の数も含めて）になるか
+	std::vector<std::array<uint32_t, 3>> expected;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		expected.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	}
+	std::vector<std::array<uint32_t, 3>> actual;
+	for (size_t m = 0; m < data.meshlets.size(); ++m) {
+		const Meshlet& meshlet = data.meshlets[m];
+		if (meshlet.vertexCount > maxVertices || meshlet.triangleCount > maxTriangles || meshlet.triangleCount == 0 ||
+			size_t(meshlet.vertexOffset) + meshlet.vertexCount > data.vertices.size() ||
+			size_t(meshlet.triangleOffset) + size_t(meshlet.triangleCount) * 3 > data.triangles.size()) {
+			errors += " meshlet " + std::to_string(m) + " exceeds its limits or ranges;";
+			return;
+		}
+		const uint32_t* meshletVertices = &data.vertices[meshlet.vertexOffset];
+		const uint8_t* triangles = &data.triangles[meshlet.triangleOffset];
+		for (uint32_t t = 0; t < meshlet.triangleCount * 3; t += 3) {
+			if (triangles[t] >= meshlet.vertexCount || triangles[t + 1] >= meshlet.vertexCount || triangles[t + 2] >= meshlet.vertexCount) {
+				errors += " meshlet " + std::to_string(m) + " has a local index out of range;";
+				return;
+			}
+			actual.push_back({ meshletVertices[triangles[t]], meshletVertices[triangles[t + 1]], meshletVertices[triangles[t + 2]] });
+		}
+
+		// 境界球（丸め誤差の分だけ許す）
+		const MeshletBounds& bounds = data.bounds[m];
+		for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+			float distance = Length(Sub(ToVector3(vertices[meshletVertices[v]].position), bounds.center));
+			maxBoundsExcess = std::max(maxBoundsExcess, distance - bounds.radius);
+			if (distance > bounds.radius * 1.0001f + 1e-5f) {
+				errors += " meshlet " + std::to_string(m) + " bounding sphere misses a vertex;";
+				return;
+			}
+		}
+
+		// 法線コーン：周りの視点のうち裏向きと判定したものからは、全ての三角形が裏向きに見えること
+		if (bounds.coneCutoff < 1.0f) {
+			const float viewDistance = bounds.radius * 4.0f + 1.0f;
+			for (uint32_t view = 0; view < 64; ++view) {
+				// 球面上に散らした視点（黄金角の螺旋）
+				float y = 1.0f - (float(view) + 0.5f) * (2.0f / 64.0f);
+				float ring = std::sqrt(std::max(0.0f, 1.0f - y * y));
+				float angle = float(view) * 2.39996323f;
+				Vector3 camera = { bounds.center.x + std::cos(angle) * ring * viewDistance, bounds.center.y + y * viewDistance,
+					bounds.center.z + std::sin(angle) * ring * viewDistance };
+				if (!IsMeshletBackfacing(bounds, camera)) {
+					continue;
+				}
+				for (uint32_t t = 0; t < meshlet.triangleCount * 3; t += 3) {
+					Vector3 p0 = ToVector3(vertices[meshletVertices[triangles[t]]].position);
+					Vector3 p1 = ToVector3(vertices[meshletVertices[triangles[t + 1]]].position);
+					Vector3 p2 = ToVector3(vertices[meshletVertices[triangles[t + 2]]].position);
+					Vector3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+					if (Dot(normal, Sub(camera, p0)) > 1e-6f * Length(normal) * viewDistance) {
+						errors += " meshlet " + std::to_string(m) + " cone culls a front-facing triangle;";
+						return;
+					}
+				}
+			}
+		}
+	}
+	if (actual.size() != expected.size()) {
+		errors += " " + std::to_string(actual.size()) + " triangles emitted for " + std::to_string(expected.size()) + ";";
+		return;
+	}
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+	if (actual != expected) {
+		errors += " triangles are missing or duplicated;";
+		return;
+	}
+
+	if (!IsSameMeshletData(data, BuildMeshlets(vertices, indices, maxVertices, maxTriangles))) {
+		errors += " second build differs;";
+	}
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunMeshletSelfTest(const std::string& name,
+	const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices) {
+	struct Limits {
+		uint32_t maxVertices;
+		uint32_t maxTriangles;
+	};
+	const Limits limits[] = { { kDefaultMeshletMaxVertices, kDefaultMeshletMaxTriangles }, { 3, 1 }, { 32, 32 }, { kMeshletVertexLimit, 512 } };
+
+	// 頂点を共有しない入力（つながりを辿れず、入力順に詰める経路を通る）
+	std::vector<VertexData> flatVertices;
+	std::vector<uint32_t> flatIndices;
+	flatVertices.reserve(indices.size());
+	for (uint32_t index : indices) {
+		flatIndices.push_back(uint32_t(flatVertices.size()));
+		flatVertices.push_back(vertices[index]);
+	}
+
+	std::vector<SelfTestResult> results;
+	for (bool flat : { false, true }) {
+		for (const Limits& limit : limits) {
+			std::string errors;
+			float maxBoundsExcess = 0.0f;
+			ValidateMeshlets(flat ? flatVertices : vertices, flat ? flatIndices : indices, limit.maxVertices, limit.maxTriangles,
+				errors, maxBoundsExcess);
+			std::string testName = "meshlets " + name + (flat ? " (flat)" : "") + " " +
+				std::to_string(limit.maxVertices) + "v/" + std::to_string(limit.maxTriangles) + "t";
+			AddSelfTestResult(results, testName, errors.empty(),
+				errors.empty() ? std::to_string(indices.size() / 3) + " triangles exactly once, bounds excess " + FormatSelfTestValue(maxBoundsExcess) : errors);
+		}
+	}
+	return results;
+}
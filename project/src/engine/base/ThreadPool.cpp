@@ -0,0 +1,104 @@
+#include "engine/base/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	workers_.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers_.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	taskCondition_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+	taskCondition_.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func) {
+	if (count == 0) {
+		return;
+	}
+	if (count == 1 || workers_.empty()) {
+		for (size_t i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	// インデックスを取り合う形で分配する（処理時間の偏りに強い）
+	struct SharedState {
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	auto state = std::make_shared<SharedState>();
+	auto run = [state, count, &func]() {
+		size_t finished = 0;
+		for (size_t i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1)) {
+			func(i);
+			++finished;
+		}
+		if (finished != 0 && state->done.fetch_add(finished) + finished == count) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->condition.notify_all();
+		}
+	};
+
+	size_t helperCount = std::min(count - 1, workers_.size());
+	for (size_t i = 0; i < helperCount; ++i) {
+		Submit(run);
+	}
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&]() { return state->done.load() == count; });
+}
+
+void ThreadPool::WaitIdle() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	idleCondition_.wait(lock, [this]() { return tasks_.empty() && activeCount_ == 0; });
+}
+
+void ThreadPool::WorkerLoop() {
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			taskCondition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+			if (stopping_ && tasks_.empty()) {
+				return;
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+			++activeCount_;
+		}
+		task();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--activeCount_;
+			if (tasks_.empty() && activeCount_ == 0) {
+				idleCondition_.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#include "engine/graphics/DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+constexpr uint32_t kIndexMask = (1u << DescriptorAllocator::kIndexBits) - 1;
+constexpr uint32_t kGenerationMask = (1u << (32 - DescriptorAllocator::kIndexBits)) - 1;
+
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(const DescriptorAllocatorDesc& desc) : desc_(desc) {
+	assert(desc_.capacity <= kMaxCapacity && desc_.framesInFlight >= 1);
+	const uint32_t transientTotal = desc_.transientCountPerFrame * desc_.framesInFlight;
+	assert(desc_.reservedCount + transientTotal <= desc_.capacity);
+	persistentBegin_ = desc_.reservedCount;
+	transientBegin_ = desc_.capacity - transientTotal;
+	transientFrames_.resize(desc_.framesInFlight);
+
+	const uint32_t persistentCount = transientBegin_ - persistentBegin_;
+	generations_.assign(persistentCount, 0);
+	alive_.assign(persistentCount, 0);
+	freeSlots_.reserve(persistentCount);
+	for (uint32_t slot = persistentCount; slot > 0; slot--) {
+		freeSlots_.push_back(slot - 1);
+	}
+	stats_.persistentCapacity = persistentCount;
+}
+
+DescriptorAllocator::Handle DescriptorAllocator::Allocate() {
+	if (freeSlots_.empty()) {
+		stats_.failedCount++;
+		return kInvalidHandle;
+	}
+	const uint32_t slot = freeSlots_.back();
+	freeSlots_.pop_back();
+	alive_[slot] = 1;
+	stats_.persistentCount++;
+	stats_.peakPersistentCount = (std::max)(stats_.peakPersistentCount, stats_.persistentCount);
+	return (uint32_t(generations_[slot]) << kIndexBits) | (persistentBegin_ + slot);
+}
+
+void DescriptorAllocator::Free(Handle handle) {
+	if (handle == kInvalidHandle) {
+		return;
+	}
+	assert(IsValid(handle)); // 二重解放・古いハンドル
+	const uint32_t slot = (handle & kIndexMask) - persistentBegin_;
+	alive_[slot] = 0;
+	// 世代を進めて、今までのハンドルを無効にする
+	generations_[slot] = uint16_t((generations_[slot] + 1) & kGenerationMask);
+	pendingFrees_.push_back(slot);
+	stats_.pendingFreeCount++;
+}
+
+void DescriptorAllocator::Retire(uint64_t fenceValue) {
+	// 一時的な区画は、使っていればこのフレームが終わるまで空にしない
+	TransientFrame& frame = transientFrames_[transientFrame_];
+	if (frame.offset != 0 && !frame.retired) {
+		frame.fenceValue = fenceValue;
+		frame.retired = true;
+	}
+
+	if (pendingFrees_.empty()) {
+		return;
+	}
+	assert(retired_.empty() || retired_.back().fenceValue <= fenceValue);
+	retired_.push_back({ fenceValue, std::move(pendingFrees_) });
+	pendingFrees_.clear();
+}
+
+void DescriptorAllocator::Reclaim(uint64_t completedFenceValue) {
+	while (!retired_.empty() && retired_.front().fenceValue <= completedFenceValue) {
+		for (uint32_t slot : retired_.front().slots) {
+			freeSlots_.push_back(slot);
+		}
+		stats_.pendingFreeCount -= uint32_t(retired_.front().slots.size());
+		stats_.persistentCount -= uint32_t(retired_.front().slots.size());
+		retired_.pop_front();
+	}
+	for (TransientFrame& frame : transientFrames_) {
+		if (frame.retired && frame.fenceValue <= completedFenceValue) {
+			frame.offset = 0;
+			frame.retired = false;
+		}
+	}
+}
+
+bool DescriptorAllocator::IsValid(Handle handle) const {
+	if (handle == kInvalidHandle) {
+		return false;
+	}
+	const uint32_t index = handle & kIndexMask;
+	if (index < persistentBegin_ || index >= transientBegin_) {
+		return false;
+	}
+	const uint32_t slot = index - persistentBegin_;
+	return alive_[slot] && generations_[slot] == (handle >> kIndexBits);
+}
+
+uint32_t DescriptorAllocator::GetIndex(Handle handle) const {
+	assert(IsValid(handle));
+	return handle & kIndexMask;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frameIndex) {
+	assert(frameIndex < desc_.framesInFlight);
+	transientFrame_ = frameIndex;
+	stats_.transientCount = transientFrames_[transientFrame_].offset;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count) {
+	TransientFrame& frame = transientFrames_[transientFrame_];
+	if (count == 0 || frame.retired || frame.offset + count > desc_.transientCountPerFrame) {
+		stats_.failedCount++;
+		return kInvalidIndex;
+	}
+	const uint32_t index = transientBegin_ + transientFrame_ * desc_.transientCountPerFrame + frame.offset;
+	frame.offset += count;
+	stats_.transientCount = frame.offset;
+	stats_.peakTransientCount = (std::max)(stats_.peakTransientCount, stats_.transientCount);
+	return index;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetCpuHandleAt(uint32_t index) const {
+	assert(index < desc_.capacity);
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = desc_.cpuStart;
+	handle.ptr += size_t(desc_.descriptorSize) * index;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetGpuHandleAt(uint32_t index) const {
+	assert(index < desc_.capacity);
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = desc_.gpuStart;
+	handle.ptr += uint64_t(desc_.descriptorSize) * index;
+	return handle;
+}
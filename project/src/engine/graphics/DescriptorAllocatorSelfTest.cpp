@@ -0,0 +1,151 @@
+#include "engine/graphics/DescriptorAllocator.h"
+
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+std::vector<SelfTestResult> RunDescriptorAllocatorSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	// ヒープは無いので、先頭を0にして番号×大きさがそのままアドレスになるようにする
+	DescriptorAllocatorDesc desc;
+	desc.capacity = 4096;
+	desc.reservedCount = 1;
+	desc.transientCountPerFrame = 64;
+	desc.framesInFlight = 3;
+	desc.gpuStart.ptr = 0;
+	desc.descriptorSize = 32;
+	DescriptorAllocator allocator(desc);
+	const uint32_t transientBegin = desc.capacity - desc.transientCountPerFrame * desc.framesInFlight;
+	const uint32_t persistentCapacity = transientBegin - desc.reservedCount;
+
+	// 擬似フェンス: 毎フレームRetireし、GPUは2フレーム遅れて終わる
+	// 一時的な区画はframesInFlight = 3フレームごとに回ってくるので、Reclaimで空になっていれば確保に失敗しない
+	// 解放した場所と一時的な区画は、そのフレームが終わるまで他に渡らないこと
+	const uint64_t kLatency = 2;
+	std::mt19937 random(19);
+	std::vector<DescriptorAllocator::Handle> live;
+	std::vector<DescriptorAllocator::Handle> freed;   // 無効になっているはずのハンドル
+	std::vector<uint64_t> busyUntil(desc.capacity, 0); // 場所ごとの、最後に解放されたフレームのフェンス値
+	uint64_t completed = 0;
+	bool unique = true;
+	bool reservedUntouched = true;
+	bool reusedAfterFence = true;
+	bool staleInvalid = true;
+	bool addressMatches = true;
+	bool transientInFrame = true; // 一時的な確保が、そのフレームの区画の中に先頭から詰めて並ぶ
+	uint32_t transientFailures = 0;
+	for (uint64_t frame = 1; frame <= 2000; ++frame) {
+		allocator.Reclaim(completed);
+		const uint32_t frameIndex = uint32_t(frame % desc.framesInFlight);
+		allocator.BeginFrame(frameIndex);
+		const uint32_t partitionBegin = transientBegin + frameIndex * desc.transientCountPerFrame;
+		uint32_t transientUsed = 0;
+		for (uint32_t count = 1 + random() % 8; transientUsed + count <= desc.transientCountPerFrame; count = 1 + random() % 8) {
+			const uint32_t index = allocator.AllocateTransient(count);
+			if (index == DescriptorAllocator::kInvalidIndex) {
+				transientFailures++;
+				break;
+			}
+			transientInFrame = transientInFrame && index == partitionBegin + transientUsed;
+			transientUsed += count;
+		}
+		// 区画からあふれる分は失敗する
+		transientInFrame = transientInFrame && allocator.AllocateTransient(desc.transientCountPerFrame - transientUsed + 1) == DescriptorAllocator::kInvalidIndex;
+		// 確保と解放を混ぜる（使用中の数は上下する）
+		const uint32_t allocateCount = random() % 64;
+		for (uint32_t i = 0; i < allocateCount; ++i) {
+			DescriptorAllocator::Handle handle = allocator.Allocate();
+			if (handle == DescriptorAllocator::kInvalidHandle) {
+				break;
+			}
+			const uint32_t index = allocator.GetIndex(handle);
+			reservedUntouched = reservedUntouched && index >= desc.reservedCount && index < transientBegin;
+			reusedAfterFence = reusedAfterFence && busyUntil[index] <= completed;
+			addressMatches = addressMatches && allocator.GetGpuHandle(handle).ptr == uint64_t(index) * desc.descriptorSize;
+			live.push_back(handle);
+		}
+		const uint32_t freeCount = live.empty() ? 0 : uint32_t(random() % (live.size() / 2 + 32));
+		for (uint32_t i = 0; i < freeCount && !live.empty(); ++i) {
+			const size_t pick = random() % live.size();
+			const DescriptorAllocator::Handle handle = live[pick];
+			busyUntil[allocator.GetIndex(handle)] = frame;
+			allocator.Free(handle);
+			freed.push_back(handle);
+			live[pick] = live.back();
+			live.pop_back();
+		}
+		allocator.Retire(frame);
+		if (frame > kLatency) {
+			completed = frame - kLatency;
+		}
+
+		if (frame % 100 == 0) {
+			std::unordered_set<uint32_t> indices;
+			for (DescriptorAllocator::Handle handle : live) {
+				unique = unique && allocator.IsValid(handle) && indices.insert(allocator.GetIndex(handle)).second;
+			}
+			for (DescriptorAllocator::Handle handle : freed) {
+				staleInvalid = staleInvalid && !allocator.IsValid(handle);
+			}
+			freed.clear();
+		}
+	}
+	const DescriptorAllocatorStats& stats = allocator.GetStats();
+	AddSelfTestResult(results, "descriptor allocator hands out unique live handles", unique && reservedUntouched && addressMatches,
+		"live " + std::to_string(live.size()) + ", peak " + std::to_string(stats.peakPersistentCount));
+	AddSelfTestResult(results, "descriptor allocator invalidates freed handles", staleInvalid);
+	AddSelfTestResult(results, "descriptor allocator reuses slots only after the fence", reusedAfterFence);
+	AddSelfTestResult(results, "descriptor allocator fills each frame's transient range linearly",
+		transientInFrame && transientFailures == 0 && stats.peakTransientCount <= desc.transientCountPerFrame,
+		"peak " + std::to_string(stats.peakTransientCount) + " of " + std::to_string(desc.transientCountPerFrame) +
+		", failures " + std::to_string(transientFailures));
+
+	// 空きが無ければ失敗し、全て返した後は全ての場所がもう一度使える
+	const size_t failedBefore = stats.failedCount;
+	while (allocator.Allocate() != DescriptorAllocator::kInvalidHandle) {
+	}
+	const bool full = stats.persistentCount == persistentCapacity && stats.failedCount == failedBefore + 1;
+	AddSelfTestResult(results, "descriptor allocator fails when the heap is full", full,
+		"used " + std::to_string(stats.persistentCount) + " of " + std::to_string(persistentCapacity));
+
+	DescriptorAllocator drained(desc);
+	std::vector<DescriptorAllocator::Handle> handles;
+	for (DescriptorAllocator::Handle handle = drained.Allocate(); handle != DescriptorAllocator::kInvalidHandle; handle = drained.Allocate()) {
+		handles.push_back(handle);
+	}
+	for (DescriptorAllocator::Handle handle : handles) {
+		drained.Free(handle);
+	}
+	drained.Retire(1);
+	const bool pending = drained.Allocate() == DescriptorAllocator::kInvalidHandle && drained.GetStats().pendingFreeCount == persistentCapacity;
+	drained.Reclaim(1);
+	uint32_t refilled = 0;
+	bool newGeneration = true;
+	for (DescriptorAllocator::Handle handle = drained.Allocate(); handle != DescriptorAllocator::kInvalidHandle; handle = drained.Allocate()) {
+		newGeneration = newGeneration && handle >> DescriptorAllocator::kIndexBits == 1;
+		refilled++;
+	}
+	AddSelfTestResult(results, "descriptor allocator refills every slot after reclaim",
+		pending && newGeneration && refilled == persistentCapacity && drained.GetStats().pendingFreeCount == 0,
+		"refilled " + std::to_string(refilled) + " of " + std::to_string(persistentCapacity));
+
+	// 締めた区画は、そのフェンスが終わるまで確保できず、終わったら先頭から使える
+	DescriptorAllocator transient(desc);
+	transient.BeginFrame(0);
+	const uint32_t first = transient.AllocateTransient(10);
+	transient.Retire(5);
+	transient.BeginFrame(0);
+	const bool blocked = transient.AllocateTransient(1) == DescriptorAllocator::kInvalidIndex;
+	transient.Reclaim(4);
+	const bool stillBlocked = transient.AllocateTransient(1) == DescriptorAllocator::kInvalidIndex;
+	transient.Reclaim(5);
+	const uint32_t reset = transient.AllocateTransient(desc.transientCountPerFrame);
+	transient.BeginFrame(1);
+	const uint32_t otherFrame = transient.AllocateTransient(1);
+	AddSelfTestResult(results, "descriptor allocator waits for the fence before resetting a transient range",
+		first == transientBegin && blocked && stillBlocked && reset == transientBegin && otherFrame == transientBegin + desc.transientCountPerFrame);
+
+	return results;
+}
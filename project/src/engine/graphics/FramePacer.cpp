@@ -0,0 +1,68 @@
+#include "engine/graphics/FramePacer.h"
+
+#include <cassert>
+#include <utility>
+
+FramePacer::FramePacer(uint32_t framesInFlight, FrameFence fence)
+	: framesInFlight_(framesInFlight), fence_(std::move(fence)), slots_(framesInFlight) {
+	assert(framesInFlight_ >= 1 && framesInFlight_ <= kMaxFramesInFlight);
+	assert(fence_.getCompletedValue && fence_.signal && fence_.wait);
+	lastSignaledValue_ = fence_.getCompletedValue();
+}
+
+FramePacer::~FramePacer() {
+	for (Slot& slot : slots_) {
+		RunDeferred(slot);
+	}
+}
+
+uint32_t FramePacer::BeginFrame() {
+	assert(!recording_);
+	recording_ = true;
+	Slot& slot = slots_[frameIndex_];
+	if (fence_.getCompletedValue() < slot.fenceValue) {
+		// framesInFlightフレーム前がまだ終わっていない（それより新しいフレームは走らせたまま）
+		fence_.wait(slot.fenceValue);
+		stats_.waitCount++;
+	}
+	RunDeferred(slot);
+	return frameIndex_;
+}
+
+uint64_t FramePacer::EndFrame() {
+	assert(recording_);
+	recording_ = false;
+	lastSignaledValue_++;
+	fence_.signal(lastSignaledValue_);
+	slots_[frameIndex_].fenceValue = lastSignaledValue_;
+	frameIndex_ = (frameIndex_ + 1) % framesInFlight_;
+	stats_.frameCount++;
+	return lastSignaledValue_;
+}
+
+void FramePacer::Defer(std::function<void()> function) {
+	// 記録中でなければ、最後に送り出したフレームのスロットに付ける（そのフレームまでGPUが終わった後になる）
+	slots_[recording_ ? frameIndex_ : (frameIndex_ + framesInFlight_ - 1) % framesInFlight_].deferred.push_back(std::move(function));
+	stats_.deferredCount++;
+}
+
+void FramePacer::WaitIdle() {
+	if (fence_.getCompletedValue() < lastSignaledValue_) {
+		fence_.wait(lastSignaledValue_);
+	}
+	for (Slot& slot : slots_) {
+		// 記録中のフレームの分は、そのフレームがまだ送り出されていないので残す
+		if (!recording_ || &slot != &slots_[frameIndex_]) {
+			RunDeferred(slot);
+		}
+	}
+}
+
+void FramePacer::RunDeferred(Slot& slot) {
+	// 呼んだ処理の中でDeferされても大丈夫なように、先に取り出しておく
+	std::vector<std::function<void()>> deferred;
+	deferred.swap(slot.deferred);
+	for (std::function<void()>& function : deferred) {
+		function();
+	}
+}
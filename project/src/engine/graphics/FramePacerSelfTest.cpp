@@ -0,0 +1,131 @@
+#include "engine/graphics/FramePacer.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 擬似GPU: Signalされたフレームを順に、1フレームあたりgpuCostの時間で終える
+struct SimulatedGpu {
+	double now = 0.0;
+	double busyUntil = 0.0;
+	uint64_t completed = 0;
+	std::deque<std::pair<double, uint64_t>> queue; // (終わる時刻, フェンス値)
+
+	void AdvanceTo(double time) {
+		now = time;
+		while (!queue.empty() && queue.front().first <= now) {
+			completed = queue.front().second;
+			queue.pop_front();
+		}
+	}
+};
+
+struct FramePacerRun {
+	double totalTime = 0.0;
+	uint64_t waitCount = 0;
+	uint64_t maxInFlight = 0;
+	bool slotOrder = true;            // スロットを順番に使う
+	bool slotReusedAfterFence = true; // 同じスロットの前のフレームが終わってから使う
+	bool deferredAfterFrame = true;   // Deferした処理は、そのフレームが終わってから呼ばれる
+	uint32_t deferredCalls = 0;
+	bool idle = false;
+};
+
+// CPUが1フレームにcpuCost、GPUがgpuCostかかるときにframeCountフレームを回す
+FramePacerRun RunSimulatedFrames(uint32_t framesInFlight, double cpuCost, double gpuCost, uint32_t frameCount) {
+	FramePacerRun run;
+	SimulatedGpu gpu;
+	FrameFence fence;
+	fence.getCompletedValue = [&gpu]() {
+		gpu.AdvanceTo(gpu.now);
+		return gpu.completed;
+	};
+	fence.signal = [&gpu, gpuCost](uint64_t value) {
+		gpu.busyUntil = (std::max)(gpu.now, gpu.busyUntil) + gpuCost;
+		gpu.queue.push_back({ gpu.busyUntil, value });
+	};
+	fence.wait = [&gpu](uint64_t value) {
+		while (gpu.completed < value && !gpu.queue.empty()) {
+			gpu.AdvanceTo(gpu.queue.front().first);
+		}
+	};
+
+	{
+		FramePacer pacer(framesInFlight, fence);
+		std::vector<uint64_t> slotFenceValues(framesInFlight, 0);
+		for (uint32_t frame = 0; frame < frameCount; ++frame) {
+			const uint32_t slot = pacer.BeginFrame();
+			run.slotOrder = run.slotOrder && slot == frame % framesInFlight;
+			run.slotReusedAfterFence = run.slotReusedAfterFence && gpu.completed >= slotFenceValues[slot];
+			const uint64_t fenceValue = pacer.GetLastSignaledValue() + 1;
+			pacer.Defer([&run, &gpu, fenceValue]() {
+				run.deferredAfterFrame = run.deferredAfterFrame && gpu.completed >= fenceValue;
+				run.deferredCalls++;
+			});
+			gpu.AdvanceTo(gpu.now + cpuCost);
+			slotFenceValues[slot] = pacer.EndFrame();
+			run.slotOrder = run.slotOrder && slotFenceValues[slot] == fenceValue;
+			run.maxInFlight = (std::max)(run.maxInFlight, pacer.GetLastSignaledValue() - gpu.completed);
+			if (frame % 16 == 0) {
+				// 記録中でないときのDeferは、最後に送り出したフレームが終わってから
+				pacer.Defer([&run, &gpu, fenceValue]() {
+					run.deferredAfterFrame = run.deferredAfterFrame && gpu.completed >= fenceValue;
+					run.deferredCalls++;
+				});
+			}
+		}
+		pacer.WaitIdle();
+		run.idle = gpu.completed == pacer.GetLastSignaledValue();
+		run.waitCount = pacer.GetStats().waitCount;
+	}
+	run.totalTime = gpu.now;
+	return run;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunFramePacerSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	const uint32_t kFrameCount = 200;
+	const uint32_t expectedDeferred = kFrameCount + (kFrameCount + 15) / 16;
+	double singleTime = 0.0;
+	for (uint32_t framesInFlight = 1; framesInFlight <= FramePacer::kMaxFramesInFlight; ++framesInFlight) {
+		// CPUとGPUが同じ重さ（重ねれば倍近く速くなる）
+		const FramePacerRun run = RunSimulatedFrames(framesInFlight, 1.0, 1.0, kFrameCount);
+		const std::string prefix = "frame pacer " + std::to_string(framesInFlight) + " in flight ";
+		AddSelfTestResult(results, prefix + "reuses a slot only after its fence",
+			run.slotOrder && run.slotReusedAfterFence && run.maxInFlight <= framesInFlight,
+			"max in flight " + std::to_string(run.maxInFlight));
+		AddSelfTestResult(results, prefix + "runs deferred work after its frame",
+			run.deferredAfterFrame && run.deferredCalls == expectedDeferred && run.idle,
+			"called " + std::to_string(run.deferredCalls) + " of " + std::to_string(expectedDeferred));
+		if (framesInFlight == 1) {
+			singleTime = run.totalTime;
+		} else {
+			// 1フレームずつ待つと2*kFrameCount、重なれば1フレーム分の遅れだけで済む
+			AddSelfTestResult(results, prefix + "overlaps CPU and GPU", run.totalTime <= kFrameCount + framesInFlight,
+				"time " + FormatSelfTestValue(run.totalTime) + ", 1 in flight " + FormatSelfTestValue(singleTime));
+		}
+	}
+
+	// GPUが重いときは、framesInFlightフレーム先まで進んだところで、スロットの前のフレームを待つ
+	// 送り出したフレームはちょうどframesInFlightまで溜まり、それを超えない
+	for (uint32_t framesInFlight = 2; framesInFlight <= FramePacer::kMaxFramesInFlight; ++framesInFlight) {
+		const FramePacerRun gpuBound = RunSimulatedFrames(framesInFlight, 1.0, 2.0, kFrameCount);
+		const std::string prefix = "frame pacer " + std::to_string(framesInFlight) + " in flight ";
+		AddSelfTestResult(results, prefix + "keeps N frames queued when GPU-bound",
+			gpuBound.slotOrder && gpuBound.slotReusedAfterFence && gpuBound.maxInFlight == framesInFlight,
+			"max in flight " + std::to_string(gpuBound.maxInFlight));
+		// 待たないのは、GPUの列がframesInFlightまで溜まるまでの最初の数フレーム（2*framesInFlight未満）だけ
+		AddSelfTestResult(results, prefix + "waits when the GPU is the bottleneck",
+			gpuBound.waitCount + 2 * framesInFlight >= kFrameCount && gpuBound.totalTime <= 2.0 * kFrameCount + 1.0,
+			"waits " + std::to_string(gpuBound.waitCount) + ", time " + FormatSelfTestValue(gpuBound.totalTime));
+	}
+
+	return results;
+}
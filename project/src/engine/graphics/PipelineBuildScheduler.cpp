@@ -0,0 +1,325 @@
+#include "engine/graphics/PipelineBuildScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+// 8バイトずつFNV-1aの要領で混ぜる（バイトコードが同じかどうかの下調べ用）
+uint64_t HashBytecode(const std::vector<uint8_t>& bytecode) {
+	uint64_t hash = kFnvOffsetBasis;
+	size_t i = 0;
+	for (; i + 8 <= bytecode.size(); i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytecode.data() + i, sizeof(word));
+		hash = (hash ^ word) * kFnvPrime;
+		hash ^= hash >> 32;
+	}
+	for (; i < bytecode.size(); ++i) {
+		hash = (hash ^ bytecode[i]) * kFnvPrime;
+	}
+	return hash;
+}
+
+double MillisecondsSince(Clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+// モックの実行中のタスクを数える
+class MockActiveScope {
+public:
+	explicit MockActiveScope(MockPipelineBuildLog& log) : log_(log) {
+		std::lock_guard<std::mutex> lock(log_.mutex);
+		log_.activeCount++;
+		log_.peakActiveCount = std::max(log_.peakActiveCount, log_.activeCount);
+	}
+	~MockActiveScope() {
+		std::lock_guard<std::mutex> lock(log_.mutex);
+		log_.activeCount--;
+	}
+
+private:
+	MockPipelineBuildLog& log_;
+};
+
+} // namespace
+
+PipelineBuildBackend CreateMockPipelineBuildBackend(std::shared_ptr<MockPipelineBuildLog> log, const MockPipelineBuildDesc& desc) {
+	assert(log);
+	PipelineBuildBackend backend;
+	backend.compileShader = [log, desc](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) {
+		MockActiveScope active(*log);
+		std::this_thread::sleep_for(std::chrono::milliseconds(desc.compileMilliseconds));
+		{
+			std::lock_guard<std::mutex> lock(log->mutex);
+			log->compileCount++;
+		}
+		if (std::find(desc.failingSources.begin(), desc.failingSources.end(), request.sourcePath) != desc.failingSources.end()) {
+			return false;
+		}
+		const std::string fake = "DXBC|" + MakeShaderRequestId(request);
+		bytecode.assign(fake.begin(), fake.end());
+		return true;
+	};
+	backend.createPipeline = [log, desc](uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders) {
+		MockActiveScope active(*log);
+		const bool complete = std::all_of(shaders.begin(), shaders.end(), [](const std::vector<uint8_t>* shader) {
+			return shader != nullptr && !shader->empty();
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(desc.pipelineMilliseconds));
+		std::lock_guard<std::mutex> lock(log->mutex);
+		log->pipelineCount++;
+		if (!complete) {
+			log->missingShaderCount++;
+		}
+		log->createdPipelines.push_back(pipeline);
+		return complete;
+	};
+	return backend;
+}
+
+PipelineBuildScheduler::ShaderId PipelineBuildScheduler::AddShader(const ShaderCompileRequest& request) {
+	const std::string id = MakeShaderRequestId(request);
+	auto it = shaderIds_.find(id);
+	if (it != shaderIds_.end()) {
+		return it->second;
+	}
+	const ShaderId shader = ShaderId(shaders_.size());
+	ShaderNode& node = shaders_.emplace_back();
+	node.request = request;
+	node.name = request.sourcePath + " (" + request.profile + ")";
+	shaderIds_.emplace(id, shader);
+	return shader;
+}
+
+PipelineBuildScheduler::PipelineId PipelineBuildScheduler::AddPipeline(const std::string& name, const std::vector<ShaderId>& shaders) {
+	const PipelineId pipeline = PipelineId(pipelines_.size());
+	PipelineNode& node = pipelines_.emplace_back();
+	node.name = name;
+	node.shaders = shaders;
+	for (ShaderId shader : shaders) {
+		assert(shader < shaders_.size());
+		shaders_[shader].dependents.push_back(pipeline);
+	}
+	return pipeline;
+}
+
+PipelineBuildReport PipelineBuildScheduler::Build(ThreadPool& threadPool, const PipelineBuildBackend& backend) {
+	assert(backend.compileShader && backend.createPipeline);
+	const Clock::time_point begin = Clock::now();
+
+	std::mutex mutex; // ノードの状態・残りのタスクの数・下の2つの表を守る
+	std::condition_variable finished;
+	size_t remainingTaskCount = shaders_.size() + pipelines_.size();
+	size_t remainingShaderCount = shaders_.size();
+	const bool prepare = bool(backend.preparePipelines);
+	bool prepared = true;
+	double prepareMilliseconds = 0.0;
+	std::unordered_multimap<uint64_t, ShaderId> bytecodeOwners;       // バイトコードのハッシュ→持ち主
+	std::map<std::vector<ShaderId>, PipelineId> createdPipelines;     // 持ち主のシェーダーの組→作ったPSO
+	for (ShaderId shader = 0; shader < shaders_.size(); shader++) {
+		shaders_[shader].source = shader;
+	}
+	for (PipelineId pipeline = 0; pipeline < pipelines_.size(); pipeline++) {
+		PipelineNode& node = pipelines_[pipeline];
+		node.remainingShaderCount = uint32_t(node.shaders.size());
+		node.shaderFailed = false;
+		node.source = pipeline;
+		node.succeeded = false;
+	}
+
+	auto finishTask = [&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--remainingTaskCount == 0) {
+			finished.notify_all();
+		}
+	};
+	auto runPipeline = [&](PipelineId pipeline) {
+		PipelineNode& node = pipelines_[pipeline];
+		// 失敗したシェーダーがあれば作らない
+		bool create = !node.shaderFailed && prepared;
+		if (create) {
+			// バイトコードの持ち主の組が同じPSOを既に作り始めていれば、それを使う
+			std::vector<ShaderId> sources;
+			sources.reserve(node.shaders.size());
+			for (ShaderId shader : node.shaders) {
+				sources.push_back(shaders_[shader].source);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			auto [it, inserted] = createdPipelines.emplace(std::move(sources), pipeline);
+			node.source = it->second;
+			create = inserted;
+		}
+		if (create) {
+			std::vector<const std::vector<uint8_t>*> shaders;
+			shaders.reserve(node.shaders.size());
+			for (ShaderId shader : node.shaders) {
+				shaders.push_back(&GetBytecode(shader));
+			}
+			const Clock::time_point start = Clock::now();
+			node.succeeded = backend.createPipeline(pipeline, shaders);
+			node.milliseconds = MillisecondsSince(start);
+		}
+		finishTask();
+	};
+	// 全てのシェーダーが終わった後の準備をしてから、全てのPSOを作り始める
+	auto runPrepare = [&]() {
+		const Clock::time_point start = Clock::now();
+		prepared = backend.preparePipelines();
+		prepareMilliseconds = MillisecondsSince(start);
+		for (PipelineId pipeline = 0; pipeline < pipelines_.size(); pipeline++) {
+			threadPool.Submit([&runPipeline, pipeline]() { runPipeline(pipeline); });
+		}
+	};
+	auto runShader = [&](ShaderId shader) {
+		ShaderNode& node = shaders_[shader];
+		const Clock::time_point start = Clock::now();
+		node.bytecode.clear();
+		node.succeeded = backend.compileShader(node.request, node.bytecode);
+		node.milliseconds = MillisecondsSince(start);
+		if (node.succeeded) {
+			// 先に終わったシェーダーと同じバイトコードなら、そちらを使って自分の分は捨てる
+			const uint64_t hash = HashBytecode(node.bytecode);
+			std::lock_guard<std::mutex> lock(mutex);
+			auto [ownersBegin, ownersEnd] = bytecodeOwners.equal_range(hash);
+			for (auto it = ownersBegin; it != ownersEnd; ++it) {
+				if (shaders_[it->second].bytecode == node.bytecode) {
+					node.source = it->second;
+					break;
+				}
+			}
+			if (node.source == shader) {
+				bytecodeOwners.emplace(hash, shader);
+			} else {
+				node.bytecode.clear();
+				node.bytecode.shrink_to_fit();
+			}
+		}
+
+		// このシェーダーで揃ったPSOから作り始める
+		for (PipelineId pipeline : node.dependents) {
+			bool ready = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				PipelineNode& dependent = pipelines_[pipeline];
+				dependent.shaderFailed |= !node.succeeded;
+				ready = --dependent.remainingShaderCount == 0;
+			}
+			if (ready && !prepare) {
+				threadPool.Submit([&runPipeline, pipeline]() { runPipeline(pipeline); });
+			}
+		}
+		if (prepare) {
+			bool last = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				last = --remainingShaderCount == 0;
+			}
+			if (last) {
+				runPrepare();
+			}
+		}
+		finishTask();
+	};
+
+	// 多くのPSOが待っているシェーダーから始める（早く揃うPSOが増える）
+	std::vector<ShaderId> order(shaders_.size());
+	std::iota(order.begin(), order.end(), ShaderId(0));
+	std::stable_sort(order.begin(), order.end(), [this](ShaderId a, ShaderId b) {
+		return shaders_[a].dependents.size() > shaders_[b].dependents.size();
+	});
+	if (prepare && shaders_.empty()) {
+		runPrepare();
+	}
+	for (PipelineId pipeline = 0; pipeline < pipelines_.size() && !prepare; pipeline++) {
+		if (pipelines_[pipeline].shaders.empty()) {
+			threadPool.Submit([&runPipeline, pipeline]() { runPipeline(pipeline); });
+		}
+	}
+	for (ShaderId shader : order) {
+		threadPool.Submit([&runShader, shader]() { runShader(shader); });
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [&]() { return remainingTaskCount == 0; });
+	}
+
+	PipelineBuildReport report;
+	report.totalMilliseconds = MillisecondsSince(begin);
+	report.shaderCount = shaders_.size();
+	report.pipelineCount = pipelines_.size();
+	report.threadCount = threadPool.GetThreadCount();
+	report.prepareMilliseconds = prepareMilliseconds;
+	report.prepareFailed = !prepared;
+	report.serialMilliseconds += prepareMilliseconds;
+	const ShaderNode* slowestShader = nullptr;
+	for (size_t shader = 0; shader < shaders_.size(); shader++) {
+		const ShaderNode& node = shaders_[shader];
+		report.serialMilliseconds += node.milliseconds;
+		report.failedShaderCount += node.succeeded ? 0 : 1;
+		if (!slowestShader || node.milliseconds > slowestShader->milliseconds) {
+			slowestShader = &node;
+		}
+		// PSOに使われないシェーダーはそれだけで1本の鎖
+		if (node.milliseconds > report.criticalPathMilliseconds) {
+			report.criticalPathMilliseconds = node.milliseconds;
+			report.criticalPath = { node.name };
+		}
+	}
+	if (prepare && (slowestShader ? slowestShader->milliseconds : 0.0) + prepareMilliseconds > report.criticalPathMilliseconds) {
+		report.criticalPathMilliseconds = (slowestShader ? slowestShader->milliseconds : 0.0) + prepareMilliseconds;
+		report.criticalPath.clear();
+		if (slowestShader) {
+			report.criticalPath.push_back(slowestShader->name);
+		}
+		report.criticalPath.push_back("(prepare pipelines)");
+	}
+	for (size_t shader = 0; shader < shaders_.size(); shader++) {
+		report.duplicateShaderCount += shaders_[shader].source != shader ? 1 : 0;
+	}
+	for (PipelineId pipeline = 0; pipeline < pipelines_.size(); pipeline++) {
+		PipelineNode& node = pipelines_[pipeline];
+		if (node.source != pipeline) {
+			// 使い回したPSOの結果に合わせる
+			node.succeeded = pipelines_[node.source].succeeded;
+			report.duplicatePipelineCount++;
+		}
+		report.serialMilliseconds += node.milliseconds;
+		report.failedPipelineCount += node.succeeded ? 0 : 1;
+		// PSOは一番遅いシェーダーを待ってから作られる（準備があれば全てのシェーダーと準備を待つ）
+		const ShaderNode* slowest = nullptr;
+		if (prepare) {
+			slowest = slowestShader;
+		} else {
+			for (ShaderId shader : node.shaders) {
+				if (!slowest || shaders_[shader].milliseconds > slowest->milliseconds) {
+					slowest = &shaders_[shader];
+				}
+			}
+		}
+		const double pathMilliseconds = (slowest ? slowest->milliseconds : 0.0) + prepareMilliseconds + node.milliseconds;
+		if (pathMilliseconds > report.criticalPathMilliseconds) {
+			report.criticalPathMilliseconds = pathMilliseconds;
+			report.criticalPath.clear();
+			if (slowest) {
+				report.criticalPath.push_back(slowest->name);
+			}
+			if (prepare) {
+				report.criticalPath.push_back("(prepare pipelines)");
+			}
+			report.criticalPath.push_back(node.name);
+		}
+	}
+	return report;
+}
@@ -0,0 +1,99 @@
+#include "engine/graphics/PipelineBuildScheduler.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Object3DとNoUVの2組に、Object3DのVSを共有するPSの派生が8つ（シェーダー12個、PSO10個）
+void AddSelfTestPipelines(PipelineBuildScheduler& scheduler) {
+	const std::vector<std::string> arguments = { "-Od" };
+	const PipelineBuildScheduler::ShaderId vertex = scheduler.AddShader({ "shaders/Object3d.VS.hlsl", "vs_6_0", "main", arguments });
+	const PipelineBuildScheduler::ShaderId pixel = scheduler.AddShader({ "shaders/Object3d.PS.hlsl", "ps_6_0", "main", arguments });
+	const PipelineBuildScheduler::ShaderId noUvVertex = scheduler.AddShader({ "shaders/Object3d_NoUV.VS.hlsl", "vs_6_0", "main", arguments });
+	const PipelineBuildScheduler::ShaderId noUvPixel = scheduler.AddShader({ "shaders/Object3d_NoUV.PS.hlsl", "ps_6_0", "main", arguments });
+	scheduler.AddPipeline("Object3d", { vertex, pixel });
+	scheduler.AddPipeline("Object3d_NoUV", { noUvVertex, noUvPixel });
+	for (uint32_t i = 0; i < 8; ++i) {
+		const PipelineBuildScheduler::ShaderId variant =
+			scheduler.AddShader({ "shaders/Object3d.PS.hlsl", "ps_6_0", "main", { "-D", "VARIANT=" + std::to_string(i) } });
+		scheduler.AddPipeline("Object3d_" + std::to_string(i), { vertex, variant });
+	}
+}
+
+bool AllPipelinesReady(const PipelineBuildScheduler& scheduler, PipelineBuildScheduler::PipelineId except = UINT32_MAX) {
+	for (PipelineBuildScheduler::PipelineId pipeline = 0; pipeline < scheduler.GetPipelineCount(); ++pipeline) {
+		if (scheduler.IsPipelineReady(pipeline) != (pipeline != except)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunPipelineBuildSchedulerSelfTest() {
+	std::vector<SelfTestResult> results;
+	ThreadPool threadPool(4);
+
+	{
+		// 同じ設定のシェーダーは1つになり、PSOは自分のシェーダーが揃ってから作られる
+		PipelineBuildScheduler scheduler;
+		AddSelfTestPipelines(scheduler);
+		const bool sameId = scheduler.AddShader({ "shaders/Object3d.VS.hlsl", "vs_6_0", "main", { "-Od" } }) == 0;
+		auto log = std::make_shared<MockPipelineBuildLog>();
+		const PipelineBuildReport report = scheduler.Build(threadPool, CreateMockPipelineBuildBackend(log));
+		AddSelfTestResult(results, "pipeline build compiles each shader once",
+			sameId && log->compileCount == 12 && report.shaderCount == 12 && report.failedShaderCount == 0,
+			"compiles " + std::to_string(log->compileCount));
+		AddSelfTestResult(results, "pipeline build creates pipelines only after their shaders",
+			log->missingShaderCount == 0 && log->pipelineCount == 10 && report.failedPipelineCount == 0 && AllPipelinesReady(scheduler));
+		// 4スレッドで12×20ms＋10×5msを回すので、1スレッドで順に行うより十分速い
+		// 最も長い鎖はコンパイル1つとPSO1つ
+		AddSelfTestResult(results, "pipeline build runs tasks in parallel",
+			log->peakActiveCount > 1 && report.totalMilliseconds < report.serialMilliseconds * 0.75 &&
+			report.criticalPathMilliseconds >= 25.0 && report.criticalPath.size() == 2,
+			"total " + FormatSelfTestValue(report.totalMilliseconds) + " ms, serial " + FormatSelfTestValue(report.serialMilliseconds) +
+			" ms, critical " + FormatSelfTestValue(report.criticalPathMilliseconds) + " ms");
+	}
+
+	{
+		// 失敗したシェーダーを使うPSOだけを作らない
+		PipelineBuildScheduler scheduler;
+		AddSelfTestPipelines(scheduler);
+		auto log = std::make_shared<MockPipelineBuildLog>();
+		MockPipelineBuildDesc desc;
+		desc.failingSources = { "shaders/Object3d_NoUV.PS.hlsl" };
+		const PipelineBuildReport report = scheduler.Build(threadPool, CreateMockPipelineBuildBackend(log, desc));
+		AddSelfTestResult(results, "pipeline build skips pipelines of failed shaders",
+			report.failedShaderCount == 1 && report.failedPipelineCount == 1 && log->pipelineCount == 9 && AllPipelinesReady(scheduler, 1),
+			"failed pipelines " + std::to_string(report.failedPipelineCount));
+	}
+
+	for (bool prepareSucceeds : { true, false }) {
+		// preparePipelinesは全てのコンパイルの後、PSOの前に1回だけ呼ばれる
+		PipelineBuildScheduler scheduler;
+		AddSelfTestPipelines(scheduler);
+		auto log = std::make_shared<MockPipelineBuildLog>();
+		PipelineBuildBackend backend = CreateMockPipelineBuildBackend(log);
+		std::atomic<uint32_t> prepareCount = 0;
+		std::atomic<bool> prepareOrdered = true;
+		backend.preparePipelines = [&]() {
+			std::lock_guard<std::mutex> lock(log->mutex);
+			prepareCount++;
+			prepareOrdered = prepareOrdered && log->compileCount == 12 && log->pipelineCount == 0;
+			return prepareSucceeds;
+		};
+		const PipelineBuildReport report = scheduler.Build(threadPool, backend);
+		const bool created = prepareSucceeds ? log->pipelineCount == 10 && AllPipelinesReady(scheduler) :
+			log->pipelineCount == 0 && report.failedPipelineCount == 10 && report.prepareFailed;
+		AddSelfTestResult(results, prepareSucceeds ? "pipeline build waits for prepare pipelines" : "pipeline build stops when prepare pipelines fails",
+			prepareCount == 1 && prepareOrdered && created,
+			"created " + std::to_string(log->pipelineCount));
+	}
+
+	return results;
+}
@@ -0,0 +1,98 @@
+#include "engine/graphics/RenderQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+uint64_t TakeBits(uint32_t value, uint32_t bits) {
+	return uint64_t(value) & ((uint64_t(1) << bits) - 1);
+}
+
+} // namespace
+
+uint64_t MakeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t texture, float depth) {
+	static_assert(kSortKeyLayerBits + kSortKeyPipelineBits + kSortKeyMaterialBits + kSortKeyTextureBits + kSortKeyDepthBits == 64);
+	const uint32_t maxDepth = (1u << kSortKeyDepthBits) - 1;
+	const float clamped = std::isnan(depth) ? 1.0f : std::clamp(depth, 0.0f, 1.0f);
+	const uint32_t quantizedDepth = uint32_t(clamped * float(maxDepth));
+
+	uint64_t key = TakeBits(layer, kSortKeyLayerBits);
+	key = (key << kSortKeyPipelineBits) | TakeBits(pipeline, kSortKeyPipelineBits);
+	key = (key << kSortKeyMaterialBits) | TakeBits(material, kSortKeyMaterialBits);
+	key = (key << kSortKeyTextureBits) | TakeBits(texture, kSortKeyTextureBits);
+	key = (key << kSortKeyDepthBits) | TakeBits(quantizedDepth, kSortKeyDepthBits);
+	return key;
+}
+
+RenderCommandBackend CreateRecordingRenderBackend(std::shared_ptr<RenderCommandLog> log) {
+	assert(log);
+	RenderCommandBackend backend;
+	backend.setPipeline = [log](uint32_t) { log->pipelineCount++; };
+	backend.setConstantBufferView = [log](uint32_t, uint64_t) { log->constantBufferViewCount++; };
+	backend.setDescriptorTable = [log](uint32_t, uint32_t) { log->descriptorTableCount++; };
+	backend.setMesh = [log](uint32_t) { log->meshCount++; };
+	backend.drawIndexed = [log](uint32_t indexCount, uint32_t firstIndex) { log->draws.emplace_back(indexCount, firstIndex); };
+	return backend;
+}
+
+void RenderQueue::Sort() {
+	// パケットごと並べ替えると大きい構造体を何度も動かすので、キーと番号だけを並べてから詰め直す
+	order_.resize(packets_.size());
+	for (size_t i = 0; i < packets_.size(); i++) {
+		order_[i] = { packets_[i].sortKey, uint32_t(i) };
+	}
+	std::sort(order_.begin(), order_.end());
+	sorted_.resize(packets_.size());
+	for (size_t i = 0; i < order_.size(); i++) {
+		sorted_[i] = packets_[order_[i].second];
+	}
+	packets_.swap(sorted_);
+}
+
+RenderQueueStats RenderQueue::Execute(const RenderCommandBackend& backend) const {
+	RenderQueueStats stats;
+	// 直前に設定した値（最初の描画では全て設定する）
+	bool first = true;
+	DrawPacket current;
+	for (const DrawPacket& packet : packets_) {
+		if (first || packet.pipeline != current.pipeline) {
+			backend.setPipeline(packet.pipeline);
+			stats.pipelineSetCount++;
+		} else {
+			stats.skippedSetCount++;
+		}
+		auto setConstantBuffer = [&](uint32_t rootParameter, uint64_t address, uint64_t previous) {
+			if (first || address != previous) {
+				backend.setConstantBufferView(rootParameter, address);
+				stats.constantBufferSetCount++;
+			} else {
+				stats.skippedSetCount++;
+			}
+		};
+		setConstantBuffer(kRootParameterMaterial, packet.material, current.material);
+		setConstantBuffer(kRootParameterTransform, packet.transform, current.transform);
+		setConstantBuffer(kRootParameterLight, packet.light, current.light);
+		if (first || packet.texture != current.texture) {
+			backend.setDescriptorTable(kRootParameterTexture, packet.texture);
+			stats.descriptorTableSetCount++;
+		} else {
+			stats.skippedSetCount++;
+		}
+		if (first || packet.mesh != current.mesh) {
+			backend.setMesh(packet.mesh);
+			stats.meshSetCount++;
+		} else {
+			stats.skippedSetCount++;
+		}
+
+		backend.drawIndexed(packet.indexCount, packet.firstIndex);
+		stats.drawCount++;
+		current = packet;
+		first = false;
+	}
+	stats.stateSetCount = stats.pipelineSetCount + stats.constantBufferSetCount + stats.descriptorTableSetCount +
+		stats.meshSetCount;
+	return stats;
+}
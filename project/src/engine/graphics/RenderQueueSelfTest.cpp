@@ -0,0 +1,107 @@
+#include "engine/graphics/RenderQueue.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+std::vector<SelfTestResult> RunRenderQueueSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	// キーは層>PSO>マテリアル>テクスチャ>深度の順に比べられ、深度は0〜1に収まる
+	const bool keyOrder = MakeSortKey(1, 0, 0, 0, 0.0f) > MakeSortKey(0, 255, 65535, 65535, 1.0f) &&
+		MakeSortKey(0, 1, 0, 0, 0.0f) > MakeSortKey(0, 0, 65535, 65535, 1.0f) &&
+		MakeSortKey(0, 0, 1, 0, 0.0f) > MakeSortKey(0, 0, 0, 65535, 1.0f) &&
+		MakeSortKey(0, 0, 0, 1, 0.0f) > MakeSortKey(0, 0, 0, 0, 1.0f) &&
+		MakeSortKey(0, 0, 0, 0, 0.5f) > MakeSortKey(0, 0, 0, 0, 0.25f) &&
+		MakeSortKey(0, 0, 0, 0, 2.0f) == MakeSortKey(0, 0, 0, 0, 1.0f) &&
+		MakeSortKey(0, 0, 0, 0, -1.0f) == MakeSortKey(0, 0, 0, 0, 0.0f);
+	AddSelfTestResult(results, "render queue sort key orders layer, pipeline, material, texture, depth", keyOrder);
+
+	// 2つのPSO、8つのマテリアル（テクスチャは4枚を共有）のメッシュを200個と、最後に描くスプライト
+	// indexCountを描画ごとに変えて、どのパケットが流れたかを見分ける
+	const uint32_t kMeshCount = 200;
+	const uint32_t kMaterialCount = 8;
+	std::mt19937 random(20);
+	std::vector<DrawPacket> packets;
+	RenderQueue queue;
+	for (uint32_t i = 0; i < kMeshCount; ++i) {
+		DrawPacket packet;
+		const uint32_t material = random() % kMaterialCount;
+		packet.pipeline = material / 4;
+		packet.material = 0x100000 + material * 256;
+		packet.transform = 0x200000;
+		packet.light = 0x300000;
+		packet.texture = 16 + material % 4;
+		// メッシュを2つずつ同じバッファに詰めた想定
+		packet.mesh = i / 2;
+		packet.indexCount = 3 * (i + 1);
+		packet.firstIndex = (i % 2) * 3;
+		packet.sortKey = MakeSortKey(0, packet.pipeline, material, material % 4, float(random() % 1000) / 1000.0f);
+		packets.push_back(packet);
+	}
+	DrawPacket sprite;
+	sprite.sortKey = MakeSortKey(1, 0, 99, 0, 0.0f);
+	sprite.indexCount = 6;
+	sprite.firstIndex = 1;
+	packets.insert(packets.begin() + kMeshCount / 2, sprite);
+	for (const DrawPacket& packet : packets) {
+		queue.Submit(packet);
+	}
+
+	auto unsortedLog = std::make_shared<RenderCommandLog>();
+	const RenderQueueStats unsorted = queue.Execute(CreateRecordingRenderBackend(unsortedLog));
+	queue.Sort();
+	auto sortedLog = std::make_shared<RenderCommandLog>();
+	const RenderQueueStats sorted = queue.Execute(CreateRecordingRenderBackend(sortedLog));
+
+	// 設定を飛ばしても、描画のたびにそのパケットの状態が揃っていること（記録しながら今の状態を追う）
+	std::vector<uint32_t> drawCounts(packets.size(), 0);
+	std::vector<uint64_t> drawKeys;
+	bool stateMatches = true;
+	DrawPacket state;
+	RenderCommandBackend tracking;
+	tracking.setPipeline = [&state](uint32_t pipeline) { state.pipeline = pipeline; };
+	tracking.setConstantBufferView = [&state](uint32_t rootParameter, uint64_t address) {
+		(rootParameter == kRootParameterMaterial ? state.material : rootParameter == kRootParameterTransform ? state.transform : state.light) = address;
+	};
+	tracking.setDescriptorTable = [&state](uint32_t, uint32_t texture) { state.texture = texture; };
+	tracking.setMesh = [&state](uint32_t mesh) { state.mesh = mesh; };
+	tracking.drawIndexed = [&](uint32_t indexCount, uint32_t firstIndex) {
+		auto it = std::find_if(packets.begin(), packets.end(), [&](const DrawPacket& packet) {
+			return packet.indexCount == indexCount && packet.firstIndex == firstIndex;
+		});
+		if (it == packets.end()) {
+			stateMatches = false;
+			return;
+		}
+		drawCounts[it - packets.begin()]++;
+		drawKeys.push_back(it->sortKey);
+		stateMatches = stateMatches && state.pipeline == it->pipeline && state.material == it->material &&
+			state.transform == it->transform && state.light == it->light && state.texture == it->texture &&
+			state.mesh == it->mesh;
+	};
+	queue.Execute(tracking);
+	const bool eachOnce = std::all_of(drawCounts.begin(), drawCounts.end(), [](uint32_t count) { return count == 1; });
+	AddSelfTestResult(results, "render queue draws every packet once with its own state", eachOnce && stateMatches);
+	AddSelfTestResult(results, "render queue executes in key order with the sprite layer last",
+		std::is_sorted(drawKeys.begin(), drawKeys.end()) && !sortedLog->draws.empty() && sortedLog->draws.back() == std::make_pair(6u, 1u));
+
+	// 統計は記録された呼び出しと合い、設定と省略を足すと描画ごとに6つ
+	auto statsMatchLog = [](const RenderQueueStats& stats, const RenderCommandLog& log) {
+		return stats.drawCount == log.draws.size() && stats.pipelineSetCount == log.pipelineCount &&
+			stats.constantBufferSetCount == log.constantBufferViewCount && stats.descriptorTableSetCount == log.descriptorTableCount &&
+			stats.meshSetCount == log.meshCount && stats.stateSetCount + stats.skippedSetCount == stats.drawCount * 6;
+	};
+	AddSelfTestResult(results, "render queue stats match the recorded commands",
+		statsMatchLog(unsorted, *unsortedLog) && statsMatchLog(sorted, *sortedLog));
+	// 並べた後は、PSOは種類ごと（スプライトで戻る分を含めて3回）、マテリアルのCBVは種類ごとに1回
+	// （最初の描画でtransform・lightも設定し、スプライトの層でmaterial・transform・lightが変わる）
+	AddSelfTestResult(results, "render queue sorting removes redundant state changes",
+		sorted.stateSetCount < unsorted.stateSetCount && sorted.pipelineSetCount == 3 &&
+		sorted.constantBufferSetCount == 3 + (kMaterialCount - 1) + 3,
+		"unsorted " + std::to_string(unsorted.stateSetCount) + " sets, sorted " + std::to_string(sorted.stateSetCount) + " sets");
+
+	return results;
+}
@@ -0,0 +1,305 @@
+#include "engine/graphics/ShaderCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace {
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+constexpr const char* kIndexHeader = "# CG2 shader cache index v1";
+constexpr const char* kIndexFileName = "index.txt";
+
+// 8バイトずつFNV-1aの要領で混ぜる（TextureCacheと同じ）
+uint64_t HashWords(const uint8_t* data, size_t size, uint64_t hash) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * kFnvPrime;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ data[i]) * kFnvPrime;
+	}
+	return hash;
+}
+
+// 長さも混ぜる（"ab"+"c"と"a"+"bc"を区別する）
+uint64_t HashString(const std::string& text, uint64_t hash) {
+	const uint64_t size = text.size();
+	hash = HashWords(reinterpret_cast<const uint8_t*>(&size), sizeof(size), hash);
+	return HashWords(reinterpret_cast<const uint8_t*>(text.data()), text.size(), hash);
+}
+
+bool ReadFileBytes(const std::string& path, std::vector<uint8_t>& bytes) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+	const std::streamoff size = file.tellg();
+	if (size < 0) {
+		return false;
+	}
+	bytes.resize(size_t(size));
+	file.seekg(0);
+	return size == 0 || bool(file.read(reinterpret_cast<char*>(bytes.data()), size));
+}
+
+std::string NormalizeShaderPath(const std::string& path) {
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+} // namespace
+
+std::string MakeShaderRequestId(const ShaderCompileRequest& request) {
+	std::string id = NormalizeShaderPath(request.sourcePath) + '|' + request.profile + '|' + request.entryPoint;
+	for (const std::string& argument : request.arguments) {
+		id += '|';
+		id += argument;
+	}
+	return id;
+}
+
+bool ComputeShaderCacheKey(const ShaderCompileRequest& request, const std::vector<std::string>& dependencies, uint64_t& key) {
+	uint64_t hash = kFnvOffsetBasis;
+	hash = HashString(request.profile, hash);
+	hash = HashString(request.entryPoint, hash);
+	for (const std::string& argument : request.arguments) {
+		hash = HashString(argument, hash);
+	}
+
+	// ソースと依存ファイルは中身で比べる（更新時刻だけ変わったときはコンパイルし直さない）
+	std::vector<uint8_t> bytes;
+	if (!ReadFileBytes(request.sourcePath, bytes)) {
+		return false;
+	}
+	hash = HashWords(bytes.data(), bytes.size(), hash);
+	for (const std::string& dependency : dependencies) {
+		if (!ReadFileBytes(dependency, bytes)) {
+			return false;
+		}
+		// 同じ中身のファイルを別の名前でインクルードしても区別する
+		hash = HashString(NormalizeShaderPath(dependency), hash);
+		hash = HashWords(bytes.data(), bytes.size(), hash);
+	}
+	// 0は「未計算」扱いなので避ける
+	key = hash == 0 ? 1 : hash;
+	return true;
+}
+
+ShaderCache::ShaderCache(const std::string& cacheDirectory, ShaderCompileFunction compile)
+	: cacheDirectory_(cacheDirectory), compile_(std::move(compile)) {
+	assert(compile_);
+	LoadIndex();
+}
+
+std::string ShaderCache::GetBytecodePath(uint64_t key) const {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.cso", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(cacheDirectory_) / name).string();
+}
+
+bool ShaderCache::GetOrCompile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string* errors) {
+	const std::string id = MakeShaderRequestId(request);
+	bool known = false;
+	std::vector<std::string> dependencies;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_.requestCount++;
+		auto indexIt = index_.find(id);
+		if (indexIt != index_.end()) {
+			known = true;
+			dependencies = indexIt->second.dependencies;
+		}
+	}
+
+	// 前回の依存ファイルで今のキーを計算し、同じキーのバイトコードがあればそれを使う
+	// （初めてのリクエストでもソースだけのキーを計算しておき、コンパイル中に書き換えられていないかの確認に使う）
+	uint64_t key = 0;
+	const bool keyedBefore = ComputeShaderCacheKey(request, dependencies, key);
+	if (known && keyedBefore && ReadFileBytes(GetBytecodePath(key), bytecode) && !bytecode.empty()) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		IndexRecord& saved = index_[id];
+		if (saved.key != key) {
+			// 一度戻した変更などで、以前のバイトコードがそのまま使えた
+			saved.key = key;
+			indexDirty_ = true;
+		}
+		stats_.hitCount++;
+		return true;
+	}
+
+	ShaderCompileOutput output;
+	const bool succeeded = compile_(request, output);
+	if (errors) {
+		*errors = output.errors;
+	}
+	if (!succeeded || output.bytecode.empty()) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_.compileCount++;
+		stats_.failedCount++;
+		return false;
+	}
+	bytecode = std::move(output.bytecode);
+
+	// 依存ファイルはソース自身と重複を除いておく
+	IndexRecord record;
+	const std::string sourcePath = NormalizeShaderPath(request.sourcePath);
+	for (const std::string& file : output.includedFiles) {
+		std::string path = NormalizeShaderPath(file);
+		if (path != sourcePath && std::find(record.dependencies.begin(), record.dependencies.end(), path) == record.dependencies.end()) {
+			record.dependencies.push_back(std::move(path));
+		}
+	}
+	bool keyed = keyedBefore && ComputeShaderCacheKey(request, record.dependencies, record.key);
+	if (keyed) {
+		// コンパイルの前と同じファイルで計算し直し、キーが変わっていればコンパイル中に書き換えられている
+		// （コンパイラが読んだのが書き換えの前か後か分からないので、新しいキーで保存すると古いバイトコードが残りうる）
+		uint64_t keyAfter = record.key;
+		if (record.dependencies != dependencies) {
+			keyed = ComputeShaderCacheKey(request, dependencies, keyAfter);
+		}
+		keyed = keyed && keyAfter == key;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_.compileCount++;
+	if (!keyed) {
+		// 読めないファイルがある・コンパイル中に書き換えられた。バイトコードは使えるが保存はしない（次のリクエストでコンパイルし直す）
+		stats_.unsavedCount++;
+		return true;
+	}
+
+	// 中身が同じ別のファイルとはキーが同じになるので、書き込みもロックの中で行う
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDirectory_, ec);
+	const std::string path = GetBytecodePath(record.key);
+	// 一時ファイルに書いてから置き換える
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return true;
+		}
+		file.write(reinterpret_cast<const char*>(bytecode.data()), std::streamsize(bytecode.size()));
+		if (!file) {
+			file.close();
+			std::filesystem::remove(temporaryPath, ec);
+			return true;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return true;
+	}
+
+	// 以前のバイトコードは他の設定と共有していなければ消す（ソースを直すたびに増えないように）
+	auto indexIt = index_.find(id);
+	if (indexIt != index_.end() && indexIt->second.key != record.key) {
+		const uint64_t oldKey = indexIt->second.key;
+		const bool shared = std::any_of(index_.begin(), index_.end(), [&](const auto& entry) {
+			return entry.first != id && entry.second.key == oldKey;
+		});
+		if (!shared) {
+			std::filesystem::remove(GetBytecodePath(oldKey), ec);
+		}
+	}
+	index_[id] = std::move(record);
+	indexDirty_ = true;
+	return true;
+}
+
+std::vector<std::string> ShaderCache::GetDependencies(const ShaderCompileRequest& request) const {
+	std::vector<std::string> dependencies = { NormalizeShaderPath(request.sourcePath) };
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.find(MakeShaderRequestId(request));
+	if (it != index_.end()) {
+		dependencies.insert(dependencies.end(), it->second.dependencies.begin(), it->second.dependencies.end());
+	}
+	return dependencies;
+}
+
+ShaderCacheStats ShaderCache::GetStats() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+void ShaderCache::LoadIndex() {
+	std::ifstream file(std::filesystem::path(cacheDirectory_) / kIndexFileName);
+	if (!file.is_open()) {
+		return;
+	}
+	std::string line;
+	if (!std::getline(file, line) || line != kIndexHeader) {
+		// 形式が違う対応表は使わない（次の保存で作り直す）
+		indexDirty_ = true;
+		return;
+	}
+	// 1行 = キー(16進) タブ 設定の文字列 タブ 依存ファイル タブ 依存ファイル ...
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string field;
+		IndexRecord record;
+		if (!std::getline(stream, field, '\t') || field.empty()) {
+			continue;
+		}
+		record.key = std::strtoull(field.c_str(), nullptr, 16);
+		std::string id;
+		if (record.key == 0 || !std::getline(stream, id, '\t') || id.empty()) {
+			continue;
+		}
+		while (std::getline(stream, field, '\t')) {
+			if (!field.empty()) {
+				record.dependencies.push_back(field);
+			}
+		}
+		index_[id] = std::move(record);
+	}
+}
+
+bool ShaderCache::SaveIndex() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!indexDirty_) {
+		return true;
+	}
+	std::error_code ec;
+	std::filesystem::create_directories(cacheDirectory_, ec);
+	std::filesystem::path path = std::filesystem::path(cacheDirectory_) / kIndexFileName;
+
+	// 一時ファイルに書いてから置き換える
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file << kIndexHeader << '\n';
+		for (const auto& [id, record] : index_) {
+			file << std::hex << record.key << std::dec << '\t' << id;
+			for (const std::string& dependency : record.dependencies) {
+				file << '\t' << dependency;
+			}
+			file << '\n';
+		}
+		if (!file) {
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return false;
+	}
+	indexDirty_ = false;
+	return true;
+}
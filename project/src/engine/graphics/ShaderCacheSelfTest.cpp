@@ -0,0 +1,192 @@
+#include "engine/graphics/ShaderCache.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// ShaderCache.cppのインデックスの形式と合わせる
+constexpr const char* kIndexHeader = "# CG2 shader cache index v1";
+constexpr const char* kIndexFileName = "index.txt";
+
+void WriteTextFile(const std::filesystem::path& path, const std::string& text) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file << text;
+}
+
+std::string ToString(const std::vector<uint8_t>& bytes) {
+	return std::string(bytes.begin(), bytes.end());
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunShaderCacheSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path(ec) / "cg2_testshaders_cache";
+	std::filesystem::remove_all(directory, ec);
+	std::filesystem::create_directories(directory, ec);
+	const std::string cacheDirectory = (directory / ".shadercache").generic_string();
+	const std::string pixelPath = (directory / "A.PS.hlsl").generic_string();
+	const std::string vertexPath = (directory / "A.VS.hlsl").generic_string();
+	WriteTextFile(pixelPath, "#include \"Common.hlsli\"\nps body\n");
+	WriteTextFile(vertexPath, "vs body\n");
+	WriteTextFile(directory / "Common.hlsli", "common v1\n");
+
+	// 偽のコンパイラ: #include "x" をソースと同じフォルダから読んで繋げ、プロファイルと引数を足したものをバイトコードにする
+	// 「ERROR」の行があれば失敗する
+	std::atomic<uint32_t> compileCount = 0;
+	auto compile = [&compileCount](const ShaderCompileRequest& request, ShaderCompileOutput& output) {
+		compileCount++;
+		std::ifstream source(request.sourcePath);
+		std::string line;
+		std::string text;
+		while (std::getline(source, line)) {
+			if (line.rfind("#include \"", 0) == 0) {
+				const std::string includePath = (std::filesystem::path(request.sourcePath).parent_path() / line.substr(10, line.size() - 11)).generic_string();
+				std::ifstream include(includePath);
+				if (!include.is_open()) {
+					output.errors = "cannot open " + includePath;
+					return false;
+				}
+				output.includedFiles.push_back(includePath);
+				std::string includeLine;
+				while (std::getline(include, includeLine)) {
+					text += includeLine + "\n";
+				}
+			} else if (line == "ERROR") {
+				output.errors = "syntax error";
+				return false;
+			} else {
+				text += line + "\n";
+			}
+		}
+		text += request.profile;
+		for (const std::string& argument : request.arguments) {
+			text += argument;
+		}
+		output.bytecode.assign(text.begin(), text.end());
+		return true;
+	};
+	auto countBytecodeFiles = [&cacheDirectory]() {
+		size_t count = 0;
+		std::error_code iterateError;
+		for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, iterateError)) {
+			count += entry.path().extension() == ".cso";
+		}
+		return count;
+	};
+
+	const std::vector<std::string> arguments = { "-Od", "-Zpr" };
+	const ShaderCompileRequest pixel = { pixelPath, "ps_6_0", "main", arguments };
+	const ShaderCompileRequest vertex = { vertexPath, "vs_6_0", "main", arguments };
+	std::vector<uint8_t> bytecode;
+	{
+		ShaderCache cache(cacheDirectory, compile);
+		const bool compiled = cache.GetOrCompile(pixel, bytecode) && ToString(bytecode).find("common v1") != std::string::npos;
+		const bool vertexCompiled = cache.GetOrCompile(vertex, bytecode);
+		const bool hit = cache.GetOrCompile(vertex, bytecode);
+		const ShaderCacheStats stats = cache.GetStats();
+		AddSelfTestResult(results, "shader cache compiles once per request in a session",
+			compiled && vertexCompiled && hit && compileCount == 2 && stats.hitCount == 1 && stats.requestCount == 3,
+			"compiles " + std::to_string(compileCount.load()));
+		const std::vector<std::string> dependencies = cache.GetDependencies(pixel);
+		AddSelfTestResult(results, "shader cache records included files as dependencies",
+			dependencies.size() == 2 && dependencies[0] == pixelPath && dependencies[1] == (directory / "Common.hlsli").generic_string());
+		AddSelfTestResult(results, "shader cache saves its index", cache.SaveIndex());
+	}
+
+	{
+		// 作り直しても、保存したバイトコードをそのまま使う
+		ShaderCache cache(cacheDirectory, compile);
+		const bool restored = cache.GetOrCompile(pixel, bytecode) && ToString(bytecode).find("common v1") != std::string::npos;
+		AddSelfTestResult(results, "shader cache hits after a restart", restored && compileCount == 2);
+
+		// 引数が違えば別のキー
+		const bool otherArguments = cache.GetOrCompile({ pixelPath, "ps_6_0", "main", { "-O3" } }, bytecode) && compileCount == 3;
+		AddSelfTestResult(results, "shader cache recompiles for different arguments", otherArguments);
+
+		// インクルードしたファイルだけを変えても気付き、古いバイトコードは消える
+		const size_t filesBefore = countBytecodeFiles();
+		WriteTextFile(directory / "Common.hlsli", "common v2\n");
+		const bool includeChanged = cache.GetOrCompile(pixel, bytecode) && compileCount == 4 &&
+			ToString(bytecode).find("common v2") != std::string::npos;
+		const bool vertexUnaffected = cache.GetOrCompile(vertex, bytecode) && compileCount == 4;
+		AddSelfTestResult(results, "shader cache recompiles when only an include changes",
+			includeChanged && vertexUnaffected && countBytecodeFiles() == filesBefore,
+			"compiles " + std::to_string(compileCount.load()) + ", files " + std::to_string(countBytecodeFiles()));
+
+		// 失敗はメッセージと共に返し、直せばまた通る
+		WriteTextFile(vertexPath, "ERROR\n");
+		std::string errors;
+		const bool failed = !cache.GetOrCompile(vertex, bytecode, &errors) && errors == "syntax error" && cache.GetStats().failedCount == 1;
+		WriteTextFile(vertexPath, "vs body\n");
+		const bool recovered = cache.GetOrCompile(vertex, bytecode) && compileCount == 5;
+		AddSelfTestResult(results, "shader cache reports compile errors", failed && recovered, errors);
+		cache.SaveIndex();
+	}
+
+	{
+		// コンパイル中にソースを書き換えられたら、コンパイラが読んだ方のバイトコードを新しいキーで保存しない
+		ShaderCache cache(cacheDirectory, [&](const ShaderCompileRequest& request, ShaderCompileOutput& output) {
+			const bool compiled = compile(request, output);
+			WriteTextFile(vertexPath, "vs body edited\n");
+			return compiled;
+		});
+		WriteTextFile(vertexPath, "vs body v2\n");
+		const uint32_t compilesBefore = compileCount;
+		const bool returned = cache.GetOrCompile(vertex, bytecode) && ToString(bytecode).find("vs body v2") != std::string::npos;
+		const bool unsaved = cache.GetStats().unsavedCount == 1;
+		ShaderCache next(cacheDirectory, compile);
+		const bool recompiled = next.GetOrCompile(vertex, bytecode) && compileCount == compilesBefore + 2 &&
+			ToString(bytecode).find("vs body edited") != std::string::npos && next.GetStats().unsavedCount == 0;
+		AddSelfTestResult(results, "shader cache does not save bytecode when the source changes during compile",
+			returned && unsaved && recompiled, "compiles " + std::to_string(compileCount.load() - compilesBefore));
+		// 元に戻して保存し直しておく（次のテストは全てヒットする前提）
+		WriteTextFile(vertexPath, "vs body\n");
+		next.GetOrCompile(vertex, bytecode);
+		next.SaveIndex();
+	}
+
+	{
+		// 複数のスレッドから同じものと違うものを同時に頼んでも、全てヒットする
+		ShaderCache cache(cacheDirectory, compile);
+		const uint32_t compilesBefore = compileCount;
+		std::atomic<uint32_t> succeeded = 0;
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < 8; ++i) {
+			threads.emplace_back([&, i]() {
+				std::vector<uint8_t> threadBytecode;
+				for (uint32_t j = 0; j < 16; ++j) {
+					succeeded += cache.GetOrCompile((i + j) % 2 ? pixel : vertex, threadBytecode) && !threadBytecode.empty();
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		AddSelfTestResult(results, "shader cache serves concurrent requests",
+			succeeded == 8 * 16 && compileCount == compilesBefore && cache.GetStats().hitCount == 8 * 16);
+	}
+
+	{
+		// 壊れた対応表は捨てて、コンパイルし直して保存し直す
+		WriteTextFile(std::filesystem::path(cacheDirectory) / kIndexFileName, "garbage\n");
+		ShaderCache cache(cacheDirectory, compile);
+		const uint32_t compilesBefore = compileCount;
+		const bool rebuilt = cache.GetOrCompile(vertex, bytecode) && compileCount == compilesBefore + 1 && cache.SaveIndex();
+		std::ifstream index(std::filesystem::path(cacheDirectory) / kIndexFileName);
+		std::string header;
+		std::getline(index, header);
+		AddSelfTestResult(results, "shader cache rebuilds a broken index", rebuilt && header == kIndexHeader);
+	}
+
+	std::filesystem::remove_all(directory, ec);
+	return results;
+}
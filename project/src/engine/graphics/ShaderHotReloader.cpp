@@ -0,0 +1,224 @@
+#include "engine/graphics/ShaderHotReloader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+ShaderWatchBackend CreateFileSystemWatchBackend() {
+	ShaderWatchBackend backend;
+	backend.getStamp = [](const std::string& path) {
+		ShaderFileStamp stamp;
+		std::error_code ec;
+		const uintmax_t size = std::filesystem::file_size(path, ec);
+		if (ec) {
+			return stamp;
+		}
+		const auto writeTime = std::filesystem::last_write_time(path, ec);
+		if (ec) {
+			return stamp;
+		}
+		stamp.exists = true;
+		stamp.size = static_cast<uint64_t>(size);
+		stamp.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		return stamp;
+	};
+	backend.nowMilliseconds = []() {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+	return backend;
+}
+
+ShaderHotReloader::ShaderHotReloader(const ShaderHotReloadDesc& desc, ShaderWatchBackend watch, ShaderReloadBackend backend)
+	: desc_(desc), watch_(std::move(watch)), backend_(std::move(backend)), worker_(1) {
+	assert(watch_.getStamp && watch_.nowMilliseconds);
+	assert(backend_.compileShader && backend_.createPipeline && backend_.swapPipeline && backend_.discardPipeline && backend_.getDependencies);
+}
+
+ShaderHotReloader::~ShaderHotReloader() {
+	worker_.WaitIdle();
+	// 差し替えずに終わるPSOは捨てる
+	if (job_) {
+		for (uint32_t pipeline : job_->pipelines) {
+			backend_.discardPipeline(pipeline);
+		}
+	}
+}
+
+void ShaderHotReloader::Track(const PipelineBuildScheduler& scheduler) {
+	assert(!job_);
+	shaders_.clear();
+	pipelines_.clear();
+	dirtyShaders_.clear();
+	retryShaders_.clear();
+	for (uint32_t shader = 0; shader < scheduler.GetShaderCount(); shader++) {
+		TrackedShader& tracked = shaders_.emplace_back();
+		tracked.request = scheduler.GetShaderRequest(shader);
+		tracked.bytecode = scheduler.GetBytecode(shader);
+		tracked.dependencies = backend_.getDependencies(tracked.request);
+	}
+	for (uint32_t pipeline = 0; pipeline < scheduler.GetPipelineCount(); pipeline++) {
+		pipelines_.push_back({ pipeline, scheduler.GetPipelineShaders(pipeline) });
+	}
+	RebuildWatchList();
+}
+
+void ShaderHotReloader::RebuildWatchList() {
+	dependents_.clear();
+	for (uint32_t shader = 0; shader < shaders_.size(); shader++) {
+		for (const std::string& path : shaders_[shader].dependencies) {
+			dependents_[path].push_back(shader);
+		}
+	}
+	// 前から監視していたファイルは前回の状態のまま（間の変更を見逃さない）、新しいファイルは今の状態から監視する
+	std::unordered_map<std::string, ShaderFileStamp> stamps;
+	for (const auto& [path, shaders] : dependents_) {
+		auto it = stamps_.find(path);
+		stamps[path] = it != stamps_.end() ? it->second : watch_.getStamp(path);
+	}
+	stamps_.swap(stamps);
+	stats_.watchedFileCount = stamps_.size();
+}
+
+bool ShaderHotReloader::Poll(double now) {
+	lastPollTime_ = now;
+	bool changed = false;
+	polled_ = true;
+	stats_.pollCount++;
+	for (auto& [path, stamp] : stamps_) {
+		const ShaderFileStamp current = watch_.getStamp(path);
+		if (current == stamp) {
+			continue;
+		}
+		stamp = current;
+		changed = true;
+		stats_.changeCount++;
+		lastChangeTime_ = now;
+		for (uint32_t shader : dependents_[path]) {
+			if (std::find(dirtyShaders_.begin(), dirtyShaders_.end(), shader) == dirtyShaders_.end()) {
+				dirtyShaders_.push_back(shader);
+			}
+		}
+	}
+	return changed;
+}
+
+ShaderReloadStatus ShaderHotReloader::Update() {
+	ShaderReloadStatus status = ShaderReloadStatus::None;
+
+	// 終わった回を差し替える（バックグラウンドは終わっているので、job_はもう触られない）
+	bool finished = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		finished = job_ && job_->finished;
+	}
+	if (finished) {
+		if (job_->succeeded) {
+			for (uint32_t pipeline : job_->pipelines) {
+				backend_.swapPipeline(pipeline);
+			}
+			for (size_t i = 0; i < job_->shaders.size(); i++) {
+				TrackedShader& shader = shaders_[job_->shaders[i]];
+				shader.bytecode = std::move(job_->bytecode[i]);
+				// インクルードが増えたり減ったりしているかもしれない
+				shader.dependencies = backend_.getDependencies(shader.request);
+			}
+			RebuildWatchList();
+			lastErrors_.clear();
+			stats_.reloadCount++;
+			stats_.swappedPipelineCount += job_->pipelines.size();
+			status = ShaderReloadStatus::Applied;
+		} else {
+			for (uint32_t pipeline : job_->pipelines) {
+				backend_.discardPipeline(pipeline);
+			}
+			// 失敗した回のシェーダーは、次の変更のときに一緒にコンパイルし直す（直したのが別のファイルでも取りこぼさない）
+			for (uint32_t shader : job_->shaders) {
+				if (std::find(retryShaders_.begin(), retryShaders_.end(), shader) == retryShaders_.end()) {
+					retryShaders_.push_back(shader);
+				}
+			}
+			lastErrors_ = job_->errors;
+			stats_.failedCount++;
+			status = ShaderReloadStatus::Failed;
+		}
+		job_.reset();
+	}
+
+	const double now = watch_.nowMilliseconds();
+	if (polled_ && now - lastPollTime_ < desc_.pollIntervalMilliseconds) {
+		return status;
+	}
+	// 保存が続いている間は待つ（新しい変更が見つからなかった確認でだけ始める）。前の回が終わっていなければ、変更は次の回にまとめる
+	if (!Poll(now) && !job_ && !dirtyShaders_.empty() && now - lastChangeTime_ >= desc_.debounceMilliseconds) {
+		StartReload();
+	}
+	return status;
+}
+
+void ShaderHotReloader::StartReload() {
+	job_ = std::make_unique<ReloadJob>();
+	job_->shaders.swap(dirtyShaders_);
+	job_->shaders.insert(job_->shaders.end(), retryShaders_.begin(), retryShaders_.end());
+	retryShaders_.clear();
+	std::sort(job_->shaders.begin(), job_->shaders.end());
+	job_->shaders.erase(std::unique(job_->shaders.begin(), job_->shaders.end()), job_->shaders.end());
+	stats_.compiledShaderCount += job_->shaders.size();
+	ReloadJob* job = job_.get();
+	worker_.Submit([this, job]() { RunReload(*job); });
+}
+
+void ShaderHotReloader::RunReload(ReloadJob& job) {
+	// バックグラウンドのスレッド。shaders_・pipelines_はjob_がある間は変わらないので読むだけならよい
+	job.bytecode.resize(job.shaders.size());
+	bool succeeded = true;
+	for (size_t i = 0; i < job.shaders.size() && succeeded; i++) {
+		const TrackedShader& shader = shaders_[job.shaders[i]];
+		std::string errors;
+		if (!backend_.compileShader(shader.request, job.bytecode[i], errors) || job.bytecode[i].empty()) {
+			job.errors = shader.request.sourcePath + " (" + shader.request.profile + "):\n" + errors;
+			succeeded = false;
+		}
+	}
+
+	// コンパイルし直したシェーダーを使うPSOだけを作り直す
+	for (const TrackedPipeline& pipeline : pipelines_) {
+		if (!succeeded) {
+			break;
+		}
+		std::vector<const std::vector<uint8_t>*> bytecode;
+		bool affected = false;
+		for (uint32_t shader : pipeline.shaders) {
+			auto it = std::find(job.shaders.begin(), job.shaders.end(), shader);
+			if (it != job.shaders.end()) {
+				bytecode.push_back(&job.bytecode[it - job.shaders.begin()]);
+				affected = true;
+			} else {
+				bytecode.push_back(&shaders_[shader].bytecode);
+			}
+		}
+		if (!affected) {
+			continue;
+		}
+		if (backend_.createPipeline(pipeline.id, bytecode)) {
+			job.pipelines.push_back(pipeline.id);
+		} else {
+			job.errors = "failed to create pipeline " + std::to_string(pipeline.id);
+			succeeded = false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	job.succeeded = succeeded;
+	job.finished = true;
+}
+
+void ShaderHotReloader::WaitIdle() {
+	worker_.WaitIdle();
+}
+
+bool ShaderHotReloader::IsReloading() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return job_ && !job_->finished;
+}
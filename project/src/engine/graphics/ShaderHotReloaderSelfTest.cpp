@@ -0,0 +1,246 @@
+#include "engine/graphics/ShaderHotReloader.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// メモリ上の偽のファイル（書くたびに更新時刻が1つ進む）と、フレームごとに進める時計
+struct FakeShaderFiles {
+	std::mutex mutex; // コンパイルはバックグラウンドのスレッドから読む
+	std::map<std::string, std::string> contents;
+	std::map<std::string, int64_t> writeTimes;
+	int64_t tick = 0;
+	double now = 0.0;
+
+	void Write(const std::string& path, const std::string& text) {
+		std::lock_guard<std::mutex> lock(mutex);
+		contents[path] = text;
+		writeTimes[path] = ++tick;
+	}
+	void Remove(const std::string& path) {
+		std::lock_guard<std::mutex> lock(mutex);
+		contents.erase(path);
+	}
+	// 「#include name」をshaders/nameから読んで展開する。「ERROR」の行があれば失敗（mutexを持って呼ぶ）
+	bool Expand(const std::string& path, std::string& text, std::vector<std::string>& dependencies, std::string& errors) const {
+		auto it = contents.find(path);
+		if (it == contents.end()) {
+			errors = "cannot open " + path;
+			return false;
+		}
+		std::istringstream stream(it->second);
+		std::string line;
+		while (std::getline(stream, line)) {
+			if (line.rfind("#include ", 0) == 0) {
+				const std::string include = "shaders/" + line.substr(9);
+				dependencies.push_back(include);
+				if (!Expand(include, text, dependencies, errors)) {
+					return false;
+				}
+			} else if (line == "ERROR") {
+				errors = path + ": syntax error";
+				return false;
+			} else {
+				text += line + "\n";
+			}
+		}
+		return true;
+	}
+};
+
+bool Contains(const std::string& text, const std::string& part) {
+	return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunShaderHotReloaderSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	FakeShaderFiles files;
+	files.Write("shaders/A.VS.hlsl", "vs\n");
+	files.Write("shaders/A.PS.hlsl", "#include common.hlsli\nps\n");
+	files.Write("shaders/B.PS.hlsl", "#include common.hlsli\nps b\n");
+	files.Write("shaders/common.hlsli", "common 1\n");
+	files.Write("shaders/extra.hlsli", "extra 1\n");
+
+	// 偽のコンパイラ: インクルードを展開したテキストをバイトコードにし、読んだファイルを覚えておく（ShaderCacheの代わり）
+	std::map<std::string, std::vector<std::string>> dependencies;
+	auto compile = [&files, &dependencies](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) {
+		std::lock_guard<std::mutex> lock(files.mutex);
+		std::string text;
+		std::vector<std::string> read = { request.sourcePath };
+		if (!files.Expand(request.sourcePath, text, read, errors)) {
+			return false;
+		}
+		dependencies[request.sourcePath] = read;
+		bytecode.assign(text.begin(), text.end());
+		return true;
+	};
+	// PSOの代わりに、シェーダーのテキストを繋げたものを持つ
+	std::mutex pipelineMutex;
+	std::map<uint32_t, std::string> livePipelines;
+	std::map<uint32_t, std::string> pendingPipelines;
+	auto makePipeline = [](const std::vector<const std::vector<uint8_t>*>& shaders) {
+		std::string pipeline;
+		for (const std::vector<uint8_t>* shader : shaders) {
+			pipeline.append(shader->begin(), shader->end());
+			pipeline += '|';
+		}
+		return pipeline;
+	};
+
+	// 起動時のビルド（A = A.VS + A.PS、B = A.VS + B.PS）
+	PipelineBuildScheduler scheduler;
+	const PipelineBuildScheduler::ShaderId vertex = scheduler.AddShader({ "shaders/A.VS.hlsl", "vs_6_0", "main", {} });
+	const PipelineBuildScheduler::ShaderId pixelA = scheduler.AddShader({ "shaders/A.PS.hlsl", "ps_6_0", "main", {} });
+	const PipelineBuildScheduler::ShaderId pixelB = scheduler.AddShader({ "shaders/B.PS.hlsl", "ps_6_0", "main", {} });
+	scheduler.AddPipeline("A", { vertex, pixelA });
+	scheduler.AddPipeline("B", { vertex, pixelB });
+	PipelineBuildBackend buildBackend;
+	buildBackend.compileShader = [&compile](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) {
+		std::string errors;
+		return compile(request, bytecode, errors);
+	};
+	buildBackend.createPipeline = [&](uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders) {
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		livePipelines[pipeline] = makePipeline(shaders);
+		return true;
+	};
+	{
+		ThreadPool threadPool(2);
+		scheduler.Build(threadPool, buildBackend);
+	}
+
+	bool failPipelineB = false;
+	size_t swapCount = 0;
+	size_t discardCount = 0;
+	ShaderReloadBackend reloadBackend;
+	reloadBackend.compileShader = compile;
+	reloadBackend.createPipeline = [&](uint32_t pipeline, const std::vector<const std::vector<uint8_t>*>& shaders) {
+		if (failPipelineB && pipeline == 1) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		pendingPipelines[pipeline] = makePipeline(shaders);
+		return true;
+	};
+	reloadBackend.swapPipeline = [&](uint32_t pipeline) {
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		livePipelines[pipeline] = pendingPipelines[pipeline];
+		pendingPipelines.erase(pipeline);
+		swapCount++;
+	};
+	reloadBackend.discardPipeline = [&](uint32_t pipeline) {
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		pendingPipelines.erase(pipeline);
+		discardCount++;
+	};
+	reloadBackend.getDependencies = [&](const ShaderCompileRequest& request) {
+		std::lock_guard<std::mutex> lock(files.mutex);
+		const std::vector<std::string>& read = dependencies[request.sourcePath];
+		const std::set<std::string> unique(read.begin(), read.end());
+		return std::vector<std::string>(unique.begin(), unique.end());
+	};
+	ShaderWatchBackend watchBackend;
+	watchBackend.getStamp = [&files](const std::string& path) {
+		std::lock_guard<std::mutex> lock(files.mutex);
+		ShaderFileStamp stamp;
+		auto it = files.contents.find(path);
+		if (it != files.contents.end()) {
+			stamp.exists = true;
+			stamp.size = it->second.size();
+			stamp.writeTime = files.writeTimes[path];
+		}
+		return stamp;
+	};
+	watchBackend.nowMilliseconds = [&files]() { return files.now; };
+
+	ShaderHotReloadDesc desc;
+	desc.pollIntervalMilliseconds = 250.0;
+	desc.debounceMilliseconds = 200.0;
+	ShaderHotReloader reloader(desc, watchBackend, reloadBackend);
+	reloader.Track(scheduler);
+	const ShaderHotReloadStats& stats = reloader.GetStats();
+
+	// 16msずつフレームを進め、None以外の最後の結果を返す（バックグラウンドの処理はフレームごとに終わらせる）
+	auto runFrames = [&](uint32_t frameCount) {
+		ShaderReloadStatus last = ShaderReloadStatus::None;
+		for (uint32_t frame = 0; frame < frameCount; ++frame) {
+			files.now += 16.0;
+			const ShaderReloadStatus status = reloader.Update();
+			if (status != ShaderReloadStatus::None) {
+				last = status;
+			}
+			reloader.WaitIdle();
+		}
+		return last;
+	};
+	auto live = [&](uint32_t pipeline) {
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		return livePipelines[pipeline];
+	};
+
+	const bool idle = runFrames(60) == ShaderReloadStatus::None && stats.reloadCount == 0 && stats.watchedFileCount == 4;
+	AddSelfTestResult(results, "shader hot reload watches sources and includes without reloading", idle,
+		"watched " + std::to_string(stats.watchedFileCount));
+
+	// インクルードだけを変えると、それを使う2つのシェーダーと2つのPSOが差し替わる
+	files.Write("shaders/common.hlsli", "common 2\n");
+	const bool includeReloaded = runFrames(60) == ShaderReloadStatus::Applied && stats.reloadCount == 1 &&
+		stats.compiledShaderCount == 2 && swapCount == 2 && Contains(live(0), "common 2") && Contains(live(1), "common 2");
+	AddSelfTestResult(results, "shader hot reload recompiles dependents of a changed include", includeReloaded,
+		"compiled " + std::to_string(stats.compiledShaderCount) + ", swapped " + std::to_string(swapCount));
+
+	// 保存が続いている間は待ち、落ち着いてから1回だけ（続けて5回保存しても増えるのは1回）
+	const size_t reloadsBeforeBurst = stats.reloadCount;
+	for (uint32_t i = 0; i < 5; ++i) {
+		files.Write("shaders/A.VS.hlsl", "vs " + std::to_string(i) + "\n");
+		runFrames(6);
+	}
+	const bool waited = stats.reloadCount == reloadsBeforeBurst;
+	runFrames(60);
+	const size_t burstReloads = stats.reloadCount - reloadsBeforeBurst;
+	AddSelfTestResult(results, "shader hot reload debounces repeated saves",
+		waited && burstReloads == 1 && Contains(live(0), "vs 4"), "reloads during burst " + std::to_string(burstReloads));
+
+	// コンパイルエラーなら前のPSOのまま
+	const std::string beforeError = live(0);
+	files.Write("shaders/A.PS.hlsl", "#include common.hlsli\nERROR\n");
+	const bool compileFailed = runFrames(60) == ShaderReloadStatus::Failed && live(0) == beforeError && stats.failedCount == 1 &&
+		Contains(reloader.GetLastErrors(), "syntax error");
+	AddSelfTestResult(results, "shader hot reload keeps the old pipeline on compile errors", compileFailed, reloader.GetLastErrors());
+
+	// 直すと差し替わり、新しくインクルードしたファイルも監視する
+	files.Write("shaders/A.PS.hlsl", "#include common.hlsli\n#include extra.hlsli\nps 2\n");
+	const bool fixed = runFrames(60) == ShaderReloadStatus::Applied && Contains(live(0), "extra 1");
+	files.Write("shaders/extra.hlsli", "extra 2\n");
+	const bool newInclude = runFrames(60) == ShaderReloadStatus::Applied && Contains(live(0), "extra 2") && stats.watchedFileCount == 5;
+	AddSelfTestResult(results, "shader hot reload watches newly included files", fixed && newInclude,
+		"watched " + std::to_string(stats.watchedFileCount));
+
+	// PSOが1つでも作れなければ、作れた分も捨てて何も差し替えない
+	failPipelineB = true;
+	const size_t discardsBefore = discardCount;
+	const std::string beforePipelineB = live(1);
+	files.Write("shaders/A.VS.hlsl", "vs 9\n");
+	const bool pipelineFailed = runFrames(60) == ShaderReloadStatus::Failed && discardCount == discardsBefore + 1 &&
+		!Contains(live(0), "vs 9") && live(1) == beforePipelineB && pendingPipelines.empty();
+	failPipelineB = false;
+	AddSelfTestResult(results, "shader hot reload discards every pipeline when one fails", pipelineFailed,
+		"discarded " + std::to_string(discardCount - discardsBefore));
+
+	// 消えたインクルードは失敗、戻せば前に失敗した分も含めて差し替わる
+	files.Remove("shaders/common.hlsli");
+	const bool missingFailed = runFrames(60) == ShaderReloadStatus::Failed;
+	files.Write("shaders/common.hlsli", "common 3\n");
+	const bool restored = runFrames(60) == ShaderReloadStatus::Applied && Contains(live(0), "vs 9") && Contains(live(1), "common 3");
+	AddSelfTestResult(results, "shader hot reload recovers after a missing include returns", missingFailed && restored);
+
+	return results;
+}
@@ -0,0 +1,121 @@
+#include "engine/graphics/ShaderPermutation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+namespace {
+
+// キーの表（1 << キーのビット数）が大きくなりすぎないように
+constexpr uint32_t kMaxTableBits = 16;
+
+uint32_t BitsFor(uint32_t valueCount) {
+	uint32_t bits = 0;
+	while ((1u << bits) < valueCount) {
+		bits++;
+	}
+	return std::max(bits, 1u);
+}
+
+} // namespace
+
+ShaderPermutationSet::ShaderPermutationSet(const ShaderPermutationManifest& manifest) : manifest_(manifest) {
+	keywordBits_.reserve(manifest_.keywords.size());
+	for (const ShaderKeyword& keyword : manifest_.keywords) {
+		assert(keyword.valueCount >= 1);
+		const uint32_t bits = BitsFor(keyword.valueCount);
+		keywordBits_.push_back({ keyBits_, bits });
+		keyBits_ += bits;
+	}
+	assert(keyBits_ <= kMaxTableBits);
+	for (const ShaderPermutationStage& stage : manifest_.stages) {
+		for (const std::string& keyword : stage.keywords) {
+			assert(FindKeyword(keyword) >= 0); // マニフェストに無いキーワード
+			(void)keyword;
+		}
+	}
+	report_.keywordCount = manifest_.keywords.size();
+}
+
+int32_t ShaderPermutationSet::FindKeyword(const std::string& define) const {
+	for (size_t i = 0; i < manifest_.keywords.size(); i++) {
+		if (manifest_.keywords[i].define == define) {
+			return int32_t(i);
+		}
+	}
+	return -1;
+}
+
+ShaderPermutationKey ShaderPermutationSet::SetKeyword(ShaderPermutationKey key, uint32_t keyword, uint32_t value) const {
+	assert(keyword < keywordBits_.size() && value < manifest_.keywords[keyword].valueCount);
+	const KeywordBits& field = keywordBits_[keyword];
+	const uint32_t mask = ((1u << field.bits) - 1) << field.shift;
+	return (key & ~mask) | ((value << field.shift) & mask);
+}
+
+uint32_t ShaderPermutationSet::GetKeyword(ShaderPermutationKey key, uint32_t keyword) const {
+	assert(keyword < keywordBits_.size());
+	const KeywordBits& field = keywordBits_[keyword];
+	return (key >> field.shift) & ((1u << field.bits) - 1);
+}
+
+bool ShaderPermutationSet::IsValidKey(ShaderPermutationKey key) const {
+	if (key >> keyBits_) {
+		return false;
+	}
+	for (uint32_t keyword = 0; keyword < keywordBits_.size(); keyword++) {
+		if (GetKeyword(key, keyword) >= manifest_.keywords[keyword].valueCount) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ShaderPermutationSet::Register(PipelineBuildScheduler& scheduler, const std::vector<std::string>& arguments) {
+	const uint32_t keyCount = 1u << keyBits_;
+	pipelines_.assign(keyCount, kInvalidPipeline);
+	report_.permutationCount = 0;
+	report_.pipelineCount = 0;
+	const size_t firstShader = scheduler.GetShaderCount();
+
+	// シェーダーの組が同じパーミュテーションは同じPSOを使う
+	std::map<std::vector<PipelineBuildScheduler::ShaderId>, uint32_t> pipelineByShaders;
+	for (ShaderPermutationKey key = 0; key < keyCount; key++) {
+		if (!IsValidKey(key)) {
+			continue;
+		}
+		report_.permutationCount++;
+
+		std::vector<PipelineBuildScheduler::ShaderId> shaders;
+		shaders.reserve(manifest_.stages.size());
+		for (const ShaderPermutationStage& stage : manifest_.stages) {
+			ShaderCompileRequest request{ stage.sourcePath, stage.profile, "main", arguments };
+			// defineはマニフェストのキーワードの順に並べる（同じ組み合わせが同じ引数になるように）
+			for (uint32_t keyword = 0; keyword < manifest_.keywords.size(); keyword++) {
+				const std::string& define = manifest_.keywords[keyword].define;
+				if (std::find(stage.keywords.begin(), stage.keywords.end(), define) != stage.keywords.end()) {
+					request.arguments.push_back("-D");
+					request.arguments.push_back(define + "=" + std::to_string(GetKeyword(key, keyword)));
+				}
+			}
+			shaders.push_back(scheduler.AddShader(request));
+		}
+
+		auto it = pipelineByShaders.find(shaders);
+		if (it == pipelineByShaders.end()) {
+			std::string name = manifest_.name;
+			for (uint32_t keyword = 0; keyword < manifest_.keywords.size(); keyword++) {
+				name += (keyword == 0 ? " [" : " ") + manifest_.keywords[keyword].define + "=" + std::to_string(GetKeyword(key, keyword));
+			}
+			name += manifest_.keywords.empty() ? "" : "]";
+			it = pipelineByShaders.emplace(shaders, scheduler.AddPipeline(name, shaders)).first;
+			report_.pipelineCount++;
+		}
+		pipelines_[key] = it->second;
+	}
+	report_.shaderCount = scheduler.GetShaderCount() - firstShader;
+}
+
+uint32_t ShaderPermutationSet::GetPipeline(ShaderPermutationKey key) const {
+	return key < pipelines_.size() ? pipelines_[key] : kInvalidPipeline;
+}
@@ -0,0 +1,143 @@
+#include "engine/graphics/ShaderPermutation.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// mainのObject3dと同じ形（LIGHTING_MODEは3値でPSだけ、HAS_UVは両方）に、どのステージも使わないDEBUG_VIEWを足したもの
+ShaderPermutationManifest MakeSelfTestManifest() {
+	return {
+		"Object3d",
+		{
+			{ "LIGHTING_MODE", 3 },
+			{ "HAS_UV", 2 },
+			{ "DEBUG_VIEW", 2 },
+		},
+		{
+			{ "shaders/Object3d.VS.hlsl", "vs_6_0", { "HAS_UV" } },
+			{ "shaders/Object3d.PS.hlsl", "ps_6_0", { "LIGHTING_MODE", "HAS_UV" } },
+		},
+	};
+}
+
+bool AllPipelinesReady(const PipelineBuildScheduler& scheduler) {
+	for (PipelineBuildScheduler::PipelineId pipeline = 0; pipeline < scheduler.GetPipelineCount(); ++pipeline) {
+		if (!scheduler.IsPipelineReady(pipeline)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunShaderPermutationSelfTest() {
+	std::vector<SelfTestResult> results;
+	ThreadPool threadPool(4);
+	const ShaderPermutationSet permutations(MakeSelfTestManifest());
+	const uint32_t lightingMode = uint32_t(permutations.FindKeyword("LIGHTING_MODE"));
+	const uint32_t hasUV = uint32_t(permutations.FindKeyword("HAS_UV"));
+	const uint32_t debugView = uint32_t(permutations.FindKeyword("DEBUG_VIEW"));
+
+	{
+		// キーワードはマニフェストの順に下のビットから詰める（LIGHTING_MODEが2ビット、残りが1ビットずつ）
+		// 1つを書き換えても他のキーワードの値は変わらない
+		bool roundTrip = true;
+		for (uint32_t lighting = 0; lighting < 3; ++lighting) {
+			for (uint32_t uv = 0; uv < 2; ++uv) {
+				for (uint32_t debug = 0; debug < 2; ++debug) {
+					ShaderPermutationKey key = permutations.SetKeyword(0x7, lightingMode, lighting);
+					key = permutations.SetKeyword(key, hasUV, uv);
+					key = permutations.SetKeyword(key, debugView, debug);
+					roundTrip = roundTrip && key == (lighting | uv << 2 | debug << 3) &&
+						permutations.GetKeyword(key, lightingMode) == lighting && permutations.GetKeyword(key, hasUV) == uv &&
+						permutations.GetKeyword(key, debugView) == debug;
+				}
+			}
+		}
+		AddSelfTestResult(results, "shader permutation packs keywords into the key",
+			roundTrip && lightingMode == 0 && hasUV == 1 && debugView == 2 && permutations.FindKeyword("MISSING") == -1);
+	}
+
+	{
+		// LIGHTING_MODE=3（2ビットに入るが範囲外）と、使っていない上のビットが立ったキーは無効
+		size_t validCount = 0;
+		for (ShaderPermutationKey key = 0; key < 16; ++key) {
+			validCount += permutations.IsValidKey(key);
+		}
+		AddSelfTestResult(results, "shader permutation rejects out-of-range keys",
+			validCount == 12 && !permutations.IsValidKey(0x3) && !permutations.IsValidKey(0xB) && !permutations.IsValidKey(0x10) &&
+			permutations.IsValidKey(0xE), "valid " + std::to_string(validCount) + " of 16");
+	}
+
+	{
+		// 組み合わせは3×2×2=12。VSはHAS_UVの2つ、PSはLIGHTING_MODEとHAS_UVの6つ
+		// DEBUG_VIEWはどのステージも使わないので、それだけが違うパーミュテーションは同じPSOを使う
+		ShaderPermutationSet set(MakeSelfTestManifest());
+		PipelineBuildScheduler scheduler;
+		const bool unregistered = set.GetPipeline(0) == ShaderPermutationSet::kInvalidPipeline;
+		set.Register(scheduler, { "-Od" });
+		const ShaderPermutationReport& report = set.GetReport();
+		AddSelfTestResult(results, "shader permutation report counts",
+			report.keywordCount == 3 && report.permutationCount == 12 && report.shaderCount == 8 && report.pipelineCount == 6 &&
+			scheduler.GetShaderCount() == 8 && scheduler.GetPipelineCount() == 6,
+			std::to_string(report.permutationCount) + " permutations, " + std::to_string(report.shaderCount) + " shaders, " +
+			std::to_string(report.pipelineCount) + " pipelines");
+
+		bool shared = unregistered && set.GetPipeline(0x3) == ShaderPermutationSet::kInvalidPipeline &&
+			set.GetPipeline(0x10) == ShaderPermutationSet::kInvalidPipeline;
+		for (ShaderPermutationKey key = 0; key < 8; ++key) {
+			if (!set.IsValidKey(key)) {
+				continue;
+			}
+			const ShaderPermutationKey debugKey = set.SetKeyword(key, debugView, 1);
+			// VSはLIGHTING_MODEが違っても共有する
+			const ShaderPermutationKey otherLighting = set.SetKeyword(key, lightingMode, (set.GetKeyword(key, lightingMode) + 1) % 3);
+			const std::vector<PipelineBuildScheduler::ShaderId>& shaders = scheduler.GetPipelineShaders(set.GetPipeline(key));
+			const std::vector<PipelineBuildScheduler::ShaderId>& otherShaders = scheduler.GetPipelineShaders(set.GetPipeline(otherLighting));
+			shared = shared && set.GetPipeline(key) != ShaderPermutationSet::kInvalidPipeline && set.GetPipeline(debugKey) == set.GetPipeline(key) &&
+				set.GetPipeline(otherLighting) != set.GetPipeline(key) && shaders[0] == otherShaders[0] && shaders[1] != otherShaders[1];
+		}
+		auto log = std::make_shared<MockPipelineBuildLog>();
+		const PipelineBuildReport buildReport = scheduler.Build(threadPool, CreateMockPipelineBuildBackend(log));
+		AddSelfTestResult(results, "shader permutation shares pipelines across unused keywords",
+			shared && log->compileCount == 8 && log->pipelineCount == 6 && buildReport.failedPipelineCount == 0 && AllPipelinesReady(scheduler),
+			"compiles " + std::to_string(log->compileCount) + ", pipelines " + std::to_string(log->pipelineCount));
+	}
+
+	{
+		// LIGHTING_MODE=2がコンパイラの中で1と全く同じバイトコードになれば、PSもPSOも先の方を使う
+		ShaderPermutationSet set(MakeSelfTestManifest());
+		PipelineBuildScheduler scheduler;
+		set.Register(scheduler, { "-Od" });
+		auto log = std::make_shared<MockPipelineBuildLog>();
+		PipelineBuildBackend backend = CreateMockPipelineBuildBackend(log);
+		backend.compileShader = [compile = backend.compileShader](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode) {
+			ShaderCompileRequest same = request;
+			for (std::string& argument : same.arguments) {
+				if (argument == "LIGHTING_MODE=2") {
+					argument = "LIGHTING_MODE=1";
+				}
+			}
+			return compile(same, bytecode);
+		};
+		const PipelineBuildReport report = scheduler.Build(threadPool, backend);
+		bool merged = true;
+		for (uint32_t uv = 0; uv < 2; ++uv) {
+			const ShaderPermutationKey lambert = set.SetKeyword(set.SetKeyword(0, lightingMode, 1), hasUV, uv);
+			const ShaderPermutationKey halfLambert = set.SetKeyword(lambert, lightingMode, 2);
+			const PipelineBuildScheduler::PipelineId first = scheduler.GetPipelineSource(set.GetPipeline(lambert));
+			const PipelineBuildScheduler::PipelineId second = scheduler.GetPipelineSource(set.GetPipeline(halfLambert));
+			merged = merged && first == second && (first == set.GetPipeline(lambert) || first == set.GetPipeline(halfLambert)) &&
+				scheduler.GetBytecode(scheduler.GetPipelineShaders(set.GetPipeline(lambert))[1]) ==
+				scheduler.GetBytecode(scheduler.GetPipelineShaders(set.GetPipeline(halfLambert))[1]);
+		}
+		AddSelfTestResult(results, "shader permutation merges identical bytecode and pipelines",
+			merged && report.duplicateShaderCount == 2 && report.duplicatePipelineCount == 2 && log->pipelineCount == 4 && AllPipelinesReady(scheduler),
+			"duplicate shaders " + std::to_string(report.duplicateShaderCount) + ", pipelines " + std::to_string(report.duplicatePipelineCount));
+	}
+
+	return results;
+}
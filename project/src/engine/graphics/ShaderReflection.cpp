@@ -0,0 +1,414 @@
+#include "engine/graphics/ShaderReflection.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+constexpr const char* kReflectionHeader = "# CG2 shader reflection v1";
+
+const char* GetStageName(ShaderStage stage) {
+	switch (stage) {
+	case ShaderStage::Vertex: return "vertex";
+	case ShaderStage::Pixel: return "pixel";
+	}
+	return "";
+}
+
+const char* GetBindingKindName(ShaderBindingKind kind) {
+	switch (kind) {
+	case ShaderBindingKind::ConstantBuffer: return "cbuffer";
+	case ShaderBindingKind::ShaderResource: return "srv";
+	case ShaderBindingKind::UnorderedAccess: return "uav";
+	case ShaderBindingKind::Sampler: return "sampler";
+	}
+	return "";
+}
+
+// b0、t1のようなレジスタの書き方（メッセージ用）
+std::string GetRegisterName(ShaderBindingKind kind, uint32_t shaderRegister, uint32_t space) {
+	static const char kPrefixes[] = { 'b', 't', 'u', 's' };
+	std::string name = kPrefixes[uint32_t(kind)] + std::to_string(shaderRegister);
+	if (space != 0) {
+		name += ", space" + std::to_string(space);
+	}
+	return name;
+}
+
+uint32_t GetStageMask(ShaderStage stage) {
+	return 1u << uint32_t(stage);
+}
+
+// 2つ以上のステージが使うパラメータはALLから見える
+bool IsVisibleFrom(uint32_t stageMask, ShaderStage stage) {
+	return (stageMask & (stageMask - 1)) != 0 || (stageMask & GetStageMask(stage)) != 0;
+}
+
+bool ParseUint(const std::string& text, uint32_t& value) {
+	if (text.empty()) {
+		return false;
+	}
+	char* end = nullptr;
+	const unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+	if (*end != '\0' || parsed > UINT32_MAX || text[0] == '-') {
+		return false;
+	}
+	value = uint32_t(parsed);
+	return true;
+}
+
+std::vector<std::string> SplitTabs(const std::string& line) {
+	std::vector<std::string> fields;
+	std::istringstream stream(line);
+	std::string field;
+	while (std::getline(stream, field, '\t')) {
+		fields.push_back(field);
+	}
+	return fields;
+}
+
+void AppendError(std::string* errors, const std::string& message) {
+	if (errors) {
+		*errors += message;
+		*errors += '\n';
+	}
+}
+
+// 同じレジスタの使い方をステージをまたいでまとめたもの
+struct MergedBinding {
+	ShaderBinding binding;
+	uint32_t stageMask = 0;
+};
+
+uint32_t GetKindRank(RootParameterKind kind) {
+	switch (kind) {
+	case RootParameterKind::Constants: return 0;
+	case RootParameterKind::ConstantBufferView: return 1;
+	case RootParameterKind::DescriptorTable: return 2;
+	}
+	return 3;
+}
+
+} // namespace
+
+bool GetShaderStageFromProfile(const std::string& profile, ShaderStage& stage) {
+	if (profile.rfind("vs_", 0) == 0) {
+		stage = ShaderStage::Vertex;
+		return true;
+	}
+	if (profile.rfind("ps_", 0) == 0) {
+		stage = ShaderStage::Pixel;
+		return true;
+	}
+	return false;
+}
+
+std::string SerializeShaderReflection(const ShaderReflectionData& reflection) {
+	std::ostringstream stream;
+	stream << kReflectionHeader << '\n';
+	stream << "stage\t" << GetStageName(reflection.stage) << '\n';
+	// binding 種類 名前 レジスタ スペース 数 大きさ、cbufferの変数はその後ろに variable 名前 オフセット 大きさ
+	for (const ShaderBinding& binding : reflection.bindings) {
+		stream << "binding\t" << GetBindingKindName(binding.kind) << '\t' << binding.name << '\t' << binding.shaderRegister << '\t'
+			<< binding.space << '\t' << binding.count << '\t' << binding.size << '\n';
+		for (const ShaderConstantVariable& variable : binding.variables) {
+			stream << "variable\t" << variable.name << '\t' << variable.offset << '\t' << variable.size << '\n';
+		}
+	}
+	return stream.str();
+}
+
+bool ParseShaderReflection(const std::string& text, ShaderReflectionData& reflection, std::string* errors) {
+	reflection = {};
+	std::istringstream stream(text);
+	std::string line;
+	if (!std::getline(stream, line) || line != kReflectionHeader) {
+		AppendError(errors, "line 1: not a shader reflection dump");
+		return false;
+	}
+	bool hasStage = false;
+	size_t lineNumber = 1;
+	while (std::getline(stream, line)) {
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty()) {
+			continue;
+		}
+		const std::vector<std::string> fields = SplitTabs(line);
+		bool valid = false;
+		if (fields[0] == "stage" && fields.size() == 2) {
+			valid = true;
+			if (fields[1] == GetStageName(ShaderStage::Vertex)) {
+				reflection.stage = ShaderStage::Vertex;
+			} else if (fields[1] == GetStageName(ShaderStage::Pixel)) {
+				reflection.stage = ShaderStage::Pixel;
+			} else {
+				valid = false;
+			}
+			hasStage = valid;
+		} else if (fields[0] == "binding" && fields.size() == 7) {
+			ShaderBinding binding;
+			binding.name = fields[2];
+			valid = false;
+			for (uint32_t kind = 0; kind <= uint32_t(ShaderBindingKind::Sampler); kind++) {
+				if (fields[1] == GetBindingKindName(ShaderBindingKind(kind))) {
+					binding.kind = ShaderBindingKind(kind);
+					valid = true;
+				}
+			}
+			valid = valid && !binding.name.empty() && ParseUint(fields[3], binding.shaderRegister) && ParseUint(fields[4], binding.space) &&
+				ParseUint(fields[5], binding.count) && ParseUint(fields[6], binding.size);
+			if (valid) {
+				reflection.bindings.push_back(std::move(binding));
+			}
+		} else if (fields[0] == "variable" && fields.size() == 4) {
+			// 直前のcbufferの変数
+			ShaderConstantVariable variable;
+			variable.name = fields[1];
+			valid = !reflection.bindings.empty() && reflection.bindings.back().kind == ShaderBindingKind::ConstantBuffer &&
+				!variable.name.empty() && ParseUint(fields[2], variable.offset) && ParseUint(fields[3], variable.size);
+			if (valid) {
+				reflection.bindings.back().variables.push_back(std::move(variable));
+			}
+		}
+		if (!valid) {
+			AppendError(errors, "line " + std::to_string(lineNumber) + ": cannot parse \"" + line + "\"");
+			return false;
+		}
+	}
+	if (!hasStage) {
+		AppendError(errors, "no stage");
+		return false;
+	}
+	return true;
+}
+
+const ShaderBinding* FindShaderBinding(const ShaderReflectionData& reflection, ShaderBindingKind kind, const std::string& name) {
+	for (const ShaderBinding& binding : reflection.bindings) {
+		if (binding.kind == kind && binding.name == name) {
+			return &binding;
+		}
+	}
+	return nullptr;
+}
+
+bool BuildRootSignatureLayout(const std::vector<const ShaderReflectionData*>& shaders, const RootSignatureLayoutDesc& desc,
+	RootSignatureLayout& layout, std::string* errors) {
+	layout = {};
+	bool succeeded = true;
+
+	// 同じ種類・レジスタ・スペースのものを1つにまとめる
+	std::vector<MergedBinding> merged;
+	for (const ShaderReflectionData* shader : shaders) {
+		for (const ShaderBinding& binding : shader->bindings) {
+			auto it = std::find_if(merged.begin(), merged.end(), [&](const MergedBinding& other) {
+				return other.binding.kind == binding.kind && other.binding.shaderRegister == binding.shaderRegister && other.binding.space == binding.space;
+			});
+			if (it == merged.end()) {
+				// 名前でパラメータを探すので、同じ名前が別のレジスタにあってはいけない
+				auto sameName = std::find_if(merged.begin(), merged.end(), [&](const MergedBinding& other) {
+					return other.binding.kind == binding.kind && other.binding.name == binding.name;
+				});
+				if (sameName != merged.end()) {
+					AppendError(errors, binding.name + " is bound to both " +
+						GetRegisterName(binding.kind, sameName->binding.shaderRegister, sameName->binding.space) + " and " +
+						GetRegisterName(binding.kind, binding.shaderRegister, binding.space));
+					succeeded = false;
+					continue;
+				}
+				merged.push_back({ binding, GetStageMask(shader->stage) });
+				continue;
+			}
+			if (binding.kind == ShaderBindingKind::ConstantBuffer && (binding.size != it->binding.size || binding.variables != it->binding.variables)) {
+				AppendError(errors, GetRegisterName(binding.kind, binding.shaderRegister, binding.space) + ": " + it->binding.name + " (" +
+					std::to_string(it->binding.size) + " bytes) and " + binding.name + " (" + std::to_string(binding.size) +
+					" bytes) have different layouts");
+				succeeded = false;
+				continue;
+			}
+			it->binding.count = std::max(it->binding.count, binding.count);
+			it->stageMask |= GetStageMask(shader->stage);
+		}
+	}
+
+	for (const MergedBinding& entry : merged) {
+		const ShaderBinding& binding = entry.binding;
+		if (binding.kind == ShaderBindingKind::Sampler) {
+			layout.staticSamplers.push_back({ binding.name, binding.shaderRegister, binding.space, entry.stageMask });
+			continue;
+		}
+		RootParameterLayout parameter;
+		parameter.bindingKind = binding.kind;
+		parameter.name = binding.name;
+		parameter.shaderRegister = binding.shaderRegister;
+		parameter.space = binding.space;
+		parameter.stageMask = entry.stageMask;
+		if (binding.kind == ShaderBindingKind::ConstantBuffer && binding.count == 1) {
+			if (binding.size != 0 && binding.size <= desc.maxRootConstantBytes) {
+				// 小さいcbufferはルートシグネチャに直接入れる（CBVのアドレスを介さずに読める）
+				parameter.kind = RootParameterKind::Constants;
+				parameter.count = (binding.size + 3) / 4;
+				parameter.cost = parameter.count;
+			} else {
+				parameter.kind = RootParameterKind::ConstantBufferView;
+				parameter.cost = 2; // GPUアドレス
+			}
+		} else {
+			// SRV/UAVと、配列のcbufferはテーブルから
+			parameter.kind = RootParameterKind::DescriptorTable;
+			parameter.count = binding.count;
+			parameter.cost = 1;
+		}
+		layout.cost += parameter.cost;
+		layout.parameters.push_back(std::move(parameter));
+	}
+
+	// 上限を超えたら、大きいルート定数からCBVに戻す
+	while (layout.cost > desc.maxCost) {
+		auto largest = layout.parameters.end();
+		for (auto it = layout.parameters.begin(); it != layout.parameters.end(); ++it) {
+			if (it->kind == RootParameterKind::Constants && it->cost > 2 && (largest == layout.parameters.end() || it->cost > largest->cost)) {
+				largest = it;
+			}
+		}
+		if (largest == layout.parameters.end()) {
+			AppendError(errors, "root signature needs " + std::to_string(layout.cost) + " DWORDs (limit " + std::to_string(desc.maxCost) + ")");
+			succeeded = false;
+			break;
+		}
+		layout.cost -= largest->cost - 2;
+		largest->kind = RootParameterKind::ConstantBufferView;
+		largest->count = 1;
+		largest->cost = 2;
+	}
+
+	// 指定された名前を先頭に、残りは種類・スペース・レジスタの順
+	for (const std::string& name : desc.order) {
+		if (FindRootParameter(layout, name) < 0) {
+			AppendError(errors, "order: " + name + " is not used by any shader");
+			succeeded = false;
+		}
+	}
+	auto orderRank = [&](const RootParameterLayout& parameter) {
+		auto it = std::find(desc.order.begin(), desc.order.end(), parameter.name);
+		return size_t(it - desc.order.begin());
+	};
+	std::stable_sort(layout.parameters.begin(), layout.parameters.end(), [&](const RootParameterLayout& a, const RootParameterLayout& b) {
+		const size_t rankA = orderRank(a);
+		const size_t rankB = orderRank(b);
+		if (rankA != rankB) {
+			return rankA < rankB;
+		}
+		if (a.kind != b.kind) {
+			return GetKindRank(a.kind) < GetKindRank(b.kind);
+		}
+		if (a.space != b.space) {
+			return a.space < b.space;
+		}
+		if (a.bindingKind != b.bindingKind) {
+			return a.bindingKind < b.bindingKind;
+		}
+		return a.shaderRegister < b.shaderRegister;
+	});
+	std::stable_sort(layout.staticSamplers.begin(), layout.staticSamplers.end(), [](const StaticSamplerLayout& a, const StaticSamplerLayout& b) {
+		return a.space != b.space ? a.space < b.space : a.shaderRegister < b.shaderRegister;
+	});
+	return succeeded;
+}
+
+int32_t FindRootParameter(const RootSignatureLayout& layout, const std::string& name) {
+	for (size_t i = 0; i < layout.parameters.size(); i++) {
+		if (layout.parameters[i].name == name) {
+			return int32_t(i);
+		}
+	}
+	return -1;
+}
+
+bool IsShaderCompatibleWithRootSignature(const ShaderReflectionData& shader, const RootSignatureLayout& layout, std::string* errors) {
+	bool compatible = true;
+	for (const ShaderBinding& binding : shader.bindings) {
+		const std::string registerName = GetRegisterName(binding.kind, binding.shaderRegister, binding.space);
+		if (binding.kind == ShaderBindingKind::Sampler) {
+			auto it = std::find_if(layout.staticSamplers.begin(), layout.staticSamplers.end(), [&](const StaticSamplerLayout& sampler) {
+				return sampler.shaderRegister == binding.shaderRegister && sampler.space == binding.space && IsVisibleFrom(sampler.stageMask, shader.stage);
+			});
+			if (it == layout.staticSamplers.end()) {
+				AppendError(errors, std::string(GetStageName(shader.stage)) + " shader uses " + binding.name + " (" + registerName + ") which has no static sampler");
+				compatible = false;
+			}
+			continue;
+		}
+		auto it = std::find_if(layout.parameters.begin(), layout.parameters.end(), [&](const RootParameterLayout& parameter) {
+			return parameter.bindingKind == binding.kind && parameter.shaderRegister == binding.shaderRegister && parameter.space == binding.space;
+		});
+		if (it == layout.parameters.end() || !IsVisibleFrom(it->stageMask, shader.stage)) {
+			AppendError(errors, std::string(GetStageName(shader.stage)) + " shader uses " + binding.name + " (" + registerName + ") which is not in the root signature");
+			compatible = false;
+			continue;
+		}
+		const bool fits = it->kind == RootParameterKind::Constants ? binding.size <= it->count * 4
+			: it->kind == RootParameterKind::DescriptorTable ? binding.count <= it->count
+			: binding.count == 1;
+		if (!fits) {
+			AppendError(errors, binding.name + " (" + registerName + ") does not fit root parameter " + it->name);
+			compatible = false;
+		}
+	}
+	return compatible;
+}
+
+bool ValidateConstantBufferLayout(const ShaderBinding& constantBuffer, const CppStructLayout& layout, std::string* errors) {
+	bool valid = true;
+	auto fail = [&](const std::string& message) {
+		AppendError(errors, layout.name + " / " + constantBuffer.name + ": " + message);
+		valid = false;
+	};
+	for (const ShaderConstantVariable& variable : constantBuffer.variables) {
+		auto it = std::find_if(layout.fields.begin(), layout.fields.end(), [&](const CppStructField& field) { return field.name == variable.name; });
+		if (it == layout.fields.end()) {
+			fail("no field for " + variable.name + " (offset " + std::to_string(variable.offset) + ", " + std::to_string(variable.size) + " bytes)");
+		} else if (it->offset != variable.offset || it->size != variable.size) {
+			fail(variable.name + " is at offset " + std::to_string(variable.offset) + " (" + std::to_string(variable.size) +
+				" bytes) in HLSL but " + std::to_string(it->offset) + " (" + std::to_string(it->size) + " bytes) in C++");
+		}
+	}
+	// 名前を変えたフィールドを見逃さないように、cbufferに無いフィールドも誤りにする
+	for (const CppStructField& field : layout.fields) {
+		auto it = std::find_if(constantBuffer.variables.begin(), constantBuffer.variables.end(),
+			[&](const ShaderConstantVariable& variable) { return variable.name == field.name; });
+		if (it == constantBuffer.variables.end()) {
+			fail(field.name + " is not in the cbuffer");
+		}
+	}
+	// cbufferの大きさは16バイト単位に切り上げられているので、最後の変数の終わりまであればよい
+	uint32_t usedSize = 0;
+	for (const ShaderConstantVariable& variable : constantBuffer.variables) {
+		usedSize = std::max(usedSize, variable.offset + variable.size);
+	}
+	if (layout.size < usedSize) {
+		fail("struct is " + std::to_string(layout.size) + " bytes but the cbuffer uses " + std::to_string(usedSize) + " bytes");
+	}
+	return valid;
+}
+
+bool ValidateConstantBufferLayouts(const ShaderReflectionData& shader, const std::vector<CppStructLayout>& layouts, std::string* errors) {
+	bool valid = true;
+	for (const ShaderBinding& binding : shader.bindings) {
+		if (binding.kind != ShaderBindingKind::ConstantBuffer) {
+			continue;
+		}
+		auto it = std::find_if(layouts.begin(), layouts.end(), [&](const CppStructLayout& layout) { return layout.constantBuffer == binding.name; });
+		if (it == layouts.end()) {
+			AppendError(errors, binding.name + ": no C++ struct is registered for this cbuffer");
+			valid = false;
+			continue;
+		}
+		valid = ValidateConstantBufferLayout(binding, *it, errors) && valid;
+	}
+	return valid;
+}
@@ -0,0 +1,189 @@
+#include "engine/graphics/ShaderReflection.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Object3dのシェーダー（HAS_UVが1と0）から書き出した反映情報
+const char* const kObject3dVertexDump =
+	"# CG2 shader reflection v1\n"
+	"stage\tvertex\n"
+	"binding\tcbuffer\tTransformCB\t1\t0\t1\t128\n"
+	"variable\tgWVP\t0\t64\n"
+	"variable\tgWorld\t64\t64\n";
+const char* const kObject3dPixelDump =
+	"# CG2 shader reflection v1\n"
+	"stage\tpixel\n"
+	"binding\tcbuffer\tMaterialCB\t0\t0\t1\t96\n"
+	"variable\tgMaterialColor\t0\t16\n"
+	"variable\tgEnableLighting\t16\t4\n"
+	"variable\tpadding\t20\t12\n"
+	"variable\tuvTransform\t32\t64\n"
+	"binding\tsrv\tgTexture\t0\t0\t1\t0\n"
+	"binding\tsampler\tgSampler\t0\t0\t1\t0\n"
+	"binding\tcbuffer\tDirectionalLightCB\t3\t0\t1\t48\n"
+	"variable\tgDirectionalLight.color\t0\t16\n"
+	"variable\tgDirectionalLight.direction\t16\t16\n"
+	"variable\tgDirectionalLight.intensity\t32\t4\n"
+	"variable\tgDirectionalLight.padding\t36\t12\n";
+const char* const kObject3dNoUvPixelDump =
+	"# CG2 shader reflection v1\n"
+	"stage\tpixel\n"
+	"binding\tcbuffer\tMaterialCB\t0\t0\t1\t96\n"
+	"variable\tgMaterialColor\t0\t16\n"
+	"variable\tgEnableLighting\t16\t4\n"
+	"variable\tpadding\t20\t12\n"
+	"variable\tuvTransform\t32\t64\n"
+	"binding\tcbuffer\tDirectionalLightCB\t3\t0\t1\t48\n"
+	"variable\tgDirectionalLight.color\t0\t16\n"
+	"variable\tgDirectionalLight.direction\t16\t16\n"
+	"variable\tgDirectionalLight.intensity\t32\t4\n"
+	"variable\tgDirectionalLight.padding\t36\t12\n";
+
+ShaderBinding MakeConstantBuffer(const std::string& name, uint32_t shaderRegister, uint32_t size, std::vector<ShaderConstantVariable> variables) {
+	ShaderBinding binding;
+	binding.name = name;
+	binding.kind = ShaderBindingKind::ConstantBuffer;
+	binding.shaderRegister = shaderRegister;
+	binding.size = size;
+	binding.variables = std::move(variables);
+	return binding;
+}
+
+ShaderBinding MakeResource(const std::string& name, ShaderBindingKind kind, uint32_t shaderRegister) {
+	ShaderBinding binding;
+	binding.name = name;
+	binding.kind = kind;
+	binding.shaderRegister = shaderRegister;
+	return binding;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunShaderReflectionSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	// 書き出したテキストを読み、もう一度書き出すと同じになる
+	ShaderReflectionData vertex;
+	ShaderReflectionData pixel;
+	ShaderReflectionData noUvPixel;
+	std::string errors;
+	const bool parsed = ParseShaderReflection(kObject3dVertexDump, vertex, &errors) && ParseShaderReflection(kObject3dPixelDump, pixel, &errors) &&
+		ParseShaderReflection(kObject3dNoUvPixelDump, noUvPixel, &errors);
+	const bool roundTrip = parsed && SerializeShaderReflection(vertex) == kObject3dVertexDump &&
+		SerializeShaderReflection(pixel) == kObject3dPixelDump && SerializeShaderReflection(noUvPixel) == kObject3dNoUvPixelDump;
+	const ShaderBinding* light = FindShaderBinding(pixel, ShaderBindingKind::ConstantBuffer, "DirectionalLightCB");
+	AddSelfTestResult(results, "shader reflection dumps round-trip",
+		roundTrip && vertex.stage == ShaderStage::Vertex && pixel.bindings.size() == 4 && light && light->shaderRegister == 3 &&
+		light->variables.size() == 4 && light->variables[2] == ShaderConstantVariable{ "gDirectionalLight.intensity", 32, 4 }, errors);
+
+	// 壊れたテキストは読まない（見出し違い、bindingの前のvariable、負のレジスタ、stageが無い）
+	const char* const brokenDumps[] = {
+		"garbage\n",
+		"# CG2 shader reflection v1\nstage\tvertex\nvariable\ta\t0\t4\n",
+		"# CG2 shader reflection v1\nstage\tvertex\nbinding\tcbuffer\tA\t-1\t0\t1\t16\n",
+		"# CG2 shader reflection v1\nbinding\tsrv\tA\t0\t0\t1\t0\n",
+		"# CG2 shader reflection v1\nstage\tgeometry\n",
+	};
+	uint32_t rejected = 0;
+	errors.clear();
+	for (const char* dump : brokenDumps) {
+		ShaderReflectionData broken;
+		rejected += ParseShaderReflection(dump, broken, &errors) ? 0 : 1;
+	}
+	AddSelfTestResult(results, "shader reflection rejects broken dumps", rejected == std::size(brokenDumps) && !errors.empty(),
+		"rejected " + std::to_string(rejected) + " of " + std::to_string(std::size(brokenDumps)));
+
+	// mainと同じ並び（描画キューのルートパラメータの番号）で、3つのシェーダーの和からルートシグネチャを作る
+	RootSignatureLayoutDesc desc;
+	desc.order = { "MaterialCB", "TransformCB", "gTexture", "DirectionalLightCB" };
+	RootSignatureLayout layout;
+	errors.clear();
+	const bool built = parsed && BuildRootSignatureLayout({ &vertex, &pixel, &noUvPixel }, desc, layout, &errors);
+	const bool ordered = built && layout.parameters.size() == 4 && FindRootParameter(layout, "MaterialCB") == 0 &&
+		FindRootParameter(layout, "TransformCB") == 1 && FindRootParameter(layout, "gTexture") == 2 && FindRootParameter(layout, "DirectionalLightCB") == 3;
+	const bool kinds = ordered && layout.parameters[0].kind == RootParameterKind::ConstantBufferView &&
+		layout.parameters[2].kind == RootParameterKind::DescriptorTable && layout.parameters[0].stageMask == kShaderStageMaskPixel &&
+		layout.parameters[1].stageMask == kShaderStageMaskVertex && layout.staticSamplers.size() == 1 &&
+		layout.staticSamplers[0].stageMask == kShaderStageMaskPixel && layout.cost == 2 + 2 + 1 + 2;
+	AddSelfTestResult(results, "shader reflection builds the Object3d root signature in draw order", kinds,
+		errors + "cost " + std::to_string(layout.cost));
+
+	// 並びの指定が無ければ、種類（ルート定数、CBV、テーブル）とレジスタの順
+	RootSignatureLayout defaultLayout;
+	const bool defaultOrder = BuildRootSignatureLayout({ &vertex, &pixel }, {}, defaultLayout) && defaultLayout.parameters.size() == 4 &&
+		defaultLayout.parameters[0].name == "MaterialCB" && defaultLayout.parameters[1].name == "TransformCB" &&
+		defaultLayout.parameters[2].name == "DirectionalLightCB" && defaultLayout.parameters[3].name == "gTexture";
+	AddSelfTestResult(results, "shader reflection orders unlisted parameters by kind and register", defaultOrder);
+
+	// 小さいcbufferはルート定数になり、両方のステージが使えばALL。上限を超えたらCBVに戻し、それでも超えれば失敗
+	const ShaderBinding transform = vertex.bindings[0];
+	const ShaderBinding material = pixel.bindings[0];
+	const ShaderBinding tint = MakeConstantBuffer("TintCB", 4, 16, { { "gTint", 0, 16 } });
+	const ShaderReflectionData vertexTint = { ShaderStage::Vertex, { transform, tint } };
+	const ShaderReflectionData pixelTint = { ShaderStage::Pixel, { material, tint } };
+	RootSignatureLayoutDesc tintDesc;
+	tintDesc.order = { "TintCB" };
+	RootSignatureLayout tintLayout;
+	const bool constants = BuildRootSignatureLayout({ &vertexTint, &pixelTint }, tintDesc, tintLayout) &&
+		tintLayout.parameters[0].name == "TintCB" && tintLayout.parameters[0].kind == RootParameterKind::Constants &&
+		tintLayout.parameters[0].count == 4 && tintLayout.parameters[0].stageMask == (kShaderStageMaskVertex | kShaderStageMaskPixel) &&
+		tintLayout.cost == 4 + 2 + 2;
+	RootSignatureLayoutDesc tightDesc;
+	tightDesc.maxCost = 6;
+	RootSignatureLayout tightLayout;
+	const bool demoted = BuildRootSignatureLayout({ &vertexTint, &pixelTint }, tightDesc, tightLayout) && tightLayout.cost == 6 &&
+		FindRootParameter(tightLayout, "TintCB") >= 0 &&
+		tightLayout.parameters[FindRootParameter(tightLayout, "TintCB")].kind == RootParameterKind::ConstantBufferView;
+	tightDesc.maxCost = 5;
+	const bool overBudget = !BuildRootSignatureLayout({ &vertexTint, &pixelTint }, tightDesc, tightLayout);
+	AddSelfTestResult(results, "shader reflection fits root constants into the budget", constants && demoted && overBudget,
+		"cost " + std::to_string(tintLayout.cost) + ", tight " + std::to_string(tightLayout.cost));
+
+	// 同じレジスタの中身がステージで違う、並びに無い名前を指定した
+	const ShaderReflectionData conflicting = { ShaderStage::Pixel, { MakeConstantBuffer("TransformCB", 1, 64, { { "gWVP", 0, 64 } }) } };
+	RootSignatureLayout conflictLayout;
+	RootSignatureLayoutDesc missingDesc;
+	missingDesc.order = { "Missing" };
+	const bool conflicts = !BuildRootSignatureLayout({ &vertex, &conflicting }, {}, conflictLayout) &&
+		!BuildRootSignatureLayout({ &vertex }, missingDesc, conflictLayout);
+	AddSelfTestResult(results, "shader reflection rejects conflicting registers and unknown names", conflicts);
+
+	// ホットリロード: 同じものは通し、増えたレジスタや見えないステージからの参照は通さない
+	ShaderReflectionData addedTexture = pixel;
+	addedTexture.bindings.push_back(MakeResource("gNormalMap", ShaderBindingKind::ShaderResource, 1));
+	const ShaderReflectionData vertexTexture = { ShaderStage::Vertex, { transform, MakeResource("gTexture", ShaderBindingKind::ShaderResource, 0) } };
+	errors.clear();
+	const bool compatible = built && IsShaderCompatibleWithRootSignature(vertex, layout) && IsShaderCompatibleWithRootSignature(pixel, layout) &&
+		IsShaderCompatibleWithRootSignature(noUvPixel, layout) && !IsShaderCompatibleWithRootSignature(addedTexture, layout, &errors) &&
+		!IsShaderCompatibleWithRootSignature(vertexTexture, layout, &errors);
+	AddSelfTestResult(results, "shader reflection checks hot-reloaded shaders against the root signature", compatible);
+
+	// HLSLのcbufferに合わせたC++の構造体（mainのMaterial・TransformationMatrix・DirectionalLightと同じ大きさと並び）
+	const std::vector<CppStructLayout> layouts = {
+		{ "Material", "MaterialCB", 96, { { "gMaterialColor", 0, 16 }, { "gEnableLighting", 16, 4 }, { "padding", 20, 12 }, { "uvTransform", 32, 64 } } },
+		{ "TransformationMatrix", "TransformCB", 128, { { "gWVP", 0, 64 }, { "gWorld", 64, 64 } } },
+		{ "DirectionalLight", "DirectionalLightCB", 48, { { "gDirectionalLight.color", 0, 16 }, { "gDirectionalLight.direction", 16, 16 },
+			{ "gDirectionalLight.intensity", 32, 4 }, { "gDirectionalLight.padding", 36, 12 } } },
+	};
+	errors.clear();
+	const bool layoutsMatch = ValidateConstantBufferLayouts(vertex, layouts, &errors) && ValidateConstantBufferLayouts(pixel, layouts, &errors) &&
+		ValidateConstantBufferLayouts(noUvPixel, layouts, &errors);
+	AddSelfTestResult(results, "shader reflection matches the C++ constant buffer structs", layoutsMatch, errors);
+
+	// HLSLからpaddingを消してuvTransformが詰まった、構造体の無いcbuffer、構造体が小さすぎる
+	const ShaderReflectionData packed = { ShaderStage::Pixel, { MakeConstantBuffer("MaterialCB", 0, 80,
+		{ { "gMaterialColor", 0, 16 }, { "gEnableLighting", 16, 4 }, { "uvTransform", 16, 64 } }) } };
+	const ShaderReflectionData unknown = { ShaderStage::Pixel, { tint } };
+	std::vector<CppStructLayout> smallLight = layouts;
+	smallLight[2].size = 44;
+	std::string mismatchErrors;
+	const bool mismatches = !ValidateConstantBufferLayouts(packed, layouts, &mismatchErrors) &&
+		!ValidateConstantBufferLayouts(unknown, layouts, &mismatchErrors) && !ValidateConstantBufferLayouts(pixel, smallLight, &mismatchErrors);
+	AddSelfTestResult(results, "shader reflection reports constant buffer layout mismatches",
+		mismatches && mismatchErrors.find("uvTransform") != std::string::npos && mismatchErrors.find("TintCB") != std::string::npos);
+
+	return results;
+}
@@ -0,0 +1,113 @@
+#include "engine/graphics/UploadRingAllocator.h"
+
+#include <cassert>
+#include <utility>
+
+namespace {
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+UploadRingAllocator::UploadRingAllocator(uint64_t pageSize, UploadPageBackend backend)
+	: pageSize_(AlignUp(pageSize, kConstantBufferAlignment)), backend_(std::move(backend)) {
+	assert(pageSize_ != 0 && backend_.createPage);
+}
+
+UploadRingAllocator::~UploadRingAllocator() {
+	if (activePage_.size != 0) {
+		DestroyPage(activePage_);
+	}
+	for (const UploadPage& page : usedPages_) {
+		DestroyPage(page);
+	}
+	for (const RetiredPages& retired : retired_) {
+		for (const UploadPage& page : retired.pages) {
+			DestroyPage(page);
+		}
+	}
+	for (const UploadPage& page : freePages_) {
+		DestroyPage(page);
+	}
+}
+
+UploadPage UploadRingAllocator::CreatePage(uint64_t size) {
+	UploadPage page = backend_.createPage(size);
+	assert(page.cpu && page.size >= size); // ページの作成に失敗したらエラー
+	stats_.pageCount++;
+	stats_.pageCreateCount++;
+	return page;
+}
+
+void UploadRingAllocator::DestroyPage(const UploadPage& page) {
+	if (backend_.destroyPage) {
+		backend_.destroyPage(page);
+	}
+}
+
+UploadAllocation UploadRingAllocator::Allocate(size_t size, size_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	// 次の割り当ても揃った位置から始まるよう、大きさも揃える
+	size = AlignUp(size == 0 ? 1 : size, alignment);
+	stats_.allocationCount++;
+	stats_.allocatedBytes += size;
+
+	if (size > pageSize_) {
+		// 専用のページ（今詰めているページはそのまま使い続ける）
+		stats_.oversizeCount++;
+		UploadPage page = CreatePage(size);
+		usedPages_.push_back(page);
+		return { page.handle, 0, page.cpu, page.gpuAddress, size };
+	}
+
+	uint64_t offset = AlignUp(activeOffset_, alignment);
+	if (activePage_.size == 0 || offset + size > activePage_.size) {
+		// 今のページに入らないので次のページへ
+		if (activePage_.size != 0) {
+			usedPages_.push_back(activePage_);
+		}
+		if (!freePages_.empty()) {
+			activePage_ = freePages_.back();
+			freePages_.pop_back();
+		} else {
+			activePage_ = CreatePage(pageSize_);
+		}
+		offset = 0;
+	}
+	activeOffset_ = offset + size;
+	// ページの先頭のアドレスは64KB単位なので、オフセットを揃えればアドレスも揃う
+	return { activePage_.handle, offset, activePage_.cpu + offset, activePage_.gpuAddress + offset, size };
+}
+
+void UploadRingAllocator::Retire(uint64_t fenceValue) {
+	if (activePage_.size != 0) {
+		usedPages_.push_back(activePage_);
+		activePage_ = UploadPage();
+		activeOffset_ = 0;
+	}
+	if (usedPages_.empty()) {
+		return;
+	}
+	assert(retired_.empty() || retired_.back().fenceValue <= fenceValue);
+	stats_.pendingPageCount += usedPages_.size();
+	retired_.push_back({ fenceValue, std::move(usedPages_) });
+	usedPages_.clear();
+}
+
+void UploadRingAllocator::Reclaim(uint64_t completedFenceValue) {
+	while (!retired_.empty() && retired_.front().fenceValue <= completedFenceValue) {
+		for (const UploadPage& page : retired_.front().pages) {
+			stats_.pendingPageCount--;
+			if (page.size == pageSize_) {
+				freePages_.push_back(page);
+			} else {
+				// 専用のページは同じ大きさで使い回せるとは限らないので捨てる
+				DestroyPage(page);
+				stats_.pageCount--;
+			}
+		}
+		retired_.pop_front();
+	}
+}
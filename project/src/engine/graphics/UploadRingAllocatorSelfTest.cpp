@@ -0,0 +1,136 @@
+#include "engine/graphics/UploadRingAllocator.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::vector<SelfTestResult> RunUploadRingAllocatorSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	// 普通のメモリをページにする。GPUアドレスは実際と同じく64KB単位で振り、ハンドルはmemoryの番号+1にする
+	// 破棄されたページはメモリを解放し、二重の破棄や知らないハンドルの破棄を数える
+	std::vector<std::unique_ptr<uint8_t[]>> memory;
+	uint64_t nextAddress = 0x10000;
+	size_t destroyCount = 0;
+	size_t badDestroyCount = 0;
+	UploadPageBackend backend;
+	backend.createPage = [&memory, &nextAddress](uint64_t size) {
+		UploadPage page;
+		memory.emplace_back(new uint8_t[size]);
+		page.handle = memory.size();
+		page.cpu = memory.back().get();
+		page.gpuAddress = nextAddress;
+		page.size = size;
+		nextAddress += (size + 0xFFFF) & ~uint64_t(0xFFFF);
+		return page;
+	};
+	backend.destroyPage = [&memory, &destroyCount, &badDestroyCount](const UploadPage& page) {
+		if (page.handle == 0 || page.handle > memory.size() || memory[page.handle - 1].get() != page.cpu) {
+			badDestroyCount++;
+			return;
+		}
+		memory[page.handle - 1].reset();
+		destroyCount++;
+	};
+	auto livePageCount = [&memory]() {
+		size_t count = 0;
+		for (const std::unique_ptr<uint8_t[]>& page : memory) {
+			count += page ? 1 : 0;
+		}
+		return count;
+	};
+
+	// 擬似フェンス: 毎フレームSignalし、GPUは2フレーム遅れて終わる
+	// 書いた値がGPUの終わるまで残っているかを、フレームごとに書いた印で確かめる
+	struct Constants {
+		uint32_t tag;
+		float padding[35];
+	};
+	auto frameUploads = std::make_unique<UploadRingAllocator>(64 * 1024, backend);
+	const uint64_t kLatency = 2;
+	std::map<uint64_t, std::vector<std::pair<const uint8_t*, uint32_t>>> inFlight;
+	uint64_t signaled = 0;
+	uint64_t completed = 0;
+	bool aligned = true;
+	bool addressed = true;
+	bool intact = true;
+	size_t createdAfterWarmup = 0;
+	size_t expectedAllocations = 0;
+	size_t expectedBytes = 0;
+	for (uint32_t frame = 0; frame < 1000; ++frame) {
+		frameUploads->Reclaim(completed);
+		if (frame == 500) {
+			createdAfterWarmup = frameUploads->GetStats().pageCreateCount;
+		}
+		// 1ページ（256個）に収まらないフレームも混ぜる
+		uint32_t count = 50 + (frame * 37) % 400;
+		std::vector<std::pair<const uint8_t*, uint32_t>>& written = inFlight[signaled + 1];
+		for (uint32_t i = 0; i < count; ++i) {
+			Constants constants{};
+			constants.tag = frame * 100000 + i;
+			UploadAllocation allocation = frameUploads->AllocateConstants(constants);
+			aligned = aligned && allocation.gpuAddress % UploadRingAllocator::kConstantBufferAlignment == 0 && allocation.size == 256;
+			// ハンドルとオフセットでページ内の同じ場所を指す
+			addressed = addressed && allocation.page != 0 && allocation.page <= memory.size() &&
+				allocation.cpu == memory[allocation.page - 1].get() + allocation.offset;
+			written.push_back({ allocation.cpu, constants.tag });
+		}
+		expectedAllocations += count;
+		expectedBytes += count * 256;
+		frameUploads->Retire(++signaled);
+		if (signaled > kLatency) {
+			completed = signaled - kLatency;
+			for (const auto& [cpu, tag] : inFlight[completed]) {
+				uint32_t value = 0;
+				std::memcpy(&value, cpu, sizeof(value));
+				intact = intact && value == tag;
+			}
+			inFlight.erase(completed);
+		}
+	}
+	const UploadAllocatorStats& frameStats = frameUploads->GetStats();
+	AddSelfTestResult(results, "upload ring constants are 256-byte aligned", aligned);
+	AddSelfTestResult(results, "upload ring allocations carry the page handle and offset", addressed);
+	AddSelfTestResult(results, "upload ring does not reuse pages before the fence completes", intact);
+	AddSelfTestResult(results, "upload ring reuses pages after the fence completes", frameStats.pageCreateCount == createdAfterWarmup,
+		"created " + std::to_string(frameStats.pageCreateCount) + ", after warmup " + std::to_string(createdAfterWarmup));
+	AddSelfTestResult(results, "upload ring stats count allocations",
+		frameStats.allocationCount == expectedAllocations && frameStats.allocatedBytes == expectedBytes &&
+		frameStats.oversizeCount == 0 && frameStats.pageCount == frameStats.pageCreateCount,
+		"allocations " + std::to_string(frameStats.allocationCount) + ", bytes " + std::to_string(frameStats.allocatedBytes));
+	frameUploads->Reclaim(signaled);
+	AddSelfTestResult(results, "upload ring has no pending pages after the last fence", frameUploads->GetStats().pendingPageCount == 0,
+		"pending " + std::to_string(frameUploads->GetStats().pendingPageCount));
+	const size_t framePageCount = frameUploads->GetStats().pageCount;
+	frameUploads.reset();
+	AddSelfTestResult(results, "upload ring destroys every page once on destruction",
+		destroyCount == framePageCount && badDestroyCount == 0 && livePageCount() == 0,
+		"destroyed " + std::to_string(destroyCount) + " of " + std::to_string(framePageCount));
+	destroyCount = 0;
+
+	// ページより大きい割り当ては専用のページになり、今詰めているページはそのまま続く
+	UploadRingAllocator oversizeUploads(1000, backend);
+	UploadAllocation before = oversizeUploads.Allocate(3, 4);
+	UploadAllocation big = oversizeUploads.Allocate(200000);
+	UploadAllocation after = oversizeUploads.Allocate(5, 16);
+	AddSelfTestResult(results, "upload ring rounds the page size up to 256", oversizeUploads.GetPageSize() == 1024,
+		"page " + std::to_string(oversizeUploads.GetPageSize()));
+	AddSelfTestResult(results, "upload ring keeps filling the page around an oversize allocation",
+		big.size >= 200000 && big.gpuAddress % UploadRingAllocator::kConstantBufferAlignment == 0 &&
+		after.gpuAddress - before.gpuAddress == 16 && after.size == 16);
+	oversizeUploads.Retire(1);
+	oversizeUploads.Reclaim(0);
+	const UploadAllocatorStats& oversizeStats = oversizeUploads.GetStats();
+	bool pending = oversizeStats.oversizeCount == 1 && oversizeStats.pageCount == 2 && oversizeStats.pendingPageCount == 2;
+	oversizeUploads.Reclaim(1);
+	bool dropped = oversizeStats.pageCount == 1 && oversizeStats.pendingPageCount == 0 && destroyCount == 1 && badDestroyCount == 0 &&
+		livePageCount() == 1;
+	AddSelfTestResult(results, "upload ring drops oversize pages after reclaim", pending && dropped,
+		"pages " + std::to_string(oversizeStats.pageCount) + ", pending " + std::to_string(oversizeStats.pendingPageCount) +
+		", destroyed " + std::to_string(destroyCount));
+
+	return results;
+}
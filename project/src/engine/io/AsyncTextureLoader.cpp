@@ -0,0 +1,389 @@
+#include "engine/io/AsyncTextureLoader.h"
+
+#include <algorithm>
+#include <cassert>
+#include "engine/io/TextureCooker.h"
+
+TextureUploadBackend CreateNullTextureUploadBackend(std::shared_ptr<NullTextureUploadLog> log) {
+	if (!log) {
+		log = std::make_shared<NullTextureUploadLog>();
+	}
+	TextureUploadBackend backend;
+	// 番号だけ振っておき、ログの記録に使う
+	backend.create = [log](const DirectX::TexMetadata&) {
+		TextureGpuResource gpu;
+		gpu.srvDescriptor = static_cast<uint32_t>(log->createCount++);
+		gpu.srvHandle.ptr = gpu.srvDescriptor + 1;
+		return gpu;
+	};
+	backend.uploadMip = [log](TextureGpuResource& gpu, const DirectX::TexMetadata&, size_t mipLevel, const DirectX::Image& image) {
+		log->uploads.push_back({ gpu.srvDescriptor, mipLevel, image.slicePitch });
+	};
+	backend.publish = [log](TextureGpuResource&, const DirectX::TexMetadata&, size_t) {
+		log->publishCount++;
+	};
+	backend.destroy = [log](TextureGpuResource&) {
+		log->destroyCount++;
+	};
+	return backend;
+}
+
+AsyncTextureLoader::AsyncTextureLoader(const AsyncTextureLoaderDesc& desc, TextureUploadBackend backend, LoadFunction load)
+	: backend_(std::move(backend)),
+	load_(load ? std::move(load) : LoadFunction(LoadTextureFile)),
+	memoryBudgetBytes_(desc.memoryBudgetBytes),
+	uploadBytesPerUpdate_(desc.uploadBytesPerUpdate),
+	cache_(desc.indexPath,
+		[this](DirectX::ScratchImage&& image) {
+			// SRVだけ作り、ピクセルはStreamMipsで少しずつ書き込む
+			// 書き込んだミップから捨てられるように、ミップごとの画像に分けてデコード結果を手放す
+			DirectX::ScratchImage decoded = std::move(image);
+			pendingStream_ = std::make_unique<Stream>();
+			pendingStream_->metadata = decoded.GetMetadata();
+			pendingStream_->mostDetailedMip = pendingStream_->metadata.mipLevels;
+			pendingStream_->mips.resize(pendingStream_->metadata.mipLevels);
+			for (size_t level = 0; level < pendingStream_->metadata.mipLevels; level++) {
+				HRESULT hr = pendingStream_->mips[level].InitializeFromImage(*decoded.GetImage(level, 0, 0));
+				assert(SUCCEEDED(hr));
+				(void)hr;
+				stats_.stagedBytes += pendingStream_->mips[level].GetPixelsSize();
+			}
+			return backend_.create(pendingStream_->metadata);
+		},
+		[this](TextureGpuResource& gpu) {
+			// 書き込み済みの量を予算から外す（gpuはcache_内のものなので、アドレスでどのテクスチャか分かる）
+			for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+				if (&cache_.GetResource(it->first) != &gpu) {
+					continue;
+				}
+				stats_.residentBytes -= it->second.residentBytes;
+				for (const DirectX::ScratchImage& mip : it->second.mips) {
+					stats_.stagedBytes -= mip.GetPixelsSize();
+				}
+				if (it->second.mostDetailedMip != 0) {
+					stats_.streamingCount--;
+				}
+				streams_.erase(it);
+				break;
+			}
+			backend_.destroy(gpu);
+		}),
+	threadPool_(desc.threadCount) {
+	assert(backend_.create && backend_.uploadMip && backend_.publish && backend_.destroy);
+}
+
+AsyncTextureLoader::~AsyncTextureLoader() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	cancelled_ = true;
+	decodeQueue_.clear();
+	// 実行中のデコードはthreadPool_の破棄で待つ
+}
+
+AsyncTextureLoader::Handle AsyncTextureLoader::Request(const std::string& filePath, int priority) {
+	std::string key = NormalizeTexturePath(filePath);
+	auto keyIt = keyToRequest_.find(key);
+	if (keyIt != keyToRequest_.end()) {
+		RequestEntry& request = requests_[keyIt->second];
+		request.refCount++;
+		if (priority > request.priority) {
+			SetPriority(keyIt->second, priority);
+		}
+		return keyIt->second;
+	}
+
+	Handle handle;
+	if (!freeRequests_.empty()) {
+		handle = freeRequests_.back();
+		freeRequests_.pop_back();
+	} else {
+		handle = static_cast<Handle>(requests_.size());
+		requests_.emplace_back();
+	}
+	RequestEntry& request = requests_[handle];
+	request = RequestEntry();
+	request.filePath = filePath;
+	request.key = key;
+	request.priority = priority;
+	request.refCount = 1;
+	request.alive = true;
+	keyToRequest_[key] = handle;
+
+	// 読み込み済みの中身ならデコードしない
+	request.texture = cache_.AcquireIfKnown(filePath);
+	if (request.texture != TextureCache::kInvalidHandle) {
+		return handle;
+	}
+
+	request.decoding = true;
+	stats_.loadingCount++;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		decodeQueue_.push_back({ handle, priority, nextOrder_++, filePath });
+	}
+	// どのタスクも実行時点で一番優先度の高いものを取るので、積んだ順番は関係ない
+	threadPool_.Submit([this]() { DecodeNext(); });
+	return handle;
+}
+
+void AsyncTextureLoader::SetPriority(Handle handle, int priority) {
+	assert(handle < requests_.size() && requests_[handle].alive);
+	requests_[handle].priority = priority;
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (DecodeTask& task : decodeQueue_) {
+		if (task.handle == handle) {
+			task.priority = priority;
+		}
+	}
+}
+
+void AsyncTextureLoader::Release(Handle handle) {
+	assert(handle < requests_.size() && requests_[handle].alive && requests_[handle].refCount > 0);
+	RequestEntry& request = requests_[handle];
+	if (--request.refCount != 0) {
+		return;
+	}
+	keyToRequest_.erase(request.key);
+	request.alive = false;
+	if (request.texture != TextureCache::kInvalidHandle) {
+		cache_.Release(request.texture);
+		request.texture = TextureCache::kInvalidHandle;
+	}
+	if (request.decoding) {
+		// まだワーカーが手を付けていなければ取り消す。実行中なら結果を受け取ったときに捨てる
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = std::find_if(decodeQueue_.begin(), decodeQueue_.end(),
+			[handle](const DecodeTask& task) { return task.handle == handle; });
+		if (it == decodeQueue_.end()) {
+			return;
+		}
+		decodeQueue_.erase(it);
+		request.decoding = false;
+		stats_.loadingCount--;
+	}
+	FreeRequest(handle);
+}
+
+void AsyncTextureLoader::Trim() {
+	cache_.Trim();
+}
+
+void AsyncTextureLoader::FreeRequest(Handle handle) {
+	requests_[handle] = RequestEntry();
+	freeRequests_.push_back(handle);
+}
+
+void AsyncTextureLoader::DecodeNext() {
+	DecodeTask task;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (cancelled_ || decodeQueue_.empty()) {
+			return;
+		}
+		auto best = std::min_element(decodeQueue_.begin(), decodeQueue_.end(),
+			[](const DecodeTask& a, const DecodeTask& b) {
+				return a.priority != b.priority ? a.priority > b.priority : a.order < b.order;
+			});
+		task = std::move(*best);
+		decodeQueue_.erase(best);
+	}
+
+	DecodeResult result;
+	result.handle = task.handle;
+	result.hr = load_(task.filePath, result.image);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!cancelled_) {
+		decodeResults_.push_back(std::move(result));
+	}
+}
+
+void AsyncTextureLoader::WaitForDecodes() {
+	threadPool_.WaitIdle();
+}
+
+void AsyncTextureLoader::Update() {
+	ReceiveDecodes();
+	StreamMips();
+}
+
+void AsyncTextureLoader::ReceiveDecodes() {
+	std::vector<DecodeResult> results;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		results.swap(decodeResults_);
+	}
+	for (DecodeResult& result : results) {
+		RequestEntry& request = requests_[result.handle];
+		assert(request.decoding);
+		request.decoding = false;
+		stats_.loadingCount--;
+		if (!request.alive) {
+			// デコード中にReleaseされた
+			FreeRequest(result.handle);
+			continue;
+		}
+		if (FAILED(result.hr)) {
+			request.failed = true;
+			stats_.failedCount++;
+			continue;
+		}
+		request.texture = cache_.AcquireDecoded(request.filePath, std::move(result.image));
+		if (pendingStream_) {
+			// 新しい中身だった（重複していればcache_が既存のテクスチャを返すのでStreamは作られない）
+			streams_[request.texture] = std::move(*pendingStream_);
+			pendingStream_.reset();
+			stats_.streamingCount++;
+		}
+	}
+}
+
+void AsyncTextureLoader::StreamMips() {
+	// テクスチャの優先度は、参照しているリクエストの中で一番高いもの
+	for (auto& [texture, stream] : streams_) {
+		stream.priority = INT32_MIN;
+	}
+	for (const RequestEntry& request : requests_) {
+		if (!request.alive || request.texture == TextureCache::kInvalidHandle) {
+			continue;
+		}
+		auto it = streams_.find(request.texture);
+		if (it != streams_.end()) {
+			it->second.priority = (std::max)(it->second.priority, request.priority);
+		}
+	}
+
+	size_t uploadedBytes = 0;
+	std::vector<TextureCache::Handle> blocked; // このUpdateでは予算に入らなかったテクスチャ
+	for (;;) {
+		// 次に書き込むミップを選ぶ
+		// まだ何も見えていないテクスチャの一番小さいミップを最優先し、その後は優先度の高い順、同じなら書き込みの進んでいない方
+		Stream* next = nullptr;
+		TextureCache::Handle nextTexture = TextureCache::kInvalidHandle;
+		for (auto& [texture, stream] : streams_) {
+			if (stream.mostDetailedMip == 0 || cache_.GetRefCount(texture) == 0 ||
+				std::find(blocked.begin(), blocked.end(), texture) != blocked.end()) {
+				continue;
+			}
+			if (!next) {
+				next = &stream;
+				nextTexture = texture;
+				continue;
+			}
+			const bool visible = stream.mostDetailedMip < stream.metadata.mipLevels;
+			const bool nextVisible = next->mostDetailedMip < next->metadata.mipLevels;
+			if (visible != nextVisible) {
+				if (!visible) {
+					next = &stream;
+					nextTexture = texture;
+				}
+				continue;
+			}
+			if (stream.priority != next->priority) {
+				if (stream.priority > next->priority) {
+					next = &stream;
+					nextTexture = texture;
+				}
+				continue;
+			}
+			if (stream.mostDetailedMip > next->mostDetailedMip) {
+				next = &stream;
+				nextTexture = texture;
+			}
+		}
+		if (!next) {
+			break;
+		}
+
+		const size_t mipLevel = next->mostDetailedMip - 1;
+		const DirectX::Image* image = next->mips[mipLevel].GetImage(0, 0, 0);
+		assert(image);
+		const size_t bytes = image->slicePitch;
+		if (uploadedBytes != 0 && uploadedBytes + bytes > uploadBytesPerUpdate_) {
+			break;
+		}
+		if (stats_.residentBytes + bytes > memoryBudgetBytes_) {
+			// 予算が空くまで今のミップで表示する（他のテクスチャの小さいミップは入るかもしれないので続ける）
+			if (blocked.empty()) {
+				stats_.budgetStallCount++;
+			}
+			blocked.push_back(nextTexture);
+			continue;
+		}
+
+		TextureGpuResource& gpu = cache_.GetResource(nextTexture);
+		backend_.uploadMip(gpu, next->metadata, mipLevel, *image);
+		backend_.publish(gpu, next->metadata, mipLevel);
+		next->mostDetailedMip = mipLevel;
+		next->residentBytes += bytes;
+		stats_.residentBytes += bytes;
+		stats_.uploadedBytes += bytes;
+		uploadedBytes += bytes;
+
+		// 書き込んだミップのCPU側の画像はもう要らない
+		stats_.stagedBytes -= next->mips[mipLevel].GetPixelsSize();
+		next->mips[mipLevel] = DirectX::ScratchImage();
+		if (mipLevel == 0) {
+			next->mips.clear();
+			stats_.streamingCount--;
+		}
+	}
+}
+
+TextureLoadState AsyncTextureLoader::GetState(Handle handle) const {
+	assert(handle < requests_.size() && requests_[handle].alive);
+	const RequestEntry& request = requests_[handle];
+	if (request.failed) {
+		return TextureLoadState::Failed;
+	}
+	if (request.texture == TextureCache::kInvalidHandle) {
+		return TextureLoadState::Loading;
+	}
+	auto it = streams_.find(request.texture);
+	if (it != streams_.end() && it->second.mostDetailedMip != 0) {
+		return TextureLoadState::Streaming;
+	}
+	return TextureLoadState::Resident;
+}
+
+size_t AsyncTextureLoader::GetMostDetailedMip(Handle handle) const {
+	assert(handle < requests_.size() && requests_[handle].alive);
+	const RequestEntry& request = requests_[handle];
+	if (request.texture == TextureCache::kInvalidHandle) {
+		return SIZE_MAX;
+	}
+	auto it = streams_.find(request.texture);
+	if (it == streams_.end()) {
+		return 0;
+	}
+	return it->second.mostDetailedMip < it->second.metadata.mipLevels ? it->second.mostDetailedMip : SIZE_MAX;
+}
+
+bool AsyncTextureLoader::IsReady(Handle handle) const {
+	assert(handle < requests_.size() && requests_[handle].alive);
+	const RequestEntry& request = requests_[handle];
+	if (request.texture == TextureCache::kInvalidHandle) {
+		return false;
+	}
+	auto it = streams_.find(request.texture);
+	return it == streams_.end() || it->second.mostDetailedMip < it->second.metadata.mipLevels;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE AsyncTextureLoader::GetSrvHandle(Handle handle) const {
+	if (handle == kInvalidHandle || !IsReady(handle)) {
+		return backend_.placeholderSrv;
+	}
+	return cache_.GetSrvHandle(requests_[handle].texture);
+}
+
+bool AsyncTextureLoader::IsIdle() const {
+	if (stats_.loadingCount != 0) {
+		return false;
+	}
+	// 参照されなくなったテクスチャの書き込みは再開しないので、待たない
+	for (const auto& [texture, stream] : streams_) {
+		if (stream.mostDetailedMip != 0 && cache_.GetRefCount(texture) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,170 @@
+#include "engine/io/AsyncTextureLoader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+std::vector<SelfTestResult> RunAsyncTextureLoaderSelfTest() {
+	std::vector<SelfTestResult> results;
+
+	// パス → (大きさ, 画素の値)。dupはaと同じ中身、missingは読み込みに失敗する
+	const std::map<std::string, std::pair<size_t, uint8_t>> files = {
+		{ "a.png", { 256, 1 } }, { "b.png", { 64, 2 } }, { "c.png", { 1024, 3 } }, { "dup.png", { 256, 1 } }, { "hi.png", { 128, 4 } } };
+	// 全てのデコードを門の前で止めておき、リクエストを積み終えてから開ける
+	std::mutex gateMutex;
+	std::condition_variable gateCondition;
+	bool gateOpen = false;
+	std::vector<std::string> decodeOrder;
+	auto load = [&](const std::string& filePath, DirectX::ScratchImage& image) -> HRESULT {
+		{
+			std::unique_lock<std::mutex> lock(gateMutex);
+			gateCondition.wait(lock, [&gateOpen]() { return gateOpen; });
+			decodeOrder.push_back(filePath);
+		}
+		auto it = files.find(filePath);
+		if (it == files.end()) {
+			return E_FAIL;
+		}
+		HRESULT hr = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, it->second.first, it->second.first, 1, 0);
+		if (SUCCEEDED(hr)) {
+			std::memset(image.GetPixels(), it->second.second, image.GetPixelsSize());
+		}
+		return hr;
+	};
+
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path(ec) / "cg2_testtextures";
+	std::filesystem::remove_all(directory, ec);
+
+	auto log = std::make_shared<NullTextureUploadLog>();
+	TextureUploadBackend backend = CreateNullTextureUploadBackend(log);
+	backend.placeholderSrv.ptr = 0xFFFF;
+	AsyncTextureLoaderDesc desc;
+	desc.indexPath = (directory / "index.txt").string();
+	desc.threadCount = 1; // デコードの順番を確かめるので1スレッド
+	desc.uploadBytesPerUpdate = 64 * 1024;
+	desc.memoryBudgetBytes = 1536 * 1024; // c.pngの最上位（4MB）は入らない
+	{
+		AsyncTextureLoader loader(desc, backend, load);
+		const AsyncTextureLoader::Handle a = loader.Request("a.png", 0);
+		const AsyncTextureLoader::Handle b = loader.Request("b.png", 0);
+		const AsyncTextureLoader::Handle c = loader.Request("c.png", 1);
+		const AsyncTextureLoader::Handle hi = loader.Request("hi.png", 5);
+		const AsyncTextureLoader::Handle dup = loader.Request("dup.png", 0);
+		const AsyncTextureLoader::Handle missing = loader.Request("missing.png", -1);
+		const AsyncTextureLoader::Handle again = loader.Request("./A.png", 0);
+
+		AddSelfTestResult(results, "texture loader placeholder while loading", again == a &&
+			loader.GetSrvHandle(a).ptr == backend.placeholderSrv.ptr && loader.GetState(a) == TextureLoadState::Loading);
+
+		{
+			std::lock_guard<std::mutex> lock(gateMutex);
+			gateOpen = true;
+		}
+		gateCondition.notify_all();
+		loader.WaitForDecodes();
+
+		// 最初の1つはワーカーがすぐ取るので、残りが優先度の高い順・同じなら頼んだ順になっていればよい
+		const std::map<std::string, int> priorities = { { "a.png", 0 }, { "b.png", 0 }, { "c.png", 1 }, { "hi.png", 5 }, { "dup.png", 0 }, { "missing.png", -1 } };
+		const std::vector<std::string> requestOrder = { "a.png", "b.png", "c.png", "hi.png", "dup.png", "missing.png" };
+		bool decodeOrdered = decodeOrder.size() == requestOrder.size();
+		std::string order;
+		for (size_t i = 0; i < decodeOrder.size(); i++) {
+			order += (i ? " " : "") + decodeOrder[i];
+			if (i < 2) {
+				continue;
+			}
+			const int previous = priorities.at(decodeOrder[i - 1]), current = priorities.at(decodeOrder[i]);
+			const auto previousIndex = std::find(requestOrder.begin(), requestOrder.end(), decodeOrder[i - 1]);
+			const auto currentIndex = std::find(requestOrder.begin(), requestOrder.end(), decodeOrder[i]);
+			decodeOrdered = decodeOrdered && (previous > current || (previous == current && previousIndex < currentIndex));
+		}
+		AddSelfTestResult(results, "texture loader decodes by priority", decodeOrdered, order);
+
+		// 最初のUpdateで、全てのテクスチャの一番小さいミップ（1x1）が見える
+		loader.Update();
+		bool smallestFirst = log->uploads.size() >= 4;
+		for (size_t i = 0; smallestFirst && i < 4; i++) {
+			smallestFirst = log->uploads[i].bytes == 4;
+		}
+		for (AsyncTextureLoader::Handle handle : { a, b, c, hi, dup }) {
+			smallestFirst = smallestFirst && loader.IsReady(handle) && loader.GetSrvHandle(handle).ptr != backend.placeholderSrv.ptr;
+		}
+		AddSelfTestResult(results, "texture loader smallest mips first", smallestFirst, std::to_string(log->uploads.size()) + " uploads in the first update");
+		AddSelfTestResult(results, "texture loader failed load", loader.GetState(missing) == TextureLoadState::Failed &&
+			loader.GetSrvHandle(missing).ptr == backend.placeholderSrv.ptr && loader.GetStats().failedCount == 1);
+		AddSelfTestResult(results, "texture loader shares duplicate content", loader.GetSrvHandle(dup).ptr == loader.GetSrvHandle(a).ptr &&
+			log->createCount == 4, std::to_string(log->createCount) + " textures created");
+
+		// 1回のUpdateの量と、全体の予算
+		bool withinUpdateLimit = true;
+		bool withinBudget = loader.GetStats().residentBytes <= desc.memoryBudgetBytes;
+		int frames = 1;
+		for (; frames < 100 && !loader.IsIdle(); frames++) {
+			const size_t before = log->uploads.size();
+			loader.Update();
+			size_t bytes = 0;
+			for (size_t i = before; i < log->uploads.size(); i++) {
+				bytes += log->uploads[i].bytes;
+			}
+			withinUpdateLimit = withinUpdateLimit && (bytes <= desc.uploadBytesPerUpdate || log->uploads.size() - before == 1);
+			withinBudget = withinBudget && loader.GetStats().residentBytes <= desc.memoryBudgetBytes;
+			if (log->uploads.size() == before) {
+				break; // 予算が足りず、これ以上進まない
+			}
+		}
+		const AsyncTextureLoaderStats& stats = loader.GetStats();
+		AddSelfTestResult(results, "texture loader upload limit per update", withinUpdateLimit, std::to_string(frames) + " updates");
+		AddSelfTestResult(results, "texture loader memory budget", withinBudget && stats.budgetStallCount > 0 &&
+			loader.GetState(c) == TextureLoadState::Streaming && loader.IsReady(c) && loader.GetMostDetailedMip(c) > 0,
+			"resident " + std::to_string(stats.residentBytes) + " / " + std::to_string(desc.memoryBudgetBytes) + " bytes, " +
+			std::to_string(stats.budgetStallCount) + " stalls, c.png at mip " + std::to_string(loader.GetMostDetailedMip(c)));
+
+		// CPU側に残るのは、まだ書き込んでいないc.pngの細かいミップだけ（書き込んだミップと全て書き込んだテクスチャの画像は捨てる）
+		size_t expectedStaged = 0;
+		for (size_t level = 0; level < loader.GetMostDetailedMip(c); level++) {
+			expectedStaged += (size_t(1024) >> level) * (size_t(1024) >> level) * 4;
+		}
+		AddSelfTestResult(results, "texture loader frees uploaded mips on the CPU", stats.stagedBytes == expectedStaged,
+			"staged " + std::to_string(stats.stagedBytes) + " bytes, expected " + std::to_string(expectedStaged));
+
+		// 各テクスチャのミップは小さい方から1つずつ、優先度の高いhi.pngが最初に全て書き込まれる
+		// （ヌルバックエンドのSRVはcreateで振った番号+1）
+		std::map<uint32_t, size_t> nextMip;
+		bool mipOrder = true;
+		size_t firstFullUpload = SIZE_MAX;
+		uint32_t firstFullTexture = UINT32_MAX;
+		for (size_t i = 0; i < log->uploads.size(); i++) {
+			const NullTextureUploadLog::Upload& upload = log->uploads[i];
+			auto it = nextMip.find(upload.texture);
+			mipOrder = mipOrder && (it == nextMip.end() ? upload.bytes == 4 : upload.mipLevel + 1 == it->second);
+			nextMip[upload.texture] = upload.mipLevel;
+			if (upload.mipLevel == 0 && firstFullUpload == SIZE_MAX) {
+				firstFullUpload = i;
+				firstFullTexture = upload.texture;
+			}
+		}
+		AddSelfTestResult(results, "texture loader mip order", mipOrder);
+		AddSelfTestResult(results, "texture loader priority streaming", loader.GetState(hi) == TextureLoadState::Resident &&
+			firstFullTexture + 1 == loader.GetSrvHandle(hi).ptr);
+
+		// 全て手放すと、Trimで全て破棄される
+		for (AsyncTextureLoader::Handle handle : { a, a, b, c, hi, dup, missing }) {
+			loader.Release(handle);
+		}
+		loader.Trim();
+		AddSelfTestResult(results, "texture loader release and trim", log->destroyCount == log->createCount &&
+			loader.GetStats().residentBytes == 0 && loader.GetStats().stagedBytes == 0 && loader.GetStats().streamingCount == 0,
+			std::to_string(log->destroyCount) + " of " + std::to_string(log->createCount) + " destroyed");
+	}
+	std::filesystem::remove_all(directory, ec);
+	return results;
+}
@@ -0,0 +1,498 @@
+#include "engine/io/MeshCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include "engine/3d/MeshOptimizer.h"
+#include "engine/3d/MeshSimplifier.h"
+#include "engine/io/ObjLoader.h"
+
+namespace {
+
+constexpr char kMeshCacheMagic[4] = { 'C', 'G', 'M', 'C' };
+// 形式を変えたら上げる（古いキャッシュは自動で作り直される）
+constexpr uint32_t kMeshCacheVersion = 5;
+constexpr size_t kBlobAlignment = 16;
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+uint64_t HashBytes(const char* data, size_t size) {
+	uint64_t hash = kFnvOffsetBasis;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= kFnvPrime;
+	}
+	// 0は「未計算」扱いなので避ける
+	return hash == 0 ? 1 : hash;
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// キャッシュ書き出し用の中間表現（メッシュごとの配列を指すだけでコピーしない）
+struct CacheMeshSource {
+	const std::string* name;
+	const std::string* materialName;
+	const std::vector<VertexData>* vertices;
+	const std::vector<uint32_t>* indices;
+	const std::vector<MeshLod>* lods;
+};
+
+struct CacheMaterialSource {
+	const std::string* name;
+	const Material* material;
+};
+
+class StringTable {
+public:
+	// 文字列を追加してオフセットを返す
+	uint32_t Add(const std::string& text) {
+		uint32_t offset = static_cast<uint32_t>(data_.size());
+		data_.insert(data_.end(), text.begin(), text.end());
+		return offset;
+	}
+	const std::vector<char>& Data() const { return data_; }
+
+private:
+	std::vector<char> data_;
+};
+
+std::vector<char> Serialize(const std::vector<CacheMeshSource>& meshes, const std::vector<CacheMaterialSource>& materials,
+	MeshCacheLayout layout, const MeshCacheSource& source, const std::string& materialLibrary, const MeshCacheSource& materialSource) {
+	MeshCacheHeader header{};
+	std::memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+	header.version = kMeshCacheVersion;
+	header.layout = static_cast<uint32_t>(layout);
+	header.vertexStride = sizeof(VertexData);
+	header.sourceSize = source.size;
+	header.sourceWriteTime = source.writeTime;
+	header.sourceHash = source.hash;
+	header.materialSourceSize = materialSource.size;
+	header.materialSourceWriteTime = materialSource.writeTime;
+	header.materialSourceHash = materialSource.hash;
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+	header.materialCount = static_cast<uint32_t>(materials.size());
+
+	StringTable strings;
+	header.materialLibraryOffset = strings.Add(materialLibrary);
+	header.materialLibraryLength = static_cast<uint32_t>(materialLibrary.size());
+	std::vector<MeshCacheMeshEntry> meshEntries(meshes.size());
+	std::vector<MeshLod> lods;
+	for (size_t i = 0; i < meshes.size(); ++i) {
+		MeshCacheMeshEntry& entry = meshEntries[i];
+		entry.nameOffset = strings.Add(*meshes[i].name);
+		entry.nameLength = static_cast<uint32_t>(meshes[i].name->size());
+		entry.materialNameOffset = strings.Add(*meshes[i].materialName);
+		entry.materialNameLength = static_cast<uint32_t>(meshes[i].materialName->size());
+		entry.firstVertex = header.vertexCount;
+		entry.vertexCount = meshes[i].vertices->size();
+		entry.firstIndex = header.indexCount;
+		entry.indexCount = meshes[i].indices->size();
+		entry.firstLod = uint32_t(lods.size());
+		if (meshes[i].lods->empty()) {
+			// LODを作っていなければ全体を1レベルとして扱う
+			lods.push_back({ 0, uint32_t(entry.indexCount), 0.0f });
+		} else {
+			lods.insert(lods.end(), meshes[i].lods->begin(), meshes[i].lods->end());
+		}
+		entry.lodCount = uint32_t(lods.size()) - entry.firstLod;
+		header.vertexCount += entry.vertexCount;
+		header.indexCount += entry.indexCount;
+	}
+
+	std::vector<MeshCacheMaterialEntry> materialEntries(materials.size());
+	for (size_t i = 0; i < materials.size(); ++i) {
+		MeshCacheMaterialEntry& entry = materialEntries[i];
+		const Material& material = *materials[i].material;
+		entry.nameOffset = strings.Add(*materials[i].name);
+		entry.nameLength = static_cast<uint32_t>(materials[i].name->size());
+		entry.texturePathOffset = strings.Add(material.textureFilePath);
+		entry.texturePathLength = static_cast<uint32_t>(material.textureFilePath.size());
+		entry.color = material.color;
+		entry.lightingMode = material.lightingMode;
+		entry.uvTransform = material.uvTransform;
+	}
+
+	// 配置を決める
+	size_t offset = sizeof(MeshCacheHeader);
+	offset += sizeof(MeshCacheMeshEntry) * meshEntries.size();
+	offset += sizeof(MeshCacheMaterialEntry) * materialEntries.size();
+	header.lodTableOffset = offset;
+	header.lodCount = uint32_t(lods.size());
+	offset += sizeof(MeshLod) * lods.size();
+	header.stringTableOffset = offset;
+	header.stringTableSize = strings.Data().size();
+	offset = AlignUp(offset + strings.Data().size(), kBlobAlignment);
+	header.vertexBlobOffset = offset;
+	offset = AlignUp(offset + sizeof(VertexData) * header.vertexCount, kBlobAlignment);
+	header.indexBlobOffset = offset;
+	offset += sizeof(uint32_t) * header.indexCount;
+
+	std::vector<char> buffer(offset, 0);
+	char* out = buffer.data();
+	std::memcpy(out, &header, sizeof(header));
+	size_t cursor = sizeof(header);
+	if (!meshEntries.empty()) {
+		std::memcpy(out + cursor, meshEntries.data(), sizeof(MeshCacheMeshEntry) * meshEntries.size());
+		cursor += sizeof(MeshCacheMeshEntry) * meshEntries.size();
+	}
+	if (!materialEntries.empty()) {
+		std::memcpy(out + cursor, materialEntries.data(), sizeof(MeshCacheMaterialEntry) * materialEntries.size());
+	}
+	if (!lods.empty()) {
+		std::memcpy(out + header.lodTableOffset, lods.data(), sizeof(MeshLod) * lods.size());
+	}
+	if (!strings.Data().empty()) {
+		std::memcpy(out + header.stringTableOffset, strings.Data().data(), strings.Data().size());
+	}
+	for (size_t i = 0; i < meshes.size(); ++i) {
+		const std::vector<VertexData>& vertices = *meshes[i].vertices;
+		const std::vector<uint32_t>& indices = *meshes[i].indices;
+		if (!vertices.empty()) {
+			std::memcpy(out + header.vertexBlobOffset + sizeof(VertexData) * meshEntries[i].firstVertex,
+				vertices.data(), sizeof(VertexData) * vertices.size());
+		}
+		if (!indices.empty()) {
+			std::memcpy(out + header.indexBlobOffset + sizeof(uint32_t) * meshEntries[i].firstIndex,
+				indices.data(), sizeof(uint32_t) * indices.size());
+		}
+	}
+	return buffer;
+}
+
+// 一時ファイルに書いてから置き換える（書きかけのキャッシュを読まないように）
+bool WriteCacheFile(const std::string& cachePath, const std::vector<char>& buffer) {
+	std::error_code ec;
+	std::filesystem::path path(cachePath);
+	std::filesystem::create_directories(path.parent_path(), ec);
+	if (ec) {
+		return false;
+	}
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		if (!file) {
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return false;
+	}
+	return true;
+}
+
+// 中身が同じだったキャッシュの更新時刻だけ書き換える（次回からハッシュ計算を省く）
+// offsetはsourceWriteTimeかmaterialSourceWriteTimeの位置
+void UpdateCacheWriteTime(const std::string& cachePath, size_t offset, int64_t writeTime) {
+	std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file.is_open()) {
+		return;
+	}
+	file.seekp(offset);
+	file.write(reinterpret_cast<const char*>(&writeTime), sizeof(writeTime));
+}
+
+// キャッシュに記録した元ファイルの情報と一致するか
+bool IsSameSource(uint64_t size, int64_t writeTime, uint64_t hash, const MeshCacheSource& source) {
+	if (size != source.size) {
+		return false;
+	}
+	if (writeTime == source.writeTime) {
+		return true;
+	}
+	// 更新時刻だけ変わった（コピーやチェックアウト）場合は中身で判定する
+	return source.hash != 0 && hash == source.hash;
+}
+
+} // namespace
+
+bool MeshCacheView::Open(const std::string& cachePath) {
+	ownedBuffer_.clear();
+	header_ = nullptr;
+	if (!file_.Open(cachePath)) {
+		return false;
+	}
+	data_ = file_.Data();
+	size_ = file_.Size();
+	return Validate();
+}
+
+bool MeshCacheView::Adopt(std::vector<char> buffer) {
+	file_.Close();
+	header_ = nullptr;
+	ownedBuffer_ = std::move(buffer);
+	data_ = ownedBuffer_.data();
+	size_ = ownedBuffer_.size();
+	return Validate();
+}
+
+bool MeshCacheView::Validate() {
+	header_ = nullptr;
+	if (data_ == nullptr || size_ < sizeof(MeshCacheHeader)) {
+		return false;
+	}
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(data_);
+	if (std::memcmp(header->magic, kMeshCacheMagic, sizeof(header->magic)) != 0 ||
+		header->version != kMeshCacheVersion || header->vertexStride != sizeof(VertexData)) {
+		return false;
+	}
+	// 壊れたファイルで範囲外を読まないように、各領域がファイルに収まるか確認する
+	uint64_t tablesEnd = sizeof(MeshCacheHeader) +
+		sizeof(MeshCacheMeshEntry) * uint64_t(header->meshCount) +
+		sizeof(MeshCacheMaterialEntry) * uint64_t(header->materialCount);
+	if (tablesEnd > header->lodTableOffset ||
+		header->lodTableOffset + sizeof(MeshLod) * uint64_t(header->lodCount) > header->stringTableOffset ||
+		header->stringTableOffset + header->stringTableSize > size_ ||
+		header->vertexBlobOffset % kBlobAlignment != 0 ||
+		header->indexBlobOffset % kBlobAlignment != 0 ||
+		header->vertexBlobOffset + sizeof(VertexData) * header->vertexCount > size_ ||
+		header->indexBlobOffset + sizeof(uint32_t) * header->indexCount > size_ ||
+		uint64_t(header->materialLibraryOffset) + header->materialLibraryLength > header->stringTableSize) {
+		return false;
+	}
+	const MeshCacheMeshEntry* meshes = reinterpret_cast<const MeshCacheMeshEntry*>(data_ + sizeof(MeshCacheHeader));
+	for (uint32_t i = 0; i < header->meshCount; ++i) {
+		const MeshCacheMeshEntry& mesh = meshes[i];
+		if (mesh.firstVertex + mesh.vertexCount > header->vertexCount ||
+			mesh.firstIndex + mesh.indexCount > header->indexCount ||
+			mesh.lodCount == 0 || uint64_t(mesh.firstLod) + mesh.lodCount > header->lodCount ||
+			uint64_t(mesh.nameOffset) + mesh.nameLength > header->stringTableSize ||
+			uint64_t(mesh.materialNameOffset) + mesh.materialNameLength > header->stringTableSize) {
+			return false;
+		}
+		const MeshLod* lods = reinterpret_cast<const MeshLod*>(data_ + header->lodTableOffset) + mesh.firstLod;
+		for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+			if (uint64_t(lods[lod].firstIndex) + lods[lod].indexCount > mesh.indexCount) {
+				return false;
+			}
+		}
+	}
+	const MeshCacheMaterialEntry* materials = reinterpret_cast<const MeshCacheMaterialEntry*>(meshes + header->meshCount);
+	for (uint32_t i = 0; i < header->materialCount; ++i) {
+		const MeshCacheMaterialEntry& material = materials[i];
+		if (uint64_t(material.nameOffset) + material.nameLength > header->stringTableSize ||
+			uint64_t(material.texturePathOffset) + material.texturePathLength > header->stringTableSize) {
+			return false;
+		}
+	}
+	header_ = header;
+	return true;
+}
+
+bool MeshCacheView::IsValidFor(const MeshCacheSource& source) const {
+	return header_ && IsSameSource(header_->sourceSize, header_->sourceWriteTime, header_->sourceHash, source);
+}
+
+bool MeshCacheView::IsMaterialValidFor(const MeshCacheSource& materialSource) const {
+	return header_ && IsSameSource(header_->materialSourceSize, header_->materialSourceWriteTime, header_->materialSourceHash, materialSource);
+}
+
+std::string_view MeshCacheView::GetMaterialLibrary() const {
+	return GetString(header_->materialLibraryOffset, header_->materialLibraryLength);
+}
+
+std::string_view MeshCacheView::GetString(uint32_t offset, uint32_t length) const {
+	return std::string_view(data_ + header_->stringTableOffset + offset, length);
+}
+
+MeshCacheMesh MeshCacheView::GetMesh(uint32_t index) const {
+	const MeshCacheMeshEntry& entry =
+		reinterpret_cast<const MeshCacheMeshEntry*>(data_ + sizeof(MeshCacheHeader))[index];
+	MeshCacheMesh mesh{};
+	mesh.name = GetString(entry.nameOffset, entry.nameLength);
+	mesh.materialName = GetString(entry.materialNameOffset, entry.materialNameLength);
+	mesh.vertices = reinterpret_cast<const VertexData*>(data_ + header_->vertexBlobOffset) + entry.firstVertex;
+	mesh.vertexCount = static_cast<size_t>(entry.vertexCount);
+	mesh.indices = reinterpret_cast<const uint32_t*>(data_ + header_->indexBlobOffset) + entry.firstIndex;
+	mesh.indexCount = static_cast<size_t>(entry.indexCount);
+	mesh.lods = reinterpret_cast<const MeshLod*>(data_ + header_->lodTableOffset) + entry.firstLod;
+	mesh.lodCount = entry.lodCount;
+	return mesh;
+}
+
+std::unordered_map<std::string, Material> MeshCacheView::LoadMaterials() const {
+	std::unordered_map<std::string, Material> materials;
+	const MeshCacheMaterialEntry* entries = reinterpret_cast<const MeshCacheMaterialEntry*>(
+		data_ + sizeof(MeshCacheHeader) + sizeof(MeshCacheMeshEntry) * header_->meshCount);
+	for (uint32_t i = 0; i < header_->materialCount; ++i) {
+		const MeshCacheMaterialEntry& entry = entries[i];
+		Material material{};
+		material.color = entry.color;
+		material.lightingMode = entry.lightingMode;
+		material.uvTransform = entry.uvTransform;
+		material.textureFilePath = std::string(GetString(entry.texturePathOffset, entry.texturePathLength));
+		materials[std::string(GetString(entry.nameOffset, entry.nameLength))] = std::move(material);
+	}
+	return materials;
+}
+
+MaterialData MeshCacheView::LoadMaterialData() const {
+	MaterialData materialData;
+	if (header_->materialCount > 0) {
+		const MeshCacheMaterialEntry& entry = *reinterpret_cast<const MeshCacheMaterialEntry*>(
+			data_ + sizeof(MeshCacheHeader) + sizeof(MeshCacheMeshEntry) * header_->meshCount);
+		materialData.textureFilePath = std::string(GetString(entry.texturePathOffset, entry.texturePathLength));
+	}
+	return materialData;
+}
+
+MeshCacheSource GetMeshCacheSource(const std::string& sourcePath) {
+	MeshCacheSource source;
+	std::error_code ec;
+	uintmax_t size = std::filesystem::file_size(sourcePath, ec);
+	if (!ec) {
+		source.size = static_cast<uint64_t>(size);
+	}
+	auto writeTime = std::filesystem::last_write_time(sourcePath, ec);
+	if (!ec) {
+		source.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+	}
+	return source;
+}
+
+uint64_t ComputeSourceHash(const std::string& sourcePath) {
+	MappedFile file;
+	if (!file.Open(sourcePath)) {
+		return 0;
+	}
+	return HashBytes(file.Data(), file.Size());
+}
+
+std::vector<char> SerializeMeshCache(const MultiModelData& model, MeshCacheLayout layout, const MeshCacheSource& source,
+	const MeshCacheSource& materialSource) {
+	std::vector<CacheMeshSource> meshes;
+	meshes.reserve(model.meshes.size());
+	for (const Mesh& mesh : model.meshes) {
+		meshes.push_back({ &mesh.name, &mesh.materialName, &mesh.vertices, &mesh.indices, &mesh.lods });
+	}
+	std::vector<CacheMaterialSource> materials;
+	materials.reserve(model.materials.size());
+	for (const auto& [name, material] : model.materials) {
+		materials.push_back({ &name, &material });
+	}
+	return Serialize(meshes, materials, layout, source, model.materialLibrary, materialSource);
+}
+
+std::vector<char> SerializeMeshCache(const ModelData& model, const MeshCacheSource& source, const MeshCacheSource& materialSource) {
+	static const std::string kDefaultName = "default";
+	Material material{};
+	material.textureFilePath = model.material.textureFilePath;
+	std::vector<CacheMeshSource> meshes = { { &kDefaultName, &kDefaultName, &model.vertices, &model.indices, &model.lods } };
+	std::vector<CacheMaterialSource> materials = { { &kDefaultName, &material } };
+	return Serialize(meshes, materials, MeshCacheLayout::Single, source, model.materialLibrary, materialSource);
+}
+
+std::string GetMeshCachePath(const std::string& directoryPath, const std::string& filename, MeshCacheLayout layout) {
+	const char* suffix = layout == MeshCacheLayout::Single ? ".single.cgmesh" : ".multi.cgmesh";
+	return directoryPath + "/.meshcache/" + filename + suffix;
+}
+
+namespace {
+
+// キャッシュに記録したmtlが変わっていないか確かめる（更新時刻だけ変わっていればキャッシュの方を書き換える）
+bool IsMaterialLibraryUpToDate(MeshCacheView& view, const std::string& directoryPath, const std::string& cachePath) {
+	if (view.GetMaterialLibrary().empty()) {
+		return true;
+	}
+	const std::string materialPath = directoryPath + "/" + std::string(view.GetMaterialLibrary());
+	MeshCacheSource materialSource = GetMeshCacheSource(materialPath);
+	if (view.IsMaterialValidFor(materialSource)) {
+		return true;
+	}
+	if (view.GetHeader().materialSourceSize != materialSource.size) {
+		return false;
+	}
+	materialSource.hash = ComputeSourceHash(materialPath);
+	if (!view.IsMaterialValidFor(materialSource)) {
+		return false;
+	}
+	view = MeshCacheView();
+	UpdateCacheWriteTime(cachePath, offsetof(MeshCacheHeader, materialSourceWriteTime), materialSource.writeTime);
+	return view.Open(cachePath);
+}
+
+// 読み込んだモデルのmtlの情報（ハッシュまで計算する）
+MeshCacheSource GetMaterialLibrarySource(const std::string& directoryPath, const std::string& materialLibrary) {
+	if (materialLibrary.empty()) {
+		return {};
+	}
+	const std::string materialPath = directoryPath + "/" + materialLibrary;
+	MeshCacheSource materialSource = GetMeshCacheSource(materialPath);
+	materialSource.hash = ComputeSourceHash(materialPath);
+	return materialSource;
+}
+
+} // namespace
+
+MeshCacheView LoadObjFileCached(const std::string& directoryPath, const std::string& filename, MeshCacheLayout layout,
+	ThreadPool* threadPool, std::vector<MeshCacheOptimizeReport>* optimizeReports) {
+	const std::string sourcePath = directoryPath + "/" + filename;
+	const std::string cachePath = GetMeshCachePath(directoryPath, filename, layout);
+	MeshCacheSource source = GetMeshCacheSource(sourcePath);
+
+	if (optimizeReports) {
+		optimizeReports->clear();
+	}
+	MeshCacheView view;
+	if (view.Open(cachePath) && view.GetHeader().layout == static_cast<uint32_t>(layout)) {
+		bool sourceValid = view.IsValidFor(source);
+		// サイズが同じで更新時刻だけ違う場合はハッシュを比べる
+		if (!sourceValid && view.GetHeader().sourceSize == source.size) {
+			source.hash = ComputeSourceHash(sourcePath);
+			if (view.IsValidFor(source)) {
+				view = MeshCacheView();
+				UpdateCacheWriteTime(cachePath, offsetof(MeshCacheHeader, sourceWriteTime), source.writeTime);
+				sourceValid = view.Open(cachePath);
+			}
+		}
+		// OBJが同じでも、mtlを書き換えていればマテリアルが古い
+		if (sourceValid && IsMaterialLibraryUpToDate(view, directoryPath, cachePath)) {
+			return view;
+		}
+	}
+
+	// キャッシュが無い・古い：OBJを読み込んで作り直す
+	if (source.hash == 0) {
+		source.hash = ComputeSourceHash(sourcePath);
+	}
+	// キャッシュには頂点キャッシュ最適化済みのデータとLODを入れる（読み込み時は並べ替え不要）
+	std::vector<char> buffer;
+	if (layout == MeshCacheLayout::Single) {
+		ModelData model = LoadObjFile(directoryPath, filename);
+		const MeshOptimizeReport report = OptimizeMesh(model);
+		if (optimizeReports) {
+			optimizeReports->push_back({ std::string(), report });
+		}
+		BuildLods(model);
+		buffer = SerializeMeshCache(model, source, GetMaterialLibrarySource(directoryPath, model.materialLibrary));
+	} else {
+		MultiModelData model = LoadObjFileMultiParallel(directoryPath, filename, threadPool);
+		for (Mesh& mesh : model.meshes) {
+			const MeshOptimizeReport report = OptimizeMesh(mesh);
+			if (optimizeReports) {
+				optimizeReports->push_back({ mesh.name, report });
+			}
+			BuildLods(mesh);
+		}
+		buffer = SerializeMeshCache(model, layout, source, GetMaterialLibrarySource(directoryPath, model.materialLibrary));
+	}
+	view = MeshCacheView();
+	if (WriteCacheFile(cachePath, buffer) && view.Open(cachePath)) {
+		return view;
+	}
+	// 書き込めなかった（読み取り専用など）ときはメモリ上のバイト列をそのまま使う
+	view.Adopt(std::move(buffer));
+	return view;
+}
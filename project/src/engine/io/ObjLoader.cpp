@@ -0,0 +1,879 @@
+#include "engine/io/ObjLoader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "engine/base/ThreadPool.h"
+#include "engine/io/MappedFile.h"
+#include "engine/math/MathFunctions.h"
+
+namespace {
+
+// 行内の区切り文字（改行は行分割で処理する）
+inline bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// バッファから1行取り出す。終端に達したらfalse
+inline bool NextLine(const char*& cursor, const char* end, const char*& lineBegin, const char*& lineEnd) {
+	if (cursor >= end) {
+		return false;
+	}
+	lineBegin = cursor;
+	const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+	lineEnd = newline ? newline : end;
+	cursor = newline ? newline + 1 : end;
+	return true;
+}
+
+// 空白区切りのトークンを1つ取り出す（コピーしない）
+inline std::string_view NextToken(const char*& p, const char* end) {
+	while (p < end && IsSpace(*p)) {
+		++p;
+	}
+	const char* begin = p;
+	while (p < end && !IsSpace(*p)) {
+		++p;
+	}
+	return std::string_view(begin, static_cast<size_t>(p - begin));
+}
+
+// 浮動小数点数を1つ読む。読めなければ値はそのまま
+inline bool ParseFloat(const char*& p, const char* end, float& out) {
+	while (p < end && IsSpace(*p)) {
+		++p;
+	}
+	if (p < end && *p == '+') {
+		++p;
+	}
+	auto [ptr, ec] = std::from_chars(p, end, out);
+	if (ec != std::errc()) {
+		return false;
+	}
+	p = ptr;
+	return true;
+}
+
+// "v/vt/vn" 形式の1要素を読み、0始まりのインデックスにする（省略時は-1）
+// 負のインデックスは現在の要素数からの相対位置として解決する
+// deferRelative: 範囲外でも解決結果をそのまま残す（並列読み込みで後から前チャンク分を足す）
+// 戻り値は相対指定だった要素のビットマスク
+inline uint32_t ParseFaceVertex(std::string_view token, const size_t counts[3], int32_t out[3], bool deferRelative = false) {
+	const char* p = token.data();
+	const char* end = p + token.size();
+	uint32_t relativeMask = 0;
+	out[0] = out[1] = out[2] = -1;
+	for (int32_t element = 0; element < 3; ++element) {
+		int32_t value = 0;
+		auto [ptr, ec] = std::from_chars(p, end, value);
+		if (ec == std::errc()) {
+			if (value > 0) {
+				out[element] = value - 1;
+			} else if (value < 0) {
+				int32_t resolved = static_cast<int32_t>(counts[element]) + value;
+				if (deferRelative) {
+					out[element] = resolved;
+					relativeMask |= 1u << element;
+				} else if (resolved >= 0) {
+					out[element] = resolved;
+				}
+			}
+			p = ptr;
+		}
+		if (p < end && *p == '/') {
+			++p;
+		} else {
+			break;
+		}
+	}
+	return relativeMask;
+}
+
+template <typename T>
+inline T FetchOrDefault(const std::vector<T>& values, int32_t index) {
+	if (index < 0 || static_cast<size_t>(index) >= values.size()) {
+		return T{};
+	}
+	return values[index];
+}
+
+// OBJの頂点属性の読み込み先
+struct ObjAttributes {
+	std::vector<Vector4> positions; // 頂点位置
+	std::vector<Vector2> texcoords; // テクスチャ座標
+	std::vector<Vector3> normals;   // 法線ベクトル
+};
+
+// v/vt/vn の行を読む。属性行ならtrue
+// flipZ: 右手系→左手系のためZを反転する（LoadObjFileMultiのみ）
+inline bool ParseAttribute(std::string_view identifier, const char*& p, const char* end, ObjAttributes& attributes, bool flipZ) {
+	if (identifier == "v") { // 頂点位置
+		Vector4 position{};
+		ParseFloat(p, end, position.x);
+		ParseFloat(p, end, position.y);
+		ParseFloat(p, end, position.z);
+		if (flipZ) {
+			position.z *= -1.0f;
+		}
+		position.w = 1.0f; // 同次座標系のためw成分を1に設定
+		attributes.positions.push_back(position);
+		return true;
+	}
+	if (identifier == "vt") { // テクスチャ座標
+		Vector2 texcoord{};
+		ParseFloat(p, end, texcoord.x);
+		ParseFloat(p, end, texcoord.y);
+		attributes.texcoords.push_back(texcoord);
+		return true;
+	}
+	if (identifier == "vn") { // 法線ベクトル
+		Vector3 normal{};
+		ParseFloat(p, end, normal.x);
+		ParseFloat(p, end, normal.y);
+		ParseFloat(p, end, normal.z);
+		if (flipZ) {
+			normal.z *= -1.0f;
+		}
+		attributes.normals.push_back(normal);
+		return true;
+	}
+	return false;
+}
+
+// 面を構成する3頂点分のインデックスを読む
+// 面は三角形限定。他のは未対応（4頂点目以降は無視する）
+// 戻り値は相対指定だった要素のビットマスク（faceVertex * 3 + element 番目）
+inline uint32_t ParseFaceIndices(const char*& p, const char* end, const size_t counts[3], int32_t outIndices[3][3], bool deferRelative = false) {
+	uint32_t relativeMask = 0;
+	for (int32_t faceVertex = 0; faceVertex < 3; ++faceVertex) {
+		relativeMask |= ParseFaceVertex(NextToken(p, end), counts, outIndices[faceVertex], deferRelative) << (faceVertex * 3);
+	}
+	return relativeMask;
+}
+
+// インデックスから頂点を組み立てる
+inline VertexData MakeVertex(const ObjAttributes& attributes, const int32_t elementIndices[3]) {
+	Vector4 position = FetchOrDefault(attributes.positions, elementIndices[0]);
+	Vector2 texcoord = FetchOrDefault(attributes.texcoords, elementIndices[1]);
+	Vector3 normal = FetchOrDefault(attributes.normals, elementIndices[2]);
+	texcoord.y = 1.0f - texcoord.y;
+	return { position, texcoord, normal };
+}
+
+// v/vt/vn の組が同じ頂点をまとめて、頂点配列とインデックス配列を作る
+// 組をキーにしたオープンアドレス法のハッシュ表を使う
+class IndexedMeshBuilder {
+public:
+	IndexedMeshBuilder(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices)
+		: vertices_(vertices), indices_(indices) {
+		Rehash(1024);
+	}
+
+	// 出力先を空にして最初から作り直す
+	// 表は大きいメッシュに合わせて広がったままなので、全体ではなく使ったスロットだけを空に戻す
+	void Reset() {
+		vertices_.clear();
+		indices_.clear();
+		for (uint32_t slotIndex : usedSlots_) {
+			slots_[slotIndex].vertexIndex = kEmpty;
+		}
+		usedSlots_.clear();
+	}
+
+	// 三角形を追加する
+	// 🔁 頂点の登録順を逆順にする（面の回り順を逆にする）
+	void AddTriangle(const ObjAttributes& attributes, const int32_t indices[3][3]) {
+		AddCorner(attributes, indices[2]);
+		AddCorner(attributes, indices[1]);
+		AddCorner(attributes, indices[0]);
+	}
+
+private:
+	struct Slot {
+		int32_t key[3];
+		uint32_t vertexIndex = kEmpty;
+	};
+	static constexpr uint32_t kEmpty = UINT32_MAX;
+
+	static size_t Hash(const int32_t key[3]) {
+		uint64_t h = static_cast<uint32_t>(key[0]) * 0x9E3779B97F4A7C15ull;
+		h ^= static_cast<uint32_t>(key[1]) * 0xC2B2AE3D27D4EB4Full;
+		h ^= static_cast<uint32_t>(key[2]) * 0x165667B19E3779F9ull;
+		return static_cast<size_t>(h ^ (h >> 29));
+	}
+
+	void AddCorner(const ObjAttributes& attributes, const int32_t key[3]) {
+		// 負荷率が1/2を超えたら広げる
+		if ((vertices_.size() + 1) * 2 > slots_.size()) {
+			Rehash(slots_.size() * 2);
+		}
+		size_t mask = slots_.size() - 1;
+		for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+			Slot& slot = slots_[i];
+			if (slot.vertexIndex == kEmpty) {
+				slot.key[0] = key[0];
+				slot.key[1] = key[1];
+				slot.key[2] = key[2];
+				slot.vertexIndex = static_cast<uint32_t>(vertices_.size());
+				usedSlots_.push_back(static_cast<uint32_t>(i));
+				vertices_.push_back(MakeVertex(attributes, key));
+				indices_.push_back(slot.vertexIndex);
+				return;
+			}
+			if (slot.key[0] == key[0] && slot.key[1] == key[1] && slot.key[2] == key[2]) {
+				indices_.push_back(slot.vertexIndex);
+				return;
+			}
+		}
+	}
+
+	void Rehash(size_t capacity) {
+		std::vector<Slot> old = std::move(slots_);
+		slots_.assign(capacity, Slot{});
+		size_t mask = capacity - 1;
+		for (uint32_t& slotIndex : usedSlots_) {
+			const Slot& slot = old[slotIndex];
+			size_t i = Hash(slot.key) & mask;
+			while (slots_[i].vertexIndex != kEmpty) {
+				i = (i + 1) & mask;
+			}
+			slots_[i] = slot;
+			slotIndex = static_cast<uint32_t>(i);
+		}
+	}
+
+	std::vector<VertexData>& vertices_;
+	std::vector<uint32_t>& indices_;
+	std::vector<Slot> slots_;
+	std::vector<uint32_t> usedSlots_; // 埋まっているスロットの位置（Resetで空に戻す分）
+};
+
+// 面情報を読んで三角形を追加する
+inline void ParseFace(const char*& p, const char* end, const ObjAttributes& attributes, IndexedMeshBuilder& builder) {
+	const size_t counts[3] = { attributes.positions.size(), attributes.texcoords.size(), attributes.normals.size() };
+	int32_t indices[3][3];
+	ParseFaceIndices(p, end, counts, indices);
+	builder.AddTriangle(attributes, indices);
+}
+
+} // namespace
+
+MaterialData LoadMaterialTemplate(const std::string& directoryPath, const std::string& filename) {
+	MaterialData materialData;
+	MappedFile file(directoryPath + "/" + filename); // ファイルを開く
+	assert(file.IsOpen()); // ファイルが開けなかったらエラー
+
+	const char* cursor = file.Data();
+	const char* end = cursor + file.Size();
+	const char* lineBegin = nullptr;
+	const char* lineEnd = nullptr;
+	while (NextLine(cursor, end, lineBegin, lineEnd)) {
+		const char* p = lineBegin;
+		std::string_view identifier = NextToken(p, lineEnd);
+
+		// identifierに応じた処理
+		if (identifier == "map_Kd") {
+			std::string_view textureFilename = NextToken(p, lineEnd);
+			// 連結してファイルパスにする
+			materialData.textureFilePath = directoryPath + "/" + std::string(textureFilename);
+		}
+	}
+	return materialData;
+}
+
+std::unordered_map<std::string, Material> LoadMaterialTemplateMulti(
+	const std::string& directoryPath,
+	const std::string& filename)
+{
+	std::unordered_map<std::string, Material> materials;
+	MappedFile file(directoryPath + "/" + filename);
+	assert(file.IsOpen());
+
+	std::string currentMaterialName;
+	Material currentMaterial{};
+
+	const char* cursor = file.Data();
+	const char* end = cursor + file.Size();
+	const char* lineBegin = nullptr;
+	const char* lineEnd = nullptr;
+	while (NextLine(cursor, end, lineBegin, lineEnd)) {
+		const char* p = lineBegin;
+		std::string_view identifier = NextToken(p, lineEnd);
+
+		if (identifier == "newmtl") {
+			// 直前のマテリアルを保存
+			if (!currentMaterialName.empty()) {
+				materials[currentMaterialName] = currentMaterial;
+			}
+
+			// 新しいマテリアル名
+			std::string_view name = NextToken(p, lineEnd);
+			if (!name.empty()) {
+				currentMaterialName.assign(name);
+			}
+			currentMaterial = Material(); // 初期化
+			currentMaterial.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+			currentMaterial.lightingMode = 1; // Lambertなど
+			currentMaterial.uvTransform = MakeIdentity4x4();
+		} else if (identifier == "Kd") {
+			// 拡散反射色
+			ParseFloat(p, lineEnd, currentMaterial.color.x);
+			ParseFloat(p, lineEnd, currentMaterial.color.y);
+			ParseFloat(p, lineEnd, currentMaterial.color.z);
+			currentMaterial.color.w = 1.0f;
+		} else if (identifier == "map_Kd") {
+			std::string_view textureFilename = NextToken(p, lineEnd);
+			currentMaterial.textureFilePath = directoryPath + "/" + std::string(textureFilename);
+		}
+	}
+
+	// 最後のマテリアルを保存
+	if (!currentMaterialName.empty()) {
+		materials[currentMaterialName] = currentMaterial;
+	}
+
+	return materials;
+}
+
+ModelData LoadObjFile(const std::string& directoryPath, const std::string& filename) {
+	ModelData modelData;
+	ObjAttributes attributes;
+	IndexedMeshBuilder builder(modelData.vertices, modelData.indices);
+
+	MappedFile file(directoryPath + "/" + filename);
+	assert(file.IsOpen()); // ファイルが開けなかったらエラー
+
+	const char* cursor = file.Data();
+	const char* end = cursor + file.Size();
+	const char* lineBegin = nullptr;
+	const char* lineEnd = nullptr;
+	while (NextLine(cursor, end, lineBegin, lineEnd)) {
+		const char* p = lineBegin;
+		std::string_view identifier = NextToken(p, lineEnd); // 行の先頭の文字列を取得
+
+		if (ParseAttribute(identifier, p, lineEnd, attributes, false)) {
+			continue;
+		}
+		if (identifier == "f") { // 面情報
+			ParseFace(p, lineEnd, attributes, builder);
+		} else if (identifier == "mtllib") {
+			modelData.materialLibrary.assign(NextToken(p, lineEnd));
+			modelData.material = LoadMaterialTemplate(directoryPath, modelData.materialLibrary);
+		}
+	}
+	return modelData;
+}
+
+MultiModelData LoadObjFileMulti(const std::string& directoryPath, const std::string& filename) {
+	MultiModelData modelData;
+	ObjAttributes attributes;
+
+	MappedFile file(directoryPath + "/" + filename);
+	assert(file.IsOpen());
+
+	std::string currentMeshName = "default";
+	std::string currentMaterialName = "default"; // 現在のマテリアル名
+	Mesh currentMesh;
+	IndexedMeshBuilder builder(currentMesh.vertices, currentMesh.indices);
+
+	// 現在のメッシュを確定して次のメッシュへ
+	auto flushMesh = [&]() {
+		Mesh mesh;
+		mesh.vertices = std::move(currentMesh.vertices);
+		mesh.indices = std::move(currentMesh.indices);
+		mesh.name = currentMeshName;
+		mesh.materialName = currentMaterialName; // 使用中のマテリアル名を記録
+		modelData.meshes.push_back(std::move(mesh));
+		builder.Reset();
+	};
+
+	const char* cursor = file.Data();
+	const char* end = cursor + file.Size();
+	const char* lineBegin = nullptr;
+	const char* lineEnd = nullptr;
+	while (NextLine(cursor, end, lineBegin, lineEnd)) {
+		const char* p = lineBegin;
+		std::string_view identifier = NextToken(p, lineEnd);
+
+		if (ParseAttribute(identifier, p, lineEnd, attributes, true)) {
+			continue;
+		}
+		if (identifier == "f") {
+			ParseFace(p, lineEnd, attributes, builder);
+		} else if (identifier == "g" || identifier == "o") {
+			if (!currentMesh.vertices.empty()) {
+				flushMesh();
+			}
+			std::string_view name = NextToken(p, lineEnd);
+			if (!name.empty()) {
+				currentMeshName.assign(name);
+			}
+		} else if (identifier == "mtllib") {
+			modelData.materialLibrary.assign(NextToken(p, lineEnd));
+			modelData.materials = LoadMaterialTemplateMulti(directoryPath, modelData.materialLibrary); // マテリアル複数対応版
+		} else if (identifier == "usemtl") {
+			// 現在のマテリアル名を更新
+			std::string_view name = NextToken(p, lineEnd);
+			if (!name.empty()) {
+				currentMaterialName.assign(name);
+			}
+
+			// もし現メッシュに頂点があれば、いったん保存してマテリアル名を更新
+			if (!currentMesh.vertices.empty()) {
+				flushMesh();
+			}
+		}
+	}
+
+	if (!currentMesh.vertices.empty()) {
+		flushMesh();
+	}
+
+	return modelData;
+}
+
+namespace {
+
+// 並列読み込みで1チャンクが持つ中間データ
+// 面のインデックスは基本的にファイル全体での絶対位置（-1は省略）
+// 負の相対インデックスだった要素はチャンク内の位置のまま持ち、relativeMasksで印を付ける
+struct ObjChunkEvent {
+	enum class Kind { Group, UseMaterial, MaterialLibrary };
+	Kind kind;
+	size_t faceOffset; // このイベントより前にあるチャンク内の面の数
+	std::string name;
+};
+
+struct ObjChunk {
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	ObjAttributes attributes;
+	std::vector<int32_t> faceIndices; // 面ごとに3頂点x3要素
+	std::vector<uint16_t> relativeMasks; // 面ごとの相対指定マスク
+	bool hasRelative = false;
+	std::vector<ObjChunkEvent> events;
+	size_t attributeBase[3] = {}; // 前のチャンクまでの要素数
+};
+
+// 1メッシュを構成する、チャンク内の面の範囲
+struct ObjFaceRange {
+	size_t chunkIndex;
+	size_t faceBegin;
+	size_t faceEnd;
+};
+
+// ファイルを改行位置でチャンクに分ける
+std::vector<ObjChunk> SplitIntoChunks(const char* data, size_t size, size_t chunkCount) {
+	std::vector<ObjChunk> chunks;
+	const char* end = data + size;
+	const char* begin = data;
+	for (size_t i = 1; i <= chunkCount && begin < end; ++i) {
+		const char* chunkEnd = (i == chunkCount) ? end : data + size * i / chunkCount;
+		if (chunkEnd < begin) {
+			chunkEnd = begin;
+		}
+		// 行の途中で切らないよう、次の改行の直後まで伸ばす
+		const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd)));
+		chunkEnd = newline ? newline + 1 : end;
+		ObjChunk chunk;
+		chunk.begin = begin;
+		chunk.end = chunkEnd;
+		chunks.push_back(std::move(chunk));
+		begin = chunkEnd;
+	}
+	return chunks;
+}
+
+// 1チャンク分の行を読む（他のチャンクには触れない）
+void ParseChunk(ObjChunk& chunk) {
+	const char* cursor = chunk.begin;
+	const char* lineBegin = nullptr;
+	const char* lineEnd = nullptr;
+	size_t faceCount = 0;
+	while (NextLine(cursor, chunk.end, lineBegin, lineEnd)) {
+		const char* p = lineBegin;
+		std::string_view identifier = NextToken(p, lineEnd);
+
+		if (ParseAttribute(identifier, p, lineEnd, chunk.attributes, true)) {
+			continue;
+		}
+		if (identifier == "f") {
+			// 負の相対インデックスはチャンク内の要素数で解決し、後で前チャンクまでの要素数を足す
+			const size_t counts[3] = { chunk.attributes.positions.size(), chunk.attributes.texcoords.size(), chunk.attributes.normals.size() };
+			int32_t indices[3][3];
+			uint32_t relativeMask = ParseFaceIndices(p, lineEnd, counts, indices, true);
+			chunk.faceIndices.insert(chunk.faceIndices.end(), &indices[0][0], &indices[0][0] + 9);
+			chunk.relativeMasks.push_back(static_cast<uint16_t>(relativeMask));
+			chunk.hasRelative |= relativeMask != 0;
+			++faceCount;
+		} else if (identifier == "g" || identifier == "o") {
+			chunk.events.push_back({ ObjChunkEvent::Kind::Group, faceCount, std::string(NextToken(p, lineEnd)) });
+		} else if (identifier == "mtllib") {
+			chunk.events.push_back({ ObjChunkEvent::Kind::MaterialLibrary, faceCount, std::string(NextToken(p, lineEnd)) });
+		} else if (identifier == "usemtl") {
+			chunk.events.push_back({ ObjChunkEvent::Kind::UseMaterial, faceCount, std::string(NextToken(p, lineEnd)) });
+		}
+	}
+}
+
+// チャンク内の相対インデックスを、前チャンクまでの要素数を足して絶対位置にする
+void ResolveChunkFaces(ObjChunk& chunk) {
+	if (!chunk.hasRelative) {
+		return;
+	}
+	const size_t faceCount = chunk.relativeMasks.size();
+	for (size_t face = 0; face < faceCount; ++face) {
+		uint32_t relativeMask = chunk.relativeMasks[face];
+		for (int32_t bit = 0; relativeMask != 0; ++bit, relativeMask >>= 1) {
+			if (relativeMask & 1) {
+				int32_t& index = chunk.faceIndices[face * 9 + bit];
+				index += static_cast<int32_t>(chunk.attributeBase[bit % 3]);
+				if (index < 0) {
+					index = -1;
+				}
+			}
+		}
+	}
+	chunk.relativeMasks = std::vector<uint16_t>();
+}
+
+} // namespace
+
+MultiModelData LoadObjFileMultiParallel(const std::string& directoryPath, const std::string& filename, ThreadPool* threadPool) {
+	MultiModelData modelData;
+
+	MappedFile file(directoryPath + "/" + filename);
+	assert(file.IsOpen());
+
+	// プールが無ければ同じ手順を呼び出し元のスレッドで順に行う
+	auto parallelFor = [threadPool](size_t count, const std::function<void(size_t)>& func) {
+		if (threadPool) {
+			threadPool->ParallelFor(count, func);
+			return;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			func(i);
+		}
+	};
+	// 1チャンクが小さすぎると分割の手間の方が大きくなる（ParallelForは呼び出し元も処理に加わる）
+	const size_t kMinChunkBytes = 64 * 1024;
+	const size_t threadCount = threadPool ? size_t(threadPool->GetThreadCount()) + 1 : 1;
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 4, file.Size() / kMinChunkBytes));
+	std::vector<ObjChunk> chunks = SplitIntoChunks(file.Data(), file.Size(), chunkCount);
+
+	// 1. 各チャンクを並列に字句解析する
+	parallelFor(chunks.size(), [&](size_t i) { ParseChunk(chunks[i]); });
+
+	// 2. 属性をファイル順に結合し、相対インデックスを解決する
+	ObjAttributes attributes;
+	size_t totals[3] = {};
+	for (ObjChunk& chunk : chunks) {
+		chunk.attributeBase[0] = totals[0];
+		chunk.attributeBase[1] = totals[1];
+		chunk.attributeBase[2] = totals[2];
+		totals[0] += chunk.attributes.positions.size();
+		totals[1] += chunk.attributes.texcoords.size();
+		totals[2] += chunk.attributes.normals.size();
+	}
+	attributes.positions.resize(totals[0]);
+	attributes.texcoords.resize(totals[1]);
+	attributes.normals.resize(totals[2]);
+	parallelFor(chunks.size(), [&](size_t i) {
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.attributes.positions.begin(), chunk.attributes.positions.end(), attributes.positions.begin() + chunk.attributeBase[0]);
+		std::copy(chunk.attributes.texcoords.begin(), chunk.attributes.texcoords.end(), attributes.texcoords.begin() + chunk.attributeBase[1]);
+		std::copy(chunk.attributes.normals.begin(), chunk.attributes.normals.end(), attributes.normals.begin() + chunk.attributeBase[2]);
+		chunk.attributes = ObjAttributes();
+		ResolveChunkFaces(chunk);
+	});
+
+	// 3. g/o/usemtl をファイル順に再生して、逐次版と同じ区切りでメッシュの面範囲を決める
+	std::string currentMeshName = "default";
+	std::string currentMaterialName = "default";
+	std::vector<std::vector<ObjFaceRange>> meshFaceRanges;
+	std::vector<ObjFaceRange> currentRanges;
+	size_t currentFaceCount = 0;
+	auto flushMesh = [&]() {
+		Mesh mesh;
+		mesh.name = currentMeshName;
+		mesh.materialName = currentMaterialName;
+		modelData.meshes.push_back(std::move(mesh));
+		meshFaceRanges.push_back(std::move(currentRanges));
+		currentRanges.clear();
+		currentFaceCount = 0;
+	};
+	for (size_t chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex) {
+		const ObjChunk& chunk = chunks[chunkIndex];
+		size_t consumedFaces = 0;
+		auto appendFaces = [&](size_t faceOffset) {
+			if (faceOffset > consumedFaces) {
+				currentRanges.push_back({ chunkIndex, consumedFaces, faceOffset });
+				currentFaceCount += faceOffset - consumedFaces;
+			}
+			consumedFaces = faceOffset;
+		};
+		for (const ObjChunkEvent& event : chunk.events) {
+			appendFaces(event.faceOffset);
+			switch (event.kind) {
+			case ObjChunkEvent::Kind::Group:
+				if (currentFaceCount != 0) {
+					flushMesh();
+				}
+				if (!event.name.empty()) {
+					currentMeshName = event.name;
+				}
+				break;
+			case ObjChunkEvent::Kind::MaterialLibrary:
+				modelData.materialLibrary = event.name;
+				modelData.materials = LoadMaterialTemplateMulti(directoryPath, event.name);
+				break;
+			case ObjChunkEvent::Kind::UseMaterial:
+				if (!event.name.empty()) {
+					currentMaterialName = event.name;
+				}
+				if (currentFaceCount != 0) {
+					flushMesh();
+				}
+				break;
+			}
+		}
+		appendFaces(chunk.faceIndices.size() / 9);
+	}
+	if (currentFaceCount != 0) {
+		flushMesh();
+	}
+
+	// 4. メッシュごとに並列で頂点をまとめる（メッシュ内の順序は逐次版と同じ）
+	parallelFor(modelData.meshes.size(), [&](size_t meshIndex) {
+		Mesh& mesh = modelData.meshes[meshIndex];
+		IndexedMeshBuilder builder(mesh.vertices, mesh.indices);
+		for (const ObjFaceRange& range : meshFaceRanges[meshIndex]) {
+			const ObjChunk& chunk = chunks[range.chunkIndex];
+			for (size_t face = range.faceBegin; face < range.faceEnd; ++face) {
+				int32_t indices[3][3];
+				std::memcpy(indices, &chunk.faceIndices[face * 9], sizeof(indices));
+				builder.AddTriangle(attributes, indices);
+			}
+		}
+	});
+
+	return modelData;
+}
+
+namespace {
+
+// ベンチマーク用のOBJを作る。size x size の格子を帯に分け、帯ごとにg/usemtlを切り替える
+void AppendNumber(std::string& text, float value) {
+	char buffer[32];
+	auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	text.append(buffer, ptr);
+}
+
+void AppendNumber(std::string& text, uint32_t value) {
+	char buffer[16];
+	auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	text.append(buffer, ptr);
+}
+
+std::string MakeBenchmarkObj(uint32_t size, const std::string& materialFilename) {
+	const uint32_t kBandCount = 8;
+	std::string text = "mtllib " + materialFilename + "\n";
+	text.reserve(size_t(size) * size * 160);
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			const float u = float(x) / float(size - 1);
+			const float v = float(y) / float(size - 1);
+			text += "v ";
+			AppendNumber(text, u * 2.0f - 1.0f);
+			text += ' ';
+			AppendNumber(text, 0.25f * float((x * 7 + y * 13) % 17) / 17.0f);
+			text += ' ';
+			AppendNumber(text, v * 2.0f - 1.0f);
+			text += "\nvt ";
+			AppendNumber(text, u);
+			text += ' ';
+			AppendNumber(text, v);
+			text += "\nvn 0 1 0\n";
+		}
+	}
+	for (uint32_t y = 0; y + 1 < size; ++y) {
+		if (y % ((size - 1 + kBandCount - 1) / kBandCount) == 0) {
+			const uint32_t band = y * kBandCount / (size - 1);
+			text += "g band";
+			AppendNumber(text, band);
+			text += "\nusemtl material";
+			AppendNumber(text, band % 2);
+			text += '\n';
+		}
+		for (uint32_t x = 0; x + 1 < size; ++x) {
+			// OBJは1始まり
+			const uint32_t corners[4] = { y * size + x + 1, y * size + x + 2, (y + 1) * size + x + 2, (y + 1) * size + x + 1 };
+			const uint32_t triangles[2][3] = { { corners[0], corners[1], corners[2] }, { corners[0], corners[2], corners[3] } };
+			for (const auto& triangle : triangles) {
+				text += 'f';
+				for (uint32_t index : triangle) {
+					text += ' ';
+					AppendNumber(text, index);
+					text += '/';
+					AppendNumber(text, index);
+					text += '/';
+					AppendNumber(text, index);
+				}
+				text += '\n';
+			}
+		}
+	}
+	return text;
+}
+
+bool WriteTextFile(const std::filesystem::path& path, const std::string& text) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(text.data(), static_cast<std::streamsize>(text.size()));
+	return static_cast<bool>(file);
+}
+
+bool IsSameVertices(const std::vector<VertexData>& a, const std::vector<VertexData>& b) {
+	return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), sizeof(VertexData) * a.size()) == 0);
+}
+
+bool IsSameModel(const MultiModelData& a, const MultiModelData& b) {
+	if (a.meshes.size() != b.meshes.size() || a.materials.size() != b.materials.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.meshes.size(); ++i) {
+		const Mesh& meshA = a.meshes[i];
+		const Mesh& meshB = b.meshes[i];
+		if (meshA.name != meshB.name || meshA.materialName != meshB.materialName ||
+			!IsSameVertices(meshA.vertices, meshB.vertices) || meshA.indices != meshB.indices) {
+			return false;
+		}
+	}
+	for (const auto& [name, material] : a.materials) {
+		auto it = b.materials.find(name);
+		if (it == b.materials.end() || it->second.textureFilePath != material.textureFilePath ||
+			std::memcmp(&it->second.color, &material.color, sizeof(material.color)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 3回読んで最速の時間を返す（1回目はページキャッシュに載せるためにも読む）
+template <typename LoadFunction>
+double MeasureBestSeconds(LoadFunction&& load) {
+	double best = 0.0;
+	for (int run = 0; run < 3; ++run) {
+		auto start = std::chrono::steady_clock::now();
+		load();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (run == 0 || seconds < best) {
+			best = seconds;
+		}
+	}
+	return best;
+}
+
+// 1ファイルを各ローダーで読んでresultsに足す
+void BenchmarkObjFile(const std::string& directoryPath, const std::string& filename, size_t fileBytes,
+	std::vector<ObjLoadBenchmarkResult>& results) {
+	const uint32_t threadCounts[] = { 1, 2, 4, 8, 16 };
+	const double megabytes = static_cast<double>(fileBytes) / 1e6;
+
+	ObjLoadBenchmarkResult single;
+	single.file = filename;
+	single.loader = "LoadObjFile";
+	single.fileBytes = fileBytes;
+	ModelData singleModel;
+	single.megabytesPerSecond = megabytes / MeasureBestSeconds([&]() { singleModel = LoadObjFile(directoryPath, filename); });
+	single.vertexCount = singleModel.vertices.size();
+	single.indexCount = singleModel.indices.size();
+	results.push_back(single);
+
+	ObjLoadBenchmarkResult multi;
+	multi.file = filename;
+	multi.loader = "LoadObjFileMulti";
+	multi.fileBytes = fileBytes;
+	MultiModelData reference;
+	multi.megabytesPerSecond = megabytes / MeasureBestSeconds([&]() { reference = LoadObjFileMulti(directoryPath, filename); });
+	for (const Mesh& mesh : reference.meshes) {
+		multi.vertexCount += mesh.vertices.size();
+		multi.indexCount += mesh.indices.size();
+	}
+	results.push_back(multi);
+
+	// 並列版：プールは計測の外で作る（呼び出し元もParallelForに加わるので、ワーカーはthreadCount - 1本）
+	for (uint32_t threadCount : threadCounts) {
+		std::unique_ptr<ThreadPool> threadPool;
+		if (threadCount > 1) {
+			threadPool = std::make_unique<ThreadPool>(threadCount - 1);
+		}
+		ObjLoadBenchmarkResult parallel;
+		parallel.file = filename;
+		parallel.loader = "LoadObjFileMultiParallel";
+		parallel.fileBytes = fileBytes;
+		parallel.threadCount = threadCount;
+		MultiModelData model;
+		parallel.megabytesPerSecond = megabytes / MeasureBestSeconds([&]() {
+			model = LoadObjFileMultiParallel(directoryPath, filename, threadPool.get());
+		});
+		for (const Mesh& mesh : model.meshes) {
+			parallel.vertexCount += mesh.vertices.size();
+			parallel.indexCount += mesh.indices.size();
+		}
+		parallel.identical = IsSameModel(model, reference);
+		results.push_back(parallel);
+	}
+}
+
+} // namespace
+
+std::vector<ObjLoadBenchmarkResult> RunObjLoadBenchmark(const std::string& resourceDirectory) {
+	// 1024は約200万面（約200MB）
+	const uint32_t sizes[] = { 256, 512, 1024 };
+
+	std::vector<ObjLoadBenchmarkResult> results;
+	std::error_code ec;
+
+	// 実際のモデル
+	for (const char* filename : { "teapot.obj", "suzanne.obj" }) {
+		const uintmax_t fileBytes = std::filesystem::file_size(std::filesystem::path(resourceDirectory) / filename, ec);
+		if (!ec) {
+			BenchmarkObjFile(resourceDirectory, filename, static_cast<size_t>(fileBytes), results);
+		}
+	}
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path(ec) / "cg2_benchobj";
+	std::filesystem::create_directories(directory, ec);
+	if (ec) {
+		return results;
+	}
+	const std::string directoryPath = directory.string();
+	const std::string materialFilename = "bench.mtl";
+	if (!WriteTextFile(directory / materialFilename, "newmtl material0\nKd 1 0 0\nnewmtl material1\nKd 0 0 1\n")) {
+		return results;
+	}
+
+	for (uint32_t size : sizes) {
+		const std::string filename = "bench" + std::to_string(size) + ".obj";
+		size_t fileBytes = 0;
+		{
+			const std::string text = MakeBenchmarkObj(size, materialFilename);
+			fileBytes = text.size();
+			if (!WriteTextFile(directory / filename, text)) {
+				continue;
+			}
+		}
+		BenchmarkObjFile(directoryPath, filename, fileBytes, results);
+		std::filesystem::remove(directory / filename, ec);
+	}
+	std::filesystem::remove_all(directory, ec);
+	return results;
+}
@@ -0,0 +1,265 @@
+#include "engine/io/TextureAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include "engine/base/ThreadPool.h"
+#include "engine/io/TextureMipmaps.h"
+#include "engine/math/MathFunctions.h"
+
+// ImGuiのフォントアトラスが使っているものと同じ実装を、このファイルだけで使う
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace {
+
+uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// 揃える単位（最後のミップの1ピクセルが元の何ピクセルか）
+uint32_t GetCellAlignment(const TextureAtlasDesc& desc) {
+	return 1u << ((std::max)(desc.mipLevels, 1u) - 1);
+}
+
+// 最後のミップでも1ピクセル以上残るガターの幅
+uint32_t GetGutter(const TextureAtlasDesc& desc) {
+	return (std::max)(desc.padding, GetCellAlignment(desc));
+}
+
+// 中身を、端のピクセルを引き伸ばしながらセル全体に書き込む
+void CopyWithGutter(const DirectX::Image& source, const TextureAtlasRegion& region, size_t bytesPerPixel, const DirectX::Image& page) {
+	const size_t contentBytes = region.width * bytesPerPixel;
+	const size_t left = region.x - region.cellX;
+	const size_t right = region.cellX + region.cellWidth - (region.x + region.width);
+	for (uint32_t cellRow = 0; cellRow < region.cellHeight; cellRow++) {
+		const uint32_t pageY = region.cellY + cellRow;
+		const int64_t sourceY = std::clamp<int64_t>(int64_t(pageY) - region.y, 0, region.height - 1);
+		const uint8_t* src = source.pixels + sourceY * source.rowPitch;
+		uint8_t* dst = page.pixels + pageY * page.rowPitch + region.cellX * bytesPerPixel;
+		for (size_t i = 0; i < left; i++) {
+			std::memcpy(dst + i * bytesPerPixel, src, bytesPerPixel);
+		}
+		std::memcpy(dst + left * bytesPerPixel, src, contentBytes);
+		const uint8_t* lastPixel = src + contentBytes - bytesPerPixel;
+		uint8_t* rightStart = dst + (left + region.width) * bytesPerPixel;
+		for (size_t i = 0; i < right; i++) {
+			std::memcpy(rightStart + i * bytesPerPixel, lastPixel, bytesPerPixel);
+		}
+	}
+}
+
+// ミップ込みの全レベルで、各テクスチャのセルの中が単色（入力と同じ色）のままかを調べる
+bool CheckSolidCells(const TextureAtlas& atlas, const std::vector<uint32_t>& colors) {
+	for (size_t i = 0; i < atlas.regions.size(); i++) {
+		const TextureAtlasRegion& region = atlas.regions[i];
+		if (region.page == kAtlasNotPacked) {
+			continue;
+		}
+		const DirectX::ScratchImage& page = atlas.pages[region.page];
+		for (size_t level = 0; level < page.GetMetadata().mipLevels; level++) {
+			const DirectX::Image* image = page.GetImage(level, 0, 0);
+			for (uint32_t y = region.cellY >> level; y < (region.cellY + region.cellHeight) >> level; y++) {
+				const uint8_t* row = image->pixels + y * image->rowPitch;
+				for (uint32_t x = region.cellX >> level; x < (region.cellX + region.cellWidth) >> level; x++) {
+					uint32_t pixel;
+					std::memcpy(&pixel, row + x * 4, sizeof(pixel));
+					if (pixel != colors[i]) {
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+HRESULT BuildTextureAtlas(const std::vector<const DirectX::Image*>& images, const TextureAtlasDesc& desc, TextureAtlas& atlas,
+	ThreadPool* threadPool) {
+	atlas = TextureAtlas();
+	if (desc.pageSize == 0 || (desc.pageSize & (desc.pageSize - 1)) != 0 || DirectX::IsCompressed(desc.format)) {
+		return E_INVALIDARG;
+	}
+	const uint32_t alignment = GetCellAlignment(desc);
+	const uint32_t gutter = GetGutter(desc);
+	if (alignment > desc.pageSize) {
+		return E_INVALIDARG;
+	}
+	const size_t bytesPerPixel = DirectX::BitsPerPixel(desc.format) / 8;
+
+	// セルの大きさを揃える単位で数えて詰める（単位ごとに詰めれば、位置も自動的に揃う）
+	atlas.regions.resize(images.size());
+	std::vector<stbrp_rect> pending;
+	for (size_t i = 0; i < images.size(); i++) {
+		const DirectX::Image* image = images[i];
+		const uint32_t cellWidth = image ? AlignUp(uint32_t(image->width) + gutter * 2, alignment) : 0;
+		const uint32_t cellHeight = image ? AlignUp(uint32_t(image->height) + gutter * 2, alignment) : 0;
+		if (!image || image->format != desc.format || image->width == 0 || image->height == 0 ||
+			image->width > desc.maxInputSize || image->height > desc.maxInputSize ||
+			cellWidth > desc.pageSize || cellHeight > desc.pageSize) {
+			atlas.stats.rejectedCount++;
+			continue;
+		}
+		stbrp_rect rect{};
+		rect.id = int(i);
+		rect.w = int(cellWidth / alignment);
+		rect.h = int(cellHeight / alignment);
+		pending.push_back(rect);
+	}
+
+	const int pageUnits = int(desc.pageSize / alignment);
+	std::vector<stbrp_node> nodes(pageUnits);
+	while (!pending.empty()) {
+		stbrp_context context;
+		stbrp_init_target(&context, pageUnits, pageUnits, nodes.data(), pageUnits);
+		stbrp_pack_rects(&context, pending.data(), int(pending.size()));
+
+		const uint32_t page = uint32_t(atlas.pages.size());
+		std::vector<stbrp_rect> next;
+		for (const stbrp_rect& rect : pending) {
+			if (!rect.was_packed) {
+				next.push_back(rect);
+				continue;
+			}
+			TextureAtlasRegion& region = atlas.regions[rect.id];
+			const DirectX::Image* image = images[rect.id];
+			region.page = page;
+			region.cellX = uint32_t(rect.x) * alignment;
+			region.cellY = uint32_t(rect.y) * alignment;
+			region.cellWidth = uint32_t(rect.w) * alignment;
+			region.cellHeight = uint32_t(rect.h) * alignment;
+			region.x = region.cellX + gutter;
+			region.y = region.cellY + gutter;
+			region.width = uint32_t(image->width);
+			region.height = uint32_t(image->height);
+			const float inversePageSize = 1.0f / float(desc.pageSize);
+			region.uvTransform = Multiply(
+				MakeScaleMatrix({ float(region.width) * inversePageSize, float(region.height) * inversePageSize, 1.0f }),
+				MakeTranslateMatrix({ float(region.x) * inversePageSize, float(region.y) * inversePageSize, 0.0f }));
+			atlas.stats.packedCount++;
+			atlas.stats.contentPixels += size_t(region.width) * region.height;
+			atlas.stats.cellPixels += size_t(region.cellWidth) * region.cellHeight;
+		}
+		// 空のページに1つも入らないことは無い（ページより大きいものは先に外している）
+		assert(next.size() < pending.size());
+		pending.swap(next);
+
+		DirectX::ScratchImage base{};
+		HRESULT hr = base.Initialize2D(desc.format, desc.pageSize, desc.pageSize, 1, 1);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		std::memset(base.GetPixels(), 0, base.GetPixelsSize());
+		const DirectX::Image* pageImage = base.GetImage(0, 0, 0);
+		for (size_t i = 0; i < atlas.regions.size(); i++) {
+			if (atlas.regions[i].page == page) {
+				CopyWithGutter(*images[i], atlas.regions[i], bytesPerPixel, *pageImage);
+			}
+		}
+
+		// ボックスフィルタなら、揃えたセルの中だけで平均されるので隣と混ざらない
+		DirectX::ScratchImage mipChain{};
+		hr = desc.mipLevels > 1 ? GenerateMipMapsFast(*pageImage, MipFilter::Box, desc.mipLevels, mipChain, threadPool) : mipChain.InitializeFromImage(*pageImage);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		atlas.pages.push_back(std::move(mipChain));
+	}
+
+	atlas.stats.pageCount = atlas.pages.size();
+	atlas.stats.pagePixels = atlas.stats.pageCount * desc.pageSize * desc.pageSize;
+	atlas.stats.efficiency = atlas.stats.pagePixels != 0 ? float(double(atlas.stats.contentPixels) / double(atlas.stats.pagePixels)) : 0.0f;
+	return S_OK;
+}
+
+bool ValidateTextureAtlas(const TextureAtlas& atlas, const TextureAtlasDesc& desc) {
+	const uint32_t alignment = GetCellAlignment(desc);
+	const uint32_t gutter = GetGutter(desc);
+	for (size_t i = 0; i < atlas.regions.size(); i++) {
+		const TextureAtlasRegion& a = atlas.regions[i];
+		if (a.page == kAtlasNotPacked) {
+			continue;
+		}
+		if (a.page >= atlas.pages.size() ||
+			a.cellX % alignment != 0 || a.cellY % alignment != 0 || a.cellWidth % alignment != 0 || a.cellHeight % alignment != 0 ||
+			a.cellX + a.cellWidth > desc.pageSize || a.cellY + a.cellHeight > desc.pageSize) {
+			return false;
+		}
+		// 中身の周りに、どの方向にもガターがある
+		if (a.x < a.cellX + gutter || a.y < a.cellY + gutter ||
+			a.x + a.width + gutter > a.cellX + a.cellWidth || a.y + a.height + gutter > a.cellY + a.cellHeight) {
+			return false;
+		}
+		for (size_t j = i + 1; j < atlas.regions.size(); j++) {
+			const TextureAtlasRegion& b = atlas.regions[j];
+			if (b.page != a.page) {
+				continue;
+			}
+			const bool separated = a.cellX + a.cellWidth <= b.cellX || b.cellX + b.cellWidth <= a.cellX ||
+				a.cellY + a.cellHeight <= b.cellY || b.cellY + b.cellHeight <= a.cellY;
+			if (!separated) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::vector<TextureAtlasBenchmarkResult> RunTextureAtlasBenchmark() {
+	struct Case {
+		size_t count;
+		uint32_t minSize;
+		uint32_t maxSize;
+	};
+	// スプライト程度の小さいもの、アイコン程度の大量のもの、大きさがばらばらのもの
+	const Case cases[] = { { 800, 16, 128 }, { 4000, 8, 32 }, { 200, 8, 512 } };
+	TextureAtlasDesc desc;
+	ThreadPool threadPool;
+
+	std::vector<TextureAtlasBenchmarkResult> results;
+	std::mt19937 random(12345);
+	for (const Case& testCase : cases) {
+		TextureAtlasBenchmarkResult result;
+		result.inputCount = testCase.count;
+		result.minSize = testCase.minSize;
+		result.maxSize = testCase.maxSize;
+
+		// 単色の画像にしておくと、全ミップでセルの中が同じ色のままかを調べられる
+		std::uniform_int_distribution<uint32_t> sizeDistribution(testCase.minSize, testCase.maxSize);
+		std::vector<DirectX::ScratchImage> sources(testCase.count);
+		std::vector<const DirectX::Image*> images;
+		std::vector<uint32_t> colors;
+		bool initialized = true;
+		for (DirectX::ScratchImage& source : sources) {
+			if (FAILED(source.Initialize2D(desc.format, sizeDistribution(random), sizeDistribution(random), 1, 1))) {
+				initialized = false;
+				break;
+			}
+			const uint32_t color = random() | 0xFF000000u;
+			uint8_t* pixels = source.GetPixels();
+			for (size_t offset = 0; offset < source.GetPixelsSize(); offset += 4) {
+				std::memcpy(pixels + offset, &color, sizeof(color));
+			}
+			images.push_back(source.GetImage(0, 0, 0));
+			colors.push_back(color);
+		}
+		if (!initialized) {
+			results.push_back(result);
+			continue;
+		}
+
+		TextureAtlas atlas;
+		auto start = std::chrono::steady_clock::now();
+		HRESULT hr = BuildTextureAtlas(images, desc, atlas, &threadPool);
+		result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		result.stats = atlas.stats;
+		result.valid = SUCCEEDED(hr) && ValidateTextureAtlas(atlas, desc) && CheckSolidCells(atlas, colors);
+		results.push_back(result);
+	}
+	return results;
+}
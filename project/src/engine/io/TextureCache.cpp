@@ -0,0 +1,314 @@
+#include "engine/io/TextureCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include "engine/io/TextureCooker.h"
+
+namespace {
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+constexpr const char* kIndexHeader = "# CG2 texture cache index v2";
+
+// 8バイトずつFNV-1aの要領で混ぜる（テクスチャは大きいので1バイトずつだと遅い）
+// 上位ビットが下位に伝わるように、1回ごとにシフトして畳み込む
+uint64_t HashWords(const uint8_t* data, size_t size, uint64_t hash) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * kFnvPrime;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ data[i]) * kFnvPrime;
+	}
+	return hash;
+}
+
+uint64_t HashValue(uint64_t value, uint64_t hash) {
+	return HashWords(reinterpret_cast<const uint8_t*>(&value), sizeof(value), hash);
+}
+
+// ファイルのサイズと更新時刻（無ければfalse）
+bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& writeTime) {
+	std::error_code ec;
+	uintmax_t fileSize = std::filesystem::file_size(path, ec);
+	if (ec) {
+		return false;
+	}
+	auto fileTime = std::filesystem::last_write_time(path, ec);
+	if (ec) {
+		return false;
+	}
+	size = static_cast<uint64_t>(fileSize);
+	writeTime = static_cast<int64_t>(fileTime.time_since_epoch().count());
+	return true;
+}
+
+} // namespace
+
+std::string NormalizeTexturePath(const std::string& filePath) {
+	std::string key = std::filesystem::path(filePath).lexically_normal().generic_string();
+	// Windowsのパスは大文字小文字を区別しない
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return key;
+}
+
+uint64_t ComputeTextureContentHash(const DirectX::ScratchImage& image) {
+	const DirectX::TexMetadata& metadata = image.GetMetadata();
+	uint64_t hash = kFnvOffsetBasis;
+	hash = HashValue(metadata.width, hash);
+	hash = HashValue(metadata.height, hash);
+	hash = HashValue(metadata.depth, hash);
+	hash = HashValue(metadata.arraySize, hash);
+	hash = HashValue(metadata.mipLevels, hash);
+	hash = HashValue(static_cast<uint64_t>(metadata.format), hash);
+	hash = HashWords(image.GetPixels(), image.GetPixelsSize(), hash);
+	// 0は「未計算」扱いなので避ける
+	return hash == 0 ? 1 : hash;
+}
+
+TextureCache::TextureCache(const std::string& indexPath, CreateFunction create, DestroyFunction destroy)
+	: indexPath_(indexPath), create_(std::move(create)), destroy_(std::move(destroy)) {
+	assert(create_);
+	LoadIndex();
+}
+
+TextureCache::Handle TextureCache::Acquire(const std::string& filePath) {
+	Handle handle = AcquireIfKnown(filePath);
+	if (handle != kInvalidHandle) {
+		return handle;
+	}
+	DirectX::ScratchImage image;
+	if (FAILED(LoadTextureFile(filePath, image))) {
+		return kInvalidHandle;
+	}
+	return AcquireDecoded(filePath, std::move(image));
+}
+
+TextureCache::Handle TextureCache::AcquireIfKnown(const std::string& filePath) {
+	stats_.requestCount++;
+	const std::string key = NormalizeTexturePath(filePath);
+	auto pathIt = pathToHandle_.find(key);
+	if (pathIt != pathToHandle_.end()) {
+		stats_.hitCount++;
+		entries_[pathIt->second].refCount++;
+		return pathIt->second;
+	}
+
+	// 中身が分かっていて、それが読み込み済みならデコードしない
+	// （ハッシュに加えて形式・大きさ・ミップ数が一致するものに限る。ピクセルを比べる小さいテクスチャはデコードする）
+	IndexRecord record;
+	auto indexIt = index_.find(key);
+	if (indexIt != index_.end() && GetDataStamp(filePath, record) &&
+		indexIt->second.size == record.size && indexIt->second.writeTime == record.writeTime) {
+		Handle handle = FindContent(indexIt->second.content, nullptr);
+		if (handle != kInvalidHandle) {
+			stats_.decodeSkipCount++;
+			return AddReference(handle, key);
+		}
+	}
+	// AcquireDecodedで数え直すので、ここでは要求に数えない
+	stats_.requestCount--;
+	return kInvalidHandle;
+}
+
+TextureCache::Handle TextureCache::AcquireDecoded(const std::string& filePath, DirectX::ScratchImage&& image) {
+	stats_.requestCount++;
+	stats_.decodeCount++;
+	const std::string key = NormalizeTexturePath(filePath);
+	auto pathIt = pathToHandle_.find(key);
+	if (pathIt != pathToHandle_.end()) {
+		// 同じパスのデコードが並行して終わった
+		stats_.hitCount++;
+		entries_[pathIt->second].refCount++;
+		return pathIt->second;
+	}
+
+	IndexRecord record;
+	const bool hasStamp = GetDataStamp(filePath, record);
+	const DirectX::TexMetadata& metadata = image.GetMetadata();
+	record.content.hash = ComputeTextureContentHash(image);
+	record.content.width = metadata.width;
+	record.content.height = metadata.height;
+	record.content.mipLevels = metadata.mipLevels;
+	record.content.format = static_cast<uint32_t>(metadata.format);
+	if (hasStamp) {
+		IndexRecord& saved = index_[key];
+		if (saved.size != record.size || saved.writeTime != record.writeTime || !(saved.content == record.content)) {
+			saved = record;
+			indexDirty_ = true;
+		}
+	}
+
+	Handle existing = FindContent(record.content, &image);
+	if (existing != kInvalidHandle) {
+		return AddReference(existing, key);
+	}
+
+	Handle handle;
+	if (!freeHandles_.empty()) {
+		handle = freeHandles_.back();
+		freeHandles_.pop_back();
+	} else {
+		handle = static_cast<Handle>(entries_.size());
+		entries_.emplace_back();
+	}
+	Entry& entry = entries_[handle];
+	entry.content = record.content;
+	entry.bytes = image.GetPixelsSize();
+	if (entry.bytes <= kComparePixelBytes) {
+		entry.pixels.assign(image.GetPixels(), image.GetPixels() + entry.bytes);
+	}
+	entry.refCount = 1;
+	entry.alive = true;
+	entry.gpu = create_(std::move(image));
+
+	hashToHandle_.emplace(record.content.hash, handle);
+	pathToHandle_[key] = handle;
+	stats_.residentCount++;
+	stats_.residentBytes += entry.bytes;
+	return handle;
+}
+
+TextureCache::Handle TextureCache::FindContent(const ContentKey& content, const DirectX::ScratchImage* image) {
+	auto [begin, end] = hashToHandle_.equal_range(content.hash);
+	bool collided = false;
+	for (auto it = begin; it != end; ++it) {
+		const Entry& entry = entries_[it->second];
+		if (!image && !entry.pixels.empty()) {
+			// ピクセルを比べるテクスチャは、デコードしないと同じか分からない（小さいのでデコードしても安い）
+			continue;
+		}
+		const bool samePixels = entry.pixels.empty() ||
+			(entry.pixels.size() == image->GetPixelsSize() && std::memcmp(entry.pixels.data(), image->GetPixels(), entry.pixels.size()) == 0);
+		if (entry.content == content && samePixels) {
+			return it->second;
+		}
+		collided = true;
+	}
+	if (collided) {
+		stats_.hashCollisionCount++;
+	}
+	return kInvalidHandle;
+}
+
+TextureCache::Handle TextureCache::AddReference(Handle handle, const std::string& key) {
+	// 別のパスで同じ中身を読み込み済みだった
+	Entry& entry = entries_[handle];
+	entry.refCount++;
+	pathToHandle_[key] = handle;
+	stats_.deduplicatedCount++;
+	stats_.bytesSaved += entry.bytes;
+	return handle;
+}
+
+void TextureCache::Release(Handle handle) {
+	assert(handle < entries_.size() && entries_[handle].alive && entries_[handle].refCount > 0);
+	entries_[handle].refCount--;
+}
+
+void TextureCache::Trim() {
+	for (Handle handle = 0; handle < entries_.size(); ++handle) {
+		Entry& entry = entries_[handle];
+		if (!entry.alive || entry.refCount != 0) {
+			continue;
+		}
+		if (destroy_) {
+			destroy_(entry.gpu);
+		}
+		auto [begin, end] = hashToHandle_.equal_range(entry.content.hash);
+		for (auto it = begin; it != end; ++it) {
+			if (it->second == handle) {
+				hashToHandle_.erase(it);
+				break;
+			}
+		}
+		for (auto it = pathToHandle_.begin(); it != pathToHandle_.end();) {
+			it = it->second == handle ? pathToHandle_.erase(it) : std::next(it);
+		}
+		stats_.residentCount--;
+		stats_.residentBytes -= entry.bytes;
+		entry = Entry();
+		freeHandles_.push_back(handle);
+	}
+}
+
+bool TextureCache::GetDataStamp(const std::string& filePath, IndexRecord& record) {
+	const std::string dataPath = IsCookedTextureUpToDate(filePath) ? GetCookedTexturePath(filePath) : filePath;
+	return GetFileStamp(dataPath, record.size, record.writeTime);
+}
+
+TextureCache::Handle TextureCache::Find(const std::string& filePath) const {
+	auto it = pathToHandle_.find(NormalizeTexturePath(filePath));
+	return it != pathToHandle_.end() ? it->second : kInvalidHandle;
+}
+
+void TextureCache::LoadIndex() {
+	std::ifstream file(indexPath_);
+	if (!file.is_open()) {
+		return;
+	}
+	std::string line;
+	if (!std::getline(file, line) || line != kIndexHeader) {
+		// 形式が違う対応表は使わない（次の保存で作り直す）
+		indexDirty_ = true;
+		return;
+	}
+	// 1行 = ハッシュ(16進) サイズ 更新時刻 幅 高さ ミップ数 DXGI_FORMAT パス
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		IndexRecord record;
+		stream >> std::hex >> record.content.hash >> std::dec >> record.size >> record.writeTime >>
+			record.content.width >> record.content.height >> record.content.mipLevels >> record.content.format;
+		std::string key;
+		if (!stream || !std::getline(stream >> std::ws, key) || key.empty()) {
+			continue;
+		}
+		index_[key] = record;
+	}
+}
+
+bool TextureCache::SaveIndex() {
+	if (!indexDirty_) {
+		return true;
+	}
+	std::error_code ec;
+	std::filesystem::path path(indexPath_);
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path(), ec);
+	}
+
+	// 一時ファイルに書いてから置き換える
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file << kIndexHeader << '\n';
+		for (const auto& [key, record] : index_) {
+			file << std::hex << record.content.hash << std::dec << ' ' << record.size << ' ' << record.writeTime << ' ' <<
+				record.content.width << ' ' << record.content.height << ' ' << record.content.mipLevels << ' ' << record.content.format << ' ' <<
+				key << '\n';
+		}
+		if (!file) {
+			return false;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return false;
+	}
+	indexDirty_ = false;
+	return true;
+}
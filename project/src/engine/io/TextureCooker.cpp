@@ -0,0 +1,357 @@
+#include "engine/io/TextureCooker.h"
+
+#include <Windows.h>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include "engine/base/ThreadPool.h"
+#include "engine/io/TextureMipmaps.h"
+
+namespace {
+
+constexpr const char* kCookParametersHeader = "# CG2 texture cook v1";
+
+std::wstring ToWideString(const std::string& str) {
+	if (str.empty()) {
+		return std::wstring();
+	}
+	int sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), nullptr, 0);
+	if (sizeNeeded == 0) {
+		return std::wstring();
+	}
+	std::wstring result(sizeNeeded, 0);
+	MultiByteToWideChar(CP_UTF8, 0, str.data(), static_cast<int>(str.size()), result.data(), sizeNeeded);
+	return result;
+}
+
+// 元画像を読み込んでミップマップを作る（threadPoolがnullptrなら呼び出したスレッドだけで作る）
+HRESULT LoadSourceWithMipMaps(const std::string& sourcePath, DirectX::ScratchImage& mipImages, ThreadPool* threadPool) {
+	DirectX::ScratchImage image{};
+	std::wstring sourcePathW = ToWideString(sourcePath);
+	HRESULT hr = DirectX::LoadFromWICFile(sourcePathW.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	// RGBA8/sRGB/RGBA32Fで2のべき乗なら専用のカーネルで作る（それ以外はDirectX::GenerateMipMapsと同じ）
+	return GenerateMipMapsFast(*image.GetImage(0, 0, 0), MipFilter::Box, 0, mipImages, threadPool);
+}
+
+DXGI_FORMAT SelectFormat(TextureCompression compression, const DirectX::ScratchImage& image) {
+	const DirectX::TexMetadata& metadata = image.GetMetadata();
+	// BCはブロック（4x4）単位なので、最上位のサイズが4の倍数でないとD3D12で作れない
+	if (compression == TextureCompression::None || metadata.width % 4 != 0 || metadata.height % 4 != 0) {
+		return metadata.format;
+	}
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	switch (compression) {
+	case TextureCompression::BC1:
+		format = DXGI_FORMAT_BC1_UNORM;
+		break;
+	case TextureCompression::BC3:
+		format = DXGI_FORMAT_BC3_UNORM;
+		break;
+	case TextureCompression::BC7:
+		format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	default:
+		format = image.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+		break;
+	}
+	// 元画像がsRGBならsRGBのまま圧縮する
+	return DirectX::IsSRGB(metadata.format) ? DirectX::MakeSRGB(format) : format;
+}
+
+// 計測用の画像を作る。単色だと圧縮が簡単すぎるので、グラデーションと模様を混ぜる
+HRESULT MakeBenchmarkImage(size_t width, size_t height, DirectX::ScratchImage& image) {
+	HRESULT hr = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	const DirectX::Image* pixels = image.GetImage(0, 0, 0);
+	uint32_t seed = 12345;
+	for (size_t y = 0; y < height; y++) {
+		uint8_t* row = pixels->pixels + y * pixels->rowPitch;
+		for (size_t x = 0; x < width; x++) {
+			seed = seed * 1664525u + 1013904223u;
+			uint8_t noise = static_cast<uint8_t>(seed >> 28);
+			row[x * 4 + 0] = static_cast<uint8_t>(x * 255 / width + noise);
+			row[x * 4 + 1] = static_cast<uint8_t>(y * 255 / height + noise);
+			row[x * 4 + 2] = static_cast<uint8_t>(((x / 16) ^ (y / 16)) & 1 ? 200 : 40);
+			row[x * 4 + 3] = static_cast<uint8_t>((x + y) * 255 / (width + height));
+		}
+	}
+	return S_OK;
+}
+
+bool IsSamePixels(const DirectX::ScratchImage& lhs, const DirectX::ScratchImage& rhs) {
+	return lhs.GetPixelsSize() == rhs.GetPixelsSize() &&
+		std::memcmp(lhs.GetPixels(), rhs.GetPixels(), lhs.GetPixelsSize()) == 0;
+}
+
+// 1行目がヘッダー、2行目が「バージョン 圧縮形式 DXGI_FORMAT ミップ数 元画像のサイズ」
+bool ReadCookParameters(const std::string& path, TextureCookParameters& parameters) {
+	std::ifstream file(path);
+	std::string line;
+	if (!file.is_open() || !std::getline(file, line) || line != kCookParametersHeader || !std::getline(file, line)) {
+		return false;
+	}
+	std::istringstream stream(line);
+	uint32_t compression = 0, format = 0;
+	stream >> parameters.version >> compression >> format >> parameters.mipLevels >> parameters.sourceSize;
+	if (!stream || compression > static_cast<uint32_t>(TextureCompression::BC7)) {
+		return false;
+	}
+	parameters.compression = static_cast<TextureCompression>(compression);
+	parameters.format = static_cast<DXGI_FORMAT>(format);
+	return true;
+}
+
+bool WriteCookParameters(const std::string& path, const TextureCookParameters& parameters) {
+	// 一時ファイルに書いてから置き換える
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file << kCookParametersHeader << '\n';
+		file << parameters.version << ' ' << static_cast<uint32_t>(parameters.compression) << ' ' << static_cast<uint32_t>(parameters.format) << ' ' <<
+			parameters.mipLevels << ' ' << parameters.sourceSize << '\n';
+		if (!file) {
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+std::string GetCookedTexturePath(const std::string& sourcePath) {
+	std::filesystem::path path(sourcePath);
+	path.replace_extension(".dds");
+	return path.generic_string();
+}
+
+std::string GetCookParametersPath(const std::string& sourcePath) {
+	std::filesystem::path path(sourcePath);
+	path.replace_extension(".cook");
+	return path.generic_string();
+}
+
+bool IsCookedTextureUpToDate(const std::string& sourcePath, const TextureCompression* compression) {
+	std::error_code ec;
+	const std::string cookedPath = GetCookedTexturePath(sourcePath);
+	auto cookedTime = std::filesystem::last_write_time(cookedPath, ec);
+	if (ec) {
+		return false;
+	}
+	auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+	// 元画像が無い場合（DDSだけ配布する場合）はDDSを使う
+	if (ec) {
+		return true;
+	}
+	if (cookedTime < sourceTime) {
+		return false;
+	}
+
+	// 更新時刻だけでは、違う設定でクックしたDDSや、元画像を古い日付のまま差し替えたことに気づけない
+	TextureCookParameters parameters;
+	if (!ReadCookParameters(GetCookParametersPath(sourcePath), parameters) || parameters.version != kTextureCookVersion) {
+		return false;
+	}
+	if (compression && parameters.compression != *compression) {
+		return false;
+	}
+	if (std::filesystem::file_size(sourcePath, ec) != parameters.sourceSize || ec) {
+		return false;
+	}
+	// DDSが別の手段で書き換えられていないか（ヘッダーだけ読む）
+	DirectX::TexMetadata metadata{};
+	std::wstring cookedPathW = ToWideString(cookedPath);
+	if (FAILED(DirectX::GetMetadataFromDDSFile(cookedPathW.c_str(), DirectX::DDS_FLAGS_NONE, metadata))) {
+		return false;
+	}
+	return metadata.format == parameters.format && metadata.mipLevels == parameters.mipLevels;
+}
+
+TextureCookResult CookTexture(const std::string& sourcePath, TextureCompression compression, ThreadPool* threadPool) {
+	auto start = std::chrono::steady_clock::now();
+	TextureCookResult result;
+	result.sourcePath = sourcePath;
+	result.cookedPath = GetCookedTexturePath(sourcePath);
+
+	TextureCookParameters parameters;
+	parameters.compression = compression;
+	std::error_code ec;
+	parameters.sourceSize = std::filesystem::file_size(sourcePath, ec);
+	if (ec) {
+		return result;
+	}
+
+	DirectX::ScratchImage mipImages{};
+	HRESULT hr = LoadSourceWithMipMaps(sourcePath, mipImages, threadPool);
+	if (FAILED(hr)) {
+		return result;
+	}
+	result.uncompressedBytes = mipImages.GetPixelsSize();
+
+	DXGI_FORMAT format = SelectFormat(compression, mipImages);
+	DirectX::ScratchImage compressed{};
+	const DirectX::ScratchImage* output = &mipImages;
+	if (format != mipImages.GetMetadata().format) {
+		// BC7は通常モードだとCPUでは非常に遅いので、QUICKモードを使う
+		DirectX::TEX_COMPRESS_FLAGS flags = DirectX::TEX_COMPRESS_PARALLEL;
+		if (compression == TextureCompression::BC7) {
+			flags |= DirectX::TEX_COMPRESS_BC7_QUICK;
+		}
+		hr = DirectX::Compress(mipImages.GetImages(), mipImages.GetImageCount(), mipImages.GetMetadata(),
+			format, flags, DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+		if (FAILED(hr)) {
+			return result;
+		}
+		output = &compressed;
+	}
+
+	// 古い設定を先に消しておく（DDSだけ書き換わって止まっても、古い設定で最新とみなさない）
+	const std::string parametersPath = GetCookParametersPath(sourcePath);
+	std::filesystem::remove(parametersPath, ec);
+
+	// 一時ファイルに書いてから置き換える（途中で止まっても壊れたDDSを残さない）
+	std::string temporaryPath = result.cookedPath + ".tmp";
+	std::wstring temporaryPathW = ToWideString(temporaryPath);
+	hr = DirectX::SaveToDDSFile(output->GetImages(), output->GetImageCount(), output->GetMetadata(),
+		DirectX::DDS_FLAGS_NONE, temporaryPathW.c_str());
+	if (FAILED(hr)) {
+		return result;
+	}
+	std::filesystem::rename(temporaryPath, result.cookedPath, ec);
+	if (ec) {
+		std::filesystem::remove(temporaryPath, ec);
+		return result;
+	}
+	parameters.format = output->GetMetadata().format;
+	parameters.mipLevels = output->GetMetadata().mipLevels;
+	if (!WriteCookParameters(parametersPath, parameters)) {
+		return result;
+	}
+
+	result.succeeded = true;
+	result.format = output->GetMetadata().format;
+	result.cookedBytes = output->GetPixelsSize();
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+std::vector<TextureCookResult> CookTextures(const std::string& directory, TextureCompression compression, bool force) {
+	std::vector<TextureCookResult> results;
+	// ミップマップの作成は全ての画像で同じプールを使う
+	ThreadPool threadPool;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+		if (!entry.is_regular_file() || entry.path().extension() != ".png") {
+			continue;
+		}
+		std::string sourcePath = entry.path().generic_string();
+		if (!force && IsCookedTextureUpToDate(sourcePath, &compression)) {
+			continue;
+		}
+		results.push_back(CookTexture(sourcePath, compression, &threadPool));
+	}
+	return results;
+}
+
+TextureCompression ParseTextureCompression(const std::string& commandLine) {
+	if (commandLine.find("-nocompress") != std::string::npos) {
+		return TextureCompression::None;
+	}
+	if (commandLine.find("-bc1") != std::string::npos) {
+		return TextureCompression::BC1;
+	}
+	if (commandLine.find("-bc3") != std::string::npos) {
+		return TextureCompression::BC3;
+	}
+	if (commandLine.find("-bc7") != std::string::npos) {
+		return TextureCompression::BC7;
+	}
+	return TextureCompression::Auto;
+}
+
+std::vector<TextureCompressBenchmarkResult> RunTextureCompressBenchmark() {
+	const size_t sizes[] = { 2048, 4096 };
+	const DXGI_FORMAT formats[] = { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_BC7_UNORM };
+
+	std::vector<TextureCompressBenchmarkResult> results;
+	for (size_t size : sizes) {
+		DirectX::ScratchImage source{};
+		if (FAILED(MakeBenchmarkImage(size, size, source))) {
+			continue;
+		}
+		const double megapixels = static_cast<double>(size) * static_cast<double>(size) / 1e6;
+		for (DXGI_FORMAT format : formats) {
+			// BC7は通常モードだと4Kで数分かかるので、クックと同じQUICKモードで測る
+			DirectX::TEX_COMPRESS_FLAGS flags = DirectX::TEX_COMPRESS_DEFAULT;
+			if (format == DXGI_FORMAT_BC7_UNORM) {
+				flags |= DirectX::TEX_COMPRESS_BC7_QUICK;
+			}
+
+			TextureCompressBenchmarkResult result;
+			result.format = format;
+			result.width = size;
+			result.height = size;
+
+			DirectX::ScratchImage serial{};
+			auto start = std::chrono::steady_clock::now();
+			HRESULT hr = DirectX::Compress(*source.GetImage(0, 0, 0), format, flags, DirectX::TEX_THRESHOLD_DEFAULT, serial);
+			double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			DirectX::ScratchImage parallel{};
+			start = std::chrono::steady_clock::now();
+			HRESULT hrParallel = DirectX::Compress(*source.GetImage(0, 0, 0), format, flags | DirectX::TEX_COMPRESS_PARALLEL,
+				DirectX::TEX_THRESHOLD_DEFAULT, parallel);
+			double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (FAILED(hr) || FAILED(hrParallel)) {
+				results.push_back(result);
+				continue;
+			}
+
+			result.serialMegapixelsPerSecond = megapixels / serialSeconds;
+			result.parallelMegapixelsPerSecond = megapixels / parallelSeconds;
+			result.identical = IsSamePixels(serial, parallel);
+			results.push_back(result);
+		}
+	}
+	return results;
+}
+
+HRESULT LoadTextureFile(const std::string& filePath, DirectX::ScratchImage& image) {
+	// 変換済みのDDSがあれば、読むだけで使える（ミップマップも圧縮も済んでいる）
+	if (IsCookedTextureUpToDate(filePath)) {
+		std::wstring cookedPathW = ToWideString(GetCookedTexturePath(filePath));
+		HRESULT hr = DirectX::LoadFromDDSFile(cookedPathW.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image);
+		if (SUCCEEDED(hr)) {
+			return hr;
+		}
+	}
+
+	// テクスチャファイルを読んでミップマップを作る
+	// ローダーのワーカーから並んで呼ばれるので、1枚の中では分けない（ワーカーごとにスレッドを起こさない）
+	return LoadSourceWithMipMaps(filePath, image, nullptr);
+}
+
+DirectX::ScratchImage LoadTexture(const std::string& filePath) {
+	DirectX::ScratchImage mipImages{};
+	HRESULT hr = LoadTextureFile(filePath, mipImages);
+	assert(SUCCEEDED(hr)); // テクスチャの読み込みかミップマップの生成に失敗したらエラー
+	return mipImages;
+}
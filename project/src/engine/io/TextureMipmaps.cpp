@@ -0,0 +1,517 @@
+#include "engine/io/TextureMipmaps.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "engine/base/ThreadPool.h"
+#include "engine/math/MathSimd.h"
+
+namespace {
+
+enum class PixelKind {
+	Unorm8,  // RGBA8/BGRA8（チャンネルの順番は平均に関係ない）
+	Srgb8,   // RGBA8/BGRA8のsRGB（RGBだけガンマ、アルファは線形）
+	Float32, // RGBA32F
+};
+
+bool GetPixelKind(DXGI_FORMAT format, PixelKind& kind) {
+	switch (format) {
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		kind = PixelKind::Unorm8;
+		return true;
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		kind = PixelKind::Srgb8;
+		return true;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		kind = PixelKind::Float32;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool IsPow2(size_t x) {
+	return x != 0 && (x & (x - 1)) == 0;
+}
+
+// sRGBと線形の変換テーブル
+// 線形→sRGBは0～1を65536段階に分けて引く（8bitに戻すので、最も傾きの大きい0付近でも誤差は0.05段階以下）
+struct SrgbTables {
+	float toLinear[256];
+	uint8_t fromLinear[65536];
+
+	SrgbTables() {
+		for (int i = 0; i < 256; i++) {
+			double c = i / 255.0;
+			toLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+		}
+		for (int i = 0; i < 65536; i++) {
+			double l = i / 65535.0;
+			double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+			fromLinear[i] = static_cast<uint8_t>(std::lround(std::clamp(c, 0.0, 1.0) * 255.0));
+		}
+	}
+};
+
+const SrgbTables& GetSrgbTables() {
+	static const SrgbTables tables;
+	return tables;
+}
+
+// 1タスクで使う作業用の行
+struct RowScratch {
+	std::vector<float> decoded;    // sRGBを線形floatに戻した入力行
+	std::vector<float> floatRow;   // 縦方向に畳み込んだ行（Triangle）
+	std::vector<uint16_t> wideRow; // UNORMのTriangleで縦方向に畳み込んだ行
+	std::vector<float> outputRow;  // sRGBに戻す前の出力行
+};
+
+//-------------------------------------------------------------------------------------
+// RGBA8 UNORM（整数のまま計算する）
+
+// sum / 2^shiftを四捨五入する
+// （DirectXTexはfloatで平均してから丸めるので、ちょうど0.5になるところは1段階ずれることがある）
+inline uint8_t RoundShift(uint32_t sum, int shift) {
+	return static_cast<uint8_t>((sum + (1u << (shift - 1))) >> shift);
+}
+
+#if MATH_USE_SSE2
+inline __m128i SimdRoundShift(__m128i sum, int shift, __m128i one) {
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_slli_epi16(one, shift - 1)), shift);
+}
+#endif
+
+// 2x2の平均。srcWidthが1のときは縦の2ピクセルの平均になる
+void BoxRowUnorm8(const uint8_t* row0, const uint8_t* row1, size_t srcWidth, uint8_t* dst, size_t dstWidth) {
+	if (srcWidth == 1) {
+		for (int c = 0; c < 4; c++) {
+			dst[c] = RoundShift(row0[c] * 2 + row1[c] * 2, 2);
+		}
+		return;
+	}
+	size_t x = 0;
+#if MATH_USE_SSE2
+	// 入力8ピクセル（32バイト）から出力4ピクセルを作る
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	for (; x + 4 <= dstWidth; x += 4) {
+		__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+		__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+		__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+		// 16bitに広げて縦に足す（1レジスタに2ピクセル）
+		__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+		__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+		__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+		__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+		// 隣のピクセルと横に足す
+		__m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+		__m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+		d01 = SimdRoundShift(d01, 2, one);
+		d23 = SimdRoundShift(d23, 2, one);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(d01, d23));
+	}
+#endif
+	for (; x < dstWidth; x++) {
+		for (int c = 0; c < 4; c++) {
+			size_t i = x * 8 + c;
+			dst[x * 4 + c] = RoundShift(row0[i] + row0[i + 4] + row1[i] + row1[i + 4], 2);
+		}
+	}
+}
+
+// 縦横に1:7:7:1で畳み込む。rowsは入力の2y-1, 2y, 2y+1, 2y+2行目（端は複製済み）
+// 縦の結果は最大255*16、横の結果は最大255*256なので16bitに収まる
+void TriangleRowUnorm8(const uint8_t* const rows[4], size_t srcWidth, uint8_t* dst, size_t dstWidth, std::vector<uint16_t>& wideRow) {
+	// 左に1ピクセル、右に2ピクセル端を複製した行を作る（srcWidthが1でも4タップ分読める）
+	wideRow.resize((srcWidth + 3) * 4);
+	uint16_t* wide = wideRow.data() + 4;
+	const size_t count = srcWidth * 4;
+	size_t i = 0;
+#if MATH_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[0] + i));
+		__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[1] + i));
+		__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[2] + i));
+		__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[3] + i));
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r3, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r3, zero));
+		__m128i midLo = _mm_add_epi16(_mm_unpacklo_epi8(r1, zero), _mm_unpacklo_epi8(r2, zero));
+		__m128i midHi = _mm_add_epi16(_mm_unpackhi_epi8(r1, zero), _mm_unpackhi_epi8(r2, zero));
+		lo = _mm_add_epi16(lo, _mm_sub_epi16(_mm_slli_epi16(midLo, 3), midLo));
+		hi = _mm_add_epi16(hi, _mm_sub_epi16(_mm_slli_epi16(midHi, 3), midHi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(wide + i), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(wide + i + 8), hi);
+	}
+#endif
+	for (; i < count; i++) {
+		wide[i] = static_cast<uint16_t>(rows[0][i] + 7 * (rows[1][i] + rows[2][i]) + rows[3][i]);
+	}
+	std::memcpy(wide - 4, wide, sizeof(uint16_t) * 4);
+	std::memcpy(wide + count, wide + count - 4, sizeof(uint16_t) * 4);
+	std::memcpy(wide + count + 4, wide + count - 4, sizeof(uint16_t) * 4);
+
+	// 出力xは複製込みの行の2x～2x+3ピクセル目を使う
+	const uint16_t* padded = wideRow.data();
+	size_t x = 0;
+#if MATH_USE_SSE2
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded));
+	for (; x + 2 <= dstWidth; x += 2) {
+		// 1レジスタに2ピクセル。出力x = lo(Rx) + 7*(hi(Rx) + lo(Rx+1)) + hi(Rx+1)
+		__m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded + (x + 1) * 8));
+		__m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded + (x + 2) * 8));
+		__m128i outer = _mm_add_epi16(_mm_unpacklo_epi64(current, next), _mm_unpackhi_epi64(next, last));
+		__m128i inner = _mm_add_epi16(_mm_unpackhi_epi64(current, next), _mm_unpacklo_epi64(next, last));
+		__m128i sum = _mm_add_epi16(outer, _mm_sub_epi16(_mm_slli_epi16(inner, 3), inner));
+		sum = SimdRoundShift(sum, 8, one);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(sum, sum));
+		current = last;
+	}
+#endif
+	for (; x < dstWidth; x++) {
+		const uint16_t* p = padded + x * 8;
+		for (int c = 0; c < 4; c++) {
+			uint32_t sum = p[c] + 7u * (p[c + 4] + p[c + 8]) + p[c + 12];
+			dst[x * 4 + c] = RoundShift(sum, 8);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// float（RGBA32FとsRGBを線形に戻した行）
+
+// 2x2の平均。足す順番はDirectXTexのボックスフィルタと同じ
+void BoxRowFloat(const float* row0, const float* row1, size_t srcWidth, float* dst, size_t dstWidth) {
+	const size_t step = srcWidth == 1 ? 0 : 4;
+	for (size_t x = 0; x < dstWidth; x++) {
+		const float* p0 = row0 + x * 8;
+		const float* p1 = row1 + x * 8;
+#if MATH_USE_SSE2
+		__m128 sum = _mm_add_ps(_mm_loadu_ps(p0), _mm_loadu_ps(p1));
+		sum = _mm_add_ps(sum, _mm_loadu_ps(p0 + step));
+		sum = _mm_add_ps(sum, _mm_loadu_ps(p1 + step));
+		_mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+		for (int c = 0; c < 4; c++) {
+			dst[x * 4 + c] = (p0[c] + p1[c] + p0[c + step] + p1[c + step]) * 0.25f;
+		}
+#endif
+	}
+}
+
+// 縦横に1:7:7:1で畳み込む
+void TriangleRowFloat(const float* const rows[4], size_t srcWidth, float* dst, size_t dstWidth, std::vector<float>& floatRow) {
+	floatRow.resize((srcWidth + 3) * 4);
+	float* wide = floatRow.data() + 4;
+	const size_t count = srcWidth * 4;
+	size_t i = 0;
+#if MATH_USE_SSE2
+	const __m128 outerWeight = _mm_set1_ps(1.0f / 16.0f);
+	const __m128 innerWeight = _mm_set1_ps(7.0f / 16.0f);
+	for (; i < count; i += 4) {
+		__m128 outer = _mm_add_ps(_mm_loadu_ps(rows[0] + i), _mm_loadu_ps(rows[3] + i));
+		__m128 inner = _mm_add_ps(_mm_loadu_ps(rows[1] + i), _mm_loadu_ps(rows[2] + i));
+		_mm_storeu_ps(wide + i, _mm_add_ps(_mm_mul_ps(outer, outerWeight), _mm_mul_ps(inner, innerWeight)));
+	}
+#else
+	for (; i < count; i++) {
+		wide[i] = (rows[0][i] + rows[3][i]) * (1.0f / 16.0f) + (rows[1][i] + rows[2][i]) * (7.0f / 16.0f);
+	}
+#endif
+	std::memcpy(wide - 4, wide, sizeof(float) * 4);
+	std::memcpy(wide + count, wide + count - 4, sizeof(float) * 4);
+	std::memcpy(wide + count + 4, wide + count - 4, sizeof(float) * 4);
+
+	const float* padded = floatRow.data();
+	for (size_t x = 0; x < dstWidth; x++) {
+		const float* p = padded + x * 8;
+#if MATH_USE_SSE2
+		__m128 outer = _mm_add_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 12));
+		__m128 inner = _mm_add_ps(_mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8));
+		_mm_storeu_ps(dst + x * 4, _mm_add_ps(_mm_mul_ps(outer, outerWeight), _mm_mul_ps(inner, innerWeight)));
+#else
+		for (int c = 0; c < 4; c++) {
+			dst[x * 4 + c] = (p[c] + p[c + 12]) * (1.0f / 16.0f) + (p[c + 4] + p[c + 8]) * (7.0f / 16.0f);
+		}
+#endif
+	}
+}
+
+// sRGBの1行を線形のfloatにする
+void DecodeSrgbRow(const uint8_t* src, size_t width, float* dst) {
+	const float* toLinear = GetSrgbTables().toLinear;
+	for (size_t x = 0; x < width; x++) {
+		dst[x * 4 + 0] = toLinear[src[x * 4 + 0]];
+		dst[x * 4 + 1] = toLinear[src[x * 4 + 1]];
+		dst[x * 4 + 2] = toLinear[src[x * 4 + 2]];
+		dst[x * 4 + 3] = src[x * 4 + 3] * (1.0f / 255.0f);
+	}
+}
+
+// 線形のfloatの1行をsRGBに戻す
+void EncodeSrgbRow(const float* src, size_t width, uint8_t* dst) {
+	const uint8_t* fromLinear = GetSrgbTables().fromLinear;
+	for (size_t x = 0; x < width; x++) {
+#if MATH_USE_SSE2
+		__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + x * 4), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		alignas(16) int32_t index[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(index),
+			_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f))));
+		dst[x * 4 + 0] = fromLinear[index[0]];
+		dst[x * 4 + 1] = fromLinear[index[1]];
+		dst[x * 4 + 2] = fromLinear[index[2]];
+		dst[x * 4 + 3] = static_cast<uint8_t>(_mm_cvtsi128_si32(_mm_cvtps_epi32(_mm_mul_ps(MATH_SWIZZLE(value, 3, 3, 3, 3), _mm_set1_ps(255.0f)))));
+#else
+		for (int c = 0; c < 3; c++) {
+			float value = std::clamp(src[x * 4 + c], 0.0f, 1.0f);
+			dst[x * 4 + c] = fromLinear[static_cast<int32_t>(value * 65535.0f + 0.5f)];
+		}
+		dst[x * 4 + 3] = static_cast<uint8_t>(std::lrint(std::clamp(src[x * 4 + 3], 0.0f, 1.0f) * 255.0f));
+#endif
+	}
+}
+
+//-------------------------------------------------------------------------------------
+
+// 出力の[rowBegin, rowEnd)行を作る
+void DownsampleRows(const DirectX::Image& src, const DirectX::Image& dst, PixelKind kind, MipFilter filter,
+	size_t rowBegin, size_t rowEnd, RowScratch& scratch) {
+	const bool triangle = filter == MipFilter::Triangle;
+	const size_t lastSrcRow = src.height - 1;
+	auto clampRow = [lastSrcRow](ptrdiff_t row) {
+		return static_cast<size_t>(std::clamp<ptrdiff_t>(row, 0, static_cast<ptrdiff_t>(lastSrcRow)));
+	};
+
+	// sRGBはこのタスクで使う入力行をまとめて線形に戻しておく
+	const size_t firstSrcRow = clampRow(static_cast<ptrdiff_t>(rowBegin * 2) - (triangle ? 1 : 0));
+	if (kind == PixelKind::Srgb8) {
+		size_t endSrcRow = clampRow(static_cast<ptrdiff_t>(rowEnd * 2) - 1 + (triangle ? 1 : 0)) + 1;
+		scratch.decoded.resize((endSrcRow - firstSrcRow) * src.width * 4);
+		for (size_t row = firstSrcRow; row < endSrcRow; row++) {
+			DecodeSrgbRow(src.pixels + row * src.rowPitch, src.width, scratch.decoded.data() + (row - firstSrcRow) * src.width * 4);
+		}
+	}
+	auto srcRow = [&](ptrdiff_t row) -> const uint8_t* {
+		size_t clamped = clampRow(row);
+		if (kind == PixelKind::Srgb8) {
+			return reinterpret_cast<const uint8_t*>(scratch.decoded.data() + (clamped - firstSrcRow) * src.width * 4);
+		}
+		return src.pixels + clamped * src.rowPitch;
+	};
+
+	for (size_t y = rowBegin; y < rowEnd; y++) {
+		const ptrdiff_t top = static_cast<ptrdiff_t>(y * 2);
+		uint8_t* dstRow = dst.pixels + y * dst.rowPitch;
+		if (kind == PixelKind::Unorm8) {
+			if (triangle) {
+				const uint8_t* rows[4] = { srcRow(top - 1), srcRow(top), srcRow(top + 1), srcRow(top + 2) };
+				TriangleRowUnorm8(rows, src.width, dstRow, dst.width, scratch.wideRow);
+			} else {
+				BoxRowUnorm8(srcRow(top), srcRow(top + 1), src.width, dstRow, dst.width);
+			}
+			continue;
+		}
+
+		// floatで計算する。RGBA32Fは出力へ直接書き、sRGBは作業用の行に書いてから戻す
+		float* output = reinterpret_cast<float*>(dstRow);
+		if (kind == PixelKind::Srgb8) {
+			scratch.outputRow.resize(dst.width * 4);
+			output = scratch.outputRow.data();
+		}
+		if (triangle) {
+			const float* rows[4] = {
+				reinterpret_cast<const float*>(srcRow(top - 1)), reinterpret_cast<const float*>(srcRow(top)),
+				reinterpret_cast<const float*>(srcRow(top + 1)), reinterpret_cast<const float*>(srcRow(top + 2)) };
+			TriangleRowFloat(rows, src.width, output, dst.width, scratch.floatRow);
+		} else {
+			BoxRowFloat(reinterpret_cast<const float*>(srcRow(top)), reinterpret_cast<const float*>(srcRow(top + 1)),
+				src.width, output, dst.width);
+		}
+		if (kind == PixelKind::Srgb8) {
+			EncodeSrgbRow(output, dst.width, dstRow);
+		}
+	}
+}
+
+// 1レベル分を縮小する。行をまとめたタスクに分けてスレッドプールで処理する
+void Downsample(const DirectX::Image& src, const DirectX::Image& dst, PixelKind kind, MipFilter filter, ThreadPool* threadPool) {
+	// 1タスクで出力16Kピクセル程度（これより細かいと分配の手間の方が大きくなる）
+	const size_t kPixelsPerTask = 16 * 1024;
+	const size_t rowsPerTask = std::max<size_t>(1, kPixelsPerTask / dst.width);
+	const size_t taskCount = (dst.height + rowsPerTask - 1) / rowsPerTask;
+	auto runTask = [&](size_t task) {
+		RowScratch scratch;
+		size_t rowBegin = task * rowsPerTask;
+		DownsampleRows(src, dst, kind, filter, rowBegin, (std::min)(dst.height, rowBegin + rowsPerTask), scratch);
+	};
+	if (threadPool && taskCount > 1) {
+		threadPool->ParallelFor(taskCount, runTask);
+	} else {
+		for (size_t task = 0; task < taskCount; task++) {
+			runTask(task);
+		}
+	}
+}
+
+// 計測用の画像を作る（グラデーションと模様と雑音を混ぜる）
+HRESULT MakeBenchmarkImage(size_t width, size_t height, DXGI_FORMAT format, DirectX::ScratchImage& image) {
+	DirectX::ScratchImage rgba8{};
+	HRESULT hr = rgba8.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	const DirectX::Image* pixels = rgba8.GetImage(0, 0, 0);
+	uint32_t seed = 12345;
+	for (size_t y = 0; y < height; y++) {
+		uint8_t* row = pixels->pixels + y * pixels->rowPitch;
+		for (size_t x = 0; x < width; x++) {
+			seed = seed * 1664525u + 1013904223u;
+			uint8_t noise = static_cast<uint8_t>(seed >> 27);
+			row[x * 4 + 0] = static_cast<uint8_t>(x * 255 / width + noise);
+			row[x * 4 + 1] = static_cast<uint8_t>(y * 255 / height + noise);
+			row[x * 4 + 2] = static_cast<uint8_t>(((x / 8) ^ (y / 8)) & 1 ? 220 : 30);
+			row[x * 4 + 3] = static_cast<uint8_t>((x + y) * 255 / (width + height));
+		}
+	}
+	if (format == DXGI_FORMAT_R8G8B8A8_UNORM) {
+		return image.InitializeFromImage(*pixels);
+	}
+	if (format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) {
+		// 同じバイト列をsRGBとして扱う
+		DirectX::Image srgb = *pixels;
+		srgb.format = format;
+		return image.InitializeFromImage(srgb);
+	}
+	return DirectX::Convert(*pixels, format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, image);
+}
+
+// 2つのミップマップチェーンの最大誤差（8bitは段階数、floatは値の差）
+float MeasureMaxError(const DirectX::ScratchImage& lhs, const DirectX::ScratchImage& rhs, PixelKind kind) {
+	float maxError = 0.0f;
+	const size_t levels = (std::min)(lhs.GetMetadata().mipLevels, rhs.GetMetadata().mipLevels);
+	for (size_t level = 0; level < levels; level++) {
+		const DirectX::Image* a = lhs.GetImage(level, 0, 0);
+		const DirectX::Image* b = rhs.GetImage(level, 0, 0);
+		for (size_t y = 0; y < a->height; y++) {
+			const uint8_t* rowA = a->pixels + y * a->rowPitch;
+			const uint8_t* rowB = b->pixels + y * b->rowPitch;
+			for (size_t i = 0; i < a->width * 4; i++) {
+				float error = kind == PixelKind::Float32 ?
+					std::fabs(reinterpret_cast<const float*>(rowA)[i] - reinterpret_cast<const float*>(rowB)[i]) :
+					static_cast<float>(std::abs(rowA[i] - rowB[i]));
+				maxError = (std::max)(maxError, error);
+			}
+		}
+	}
+	return maxError;
+}
+
+// 従来の経路との差の許容範囲（8bitは段階数、RGBA32Fは値の差）
+// 8bitのボックスは、ちょうど半分になる値の丸め方が違い、それが下のレベルへ積み重なるので2段階まで
+float GetMaxErrorTolerance(PixelKind kind, MipFilter filter) {
+	switch (kind) {
+	case PixelKind::Unorm8:
+		return filter == MipFilter::Box ? 2.0f : 1.0f;
+	case PixelKind::Srgb8:
+		return 1.0f;
+	case PixelKind::Float32:
+		return 1e-6f;
+	}
+	return 0.0f;
+}
+
+} // namespace
+
+bool CanGenerateMipMapsFast(DXGI_FORMAT format, size_t width, size_t height) {
+	PixelKind kind;
+	return GetPixelKind(format, kind) && IsPow2(width) && IsPow2(height);
+}
+
+HRESULT GenerateMipMapsFast(const DirectX::Image& baseImage, MipFilter filter, size_t levels,
+	DirectX::ScratchImage& mipChain, ThreadPool* threadPool) {
+	PixelKind kind;
+	if (!GetPixelKind(baseImage.format, kind) || !IsPow2(baseImage.width) || !IsPow2(baseImage.height)) {
+		// ボックスフィルタは2のべき乗しか扱えないので、DirectXTexに任せる（既定ではリニアになる）
+		DirectX::TEX_FILTER_FLAGS flags = filter == MipFilter::Triangle ? DirectX::TEX_FILTER_TRIANGLE : DirectX::TEX_FILTER_DEFAULT;
+		return DirectX::GenerateMipMaps(baseImage, flags, levels, mipChain);
+	}
+
+	size_t maxLevels = 1;
+	for (size_t size = (std::max)(baseImage.width, baseImage.height); size > 1; size >>= 1) {
+		maxLevels++;
+	}
+	if (levels == 0) {
+		levels = maxLevels;
+	} else if (levels > maxLevels) {
+		return E_INVALIDARG;
+	}
+
+	HRESULT hr = mipChain.Initialize2D(baseImage.format, baseImage.width, baseImage.height, 1, levels);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	const DirectX::Image* top = mipChain.GetImage(0, 0, 0);
+	const size_t rowBytes = (std::min)(baseImage.rowPitch, top->rowPitch);
+	for (size_t y = 0; y < baseImage.height; y++) {
+		std::memcpy(top->pixels + y * top->rowPitch, baseImage.pixels + y * baseImage.rowPitch, rowBytes);
+	}
+
+	// 小さい画像は分配する方が高くつく
+	if (baseImage.width * baseImage.height < 256 * 256) {
+		threadPool = nullptr;
+	}
+	for (size_t level = 1; level < levels; level++) {
+		Downsample(*mipChain.GetImage(level - 1, 0, 0), *mipChain.GetImage(level, 0, 0), kind, filter, threadPool);
+	}
+	return S_OK;
+}
+
+std::vector<MipMapBenchmarkResult> RunMipMapBenchmark() {
+	const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_R32G32B32A32_FLOAT };
+	const MipFilter filters[] = { MipFilter::Box, MipFilter::Triangle };
+	const size_t size = 2048;
+	ThreadPool threadPool;
+
+	std::vector<MipMapBenchmarkResult> results;
+	for (DXGI_FORMAT format : formats) {
+		DirectX::ScratchImage source{};
+		if (FAILED(MakeBenchmarkImage(size, size, format, source))) {
+			continue;
+		}
+		PixelKind kind = PixelKind::Unorm8;
+		GetPixelKind(format, kind);
+		for (MipFilter filter : filters) {
+			MipMapBenchmarkResult result;
+			result.format = format;
+			result.filter = filter;
+			result.width = size;
+			result.height = size;
+			result.tolerance = GetMaxErrorTolerance(kind, filter);
+
+			// 比較対象は今までの経路（ボックスはTEX_FILTER_DEFAULT、三角はTEX_FILTER_TRIANGLE）
+			DirectX::TEX_FILTER_FLAGS flags = filter == MipFilter::Triangle ? DirectX::TEX_FILTER_TRIANGLE : DirectX::TEX_FILTER_DEFAULT;
+			DirectX::ScratchImage reference{};
+			auto start = std::chrono::steady_clock::now();
+			HRESULT hr = DirectX::GenerateMipMaps(*source.GetImage(0, 0, 0), flags, 0, reference);
+			result.referenceMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			DirectX::ScratchImage fast{};
+			start = std::chrono::steady_clock::now();
+			HRESULT hrFast = GenerateMipMapsFast(*source.GetImage(0, 0, 0), filter, 0, fast, &threadPool);
+			result.fastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (FAILED(hr) || FAILED(hrFast)) {
+				result.maxError = -1.0f;
+			} else {
+				result.maxError = MeasureMaxError(reference, fast, kind);
+			}
+			results.push_back(result);
+		}
+	}
+	return results;
+}
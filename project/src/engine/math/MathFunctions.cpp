@@ -0,0 +1,400 @@
+#include "engine/math/MathFunctions.h"
+
+#include <cmath>
+#include "engine/math/MathSimd.h"
+
+#if MATH_USE_SSE2
+namespace {
+
+// 2x2行列を (m00, m01, m10, m11) の順で1レジスタに入れて計算する
+// a * b
+inline __m128 Mat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, MATH_SWIZZLE(b, 0, 3, 0, 3)),
+		_mm_mul_ps(MATH_SWIZZLE(a, 1, 0, 3, 2), MATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+// adj(a) * b
+inline __m128 Mat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(MATH_SWIZZLE(a, 3, 3, 0, 0), b),
+		_mm_mul_ps(MATH_SWIZZLE(a, 1, 1, 2, 2), MATH_SWIZZLE(b, 2, 3, 0, 1)));
+}
+// a * adj(b)
+inline __m128 Mat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, MATH_SWIZZLE(b, 3, 0, 3, 0)),
+		_mm_mul_ps(MATH_SWIZZLE(a, 1, 0, 3, 2), MATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+} // namespace
+#endif
+
+// 単位行列の作成
+Matrix4x4 MakeIdentity4x4() {
+	Matrix4x4 result;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			if (i == j) {
+				result.m[i][j] = 1.0f;
+			} else {
+				result.m[i][j] = 0.0f;
+			}
+		}
+	}
+	return result;
+}
+
+// 4x4行列の積
+// SSE版も要素ごとの足し算の順番はスカラー版と同じなので、結果はビット単位で一致する
+Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2) {
+	Matrix4x4 result;
+#if MATH_USE_SSE2
+	__m128 b0 = SimdLoadRow(m2, 0);
+	__m128 b1 = SimdLoadRow(m2, 1);
+	__m128 b2 = SimdLoadRow(m2, 2);
+	__m128 b3 = SimdLoadRow(m2, 3);
+	for (int i = 0; i < 4; i++) {
+		SimdStoreRow(result, i, SimdMultiplyRow(SimdLoadRow(m1, i), b0, b1, b2, b3));
+	}
+#else
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			result.m[i][j] = 0;
+			for (int k = 0; k < 4; k++) {
+				result.m[i][j] += m1.m[i][k] * m2.m[k][j];
+			}
+		}
+	}
+#endif
+	return result;
+}
+
+// 行ベクトル × 行列
+Vector4 Multiply(const Vector4& v, const Matrix4x4& m) {
+	Vector4 result;
+#if MATH_USE_SSE2
+	__m128 row = SimdMultiplyRow(_mm_loadu_ps(&v.x), SimdLoadRow(m, 0), SimdLoadRow(m, 1), SimdLoadRow(m, 2), SimdLoadRow(m, 3));
+	_mm_storeu_ps(&result.x, row);
+#else
+	const float in[4] = { v.x, v.y, v.z, v.w };
+	float out[4];
+	for (int j = 0; j < 4; j++) {
+		out[j] = 0;
+		for (int k = 0; k < 4; k++) {
+			out[j] += in[k] * m.m[k][j];
+		}
+	}
+	result = { out[0], out[1], out[2], out[3] };
+#endif
+	return result;
+}
+
+// 座標変換（w=1）。wで割る
+Vector3 TransformPoint(const Vector3& v, const Matrix4x4& m) {
+	Vector4 result = Multiply(Vector4{ v.x, v.y, v.z, 1.0f }, m);
+	if (result.w == 0.0f || result.w == 1.0f) {
+		return { result.x, result.y, result.z };
+	}
+	return { result.x / result.w, result.y / result.w, result.z / result.w };
+}
+
+// 方向の変換（w=0、平行移動しない）
+Vector3 TransformDirection(const Vector3& v, const Matrix4x4& m) {
+	Vector4 result = Multiply(Vector4{ v.x, v.y, v.z, 0.0f }, m);
+	return { result.x, result.y, result.z };
+}
+
+// 拡大縮小
+Matrix4x4 MakeScaleMatrix(const Vector3& scale) {
+	Matrix4x4 result{};
+	result.m[0][0] = scale.x;
+	result.m[1][1] = scale.y;
+	result.m[2][2] = scale.z;
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
+	Matrix4x4 result{};
+	result.m[0][0] = 1.0f;
+	result.m[1][1] = 1.0f;
+	result.m[2][2] = 1.0f;
+	result.m[3][3] = 1.0f;
+	result.m[3][0] = translate.x;
+	result.m[3][1] = translate.y;
+	result.m[3][2] = translate.z;
+	return result;
+}
+
+
+// X軸回転行列
+Matrix4x4 MakeRotateXMatrix(float angle) {
+	Matrix4x4 result = {};
+	result.m[0][0] = 1.0f;
+	result.m[3][3] = 1.0f;
+	result.m[1][1] = std::cos(angle);
+	result.m[1][2] = std::sin(angle);
+	result.m[2][1] = -std::sin(angle);
+	result.m[2][2] = std::cos(angle);
+	return result;
+}
+// Y軸回転行列
+Matrix4x4 MakeRotateYMatrix(float angle) {
+	Matrix4x4 result = {};
+	result.m[1][1] = 1.0f;
+	result.m[3][3] = 1.0f;
+	result.m[0][0] = std::cos(angle);
+	result.m[0][2] = -std::sin(angle);
+	result.m[2][0] = std::sin(angle);
+	result.m[2][2] = std::cos(angle);
+	return result;
+}
+// Z軸回転行列
+Matrix4x4 MakeRotateZMatrix(float angle) {
+	Matrix4x4 result = {};
+	result.m[2][2] = 1.0f;
+	result.m[3][3] = 1.0f;
+	result.m[0][0] = std::cos(angle);
+	result.m[0][1] = std::sin(angle);
+	result.m[1][0] = -std::sin(angle);
+	result.m[1][1] = std::cos(angle);
+	return result;
+}
+
+// アフィン変換行列
+// Rx * (Ry * Rz) を展開した式で直接求める（sin/cosは各軸1回ずつ）
+// 掛け算の組み合わせ方は行列の積と同じにしてあるので、0の符号以外はビット単位で一致する
+Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+	Matrix4x4 result = {};
+	const float sx = std::sin(rotate.x), cx = std::cos(rotate.x);
+	const float sy = std::sin(rotate.y), cy = std::cos(rotate.y);
+	const float sz = std::sin(rotate.z), cz = std::cos(rotate.z);
+
+	// Ry * Rz
+	const float yz00 = cy * cz, yz01 = cy * sz, yz02 = -sy;
+	const float yz10 = -sz, yz11 = cz;
+	const float yz20 = sy * cz, yz21 = sy * sz, yz22 = cy;
+
+	// Rx * (Ry * Rz)
+	Matrix4x4 rotateXYZ;
+	rotateXYZ.m[0][0] = yz00;
+	rotateXYZ.m[0][1] = yz01;
+	rotateXYZ.m[0][2] = yz02;
+	rotateXYZ.m[1][0] = cx * yz10 + sx * yz20;
+	rotateXYZ.m[1][1] = cx * yz11 + sx * yz21;
+	rotateXYZ.m[1][2] = sx * yz22;
+	rotateXYZ.m[2][0] = -sx * yz10 + cx * yz20;
+	rotateXYZ.m[2][1] = -sx * yz11 + cx * yz21;
+	rotateXYZ.m[2][2] = cx * yz22;
+
+	result.m[0][0] = scale.x * rotateXYZ.m[0][0];
+	result.m[0][1] = scale.x * rotateXYZ.m[0][1];
+	result.m[0][2] = scale.x * rotateXYZ.m[0][2];
+	result.m[1][0] = scale.y * rotateXYZ.m[1][0];
+	result.m[1][1] = scale.y * rotateXYZ.m[1][1];
+	result.m[1][2] = scale.y * rotateXYZ.m[1][2];
+	result.m[2][0] = scale.z * rotateXYZ.m[2][0];
+	result.m[2][1] = scale.z * rotateXYZ.m[2][1];
+	result.m[2][2] = scale.z * rotateXYZ.m[2][2];
+	result.m[3][0] = translate.x;
+	result.m[3][1] = translate.y;
+	result.m[3][2] = translate.z;
+	result.m[3][3] = 1.0f;
+
+	return result;
+}
+
+// 4x4行列の逆行列を計算
+// 2x2の小行列式から余因子を組み立てる（3x3の小行列式を16回計算しない）
+// 元の実装（余因子展開）とは計算順が違うので、結果は丸め誤差の範囲で異なる
+Matrix4x4 Inverse(const Matrix4x4& m) {
+	Matrix4x4 result = {};
+#if MATH_USE_SSE2
+	// 行列を2x2のブロック [A B; C D] に分けて計算する
+	__m128 r0 = SimdLoadRow(m, 0);
+	__m128 r1 = SimdLoadRow(m, 1);
+	__m128 r2 = SimdLoadRow(m, 2);
+	__m128 r3 = SimdLoadRow(m, 3);
+	__m128 a = _mm_movelh_ps(r0, r1);
+	__m128 b = _mm_movehl_ps(r1, r0);
+	__m128 c = _mm_movelh_ps(r2, r3);
+	__m128 d = _mm_movehl_ps(r3, r2);
+
+	// (|A|, |B|, |C|, |D|)
+	__m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(MATH_SHUFFLE(r0, r2, 0, 2, 0, 2), MATH_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+		_mm_mul_ps(MATH_SHUFFLE(r0, r2, 1, 3, 1, 3), MATH_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+	__m128 detA = MATH_SWIZZLE(detSub, 0, 0, 0, 0);
+	__m128 detB = MATH_SWIZZLE(detSub, 1, 1, 1, 1);
+	__m128 detC = MATH_SWIZZLE(detSub, 2, 2, 2, 2);
+	__m128 detD = MATH_SWIZZLE(detSub, 3, 3, 3, 3);
+
+	__m128 dc = Mat2AdjMul(d, c);
+	__m128 ab = Mat2AdjMul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Mul(b, dc));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Mul(c, ab));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MulAdj(d, ab));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MulAdj(a, dc));
+
+	// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+	__m128 trace = _mm_mul_ps(ab, MATH_SWIZZLE(dc, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, _mm_movehl_ps(trace, trace));
+	trace = _mm_add_ss(trace, MATH_SWIZZLE(trace, 1, 1, 1, 1));
+	float det = _mm_cvtss_f32(_mm_sub_ss(_mm_add_ss(_mm_mul_ss(detA, detD), _mm_mul_ss(detB, detC)), trace));
+
+	// 行列式が0の場合は逆行列が存在しない
+	if (det == 0.0f) {
+		return result;
+	}
+
+	__m128 invDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), _mm_set1_ps(det));
+	x = _mm_mul_ps(x, invDet);
+	y = _mm_mul_ps(y, invDet);
+	z = _mm_mul_ps(z, invDet);
+	w = _mm_mul_ps(w, invDet);
+	SimdStoreRow(result, 0, MATH_SHUFFLE(x, y, 3, 1, 3, 1));
+	SimdStoreRow(result, 1, MATH_SHUFFLE(x, y, 2, 0, 2, 0));
+	SimdStoreRow(result, 2, MATH_SHUFFLE(z, w, 3, 1, 3, 1));
+	SimdStoreRow(result, 3, MATH_SHUFFLE(z, w, 2, 0, 2, 0));
+#else
+	// 上2行・下2行の2x2小行列式
+	float s0 = m.m[0][0] * m.m[1][1] - m.m[1][0] * m.m[0][1];
+	float s1 = m.m[0][0] * m.m[1][2] - m.m[1][0] * m.m[0][2];
+	float s2 = m.m[0][0] * m.m[1][3] - m.m[1][0] * m.m[0][3];
+	float s3 = m.m[0][1] * m.m[1][2] - m.m[1][1] * m.m[0][2];
+	float s4 = m.m[0][1] * m.m[1][3] - m.m[1][1] * m.m[0][3];
+	float s5 = m.m[0][2] * m.m[1][3] - m.m[1][2] * m.m[0][3];
+	float c5 = m.m[2][2] * m.m[3][3] - m.m[3][2] * m.m[2][3];
+	float c4 = m.m[2][1] * m.m[3][3] - m.m[3][1] * m.m[2][3];
+	float c3 = m.m[2][1] * m.m[3][2] - m.m[3][1] * m.m[2][2];
+	float c2 = m.m[2][0] * m.m[3][3] - m.m[3][0] * m.m[2][3];
+	float c1 = m.m[2][0] * m.m[3][2] - m.m[3][0] * m.m[2][2];
+	float c0 = m.m[2][0] * m.m[3][1] - m.m[3][0] * m.m[2][1];
+
+	float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+	// 行列式が0の場合は逆行列が存在しない
+	if (det == 0.0f) {
+		return result;
+	}
+
+	float invDet = 1.0f / det;
+	result.m[0][0] = (m.m[1][1] * c5 - m.m[1][2] * c4 + m.m[1][3] * c3) * invDet;
+	result.m[0][1] = (-m.m[0][1] * c5 + m.m[0][2] * c4 - m.m[0][3] * c3) * invDet;
+	result.m[0][2] = (m.m[3][1] * s5 - m.m[3][2] * s4 + m.m[3][3] * s3) * invDet;
+	result.m[0][3] = (-m.m[2][1] * s5 + m.m[2][2] * s4 - m.m[2][3] * s3) * invDet;
+	result.m[1][0] = (-m.m[1][0] * c5 + m.m[1][2] * c2 - m.m[1][3] * c1) * invDet;
+	result.m[1][1] = (m.m[0][0] * c5 - m.m[0][2] * c2 + m.m[0][3] * c1) * invDet;
+	result.m[1][2] = (-m.m[3][0] * s5 + m.m[3][2] * s2 - m.m[3][3] * s1) * invDet;
+	result.m[1][3] = (m.m[2][0] * s5 - m.m[2][2] * s2 + m.m[2][3] * s1) * invDet;
+	result.m[2][0] = (m.m[1][0] * c4 - m.m[1][1] * c2 + m.m[1][3] * c0) * invDet;
+	result.m[2][1] = (-m.m[0][0] * c4 + m.m[0][1] * c2 - m.m[0][3] * c0) * invDet;
+	result.m[2][2] = (m.m[3][0] * s4 - m.m[3][1] * s2 + m.m[3][3] * s0) * invDet;
+	result.m[2][3] = (-m.m[2][0] * s4 + m.m[2][1] * s2 - m.m[2][3] * s0) * invDet;
+	result.m[3][0] = (-m.m[1][0] * c3 + m.m[1][1] * c1 - m.m[1][2] * c0) * invDet;
+	result.m[3][1] = (m.m[0][0] * c3 - m.m[0][1] * c1 + m.m[0][2] * c0) * invDet;
+	result.m[3][2] = (-m.m[3][0] * s3 + m.m[3][1] * s1 - m.m[3][2] * s0) * invDet;
+	result.m[3][3] = (m.m[2][0] * s3 - m.m[2][1] * s1 + m.m[2][2] * s0) * invDet;
+#endif
+	return result;
+}
+
+// アフィン変換行列（4列目が(0,0,0,1)）の逆行列
+// 左上3x3だけを外積で逆行列にし、平行移動は -t * L^-1 で求める
+Matrix4x4 InverseAffine(const Matrix4x4& m) {
+	Matrix4x4 result = {};
+#if MATH_USE_SSE2
+	// w成分を0にして3要素のベクトルとして扱う
+	const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 r0 = _mm_and_ps(SimdLoadRow(m, 0), mask);
+	__m128 r1 = _mm_and_ps(SimdLoadRow(m, 1), mask);
+	__m128 r2 = _mm_and_ps(SimdLoadRow(m, 2), mask);
+	auto cross = [](__m128 a, __m128 b) {
+		return _mm_sub_ps(
+			_mm_mul_ps(MATH_SWIZZLE(a, 1, 2, 0, 3), MATH_SWIZZLE(b, 2, 0, 1, 3)),
+			_mm_mul_ps(MATH_SWIZZLE(a, 2, 0, 1, 3), MATH_SWIZZLE(b, 1, 2, 0, 3)));
+	};
+	// 行r0,r1,r2の行列の逆行列は、列が (r1×r2, r2×r0, r0×r1) / det になる
+	__m128 c0 = cross(r1, r2);
+	__m128 c1 = cross(r2, r0);
+	__m128 c2 = cross(r0, r1);
+	__m128 dot = _mm_mul_ps(r0, c0);
+	float det = _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(dot, MATH_SWIZZLE(dot, 1, 1, 1, 1)), MATH_SWIZZLE(dot, 2, 2, 2, 2)));
+
+	// 行列式が0の場合は逆行列が存在しない
+	if (det == 0.0f) {
+		return result;
+	}
+
+	__m128 invDet = _mm_set1_ps(1.0f / det);
+	c0 = _mm_mul_ps(c0, invDet);
+	c1 = _mm_mul_ps(c1, invDet);
+	c2 = _mm_mul_ps(c2, invDet);
+	__m128 c3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	__m128 t = SimdLoadRow(m, 3);
+	__m128 translate = _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(MATH_SWIZZLE(t, 0, 0, 0, 0), c0),
+		_mm_mul_ps(MATH_SWIZZLE(t, 1, 1, 1, 1), c1)),
+		_mm_mul_ps(MATH_SWIZZLE(t, 2, 2, 2, 2), c2));
+	SimdStoreRow(result, 0, c0);
+	SimdStoreRow(result, 1, c1);
+	SimdStoreRow(result, 2, c2);
+	SimdStoreRow(result, 3, _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), translate));
+#else
+	const Vector3 r0 = { m.m[0][0], m.m[0][1], m.m[0][2] };
+	const Vector3 r1 = { m.m[1][0], m.m[1][1], m.m[1][2] };
+	const Vector3 r2 = { m.m[2][0], m.m[2][1], m.m[2][2] };
+	// 行r0,r1,r2の行列の逆行列は、列が (r1×r2, r2×r0, r0×r1) / det になる
+	const Vector3 c0 = { r1.y * r2.z - r1.z * r2.y, r1.z * r2.x - r1.x * r2.z, r1.x * r2.y - r1.y * r2.x };
+	const Vector3 c1 = { r2.y * r0.z - r2.z * r0.y, r2.z * r0.x - r2.x * r0.z, r2.x * r0.y - r2.y * r0.x };
+	const Vector3 c2 = { r0.y * r1.z - r0.z * r1.y, r0.z * r1.x - r0.x * r1.z, r0.x * r1.y - r0.y * r1.x };
+	float det = r0.x * c0.x + r0.y * c0.y + r0.z * c0.z;
+
+	// 行列式が0の場合は逆行列が存在しない
+	if (det == 0.0f) {
+		return result;
+	}
+
+	float invDet = 1.0f / det;
+	result.m[0][0] = c0.x * invDet; result.m[0][1] = c1.x * invDet; result.m[0][2] = c2.x * invDet;
+	result.m[1][0] = c0.y * invDet; result.m[1][1] = c1.y * invDet; result.m[1][2] = c2.y * invDet;
+	result.m[2][0] = c0.z * invDet; result.m[2][1] = c1.z * invDet; result.m[2][2] = c2.z * invDet;
+	const float tx = m.m[3][0], ty = m.m[3][1], tz = m.m[3][2];
+	for (int j = 0; j < 3; j++) {
+		result.m[3][j] = -(tx * result.m[0][j] + ty * result.m[1][j] + tz * result.m[2][j]);
+	}
+	result.m[3][3] = 1.0f;
+#endif
+	return result;
+}
+
+// 透視投影行列
+Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip, float farClip) {
+	Matrix4x4 result = {};
+	result.m[0][0] = 1.0f / (aspectRatio * std::tan(fovY / 2.0f));
+	result.m[1][1] = 1.0f / std::tan(fovY / 2.0f);
+	result.m[2][2] = farClip / (farClip - nearClip);
+	result.m[2][3] = 1.0f;
+	result.m[3][2] = -(farClip * nearClip) / (farClip - nearClip);
+	return result;
+}
+
+// 平行投影行列（左手座標系）
+Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip, float farClip) {
+	Matrix4x4 result = {};
+
+	result.m[0][0] = 2.0f / (right - left);
+	result.m[1][1] = 2.0f / (top - bottom);
+	result.m[2][2] = 1.0f / (farClip - nearClip);
+	result.m[3][0] = (left + right) / (left - right);
+	result.m[3][1] = (top + bottom) / (bottom - top);
+	result.m[3][2] = -nearClip / (farClip - nearClip);
+	result.m[3][3] = 1.0f;
+
+	return result;
+}
+
+// 正規化
+Vector3 Normalize(const Vector3& v) {
+	float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	if (length == 0.0f) return { 0.0f, 0.0f, 0.0f };
+	return { v.x / length, v.y / length, v.z / length };
+}
@@ -0,0 +1,394 @@
+#include "engine/math/MathFunctions.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "engine/math/MathSimd.h"
+
+namespace {
+
+// 自己診断の比較用。SSE版・展開した式に置き換える前のスカラーの実装
+
+Matrix4x4 ReferenceMultiply(const Matrix4x4& m1, const Matrix4x4& m2) {
+	Matrix4x4 result;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			result.m[i][j] = 0;
+			for (int k = 0; k < 4; k++) {
+				result.m[i][j] += m1.m[i][k] * m2.m[k][j];
+			}
+		}
+	}
+	return result;
+}
+
+Vector4 ReferenceMultiply(const Vector4& v, const Matrix4x4& m) {
+	const float in[4] = { v.x, v.y, v.z, v.w };
+	float out[4];
+	for (int j = 0; j < 4; j++) {
+		out[j] = 0;
+		for (int k = 0; k < 4; k++) {
+			out[j] += in[k] * m.m[k][j];
+		}
+	}
+	return { out[0], out[1], out[2], out[3] };
+}
+
+// 回転行列を積で合成してから拡大縮小を掛ける
+Matrix4x4 ReferenceMakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+	Matrix4x4 rotateXYZ =
+		ReferenceMultiply(MakeRotateXMatrix(rotate.x), ReferenceMultiply(MakeRotateYMatrix(rotate.y), MakeRotateZMatrix(rotate.z)));
+	Matrix4x4 result = {};
+	const float scales[3] = { scale.x, scale.y, scale.z };
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			result.m[i][j] = scales[i] * rotateXYZ.m[i][j];
+		}
+	}
+	result.m[3][0] = translate.x;
+	result.m[3][1] = translate.y;
+	result.m[3][2] = translate.z;
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+float ReferenceDeterminant3x3(float matrix[3][3]) {
+	return matrix[0][0] * (matrix[1][1] * matrix[2][2] - matrix[1][2] * matrix[2][1]) -
+		matrix[0][1] * (matrix[1][0] * matrix[2][2] - matrix[1][2] * matrix[2][0]) +
+		matrix[0][2] * (matrix[1][0] * matrix[2][1] - matrix[1][1] * matrix[2][0]);
+}
+
+float ReferenceMinor(const Matrix4x4& m, int row, int col) {
+	float sub[3][3];
+	int subI = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (i == row) continue;
+		int subJ = 0;
+		for (int j = 0; j < 4; ++j) {
+			if (j == col) continue;
+			sub[subI][subJ] = m.m[i][j];
+			subJ++;
+		}
+		subI++;
+	}
+	return ReferenceDeterminant3x3(sub);
+}
+
+// 余因子展開の逆行列
+Matrix4x4 ReferenceInverse(const Matrix4x4& m) {
+	Matrix4x4 result = {};
+	float det = 0.0f;
+	for (int col = 0; col < 4; ++col) {
+		float sign = (col % 2 == 0) ? 1.0f : -1.0f;
+		det += sign * m.m[0][col] * ReferenceMinor(m, 0, col);
+	}
+	if (det == 0.0f) {
+		return result;
+	}
+	float invDet = 1.0f / det;
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			float sign = ((i + j) % 2 == 0) ? 1.0f : -1.0f;
+			result.m[j][i] = sign * ReferenceMinor(m, i, j) * invDet;
+		}
+	}
+	return result;
+}
+
+// double精度の掃き出し法（ピボット選択あり）。誤差を測る基準にする
+bool DoubleInverse(const Matrix4x4& m, double out[4][4]) {
+	double a[4][8];
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			a[i][j] = m.m[i][j];
+			a[i][j + 4] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+	for (int col = 0; col < 4; ++col) {
+		int pivot = col;
+		for (int i = col + 1; i < 4; ++i) {
+			if (std::fabs(a[i][col]) > std::fabs(a[pivot][col])) pivot = i;
+		}
+		if (a[pivot][col] == 0.0) return false;
+		for (int j = 0; j < 8; ++j) std::swap(a[col][j], a[pivot][j]);
+		const double scale = 1.0 / a[col][col];
+		for (int j = 0; j < 8; ++j) a[col][j] *= scale;
+		for (int i = 0; i < 4; ++i) {
+			if (i == col) continue;
+			const double factor = a[i][col];
+			for (int j = 0; j < 8; ++j) a[i][j] -= factor * a[col][j];
+		}
+	}
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) out[i][j] = a[i][j + 4];
+	}
+	return true;
+}
+
+// doubleの逆行列との差（逆行列の最大要素に対する割合）
+double InverseError(const Matrix4x4& inverse, const double expected[4][4]) {
+	double largest = 0.0, difference = 0.0;
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			largest = (std::max)(largest, std::fabs(expected[i][j]));
+			difference = (std::max)(difference, std::fabs(double(inverse.m[i][j]) - expected[i][j]));
+		}
+	}
+	return largest > 0.0 ? difference / largest : difference;
+}
+
+// 条件数 ‖m‖∞‖inv‖∞。sizeが3なら左上3x3（アフィン行列の線形部分）で測る
+double ConditionNumber(const Matrix4x4& m, const double inverse[4][4], int size) {
+	double normM = 0.0, normInverse = 0.0;
+	for (int i = 0; i < size; ++i) {
+		double rowM = 0.0, rowInverse = 0.0;
+		for (int j = 0; j < size; ++j) {
+			rowM += std::fabs(m.m[i][j]);
+			rowInverse += std::fabs(inverse[i][j]);
+		}
+		normM = (std::max)(normM, rowM);
+		normInverse = (std::max)(normInverse, rowInverse);
+	}
+	return normM * normInverse;
+}
+
+// 逆行列の誤差をkInverseErrorBoundの単位（κ * FLT_EPSILON）で表す。1以下なら保証の範囲
+double InverseErrorRatio(const Matrix4x4& inverse, const double expected[4][4], double condition) {
+	return InverseError(inverse, expected) / (kInverseErrorBound * condition * double(FLT_EPSILON));
+}
+
+// 結果のULP（doubleの真値の指数で測る）
+double UlpError(float value, double expected) {
+	int exponent = 0;
+	std::frexp((std::max)(std::fabs(expected), double(FLT_MIN)), &exponent);
+	return std::fabs(double(value) - expected) / std::ldexp(1.0, exponent - 24);
+}
+
+bool IsBitwiseEqual(const float* a, const float* b, size_t count) {
+	return std::memcmp(a, b, count * sizeof(float)) == 0;
+}
+
+// 値として等しい（+0と-0は同じとみなす）
+bool IsEqual(const Matrix4x4& a, const Matrix4x4& b) {
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			if (!(a.m[i][j] == b.m[i][j])) return false;
+		}
+	}
+	return true;
+}
+
+bool IsZero(const Matrix4x4& m) {
+	return IsEqual(m, Matrix4x4{});
+}
+
+// countの入力それぞれにfunctionを呼ぶのを3回繰り返し、最速の1回あたりの時間を返す
+// 結果はsinkに足して、呼び出しが消されないようにする
+template <typename Function>
+double MeasureNanosecondsPerCall(size_t count, int repeat, Function&& function, float& sink) {
+	double best = 0.0;
+	for (int run = 0; run < 3; ++run) {
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeat; ++r) {
+			for (size_t i = 0; i < count; ++i) {
+				sink += function(i);
+			}
+		}
+		double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(count * repeat);
+		if (run == 0 || nanoseconds < best) {
+			best = nanoseconds;
+		}
+	}
+	return best;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunMathSelfTest() {
+	std::vector<SelfTestResult> results;
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<float> anyValue(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(-6.3f, 6.3f);
+	std::uniform_real_distribution<float> scaleValue(0.25f, 4.0f);
+	std::uniform_real_distribution<float> translateValue(-500.0f, 500.0f);
+	auto randomMatrix = [&]() {
+		Matrix4x4 m;
+		for (int i = 0; i < 4; ++i) {
+			for (int j = 0; j < 4; ++j) m.m[i][j] = anyValue(random);
+		}
+		return m;
+	};
+	auto randomAffine = [&]() {
+		const Vector3 scale = { scaleValue(random), scaleValue(random), scaleValue(random) };
+		const Vector3 rotate = { angle(random), angle(random), angle(random) };
+		const Vector3 translate = { translateValue(random), translateValue(random), translateValue(random) };
+		return ReferenceMakeAffineMatrix(scale, rotate, translate);
+	};
+	const int kIterations = 10000;
+	const char* path = MATH_USE_SSE2 ? "SSE2" : "scalar";
+
+	// 積は足す順番が同じなのでビット単位で一致する
+	bool multiplyExact = true;
+	bool vectorExact = true;
+	for (int n = 0; n < kIterations; ++n) {
+		const Matrix4x4 a = randomMatrix(), b = randomMatrix();
+		const Matrix4x4 product = Multiply(a, b), expected = ReferenceMultiply(a, b);
+		multiplyExact = multiplyExact && IsBitwiseEqual(&product.m[0][0], &expected.m[0][0], 16);
+		const Vector4 v = { anyValue(random), anyValue(random), anyValue(random), anyValue(random) };
+		const Vector4 transformed = Multiply(v, a), expectedVector = ReferenceMultiply(v, a);
+		vectorExact = vectorExact && IsBitwiseEqual(&transformed.x, &expectedVector.x, 4);
+	}
+	AddSelfTestResult(results, std::string("math Multiply(Matrix4x4) bitwise (") + path + ")", multiplyExact, std::to_string(kIterations) + " random pairs");
+	AddSelfTestResult(results, std::string("math Multiply(Vector4) bitwise (") + path + ")", vectorExact, std::to_string(kIterations) + " random pairs");
+
+	// 展開したアフィン変換行列は0の符号以外で一致する
+	bool affineEqual = true;
+	for (int n = 0; n < kIterations; ++n) {
+		const Vector3 scale = { scaleValue(random), scaleValue(random), scaleValue(random) };
+		const Vector3 rotate = { angle(random), angle(random), angle(random) };
+		const Vector3 translate = { translateValue(random), translateValue(random), translateValue(random) };
+		affineEqual = affineEqual && IsEqual(MakeAffineMatrix(scale, rotate, translate), ReferenceMakeAffineMatrix(scale, rotate, translate));
+	}
+	AddSelfTestResult(results, "math MakeAffineMatrix matches composed rotations", affineEqual, std::to_string(kIterations) + " random transforms");
+
+	// 逆行列はdoubleの結果と比べ、MathFunctions.hのkInverseErrorBoundに収まる（比が1以下）
+	double inverseRatio = 0.0, referenceRatio = 0.0, affineRatio = 0.0, generalRatio = 0.0, generalReferenceRatio = 0.0;
+	double identityResidual = 0.0;
+	for (int n = 0; n < kIterations; ++n) {
+		const Matrix4x4 affine = randomAffine();
+		double expected[4][4];
+		if (!DoubleInverse(affine, expected)) continue;
+		const double affineCondition = ConditionNumber(affine, expected, 3);
+		inverseRatio = (std::max)(inverseRatio, InverseErrorRatio(Inverse(affine), expected, affineCondition));
+		referenceRatio = (std::max)(referenceRatio, InverseErrorRatio(ReferenceInverse(affine), expected, affineCondition));
+		const Matrix4x4 inverseAffine = InverseAffine(affine);
+		affineRatio = (std::max)(affineRatio, InverseErrorRatio(inverseAffine, expected, affineCondition));
+		const Matrix4x4 identity = ReferenceMultiply(affine, inverseAffine);
+		for (int i = 0; i < 4; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				// 平行移動の行は打ち消し合う値が大きいので、その大きさに対して測る
+				const double magnitude = (i == 3) ? (std::max)(1.0, double(std::fabs(affine.m[3][0]) + std::fabs(affine.m[3][1]) + std::fabs(affine.m[3][2]))) : 1.0;
+				identityResidual = (std::max)(identityResidual, std::fabs(double(identity.m[i][j]) - (i == j ? 1.0 : 0.0)) / magnitude);
+			}
+		}
+
+		const Matrix4x4 general = randomMatrix();
+		if (!DoubleInverse(general, expected)) continue;
+		const double generalCondition = ConditionNumber(general, expected, 4);
+		generalRatio = (std::max)(generalRatio, InverseErrorRatio(Inverse(general), expected, generalCondition));
+		generalReferenceRatio = (std::max)(generalReferenceRatio, InverseErrorRatio(ReferenceInverse(general), expected, generalCondition));
+	}
+	AddSelfTestResult(results, std::string("math Inverse affine (") + path + ")", inverseRatio <= 1.0,
+		"error / bound " + FormatSelfTestValue(inverseRatio) + ", cofactor expansion " + FormatSelfTestValue(referenceRatio));
+	// A * inv(A) - I は保証の対象ではないので参考に出す
+	AddSelfTestResult(results, std::string("math InverseAffine (") + path + ")", affineRatio <= 1.0,
+		"error / bound " + FormatSelfTestValue(affineRatio) + ", |A*inv(A)-I| " + FormatSelfTestValue(identityResidual));
+	AddSelfTestResult(results, std::string("math Inverse general (") + path + ")", generalRatio <= 1.0,
+		"error / bound " + FormatSelfTestValue(generalRatio) + ", cofactor expansion " + FormatSelfTestValue(generalReferenceRatio));
+
+#if MATH_USE_SSE2
+	// SimdSinCosはMathSimd.hの上限に収まる。乱数に加えて、誤差が出やすいπ/2の倍数の近く（値が0に近い所）を調べる
+	double sinCosAbsError = 0.0, sinCosUlpError = 0.0;
+	auto checkSinCos = [&](const float (&x)[4]) {
+		__m128 sinValues, cosValues;
+		SimdSinCos(_mm_loadu_ps(x), &sinValues, &cosValues);
+		float sines[4], cosines[4];
+		_mm_storeu_ps(sines, sinValues);
+		_mm_storeu_ps(cosines, cosValues);
+		for (int k = 0; k < 4; ++k) {
+			const double expectedValues[2] = { std::sin(double(x[k])), std::cos(double(x[k])) };
+			const float values[2] = { sines[k], cosines[k] };
+			for (int c = 0; c < 2; ++c) {
+				sinCosAbsError = (std::max)(sinCosAbsError, std::fabs(double(values[c]) - expectedValues[c]));
+				if (std::fabs(expectedValues[c]) >= 0.5) {
+					sinCosUlpError = (std::max)(sinCosUlpError, UlpError(values[c], expectedValues[c]));
+				}
+			}
+		}
+	};
+	std::uniform_real_distribution<float> sinCosInput(-kSimdSinCosMaxInput, kSimdSinCosMaxInput);
+	for (int n = 0; n < kIterations * 10; ++n) {
+		const float x[4] = { sinCosInput(random), sinCosInput(random), angle(random), angle(random) };
+		checkSinCos(x);
+	}
+	for (double multiple = 0.0; multiple * 1.5707963267948966 < double(kSimdSinCosMaxInput); multiple = multiple * 2.0 + 1.0) {
+		const double center = multiple * 1.5707963267948966;
+		float x[4] = { float(center), -float(center), float(center), -float(center) };
+		for (int step = 0; step < 64; ++step) {
+			checkSinCos(x);
+			x[0] = std::nextafter(x[0], kSimdSinCosMaxInput);
+			x[1] = std::nextafter(x[1], -kSimdSinCosMaxInput);
+			x[2] = std::nextafter(x[2], 0.0f);
+			x[3] = std::nextafter(x[3], 0.0f);
+		}
+	}
+	AddSelfTestResult(results, "math SimdSinCos error bounds", sinCosAbsError <= kSimdSinCosMaxAbsError && sinCosUlpError <= 2.0,
+		"max abs error " + FormatSelfTestValue(sinCosAbsError / double(FLT_EPSILON)) + " FLT_EPSILON, |value| >= 0.5 " +
+		FormatSelfTestValue(sinCosUlpError) + " ULP");
+#endif
+
+	// 行列式が0なら零行列
+	const Matrix4x4 flat = MakeScaleMatrix({ 1.0f, 0.0f, 1.0f });
+	AddSelfTestResult(results, "math Inverse singular returns zero", IsZero(Inverse(Matrix4x4{})) && IsZero(Inverse(flat)) &&
+		IsZero(InverseAffine(Matrix4x4{})) && IsZero(InverseAffine(flat)));
+	return results;
+}
+
+std::vector<MathBenchmarkResult> RunMathBenchmark() {
+	const size_t kCount = 4096;
+	const int kRepeat = 64;
+	std::mt19937 random(777);
+	std::uniform_real_distribution<float> anyValue(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(-6.3f, 6.3f);
+	std::uniform_real_distribution<float> scaleValue(0.25f, 4.0f);
+	std::uniform_real_distribution<float> translateValue(-500.0f, 500.0f);
+
+	std::vector<Matrix4x4> matrices(kCount), affines(kCount);
+	std::vector<Vector4> vectors(kCount);
+	std::vector<Vector3> scales(kCount), rotates(kCount), translates(kCount);
+	for (size_t i = 0; i < kCount; ++i) {
+		for (int r = 0; r < 4; ++r) {
+			for (int c = 0; c < 4; ++c) matrices[i].m[r][c] = anyValue(random);
+		}
+		vectors[i] = { anyValue(random), anyValue(random), anyValue(random), anyValue(random) };
+		scales[i] = { scaleValue(random), scaleValue(random), scaleValue(random) };
+		rotates[i] = { angle(random), angle(random), angle(random) };
+		translates[i] = { translateValue(random), translateValue(random), translateValue(random) };
+		affines[i] = ReferenceMakeAffineMatrix(scales[i], rotates[i], translates[i]);
+	}
+
+	float sink = 0.0f;
+	auto measure = [&](const char* name, auto&& reference, auto&& fast) {
+		MathBenchmarkResult result;
+		result.name = name;
+		result.referenceNanoseconds = MeasureNanosecondsPerCall(kCount, kRepeat, reference, sink);
+		result.fastNanoseconds = MeasureNanosecondsPerCall(kCount, kRepeat, fast, sink);
+		return result;
+	};
+	std::vector<MathBenchmarkResult> results;
+	results.push_back(measure("Multiply(Matrix4x4)",
+		[&](size_t i) { return ReferenceMultiply(matrices[i], matrices[(i + 1) % kCount]).m[3][3]; },
+		[&](size_t i) { return Multiply(matrices[i], matrices[(i + 1) % kCount]).m[3][3]; }));
+	results.push_back(measure("Multiply(Vector4)",
+		[&](size_t i) { return ReferenceMultiply(vectors[i], matrices[i]).w; },
+		[&](size_t i) { return Multiply(vectors[i], matrices[i]).w; }));
+	results.push_back(measure("Inverse",
+		[&](size_t i) { return ReferenceInverse(matrices[i]).m[3][3]; },
+		[&](size_t i) { return Inverse(matrices[i]).m[3][3]; }));
+	results.push_back(measure("InverseAffine",
+		[&](size_t i) { return ReferenceInverse(affines[i]).m[3][2]; },
+		[&](size_t i) { return InverseAffine(affines[i]).m[3][2]; }));
+	results.push_back(measure("MakeAffineMatrix",
+		[&](size_t i) { return ReferenceMakeAffineMatrix(scales[i], rotates[i], translates[i]).m[3][2]; },
+		[&](size_t i) { return MakeAffineMatrix(scales[i], rotates[i], translates[i]).m[3][2]; }));
+	// 合計は使わないが、捨てると計算ごと消されることがある
+	volatile float keep = sink;
+	(void)keep;
+	return results;
+}
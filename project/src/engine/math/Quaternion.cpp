@@ -0,0 +1,195 @@
+#include "engine/math/Quaternion.h"
+
+#include <cmath>
+#include "engine/math/MathFunctions.h"
+#include "engine/math/MathSimd.h"
+
+namespace {
+
+// 半角のsin/cosからオイラー角（X→Y→Z）のクォータニオンを組み立てる
+// q = qz * qy * qx
+Quaternion ComposeEuler(float sx, float cx, float sy, float cy, float sz, float cz) {
+	return {
+		sx * cy * cz - cx * sy * sz,
+		cx * sy * cz + sx * cy * sz,
+		cx * cy * sz - sx * sy * cz,
+		cx * cy * cz + sx * sy * sz };
+}
+
+} // namespace
+
+Quaternion IdentityQuaternion() {
+	return { 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+Quaternion Multiply(const Quaternion& lhs, const Quaternion& rhs) {
+	return {
+		lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,
+		lhs.w * rhs.y - lhs.x * rhs.z + lhs.y * rhs.w + lhs.z * rhs.x,
+		lhs.w * rhs.z + lhs.x * rhs.y - lhs.y * rhs.x + lhs.z * rhs.w,
+		lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z };
+}
+
+Quaternion Conjugate(const Quaternion& q) {
+	return { -q.x, -q.y, -q.z, q.w };
+}
+
+float Dot(const Quaternion& q0, const Quaternion& q1) {
+	return q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w;
+}
+
+float Norm(const Quaternion& q) {
+	return std::sqrt(Dot(q, q));
+}
+
+Quaternion Normalize(const Quaternion& q) {
+	float norm = Norm(q);
+	if (norm == 0.0f) {
+		return IdentityQuaternion();
+	}
+	float invNorm = 1.0f / norm;
+	return { q.x * invNorm, q.y * invNorm, q.z * invNorm, q.w * invNorm };
+}
+
+Quaternion Inverse(const Quaternion& q) {
+	float normSq = Dot(q, q);
+	if (normSq == 0.0f) {
+		return {};
+	}
+	float invNormSq = 1.0f / normSq;
+	return { -q.x * invNormSq, -q.y * invNormSq, -q.z * invNormSq, q.w * invNormSq };
+}
+
+Quaternion MakeRotateAxisAngleQuaternion(const Vector3& axis, float angle) {
+	float s = std::sin(angle * 0.5f);
+	return { axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+}
+
+Quaternion MakeQuaternionFromEuler(const Vector3& rotate) {
+	float hx = rotate.x * 0.5f, hy = rotate.y * 0.5f, hz = rotate.z * 0.5f;
+	return ComposeEuler(std::sin(hx), std::cos(hx), std::sin(hy), std::cos(hy), std::sin(hz), std::cos(hz));
+}
+
+void MakeQuaternionsFromEuler(const Vector3* rotates, Quaternion* out, size_t count) {
+	size_t i = 0;
+#if MATH_USE_SSE2
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (; i + 4 <= count; i += 4) {
+		const Vector3* r = rotates + i;
+		__m128 sx, cx, sy, cy, sz, cz;
+		SimdSinCos(_mm_mul_ps(_mm_setr_ps(r[0].x, r[1].x, r[2].x, r[3].x), half), &sx, &cx);
+		SimdSinCos(_mm_mul_ps(_mm_setr_ps(r[0].y, r[1].y, r[2].y, r[3].y), half), &sy, &cy);
+		SimdSinCos(_mm_mul_ps(_mm_setr_ps(r[0].z, r[1].z, r[2].z, r[3].z), half), &sz, &cz);
+
+		__m128 cycz = _mm_mul_ps(cy, cz), sysz = _mm_mul_ps(sy, sz);
+		__m128 sycz = _mm_mul_ps(sy, cz), cysz = _mm_mul_ps(cy, sz);
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sx, cycz), _mm_mul_ps(cx, sysz));
+		__m128 qy = _mm_add_ps(_mm_mul_ps(cx, sycz), _mm_mul_ps(sx, cysz));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(cx, cysz), _mm_mul_ps(sx, sycz));
+		__m128 qw = _mm_add_ps(_mm_mul_ps(cx, cycz), _mm_mul_ps(sx, sysz));
+		// (x,y,z,w)の並びに転置して書き込む
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+		_mm_storeu_ps(&out[i + 0].x, qx);
+		_mm_storeu_ps(&out[i + 1].x, qy);
+		_mm_storeu_ps(&out[i + 2].x, qz);
+		_mm_storeu_ps(&out[i + 3].x, qw);
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = MakeQuaternionFromEuler(rotates[i]);
+	}
+}
+
+Vector3 MakeEulerFromQuaternion(const Quaternion& q) {
+	// 回転行列の要素から求める（MakeRotateMatrixと同じ式）
+	const double x = q.x, y = q.y, z = q.z, w = q.w;
+	double m00 = 1.0 - 2.0 * (y * y + z * z);
+	double m01 = 2.0 * (x * y + w * z);
+	double m02 = 2.0 * (x * z - w * y);
+	double m10 = 2.0 * (x * y - w * z);
+	double m11 = 1.0 - 2.0 * (x * x + z * z);
+	double m20 = 2.0 * (x * z + w * y);
+	double m21 = 2.0 * (y * z - w * x);
+
+	// m02 = -sin(Y), (m00, m01) = cos(Y) * (cos(Z), sin(Z))
+	// asinは±90°付近で精度が落ちるので、atan2で求める
+	double cosY = std::sqrt(m00 * m00 + m01 * m01);
+	double angleY = std::atan2(-m02, cosY);
+	double angleZ = cosY > 1e-12 ? std::atan2(m01, m00) : 0.0;
+	// Xは求めたZを使って2行目・3行目から求める（ジンバルロック付近でもXとZの組み合わせが崩れない）
+	double sz = std::sin(angleZ), cz = std::cos(angleZ);
+	double angleX = std::atan2(m20 * sz - m21 * cz, m11 * cz - m10 * sz);
+	return { static_cast<float>(angleX), static_cast<float>(angleY), static_cast<float>(angleZ) };
+}
+
+Vector3 RotateVector(const Vector3& v, const Quaternion& q) {
+	// v' = v + 2w(u×v) + 2u×(u×v)（uはqの虚部）
+	Vector3 u = { q.x, q.y, q.z };
+	Vector3 t = {
+		2.0f * (u.y * v.z - u.z * v.y),
+		2.0f * (u.z * v.x - u.x * v.z),
+		2.0f * (u.x * v.y - u.y * v.x) };
+	return {
+		v.x + q.w * t.x + (u.y * t.z - u.z * t.y),
+		v.y + q.w * t.y + (u.z * t.x - u.x * t.z),
+		v.z + q.w * t.z + (u.x * t.y - u.y * t.x) };
+}
+
+Matrix4x4 MakeRotateMatrix(const Quaternion& q) {
+	return MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, q, { 0.0f, 0.0f, 0.0f });
+}
+
+Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Quaternion& rotate, const Vector3& translate) {
+	const float xx = rotate.x * rotate.x, yy = rotate.y * rotate.y, zz = rotate.z * rotate.z;
+	const float xy = rotate.x * rotate.y, xz = rotate.x * rotate.z, yz = rotate.y * rotate.z;
+	const float wx = rotate.w * rotate.x, wy = rotate.w * rotate.y, wz = rotate.w * rotate.z;
+
+	Matrix4x4 result = {};
+	result.m[0][0] = scale.x * (1.0f - 2.0f * (yy + zz));
+	result.m[0][1] = scale.x * (2.0f * (xy + wz));
+	result.m[0][2] = scale.x * (2.0f * (xz - wy));
+	result.m[1][0] = scale.y * (2.0f * (xy - wz));
+	result.m[1][1] = scale.y * (1.0f - 2.0f * (xx + zz));
+	result.m[1][2] = scale.y * (2.0f * (yz + wx));
+	result.m[2][0] = scale.z * (2.0f * (xz + wy));
+	result.m[2][1] = scale.z * (2.0f * (yz - wx));
+	result.m[2][2] = scale.z * (1.0f - 2.0f * (xx + yy));
+	result.m[3][0] = translate.x;
+	result.m[3][1] = translate.y;
+	result.m[3][2] = translate.z;
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+Quaternion Slerp(const Quaternion& q0, const Quaternion& q1, float t) {
+	float dot = Dot(q0, q1);
+	// 遠回りしないように、内積が負なら片方を反転する
+	Quaternion target = q1;
+	if (dot < 0.0f) {
+		target = { -q1.x, -q1.y, -q1.z, -q1.w };
+		dot = -dot;
+	}
+	// ほぼ同じ向きならsinθが0に近くなるので線形補間にする
+	if (dot > 0.9995f) {
+		return Nlerp(q0, target, t);
+	}
+	float theta = std::acos(dot);
+	float invSin = 1.0f / std::sin(theta);
+	float scale0 = std::sin((1.0f - t) * theta) * invSin;
+	float scale1 = std::sin(t * theta) * invSin;
+	return {
+		scale0 * q0.x + scale1 * target.x,
+		scale0 * q0.y + scale1 * target.y,
+		scale0 * q0.z + scale1 * target.z,
+		scale0 * q0.w + scale1 * target.w };
+}
+
+Quaternion Nlerp(const Quaternion& q0, const Quaternion& q1, float t) {
+	float sign = Dot(q0, q1) < 0.0f ? -1.0f : 1.0f;
+	Quaternion result = {
+		q0.x + (sign * q1.x - q0.x) * t,
+		q0.y + (sign * q1.y - q0.y) * t,
+		q0.z + (sign * q1.z - q0.z) * t,
+		q0.w + (sign * q1.w - q0.w) * t };
+	return Normalize(result);
+}
@@ -0,0 +1,155 @@
+#include "engine/math/Quaternion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "engine/math/MathFunctions.h"
+
+namespace {
+
+// 左上3x3の要素の差の最大
+double RotationDifference(const Matrix4x4& a, const Matrix4x4& b) {
+	double difference = 0.0;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			difference = (std::max)(difference, std::fabs(double(a.m[i][j]) - double(b.m[i][j])));
+		}
+	}
+	return difference;
+}
+
+// 2つの回転の間の角度（qと-qは同じ回転）
+// acos(内積)は0付近で誤差が大きいので、差の回転 conj(q0)*q1 の虚部と実部からatan2で求める
+double RotationAngle(const Quaternion& q0, const Quaternion& q1) {
+	const double x0 = q0.x, y0 = q0.y, z0 = q0.z, w0 = q0.w;
+	const double x1 = q1.x, y1 = q1.y, z1 = q1.z, w1 = q1.w;
+	const double x = w0 * x1 - x0 * w1 - y0 * z1 + z0 * y1;
+	const double y = w0 * y1 + x0 * z1 - y0 * w1 - z0 * x1;
+	const double z = w0 * z1 - x0 * y1 + y0 * x1 - z0 * w1;
+	const double w = w0 * w1 + x0 * x1 + y0 * y1 + z0 * z1;
+	return 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::fabs(w));
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunQuaternionSelfTest() {
+	std::vector<SelfTestResult> results;
+	std::mt19937 random(777);
+	std::uniform_real_distribution<float> angle(-6.3f, 6.3f);
+	std::uniform_real_distribution<float> largeAngle(-8000.0f, 8000.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto randomEuler = [&]() { return Vector3{ angle(random), angle(random), angle(random) }; };
+	const int kIterations = 10000;
+	const Vector3 one = { 1.0f, 1.0f, 1.0f };
+	const Vector3 zero = { 0.0f, 0.0f, 0.0f };
+
+	// オイラー角から作った回転が、MakeAffineMatrix（Rx * Ry * Rz）と同じ回転になる
+	double eulerError = 0.0, rotateVectorError = 0.0;
+	for (int n = 0; n < kIterations; n++) {
+		const Vector3 rotate = randomEuler();
+		const Quaternion q = MakeQuaternionFromEuler(rotate);
+		const Matrix4x4 expected = MakeAffineMatrix(one, rotate, zero);
+		eulerError = (std::max)(eulerError, RotationDifference(MakeRotateMatrix(q), expected));
+		const Vector3 v = { angle(random), angle(random), angle(random) };
+		const Vector3 rotated = RotateVector(v, q), transformed = TransformDirection(v, expected);
+		const double length = std::sqrt(double(v.x) * v.x + double(v.y) * v.y + double(v.z) * v.z);
+		rotateVectorError = (std::max)(rotateVectorError, (std::max)({ std::fabs(double(rotated.x) - transformed.x),
+			std::fabs(double(rotated.y) - transformed.y), std::fabs(double(rotated.z) - transformed.z) }) / (std::max)(length, 1.0));
+	}
+	AddSelfTestResult(results, "quaternion from Euler matches MakeAffineMatrix", eulerError <= 1e-5,
+		"max element difference " + FormatSelfTestValue(eulerError));
+	AddSelfTestResult(results, "quaternion RotateVector matches TransformDirection", rotateVectorError <= 1e-5,
+		"max relative difference " + FormatSelfTestValue(rotateVectorError));
+
+	// オイラー角に戻して作り直しても同じ回転（角度そのものは一意でないので行列で比べる）
+	// Y=±90°（ジンバルロック）付近も混ぜる
+	double roundTripError = 0.0;
+	const float halfPi = 1.57079637f;
+	for (int n = 0; n < kIterations; n++) {
+		Vector3 rotate = randomEuler();
+		if (n % 4 == 0) {
+			rotate.y = (n % 8 == 0 ? halfPi : -halfPi) + (unit(random) - 0.5f) * 1e-3f;
+		}
+		const Quaternion q = MakeQuaternionFromEuler(rotate);
+		const Vector3 euler = MakeEulerFromQuaternion(q);
+		roundTripError = (std::max)(roundTripError, RotationDifference(MakeAffineMatrix(one, euler, zero), MakeRotateMatrix(q)));
+	}
+	AddSelfTestResult(results, "quaternion Euler round trip (incl. gimbal lock)", roundTripError <= 1e-5,
+		"max element difference " + FormatSelfTestValue(roundTripError));
+
+	// 積は「rhsで回してからlhs」、逆との積は単位
+	double multiplyError = 0.0, inverseError = 0.0;
+	for (int n = 0; n < kIterations; n++) {
+		const Quaternion a = MakeQuaternionFromEuler(randomEuler());
+		const Quaternion b = MakeQuaternionFromEuler(randomEuler());
+		multiplyError = (std::max)(multiplyError,
+			RotationDifference(MakeRotateMatrix(Multiply(a, b)), Multiply(MakeRotateMatrix(b), MakeRotateMatrix(a))));
+		inverseError = (std::max)(inverseError, RotationAngle(Multiply(a, Inverse(a)), IdentityQuaternion()));
+	}
+	AddSelfTestResult(results, "quaternion Multiply/Inverse", multiplyError <= 1e-5 && inverseError <= 1e-5,
+		"composition difference " + FormatSelfTestValue(multiplyError) + ", q*inv(q) angle " + FormatSelfTestValue(inverseError));
+
+	// Slerp: 両端が一致し、長さ1のまま、角度がtに比例し、近い方の経路を通る
+	// Nlerp: 両端が一致し、長さ1のまま、同じ経路を単調に進み、中点はSlerpと同じ
+	double slerpEndpoint = 0.0, slerpNorm = 0.0, slerpRate = 0.0;
+	double nlerpEndpoint = 0.0, nlerpNorm = 0.0, nlerpMidpoint = 0.0;
+	bool nlerpMonotonic = true;
+	for (int n = 0; n < kIterations; n++) {
+		const Quaternion q0 = MakeQuaternionFromEuler(randomEuler());
+		Quaternion q1 = MakeQuaternionFromEuler(randomEuler());
+		if (n % 8 == 0) {
+			// ほぼ同じ向き（線形補間に切り替わる側）
+			q1 = Normalize(Multiply(MakeRotateAxisAngleQuaternion({ 0.0f, 1.0f, 0.0f }, unit(random) * 0.02f), q0));
+		}
+		if (n % 2 == 0) {
+			// 同じ回転の反対側の表現（遠回りしないこと）
+			q1 = { -q1.x, -q1.y, -q1.z, -q1.w };
+		}
+		const double total = RotationAngle(q0, q1);
+		slerpEndpoint = (std::max)({ slerpEndpoint, RotationAngle(Slerp(q0, q1, 0.0f), q0), RotationAngle(Slerp(q0, q1, 1.0f), q1) });
+		nlerpEndpoint = (std::max)({ nlerpEndpoint, RotationAngle(Nlerp(q0, q1, 0.0f), q0), RotationAngle(Nlerp(q0, q1, 1.0f), q1) });
+		nlerpMidpoint = (std::max)(nlerpMidpoint, RotationAngle(Nlerp(q0, q1, 0.5f), Slerp(q0, q1, 0.5f)));
+		double previous = 0.0;
+		for (int step = 1; step < 8; step++) {
+			const float t = step / 8.0f;
+			const Quaternion s = Slerp(q0, q1, t);
+			const Quaternion l = Nlerp(q0, q1, t);
+			slerpNorm = (std::max)(slerpNorm, std::fabs(double(Norm(s)) - 1.0));
+			nlerpNorm = (std::max)(nlerpNorm, std::fabs(double(Norm(l)) - 1.0));
+			// 経路の上にあれば、両端からの角度の和が全体の角度になる
+			slerpRate = (std::max)({ slerpRate, std::fabs(RotationAngle(q0, s) - t * total),
+				std::fabs(RotationAngle(q0, s) + RotationAngle(s, q1) - total) });
+			const double travelled = RotationAngle(q0, l);
+			nlerpMonotonic = nlerpMonotonic && travelled + 1e-5 >= previous && std::fabs(travelled + RotationAngle(l, q1) - total) <= 1e-5;
+			previous = travelled;
+		}
+	}
+	const double kAngleTolerance = 1e-5;
+	AddSelfTestResult(results, "quaternion Slerp", slerpEndpoint <= kAngleTolerance && slerpNorm <= 1e-5 && slerpRate <= kAngleTolerance,
+		"endpoint " + FormatSelfTestValue(slerpEndpoint) + " rad, |norm-1| " + FormatSelfTestValue(slerpNorm) +
+		", angle vs t " + FormatSelfTestValue(slerpRate) + " rad");
+	AddSelfTestResult(results, "quaternion Nlerp", nlerpEndpoint <= kAngleTolerance && nlerpNorm <= 1e-5 && nlerpMonotonic &&
+		nlerpMidpoint <= kAngleTolerance,
+		"endpoint " + FormatSelfTestValue(nlerpEndpoint) + " rad, |norm-1| " + FormatSelfTestValue(nlerpNorm) +
+		", midpoint vs Slerp " + FormatSelfTestValue(nlerpMidpoint) + " rad");
+
+	// まとめて変換した結果は1つずつ変換した結果と近似のsin/cosの誤差の範囲で一致する（端数も通す）
+	const size_t kBatchCount = 4099;
+	std::vector<Vector3> rotates(kBatchCount);
+	for (size_t i = 0; i < kBatchCount; i++) {
+		rotates[i] = (i % 16 == 15) ? Vector3{ largeAngle(random), largeAngle(random), largeAngle(random) } : randomEuler();
+	}
+	std::vector<Quaternion> batch(kBatchCount);
+	MakeQuaternionsFromEuler(rotates.data(), batch.data(), kBatchCount);
+	double batchError = 0.0;
+	for (size_t i = 0; i < kBatchCount; i++) {
+		const Quaternion expected = MakeQuaternionFromEuler(rotates[i]);
+		batchError = (std::max)({ batchError, std::fabs(double(batch[i].x) - expected.x), std::fabs(double(batch[i].y) - expected.y),
+			std::fabs(double(batch[i].z) - expected.z), std::fabs(double(batch[i].w) - expected.w) });
+	}
+	AddSelfTestResult(results, "quaternion MakeQuaternionsFromEuler matches scalar", batchError <= 1e-6,
+		std::to_string(kBatchCount) + " rotations, max component difference " + FormatSelfTestValue(batchError));
+	return results;
+}
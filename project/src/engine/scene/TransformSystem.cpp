@@ -0,0 +1,361 @@
+#include "engine/scene/TransformSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include "engine/math/MathFunctions.h"
+#include "engine/math/MathSimd.h"
+
+namespace {
+
+bool SameVector(const Vector3& a, float x, float y, float z) {
+	return a.x == x && a.y == y && a.z == z;
+}
+
+#if MATH_USE_SSE2
+// 4オブジェクト分の1行（レーン = オブジェクト）を転置して、各オブジェクトの行として書き込む
+inline void StoreTransposedRow(__m128 c0, __m128 c1, __m128 c2, __m128 c3, Matrix4x4* const* targets, size_t count, int row) {
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	if (count == 4) {
+		SimdStoreRow(*targets[0], row, c0);
+		SimdStoreRow(*targets[1], row, c1);
+		SimdStoreRow(*targets[2], row, c2);
+		SimdStoreRow(*targets[3], row, c3);
+		return;
+	}
+	const __m128 rows[4] = { c0, c1, c2, c3 };
+	for (size_t lane = 0; lane < count; lane++) {
+		SimdStoreRow(*targets[lane], row, rows[lane]);
+	}
+}
+
+// World行列の1行（レーン = オブジェクト）× VP。vpはVPの各要素を4レーンに複製したもの
+// Worldの4列目は(0,0,0,1)なので、平行移動の行だけVPの4行目を足す
+inline void StoreWvpRow(__m128 w0, __m128 w1, __m128 w2, const __m128 (*vp)[4], bool translationRow,
+	Matrix4x4* const* targets, size_t count, int row) {
+	__m128 c0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, vp[0][0]), _mm_mul_ps(w1, vp[1][0])), _mm_mul_ps(w2, vp[2][0]));
+	__m128 c1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, vp[0][1]), _mm_mul_ps(w1, vp[1][1])), _mm_mul_ps(w2, vp[2][1]));
+	__m128 c2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, vp[0][2]), _mm_mul_ps(w1, vp[1][2])), _mm_mul_ps(w2, vp[2][2]));
+	__m128 c3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, vp[0][3]), _mm_mul_ps(w1, vp[1][3])), _mm_mul_ps(w2, vp[2][3]));
+	if (translationRow) {
+		c0 = _mm_add_ps(c0, vp[3][0]);
+		c1 = _mm_add_ps(c1, vp[3][1]);
+		c2 = _mm_add_ps(c2, vp[3][2]);
+		c3 = _mm_add_ps(c3, vp[3][3]);
+	}
+	StoreTransposedRow(c0, c1, c2, c3, targets, count, row);
+}
+#endif
+
+} // namespace
+
+TransformSystem::TransformSystem(size_t reserveCount) {
+	scaleX_.reserve(reserveCount);
+	scaleY_.reserve(reserveCount);
+	scaleZ_.reserve(reserveCount);
+	rotateX_.reserve(reserveCount);
+	rotateY_.reserve(reserveCount);
+	rotateZ_.reserve(reserveCount);
+	translateX_.reserve(reserveCount);
+	translateY_.reserve(reserveCount);
+	translateZ_.reserve(reserveCount);
+	dirty_.reserve(reserveCount);
+	dirtyList_.reserve(reserveCount);
+	matrices_.reserve(reserveCount);
+}
+
+TransformSystem::Handle TransformSystem::Create(const Transform& transform) {
+	Handle handle = static_cast<Handle>(matrices_.size());
+	scaleX_.push_back(transform.scale.x);
+	scaleY_.push_back(transform.scale.y);
+	scaleZ_.push_back(transform.scale.z);
+	rotateX_.push_back(transform.rotate.x);
+	rotateY_.push_back(transform.rotate.y);
+	rotateZ_.push_back(transform.rotate.z);
+	translateX_.push_back(transform.translate.x);
+	translateY_.push_back(transform.translate.y);
+	translateZ_.push_back(transform.translate.z);
+	dirty_.push_back(0);
+	matrices_.push_back({ MakeIdentity4x4(), MakeIdentity4x4() });
+	MarkDirty(handle);
+	return handle;
+}
+
+void TransformSystem::SetTransform(Handle handle, const Transform& transform) {
+	SetScale(handle, transform.scale);
+	SetRotate(handle, transform.rotate);
+	SetTranslate(handle, transform.translate);
+}
+
+void TransformSystem::SetScale(Handle handle, const Vector3& scale) {
+	assert(handle < matrices_.size());
+	if (SameVector(scale, scaleX_[handle], scaleY_[handle], scaleZ_[handle])) {
+		return;
+	}
+	scaleX_[handle] = scale.x;
+	scaleY_[handle] = scale.y;
+	scaleZ_[handle] = scale.z;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetRotate(Handle handle, const Vector3& rotate) {
+	assert(handle < matrices_.size());
+	if (SameVector(rotate, rotateX_[handle], rotateY_[handle], rotateZ_[handle])) {
+		return;
+	}
+	rotateX_[handle] = rotate.x;
+	rotateY_[handle] = rotate.y;
+	rotateZ_[handle] = rotate.z;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetTranslate(Handle handle, const Vector3& translate) {
+	assert(handle < matrices_.size());
+	if (SameVector(translate, translateX_[handle], translateY_[handle], translateZ_[handle])) {
+		return;
+	}
+	translateX_[handle] = translate.x;
+	translateY_[handle] = translate.y;
+	translateZ_[handle] = translate.z;
+	MarkDirty(handle);
+}
+
+Transform TransformSystem::GetTransform(Handle handle) const {
+	assert(handle < matrices_.size());
+	return {
+		{ scaleX_[handle], scaleY_[handle], scaleZ_[handle] },
+		{ rotateX_[handle], rotateY_[handle], rotateZ_[handle] },
+		{ translateX_[handle], translateY_[handle], translateZ_[handle] } };
+}
+
+void TransformSystem::MarkDirty(Handle handle) {
+	if (!dirty_[handle]) {
+		dirty_[handle] = 1;
+		dirtyList_.push_back(handle);
+	}
+}
+
+void TransformSystem::Update(const Matrix4x4& viewProjection) {
+	bool viewProjectionChanged =
+		!hasViewProjection_ || std::memcmp(&viewProjection, &viewProjection_, sizeof(Matrix4x4)) != 0;
+
+	if (viewProjectionChanged) {
+		// WVPは全て作り直すので、変更分はWorldだけ計算しておく
+		UpdateWorld(dirtyList_.data(), dirtyList_.size(), viewProjection, false);
+		UpdateAllWvp(viewProjection);
+		lastWvpUpdateCount_ = matrices_.size();
+	} else {
+		UpdateWorld(dirtyList_.data(), dirtyList_.size(), viewProjection, true);
+		lastWvpUpdateCount_ = dirtyList_.size();
+	}
+	lastWorldUpdateCount_ = dirtyList_.size();
+
+	for (uint32_t handle : dirtyList_) {
+		dirty_[handle] = 0;
+	}
+	dirtyList_.clear();
+	viewProjection_ = viewProjection;
+	hasViewProjection_ = true;
+}
+
+void TransformSystem::UpdateWorld(const uint32_t* indices, size_t count, const Matrix4x4& viewProjection, bool writeWvp) {
+#if MATH_USE_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+	__m128 vp[4][4];
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) {
+			vp[row][col] = _mm_set1_ps(viewProjection.m[row][col]);
+		}
+	}
+
+	for (size_t base = 0; base < count; base += 4) {
+		// 端数は最後のオブジェクトを繰り返して埋め、書き込みはしない
+		size_t laneCount = std::min<size_t>(4, count - base);
+		uint32_t id[4];
+		Matrix4x4* worldTargets[4];
+		Matrix4x4* wvpTargets[4];
+		for (size_t lane = 0; lane < 4; lane++) {
+			id[lane] = indices[base + std::min(lane, laneCount - 1)];
+			worldTargets[lane] = &matrices_[id[lane]].World;
+			wvpTargets[lane] = &matrices_[id[lane]].WVP;
+		}
+		// 番号が連続していれば（全体を計算し直すときなど）そのまま読み込む
+		bool contiguous = id[1] == id[0] + 1 && id[2] == id[0] + 2 && id[3] == id[0] + 3;
+		auto gather = [&id, contiguous](const std::vector<float>& values) {
+			if (contiguous) {
+				return _mm_loadu_ps(&values[id[0]]);
+			}
+			return _mm_setr_ps(values[id[0]], values[id[1]], values[id[2]], values[id[3]]);
+		};
+
+		__m128 sx, cx, sy, cy, sz, cz;
+		SimdSinCos(gather(rotateX_), &sx, &cx);
+		SimdSinCos(gather(rotateY_), &sy, &cy);
+		SimdSinCos(gather(rotateZ_), &sz, &cz);
+
+		// MakeAffineMatrixと同じく scale * Rx * (Ry * Rz) を展開する
+		__m128 yz00 = _mm_mul_ps(cy, cz), yz01 = _mm_mul_ps(cy, sz), yz02 = _mm_xor_ps(sy, signMask);
+		__m128 yz10 = _mm_xor_ps(sz, signMask), yz11 = cz;
+		__m128 yz20 = _mm_mul_ps(sy, cz), yz21 = _mm_mul_ps(sy, sz), yz22 = cy;
+		__m128 negSx = _mm_xor_ps(sx, signMask);
+
+		__m128 scaleX = gather(scaleX_);
+		__m128 scaleY = gather(scaleY_);
+		__m128 scaleZ = gather(scaleZ_);
+		__m128 w00 = _mm_mul_ps(scaleX, yz00);
+		__m128 w01 = _mm_mul_ps(scaleX, yz01);
+		__m128 w02 = _mm_mul_ps(scaleX, yz02);
+		__m128 w10 = _mm_mul_ps(scaleY, _mm_add_ps(_mm_mul_ps(cx, yz10), _mm_mul_ps(sx, yz20)));
+		__m128 w11 = _mm_mul_ps(scaleY, _mm_add_ps(_mm_mul_ps(cx, yz11), _mm_mul_ps(sx, yz21)));
+		__m128 w12 = _mm_mul_ps(scaleY, _mm_mul_ps(sx, yz22));
+		__m128 w20 = _mm_mul_ps(scaleZ, _mm_add_ps(_mm_mul_ps(negSx, yz10), _mm_mul_ps(cx, yz20)));
+		__m128 w21 = _mm_mul_ps(scaleZ, _mm_add_ps(_mm_mul_ps(negSx, yz11), _mm_mul_ps(cx, yz21)));
+		__m128 w22 = _mm_mul_ps(scaleZ, _mm_mul_ps(cx, yz22));
+		__m128 w30 = gather(translateX_);
+		__m128 w31 = gather(translateY_);
+		__m128 w32 = gather(translateZ_);
+
+		StoreTransposedRow(w00, w01, w02, zero, worldTargets, laneCount, 0);
+		StoreTransposedRow(w10, w11, w12, zero, worldTargets, laneCount, 1);
+		StoreTransposedRow(w20, w21, w22, zero, worldTargets, laneCount, 2);
+		StoreTransposedRow(w30, w31, w32, one, worldTargets, laneCount, 3);
+
+		if (writeWvp) {
+			StoreWvpRow(w00, w01, w02, vp, false, wvpTargets, laneCount, 0);
+			StoreWvpRow(w10, w11, w12, vp, false, wvpTargets, laneCount, 1);
+			StoreWvpRow(w20, w21, w22, vp, false, wvpTargets, laneCount, 2);
+			StoreWvpRow(w30, w31, w32, vp, true, wvpTargets, laneCount, 3);
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++) {
+		uint32_t handle = indices[i];
+		Transform transform = GetTransform(handle);
+		Matrix4x4 world = MakeAffineMatrix(transform.scale, transform.rotate, transform.translate);
+		matrices_[handle].World = world;
+		if (writeWvp) {
+			matrices_[handle].WVP = Multiply(world, viewProjection);
+		}
+	}
+#endif
+}
+
+void TransformSystem::UpdateAllWvp(const Matrix4x4& viewProjection) {
+#if MATH_USE_SSE2
+	__m128 vp0 = SimdLoadRow(viewProjection, 0);
+	__m128 vp1 = SimdLoadRow(viewProjection, 1);
+	__m128 vp2 = SimdLoadRow(viewProjection, 2);
+	__m128 vp3 = SimdLoadRow(viewProjection, 3);
+	for (TransformationMatrix& matrix : matrices_) {
+		for (int row = 0; row < 4; row++) {
+			SimdStoreRow(matrix.WVP, row, SimdMultiplyRow(SimdLoadRow(matrix.World, row), vp0, vp1, vp2, vp3));
+		}
+	}
+#else
+	for (TransformationMatrix& matrix : matrices_) {
+		matrix.WVP = Multiply(matrix.World, viewProjection);
+	}
+#endif
+}
+
+std::vector<TransformBenchmarkResult> RunTransformBenchmark() {
+	const size_t kObjectCount = 100000;
+	const int kRuns = 10;
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> angle(-3.1f, 3.1f);
+	std::uniform_real_distribution<float> scaleValue(0.5f, 2.0f);
+	std::uniform_real_distribution<float> translateValue(-100.0f, 100.0f);
+	auto randomTransform = [&]() {
+		Transform transform;
+		transform.scale = { scaleValue(random), scaleValue(random), scaleValue(random) };
+		transform.rotate = { angle(random), angle(random), angle(random) };
+		transform.translate = { translateValue(random), translateValue(random), translateValue(random) };
+		return transform;
+	};
+	std::vector<Transform> transforms(kObjectCount);
+	for (Transform& transform : transforms) {
+		transform = randomTransform();
+	}
+	const Matrix4x4 view = InverseAffine(MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { 0.3f, 0.0f, 0.0f }, { 0.0f, 20.0f, -200.0f }));
+	const Matrix4x4 projection = MakePerspectiveFovMatrix(0.45f, 16.0f / 9.0f, 0.1f, 1000.0f);
+	const Matrix4x4 viewProjections[2] = {
+		Multiply(view, projection),
+		Multiply(MakeTranslateMatrix({ 1.0f, 0.0f, 0.0f }), Multiply(view, projection)),
+	};
+
+	// prepareは計測の外で毎回呼ぶ（変更の設定など）。updateの時間の最速を返す
+	auto measure = [&](auto&& prepare, auto&& update) {
+		double best = 0.0;
+		for (int run = 0; run < kRuns; ++run) {
+			prepare(run);
+			auto start = std::chrono::steady_clock::now();
+			update(run);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (run == 0 || milliseconds < best) {
+				best = milliseconds;
+			}
+		}
+		return best;
+	};
+
+	std::vector<TransformBenchmarkResult> results;
+
+	// 従来の経路：オブジェクトごとにWorldを作ってVPを掛ける
+	std::vector<TransformationMatrix> perObject(kObjectCount);
+	TransformBenchmarkResult reference;
+	reference.scenario = "per-object MakeAffineMatrix + Multiply";
+	reference.objectCount = kObjectCount;
+	reference.worldUpdateCount = kObjectCount;
+	reference.wvpUpdateCount = kObjectCount;
+	reference.milliseconds = measure([](int) {}, [&](int run) {
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			perObject[i].World = MakeAffineMatrix(transforms[i].scale, transforms[i].rotate, transforms[i].translate);
+			perObject[i].WVP = Multiply(perObject[i].World, viewProjections[run % 2]);
+		}
+	});
+	results.push_back(reference);
+
+	TransformSystem system(kObjectCount);
+	for (const Transform& transform : transforms) {
+		system.Create(transform);
+	}
+	system.Update(viewProjections[0]);
+	auto addResult = [&](const char* scenario, double milliseconds) {
+		TransformBenchmarkResult result;
+		result.scenario = scenario;
+		result.objectCount = kObjectCount;
+		result.worldUpdateCount = system.GetLastWorldUpdateCount();
+		result.wvpUpdateCount = system.GetLastWvpUpdateCount();
+		result.milliseconds = milliseconds;
+		results.push_back(result);
+	};
+
+	// 全て変更（回転を少しずつ動かす）
+	addResult("all dirty", measure([&](int run) {
+		for (TransformSystem::Handle handle = 0; handle < kObjectCount; ++handle) {
+			Vector3 rotate = transforms[handle].rotate;
+			rotate.y += 0.001f * float(run + 1);
+			system.SetRotate(handle, rotate);
+		}
+	}, [&](int) { system.Update(viewProjections[0]); }));
+
+	// 1%だけ変更
+	addResult("1% dirty", measure([&](int run) {
+		for (TransformSystem::Handle handle = 0; handle < kObjectCount; handle += 100) {
+			Vector3 translate = transforms[handle].translate;
+			translate.x += 0.01f * float(run + 1);
+			system.SetTranslate(handle, translate);
+		}
+	}, [&](int) { system.Update(viewProjections[0]); }));
+
+	// カメラだけ動いた（WorldはキャッシュしたものからWVPだけ作り直す）
+	addResult("view-projection change", measure([](int) {}, [&](int run) { system.Update(viewProjections[(run + 1) % 2]); }));
+
+	// 何も変わっていない
+	addResult("nothing changed", measure([](int) {}, [&](int) { system.Update(viewProjections[kRuns % 2]); }));
+	return results;
+}
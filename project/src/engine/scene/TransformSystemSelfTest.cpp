@@ -0,0 +1,126 @@
+#include "engine/scene/TransformSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "engine/math/MathFunctions.h"
+
+namespace {
+
+// 要素ごとの誤差を、その要素を求める積の絶対値の和に対する割合で測る
+// Worldは scale * R の各行、WVPは |World| * |VP| を基準にする（平行移動の行は打ち消し合う値が大きいため）
+double MatrixError(const Matrix4x4& actual, const Matrix4x4& expected, const Matrix4x4& magnitude) {
+	double error = 0.0;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			double scale = (std::max)(double(magnitude.m[i][j]), 1e-30);
+			error = (std::max)(error, std::fabs(double(actual.m[i][j]) - double(expected.m[i][j])) / scale);
+		}
+	}
+	return error;
+}
+
+Matrix4x4 AbsMatrix(const Matrix4x4& m) {
+	Matrix4x4 result;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			result.m[i][j] = std::fabs(m.m[i][j]);
+		}
+	}
+	return result;
+}
+
+// Worldの各行の大きさ（回転の行はscale、平行移動の行は成分の絶対値の最大）
+Matrix4x4 WorldMagnitude(const Matrix4x4& world) {
+	Matrix4x4 result;
+	for (int i = 0; i < 4; i++) {
+		float largest = 0.0f;
+		for (int j = 0; j < 4; j++) {
+			largest = (std::max)(largest, std::fabs(world.m[i][j]));
+		}
+		for (int j = 0; j < 4; j++) {
+			result.m[i][j] = largest;
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+std::vector<SelfTestResult> RunTransformSystemSelfTest() {
+	std::vector<SelfTestResult> results;
+	std::mt19937 random(2024);
+	std::uniform_real_distribution<float> angle(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> largeAngle(-8000.0f, 8000.0f);
+	std::uniform_real_distribution<float> scaleValue(0.01f, 100.0f);
+	std::uniform_real_distribution<float> translateValue(-1000.0f, 1000.0f);
+	auto randomTransform = [&](bool large) {
+		Transform transform;
+		transform.scale = { scaleValue(random), scaleValue(random), scaleValue(random) };
+		if (large) {
+			transform.rotate = { largeAngle(random), largeAngle(random), largeAngle(random) };
+		} else {
+			transform.rotate = { angle(random), angle(random), angle(random) };
+		}
+		transform.translate = { translateValue(random), translateValue(random), translateValue(random) };
+		return transform;
+	};
+
+	// 4の倍数でない数にして、端数のレーンも通す
+	const size_t kCount = 4099;
+	TransformSystem system(kCount);
+	for (size_t i = 0; i < kCount; i++) {
+		system.Create(randomTransform(i % 16 == 15));
+	}
+	const Matrix4x4 view = InverseAffine(MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { 0.3f, -0.7f, 0.0f }, { 12.0f, 40.0f, -150.0f }));
+	const Matrix4x4 viewProjection = Multiply(view, MakePerspectiveFovMatrix(0.45f, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+	double worldError = 0.0, wvpError = 0.0;
+	auto compareAll = [&](const Matrix4x4& currentViewProjection) {
+		const Matrix4x4 absViewProjection = AbsMatrix(currentViewProjection);
+		for (TransformSystem::Handle handle = 0; handle < system.GetCount(); handle++) {
+			const Transform transform = system.GetTransform(handle);
+			const Matrix4x4 world = MakeAffineMatrix(transform.scale, transform.rotate, transform.translate);
+			const TransformationMatrix& matrix = system.GetMatrix(handle);
+			worldError = (std::max)(worldError, MatrixError(matrix.World, world, WorldMagnitude(world)));
+			wvpError = (std::max)(wvpError, MatrixError(matrix.WVP, Multiply(world, currentViewProjection),
+				Multiply(AbsMatrix(world), absViewProjection)));
+		}
+	};
+
+	system.Update(viewProjection);
+	bool countsValid = system.GetLastWorldUpdateCount() == kCount && system.GetLastWvpUpdateCount() == kCount;
+	compareAll(viewProjection);
+
+	// 一部だけ変える（同じ値を入れたものは計算し直さない）
+	size_t changed = 0;
+	for (TransformSystem::Handle handle = 0; handle < kCount; handle += 7) {
+		system.SetTransform(handle, randomTransform(false));
+		system.SetTranslate(handle + 1, system.GetTransform(handle + 1).translate);
+		changed++;
+	}
+	system.Update(viewProjection);
+	countsValid = countsValid && system.GetLastWorldUpdateCount() == changed && system.GetLastWvpUpdateCount() == changed;
+	compareAll(viewProjection);
+
+	// ビュー射影行列だけ変えたときは、Worldはそのまま全てのWVPを作り直す
+	const Matrix4x4 movedViewProjection = Multiply(MakeTranslateMatrix({ 0.5f, -2.0f, 3.0f }), viewProjection);
+	system.SetRotate(3, { 1.0f, 2.0f, 3.0f });
+	system.Update(movedViewProjection);
+	countsValid = countsValid && system.GetLastWorldUpdateCount() == 1 && system.GetLastWvpUpdateCount() == kCount;
+	compareAll(movedViewProjection);
+
+	system.Update(movedViewProjection);
+	countsValid = countsValid && system.GetLastWorldUpdateCount() == 0 && system.GetLastWvpUpdateCount() == 0;
+
+	const double kTolerance = 1e-5;
+	AddSelfTestResult(results, "transform World matches MakeAffineMatrix", worldError <= kTolerance,
+		std::to_string(kCount) + " objects, max relative error " + FormatSelfTestValue(worldError));
+	AddSelfTestResult(results, "transform WVP matches Multiply(World, VP)", wvpError <= kTolerance,
+		"max relative error " + FormatSelfTestValue(wvpError));
+	AddSelfTestResult(results, "transform dirty tracking", countsValid,
+		"changed " + std::to_string(changed) + " of " + std::to_string(kCount));
+	return results;
+}